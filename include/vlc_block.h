@@ -174,6 +174,23 @@ VLC_API block_t * block_shm_Alloc(void *addr, size_t length) VLC_USED VLC_MALLOC
 VLC_API block_t *block_File(int fd) VLC_USED VLC_MALLOC;
 VLC_API block_t *block_FilePath(const char *) VLC_USED VLC_MALLOC;
 
+/****************************************************************************
+ * Block pools:
+ ****************************************************************************
+ * - block_pool_New : create a pool of recycled blocks of a fixed size
+ * - block_pool_Alloc : get a block of the pool payload size; released blocks
+ *      go back to the pool, and the heap is used when the pool is empty
+ * - block_pool_Release : release the pool (outstanding blocks stay valid)
+ * - block_pool_GetStats : get the number of recycled/heap allocations
+ ****************************************************************************/
+typedef struct block_pool_t block_pool_t;
+
+VLC_API block_pool_t *block_pool_New(size_t size, unsigned count) VLC_USED;
+VLC_API void block_pool_Release(block_pool_t *);
+VLC_API block_t *block_pool_Alloc(block_pool_t *) VLC_USED;
+VLC_API void block_pool_GetStats(block_pool_t *, uint64_t *hits,
+                                 uint64_t *misses);
+
 static inline void block_Cleanup (void *block)
 {
     block_Release ((block_t *)block);
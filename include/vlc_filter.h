@@ -240,6 +240,93 @@ VLC_API int filter_Blend( filter_t *, picture_t *p_dst, int i_dst_x, int i_dst_y
  */
 VLC_API void filter_DeleteBlend( filter_t * );
 
+/**
+ * Slice job callback.
+ *
+ * It processes the lines [i_first, i_end) of the job, and may be called
+ * concurrently for the other lines.
+ */
+typedef void (*filter_slice_cb_t)( filter_t *, void *p_data,
+                                   unsigned i_first, unsigned i_end );
+
+/**
+ * It splits the lines [0, i_lines) into horizontal bands, and processes
+ * them on the shared slice worker threads (and on the calling thread).
+ *
+ * All bands but the last start and end on a multiple of i_align lines.
+ * It returns once all the lines were processed.
+ */
+VLC_API void filter_Slice( filter_t *, unsigned i_lines, unsigned i_align,
+                           filter_slice_cb_t pf_slice, void *p_data );
+
+/**
+ * Slice job callback, for vlc_Slice().
+ */
+typedef void (*vlc_slice_cb_t)( void *p_data, unsigned i_first,
+                                unsigned i_end );
+
+/**
+ * It runs a slice job like filter_Slice(), on behalf of any object, e.g. a
+ * decoder copying pictures out of hardware surfaces.
+ */
+VLC_API void vlc_Slice( vlc_object_t *, unsigned i_lines, unsigned i_align,
+                        vlc_slice_cb_t pf_slice, void *p_data );
+
+/**
+ * It returns how many bands of a slice job may be processed at the same
+ * time, i.e. the slice worker threads and the calling thread.
+ *
+ * A filter can allocate that many band buffers once, when it is opened.
+ */
+VLC_API unsigned vlc_SliceThreads( vlc_object_t * );
+
+/**
+ * It returns the line alignment that a slice of the picture must have, for
+ * the slice to cover whole lines of every plane (i.e. the vertical chroma
+ * subsampling).
+ */
+static inline unsigned filter_SliceAlignment( const picture_t *p_pic )
+{
+    unsigned i_align = 1;
+
+    for( int i = 1; i < p_pic->i_planes; i++ )
+        if( p_pic->p[i].i_lines > 0
+         && (unsigned)(p_pic->p[0].i_lines / p_pic->p[i].i_lines) > i_align )
+            i_align = p_pic->p[0].i_lines / p_pic->p[i].i_lines;
+    return i_align;
+}
+
+/**
+ * It initializes a view of the lines [i_first, i_end) of a picture, in
+ * units of lines of its first plane (the other planes are scaled).
+ *
+ * The view shares the pixels of the picture. It must not be held nor
+ * released, and it is only valid as long as the picture is.
+ */
+static inline void filter_SlicePicture( picture_t *p_view,
+                                        const picture_t *p_pic,
+                                        unsigned i_first, unsigned i_end )
+{
+    *p_view = *p_pic;
+    for( int i = 0; i < p_pic->i_planes; i++ )
+    {
+        const plane_t *p_plane = &p_pic->p[i];
+        unsigned i_plane_first = i_first * p_plane->i_lines
+                               / p_pic->p[0].i_lines;
+        unsigned i_plane_end = i_end * p_plane->i_lines / p_pic->p[0].i_lines;
+
+        if( i_end >= (unsigned)p_pic->p[0].i_visible_lines )
+            i_plane_end = p_plane->i_visible_lines;
+        if( i_plane_end < i_plane_first )
+            i_plane_end = i_plane_first;
+
+        p_view->p[i].p_pixels = p_plane->p_pixels
+                              + (ptrdiff_t)i_plane_first * p_plane->i_pitch;
+        p_view->p[i].i_lines = i_plane_end - i_plane_first;
+        p_view->p[i].i_visible_lines = i_plane_end - i_plane_first;
+    }
+}
+
 /**
  * Create a picture_t *(*)( filter_t *, picture_t * ) compatible wrapper
  * using a void (*)( filter_t *, picture_t *, picture_t * ) function
@@ -260,6 +347,42 @@ VLC_API void filter_DeleteBlend( filter_t * );
         return p_outpic;                                                \
     }
 
+/**
+ * Create a picture_t *(*)( filter_t *, picture_t * ) compatible wrapper
+ * using a void (*)( filter_t *, picture_t *, picture_t *, unsigned )
+ * function, that converts the given number of lines of the pictures.
+ *
+ * The function is called with views of horizontal bands of both pictures
+ * (see filter_Slice()), aligned on the chroma subsampling of both.
+ */
+#define VIDEO_FILTER_WRAPPER_SLICE( name )                              \
+    static void name ## _Slice ( filter_t *p_filter, void *p_data,      \
+                                 unsigned i_first, unsigned i_end )     \
+    {                                                                   \
+        picture_t **pp_pics = p_data;                                   \
+        picture_t src, dst;                                             \
+        filter_SlicePicture( &src, pp_pics[0], i_first, i_end );        \
+        filter_SlicePicture( &dst, pp_pics[1], i_first, i_end );        \
+        name( p_filter, &src, &dst, i_end - i_first );                  \
+    }                                                                   \
+    static picture_t *name ## _Filter ( filter_t *p_filter,             \
+                                        picture_t *p_pic )              \
+    {                                                                   \
+        picture_t *p_outpic = filter_NewPicture( p_filter );            \
+        if( p_outpic )                                                  \
+        {                                                               \
+            picture_t *pp_pics[2] = { p_pic, p_outpic };                \
+            unsigned i_align = filter_SliceAlignment( p_pic );          \
+            if( filter_SliceAlignment( p_outpic ) > i_align )           \
+                i_align = filter_SliceAlignment( p_outpic );            \
+            filter_Slice( p_filter, p_filter->fmt_in.video.i_height,    \
+                          i_align, name ## _Slice, pp_pics );           \
+            picture_CopyProperties( p_outpic, p_pic );                  \
+        }                                                               \
+        picture_Release( p_pic );                                       \
+        return p_outpic;                                                \
+    }
+
 /**
  * Filter chain management API
  * The filter chain management API is used to dynamically construct filters
@@ -351,6 +351,8 @@ struct input_stats_t
     /* Decoders */
     int64_t i_decoded_audio;
     int64_t i_decoded_video;
+    int64_t i_decoder_queued;
+    mtime_t i_decoder_stall;
 
     /* Vout */
     int64_t i_displayed_pictures;
@@ -44,6 +44,9 @@
 #include <vlc_block.h>
 #include <vlc_interrupt.h>
 #include <fcntl.h>
+#ifdef HAVE_RECVMMSG
+# include <sys/socket.h>
+#endif
 
 #define MTU 65535
 
@@ -55,6 +58,10 @@ static void Close( vlc_object_t * );
 
 #define BUFFER_TEXT N_("Receive buffer")
 #define BUFFER_LONGTEXT N_("UDP receive buffer size (bytes)" )
+#define BATCH_TEXT N_("Receive batch")
+#define BATCH_LONGTEXT N_( \
+    "Maximum number of datagrams to receive per system call " \
+    "(1 disables batching)." )
 
 vlc_module_begin ()
     set_shortname( N_("UDP" ) )
@@ -64,6 +71,10 @@ vlc_module_begin ()
 
     add_obsolete_integer( "server-port" ) /* since 2.0.0 */
     add_integer( "udp-buffer", 0x400000, BUFFER_TEXT, BUFFER_LONGTEXT, true )
+#ifdef HAVE_RECVMMSG
+    add_integer_with_range( "udp-batch", 16, 1, 256,
+                            BATCH_TEXT, BATCH_LONGTEXT, true )
+#endif
 
     set_capability( "access", 0 )
     add_shortcut( "udp", "udpstream", "udp4", "udp6" )
@@ -76,8 +87,16 @@ struct access_sys_t
     int fd;
     size_t fifo_size;
     block_fifo_t *fifo;
+    block_pool_t *pool;
     vlc_sem_t semaphore;
     vlc_thread_t thread;
+#ifdef HAVE_RECVMMSG
+    unsigned batch;
+    /* Statistics (only touched by the reader thread until joined) */
+    uint64_t wakeups;
+    uint64_t packets;
+    unsigned max_batch;
+#endif
 };
 
 /*****************************************************************************
@@ -86,6 +105,9 @@ struct access_sys_t
 static block_t *BlockUDP( access_t * );
 static int Control( access_t *, int, va_list );
 static void* ThreadRead( void *data );
+#ifdef HAVE_RECVMMSG
+static void* ThreadReadBatch( void *data );
+#endif
 
 /*****************************************************************************
  * Open: open the socket
@@ -178,13 +200,32 @@ static int Open( vlc_object_t *p_this )
         goto error;
     }
 
+    sys->pool = block_pool_New( MTU, 64 );
+    if( unlikely( sys->pool == NULL ) )
+    {
+        block_FifoRelease( sys->fifo );
+        net_Close( sys->fd );
+        goto error;
+    }
+
     sys->fifo_size = var_InheritInteger( p_access, "udp-buffer");
     vlc_sem_init( &sys->semaphore, 0 );
 
-    if( vlc_clone( &sys->thread, ThreadRead, p_access,
+    void *(*entry)( void * ) = ThreadRead;
+#ifdef HAVE_RECVMMSG
+    sys->batch = var_InheritInteger( p_access, "udp-batch" );
+    sys->wakeups = 0;
+    sys->packets = 0;
+    sys->max_batch = 0;
+    if( sys->batch > 1 )
+        entry = ThreadReadBatch;
+#endif
+
+    if( vlc_clone( &sys->thread, entry, p_access,
                    VLC_THREAD_PRIORITY_INPUT ) )
     {
         vlc_sem_destroy( &sys->semaphore );
+        block_pool_Release( sys->pool );
         block_FifoRelease( sys->fifo );
         net_Close( sys->fd );
 error:
@@ -205,8 +246,21 @@ static void Close( vlc_object_t *p_this )
 
     vlc_cancel( sys->thread );
     vlc_join( sys->thread, NULL );
+#ifdef HAVE_RECVMMSG
+    if( sys->wakeups > 0 )
+        msg_Dbg( p_access, "received %"PRIu64" packets in %"PRIu64" wakeups "
+                 "(%.2f packets per wakeup, max %u)", sys->packets,
+                 sys->wakeups, (double)sys->packets / sys->wakeups,
+                 sys->max_batch );
+#endif
     vlc_sem_destroy( &sys->semaphore );
     block_FifoRelease( sys->fifo );
+
+    uint64_t hits, misses;
+    block_pool_GetStats( sys->pool, &hits, &misses );
+    msg_Dbg( p_access, "block pool: %"PRIu64" recycled, %"PRIu64" allocated",
+             hits, misses );
+    block_pool_Release( sys->pool );
     net_Close( sys->fd );
     free( sys );
 }
@@ -270,7 +324,7 @@ static void* ThreadRead( void *data )
 
     for(;;)
     {
-        block_t *pkt = block_Alloc(MTU);
+        block_t *pkt = block_pool_Alloc(sys->pool);
         if (unlikely(pkt == NULL))
         {   /* OOM - dequeue and discard one packet */
             char dummy;
@@ -310,3 +364,134 @@ static void* ThreadRead( void *data )
 
     return NULL;
 }
+
+#ifdef HAVE_RECVMMSG
+struct udp_ring
+{
+    unsigned count;
+    block_t **blocks;
+    struct mmsghdr *msgs;
+    struct iovec *iovs;
+};
+
+static void ReleaseRing( void *data )
+{
+    struct udp_ring *ring = data;
+
+    for (unsigned i = 0; i < ring->count; i++)
+        if (ring->blocks[i] != NULL)
+            block_Release(ring->blocks[i]);
+    free(ring->blocks);
+    free(ring->msgs);
+    free(ring->iovs);
+}
+
+/* Refills empty ring slots, returns the number of usable leading slots. */
+static unsigned FillRing( struct udp_ring *ring, block_pool_t *pool )
+{
+    unsigned i;
+
+    for (i = 0; i < ring->count; i++)
+    {
+        if (ring->blocks[i] == NULL)
+        {
+            ring->blocks[i] = block_pool_Alloc(pool);
+            if (unlikely(ring->blocks[i] == NULL))
+                break;
+        }
+        ring->iovs[i].iov_base = ring->blocks[i]->p_buffer;
+        ring->iovs[i].iov_len = MTU;
+        memset(&ring->msgs[i], 0, sizeof (ring->msgs[i]));
+        ring->msgs[i].msg_hdr.msg_iov = &ring->iovs[i];
+        ring->msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    return i;
+}
+
+/*****************************************************************************
+ * ThreadReadBatch: Pull up to "udp-batch" packets per system call.
+ *****************************************************************************/
+static void* ThreadReadBatch( void *data )
+{
+    access_t *access = data;
+    access_sys_t *sys = access->p_sys;
+    struct udp_ring ring;
+
+    ring.count = sys->batch;
+    ring.blocks = calloc(ring.count, sizeof (*ring.blocks));
+    ring.msgs = malloc(ring.count * sizeof (*ring.msgs));
+    ring.iovs = malloc(ring.count * sizeof (*ring.iovs));
+    if (unlikely(ring.blocks == NULL || ring.msgs == NULL
+              || ring.iovs == NULL))
+    {
+        ring.count = 0;
+        ReleaseRing(&ring);
+        return ThreadRead(data);
+    }
+
+    vlc_cleanup_push(ReleaseRing, &ring);
+    for (;;)
+    {
+        unsigned slots = FillRing(&ring, sys->pool);
+        if (unlikely(slots == 0))
+        {   /* OOM - dequeue and discard one packet */
+            char dummy;
+            recv(sys->fd, &dummy, 1, 0);
+            continue;
+        }
+
+        int n;
+        do
+        {
+#ifndef LIBVLC_USE_PTHREAD
+            struct pollfd ufd = { .fd = sys->fd, .events = POLLIN };
+            while (poll(&ufd, 1, -1) <= 0); /* cancellation point */
+#endif
+            n = recvmmsg(sys->fd, ring.msgs, slots, MSG_WAITFORONE, NULL);
+        }
+        while (n <= 0);
+
+        sys->wakeups++;
+        sys->packets += n;
+        if ((unsigned)n > sys->max_batch)
+            sys->max_batch = n;
+
+        int canc = vlc_savecancel();
+        block_t *chain = NULL, **pp = &chain;
+        size_t bytes = 0;
+
+        for (int i = 0; i < n; i++)
+        {
+            block_t *pkt = ring.blocks[i];
+
+            ring.blocks[i] = NULL;
+            pkt->i_buffer = ring.msgs[i].msg_len;
+            bytes += pkt->i_buffer;
+            *pp = pkt;
+            pp = &pkt->p_next;
+        }
+
+        vlc_fifo_Lock(sys->fifo);
+        /* Discard old buffers on overflow */
+        while (vlc_fifo_GetCount(sys->fifo) > 0
+            && vlc_fifo_GetBytes(sys->fifo) + bytes > sys->fifo_size)
+            block_Release(vlc_fifo_DequeueUnlocked(sys->fifo));
+
+        vlc_fifo_QueueUnlocked(sys->fifo, chain);
+        vlc_fifo_Unlock(sys->fifo);
+
+        for (int i = 0; i < n; i++)
+            vlc_sem_post(&sys->semaphore);
+
+        /* Move unused preallocated blocks to the front of the ring */
+        for (unsigned i = n; i < ring.count; i++)
+        {
+            ring.blocks[i - n] = ring.blocks[i];
+            ring.blocks[i] = NULL;
+        }
+        vlc_restorecancel(canc);
+    }
+    vlc_cleanup_pop();
+    return NULL;
+}
+#endif
@@ -76,72 +76,58 @@ static ssize_t Read( sout_access_out_t *p_access, block_t *p_buffer )
 /*****************************************************************************
  * Write: standard write on a file descriptor.
  *****************************************************************************/
-static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
-{
-    size_t i_write = 0;
-
-    while( p_buffer )
-    {
-        ssize_t val = write ((intptr_t)p_access->p_sys,
-                             p_buffer->p_buffer, p_buffer->i_buffer);
-        if (val <= 0)
-        {
-            if (errno == EINTR)
-                continue;
-            block_ChainRelease (p_buffer);
-            msg_Err( p_access, "cannot write: %s", vlc_strerror_c(errno) );
-            return -1;
-        }
+#define MAX_IOV 64
 
-        if ((size_t)val >= p_buffer->i_buffer)
-        {
-            block_t *p_next = p_buffer->p_next;
-            block_Release (p_buffer);
-            p_buffer = p_next;
-        }
-        else
-        {
-            p_buffer->p_buffer += val;
-            p_buffer->i_buffer -= val;
-        }
-        i_write += val;
-    }
-    return i_write;
-}
-
-static ssize_t WritePipe(sout_access_out_t *access, block_t *block)
+/* Writes a whole block chain, a batch of blocks per system call. */
+static ssize_t Write(sout_access_out_t *access, block_t *block)
 {
     int fd = (intptr_t)access->p_sys;
     ssize_t total = 0;
 
     while (block != NULL)
     {
-        if (block->i_buffer == 0)
+        struct iovec iov[MAX_IOV];
+        int iovcnt = 0;
+
+        for (block_t *b = block; b != NULL && iovcnt < MAX_IOV; b = b->p_next)
+            if (b->i_buffer > 0)
+            {
+                iov[iovcnt].iov_base = b->p_buffer;
+                iov[iovcnt].iov_len = b->i_buffer;
+                iovcnt++;
+            }
+
+        ssize_t val = 0;
+        if (iovcnt > 0)
+        {
+            val = vlc_writev(fd, iov, iovcnt);
+            if (val <= 0)
+            {
+                if (val < 0 && errno == EINTR)
+                    continue;
+
+                block_ChainRelease(block);
+                msg_Err(access, "cannot write: %s", vlc_strerror_c(errno));
+                return -1;
+            }
+            total += val;
+        }
+
+        /* Release what was written, including empty blocks */
+        while (block != NULL && (size_t)val >= block->i_buffer)
         {
             block_t *next = block->p_next;
+
+            val -= block->i_buffer;
             block_Release(block);
             block = next;
-            continue;
         }
 
-        /* TODO: vectorized I/O with writev() */
-        ssize_t val = vlc_write(fd, block->p_buffer, block->i_buffer);
-        if (val < 0)
+        if (block != NULL)
         {
-            if (errno == EINTR)
-                continue;
-
-            block_ChainRelease(block);
-            msg_Err(access, "cannot write: %s", vlc_strerror_c(errno));
-            total = -1;
-            break;
+            block->p_buffer += val;
+            block->i_buffer -= val;
         }
-
-        total += val;
-
-        assert((size_t)val <= block->i_buffer);
-        block->p_buffer += val;
-        block->i_buffer -= val;
     }
 
     return total;
@@ -354,7 +340,7 @@ static int Open( vlc_object_t *p_this )
 #endif
     else
     {
-        p_access->pf_write = WritePipe;
+        p_access->pf_write = Write;
         p_access->pf_seek = NoSeek;
     }
     p_access->pf_control = Control;
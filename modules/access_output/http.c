@@ -61,6 +61,9 @@ static void Close( vlc_object_t * );
 #define METACUBE_TEXT N_("Metacube")
 #define METACUBE_LONGTEXT N_("Use the Metacube protocol. Needed for streaming " \
                              "to the Cubemap reflector.")
+#define BUFFER_TEXT N_("Buffer size")
+#define BUFFER_LONGTEXT N_("Amount of past stream data (in bytes) kept " \
+                           "for slow clients.")
 
 
 vlc_module_begin ()
@@ -78,6 +81,9 @@ vlc_module_begin ()
                 MIME_TEXT, MIME_LONGTEXT, true )
     add_bool( SOUT_CFG_PREFIX "metacube", false,
               METACUBE_TEXT, METACUBE_LONGTEXT, true )
+    add_integer( SOUT_CFG_PREFIX "buffer", 5000000,
+                 BUFFER_TEXT, BUFFER_LONGTEXT, true )
+        change_integer_range( 65536, 1 << 30 )
     set_callbacks( Open, Close )
 vlc_module_end ()
 
@@ -86,7 +92,7 @@ vlc_module_end ()
  * Exported prototypes
  *****************************************************************************/
 static const char *const ppsz_sout_options[] = {
-    "user", "pwd", "mime", "metacube", NULL
+    "user", "pwd", "mime", "metacube", "buffer", NULL
 };
 
 static ssize_t Write( sout_access_out_t *, block_t * );
@@ -275,6 +281,9 @@ static int Open( vlc_object_t *p_this )
         return VLC_EGENERIC;
     }
 
+    httpd_StreamSetBufferSize( p_sys->p_httpd_stream,
+                          var_GetInteger( p_access, SOUT_CFG_PREFIX "buffer" ) );
+
     if( p_sys->b_metacube )
     {
         httpd_header headers[] = {{ "Content-encoding", "metacube" }};
@@ -50,6 +50,7 @@
 #include <vlc_network.h>
 
 #define MAX_EMPTY_BLOCKS 200
+#define MAX_BATCH_PACKETS 64
 
 /*****************************************************************************
  * Module descriptor
@@ -71,6 +72,12 @@ static void Close( vlc_object_t * );
                           "helps reducing the scheduling load on " \
                           "heavily-loaded systems." )
 
+#define WINDOW_TEXT N_("Pacing window (ms)")
+#define WINDOW_LONGTEXT N_("Packets due within this time window are " \
+                           "coalesced and sent with a single system call. " \
+                           "Packets carrying a clock reference are never " \
+                           "sent early. 0 sends packets one by one." )
+
 vlc_module_begin ()
     set_description( N_("UDP stream output") )
     set_shortname( "UDP" )
@@ -79,6 +86,10 @@ vlc_module_begin ()
     add_integer( SOUT_CFG_PREFIX "caching", DEFAULT_PTS_DELAY / 1000, CACHING_TEXT, CACHING_LONGTEXT, true )
     add_integer( SOUT_CFG_PREFIX "group", 1, GROUP_TEXT, GROUP_LONGTEXT,
                                  true )
+#ifdef HAVE_SENDMMSG
+    add_integer_with_range( SOUT_CFG_PREFIX "window", 0, 0, 100,
+                            WINDOW_TEXT, WINDOW_LONGTEXT, true )
+#endif
 
     set_capability( "sout access", 0 )
     add_shortcut( "udp" )
@@ -92,6 +103,9 @@ vlc_module_end ()
 static const char *const ppsz_sout_options[] = {
     "caching",
     "group",
+#ifdef HAVE_SENDMMSG
+    "window",
+#endif
     NULL
 };
 
@@ -108,6 +122,9 @@ static int  Seek    ( sout_access_out_t *, off_t  );
 static int Control( sout_access_out_t *, int, va_list );
 
 static void* ThreadWrite( void * );
+#ifdef HAVE_SENDMMSG
+static void* ThreadWriteBatch( void * );
+#endif
 static block_t *NewUDPPacket( sout_access_out_t *, mtime_t );
 
 struct sout_access_out_sys_t
@@ -122,6 +139,15 @@ struct sout_access_out_sys_t
     block_t      *p_buffer;
 
     vlc_thread_t  thread;
+#ifdef HAVE_SENDMMSG
+    mtime_t       i_window;
+    block_t      *p_pending;
+
+    /* Statistics (only touched by the writer thread until joined) */
+    uint64_t      i_syscalls;
+    uint64_t      i_packets;
+    uint64_t      i_late;
+#endif
 };
 
 #define DEFAULT_PORT 1234
@@ -214,7 +240,19 @@ static int Open( vlc_object_t *p_this )
     p_sys->p_empty_blocks = block_FifoNew();
     p_sys->p_buffer = NULL;
 
-    if( vlc_clone( &p_sys->thread, ThreadWrite, p_access,
+    void *(*entry)( void * ) = ThreadWrite;
+#ifdef HAVE_SENDMMSG
+    p_sys->i_window = UINT64_C(1000)
+                    * var_GetInteger( p_access, SOUT_CFG_PREFIX "window" );
+    p_sys->p_pending = NULL;
+    p_sys->i_syscalls = 0;
+    p_sys->i_packets = 0;
+    p_sys->i_late = 0;
+    if( p_sys->i_window > 0 )
+        entry = ThreadWriteBatch;
+#endif
+
+    if( vlc_clone( &p_sys->thread, entry, p_access,
                            VLC_THREAD_PRIORITY_HIGHEST ) )
     {
         msg_Err( p_access, "cannot spawn sout access thread" );
@@ -242,6 +280,14 @@ static void Close( vlc_object_t * p_this )
 
     vlc_cancel( p_sys->thread );
     vlc_join( p_sys->thread, NULL );
+#ifdef HAVE_SENDMMSG
+    if( p_sys->p_pending != NULL )
+        block_Release( p_sys->p_pending );
+    if( p_sys->i_syscalls > 0 )
+        msg_Dbg( p_access, "sent %"PRIu64" packets in %"PRIu64" system calls"
+                 ", %"PRIu64" late", p_sys->i_packets, p_sys->i_syscalls,
+                 p_sys->i_late );
+#endif
     block_FifoRelease( p_sys->p_fifo );
     block_FifoRelease( p_sys->p_empty_blocks );
 
@@ -465,3 +511,129 @@ static void* ThreadWrite( void *data )
     }
     return NULL;
 }
+
+#ifdef HAVE_SENDMMSG
+/*****************************************************************************
+ * ThreadWriteBatch: Write all packets due within the pacing window at once.
+ *****************************************************************************/
+static void* ThreadWriteBatch( void *data )
+{
+    sout_access_out_t *p_access = data;
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    block_t *batch[MAX_BATCH_PACKETS];
+    mtime_t dates[MAX_BATCH_PACKETS];
+    struct mmsghdr msgs[MAX_BATCH_PACKETS];
+    struct iovec iovs[MAX_BATCH_PACKETS];
+    const unsigned i_group = var_GetInteger( p_access,
+                                             SOUT_CFG_PREFIX "group" );
+    mtime_t i_date_last = -1;
+    mtime_t i_stats_date = mdate();
+    uint64_t i_stats_syscalls = 0;
+    unsigned i_dropped_packets = 0;
+
+    for (;;)
+    {
+        block_t *p_pk = p_sys->p_pending;
+        mtime_t i_date;
+
+        if( p_pk == NULL )
+            p_pk = block_FifoGet( p_sys->p_fifo );
+        p_sys->p_pending = NULL;
+
+        i_date = p_sys->i_caching + p_pk->i_dts;
+        if( i_date_last > 0 && i_date - i_date_last > 2000000 )
+        {
+            if( !i_dropped_packets )
+                msg_Dbg( p_access, "mmh, hole (%"PRId64" > 2s) -> drop",
+                         i_date - i_date_last );
+
+            block_FifoPut( p_sys->p_empty_blocks, p_pk );
+
+            i_date_last = i_date;
+            i_dropped_packets++;
+            continue;
+        }
+
+        if( i_dropped_packets )
+        {
+            msg_Dbg( p_access, "dropped %i packets", i_dropped_packets );
+            i_dropped_packets = 0;
+        }
+
+        block_cleanup_push( p_pk );
+        mwait( i_date );
+        vlc_cleanup_pop();
+
+        int canc = vlc_savecancel();
+        const mtime_t now = mdate();
+        unsigned n = 0;
+
+        batch[n] = p_pk;
+        dates[n++] = i_date;
+        i_date_last = i_date;
+
+        /* Gather whatever else is due before the end of the window, and
+         * like ThreadWrite(), up to a group of packets already queued even
+         * if they are due later. Clock references must go out on time, so
+         * they end the batch early. */
+        while( n < MAX_BATCH_PACKETS && block_FifoCount( p_sys->p_fifo ) > 0 )
+        {
+            p_pk = block_FifoGet( p_sys->p_fifo );
+            i_date = p_sys->i_caching + p_pk->i_dts;
+
+            if( (n >= i_group && i_date > now + p_sys->i_window)
+             || ((p_pk->i_flags & BLOCK_FLAG_CLOCK) && i_date > now) )
+            {
+                p_sys->p_pending = p_pk;
+                break;
+            }
+            batch[n] = p_pk;
+            dates[n++] = i_date;
+            i_date_last = i_date;
+        }
+
+        for( unsigned i = 0; i < n; i++ )
+        {
+            iovs[i].iov_base = batch[i]->p_buffer;
+            iovs[i].iov_len = batch[i]->i_buffer;
+            memset( &msgs[i], 0, sizeof( msgs[i] ) );
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        for( unsigned i = 0; i < n; )
+        {
+            int val = sendmmsg( p_sys->i_handle, msgs + i, n - i, 0 );
+
+            p_sys->i_syscalls++;
+            if( val == -1 )
+            {   /* skip the offending packet */
+                msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
+                val = 1;
+            }
+            i += val;
+        }
+
+        const mtime_t i_sent = mdate();
+        for( unsigned i = 0; i < n; i++ )
+        {
+            if( i_sent > dates[i] + 20000 )
+                p_sys->i_late++;
+            block_FifoPut( p_sys->p_empty_blocks, batch[i] );
+        }
+        p_sys->i_packets += n;
+
+        if( i_sent - i_stats_date >= CLOCK_FREQ * 10 )
+        {
+            msg_Dbg( p_access, "%.1f system calls per second, %"PRIu64
+                     " late packets so far",
+                     (double)(p_sys->i_syscalls - i_stats_syscalls)
+                     * CLOCK_FREQ / (i_sent - i_stats_date), p_sys->i_late );
+            i_stats_date = i_sent;
+            i_stats_syscalls = p_sys->i_syscalls;
+        }
+        vlc_restorecancel( canc );
+    }
+    return NULL;
+}
+#endif
@@ -446,7 +446,8 @@ static int Create( vlc_va_t *va, AVCodecContext *ctx, enum PixelFormat pix_fmt,
     if (FindFormat(sys))
         goto error;
 
-    if (unlikely(CopyInitCache(&sys->image_cache, ctx->coded_width)))
+    if (unlikely(CopyInitCache(&sys->image_cache, ctx->coded_width,
+                               VLC_OBJECT(va))))
         goto error;
 
     vlc_mutex_init(&sys->lock);
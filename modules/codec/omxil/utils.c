@@ -176,7 +176,8 @@ void ArchitectureSpecificCopyHooks( decoder_t *p_dec, int i_color_format,
     if( i_color_format == OMX_COLOR_FormatYUV420SemiPlanar && vlc_CPU_SSE2() )
     {
         copy_cache_t *p_surface_cache = malloc( sizeof(copy_cache_t) );
-        if( !p_surface_cache || CopyInitCache( p_surface_cache, i_src_stride ) )
+        if( !p_surface_cache || CopyInitCache( p_surface_cache, i_src_stride,
+                                               VLC_OBJECT(p_dec) ) )
         {
             free( p_surface_cache );
             return;
@@ -33,6 +33,7 @@
 #include "logic/AlwaysBestAdaptationLogic.h"
 #include "logic/RateBasedAdaptationLogic.h"
 #include "logic/AlwaysLowestAdaptationLogic.hpp"
+#include "logic/HybridAdaptationLogic.hpp"
 #include "tools/Debug.hpp"
 #include <vlc_stream.h>
 #include <vlc_demux.h>
@@ -451,6 +452,19 @@ AbstractAdaptationLogic *PlaylistManager::createLogic(AbstractAdaptationLogic::L
             conn->setDownloadRateObserver(logic);
             return logic;
         }
+        case AbstractAdaptationLogic::Hybrid:
+        {
+            int width = var_InheritInteger(p_demux, "adaptative-width");
+            int height = var_InheritInteger(p_demux, "adaptative-height");
+            mtime_t target = CLOCK_FREQ * var_InheritInteger(p_demux, "adaptative-readahead");
+            if(target <= 0) /* unlimited read-ahead */
+                target = CLOCK_FREQ * 10;
+            HybridAdaptationLogic *logic =
+                    new (std::nothrow) HybridAdaptationLogic(VLC_OBJECT(p_demux), width, height,
+                                                             new EWMABandwidthEstimator(), target);
+            conn->setDownloadRateObserver(logic);
+            return logic;
+        }
         default:
             return NULL;
     }
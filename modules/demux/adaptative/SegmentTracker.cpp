@@ -48,6 +48,15 @@ SegmentTrackerEvent::SegmentTrackerEvent(const StreamFormat *fmt)
     u.format.f = fmt;
 }
 
+SegmentTrackerEvent::SegmentTrackerEvent(BaseAdaptationSet *set, mtime_t current,
+                                         mtime_t duration)
+{
+    type = BUFFERING_STATE;
+    u.buffering.adaptSet = set;
+    u.buffering.current = current;
+    u.buffering.duration = duration;
+}
+
 SegmentTracker::SegmentTracker(AbstractAdaptationLogic *logic_, BaseAdaptationSet *adaptSet)
 {
     first = true;
@@ -254,6 +263,11 @@ void SegmentTracker::updateSelected()
     }
 }
 
+void SegmentTracker::notifyBufferingLevel(mtime_t current, mtime_t duration)
+{
+    notify(SegmentTrackerEvent(adaptationSet, current, duration));
+}
+
 void SegmentTracker::notify(const SegmentTrackerEvent &event)
 {
     std::list<SegmentTrackerListenerInterface *>::const_iterator it;
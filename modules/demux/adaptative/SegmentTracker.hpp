@@ -58,11 +58,13 @@ namespace adaptative
             SegmentTrackerEvent(SegmentChunk *);
             SegmentTrackerEvent(BaseRepresentation *, BaseRepresentation *);
             SegmentTrackerEvent(const StreamFormat *);
+            SegmentTrackerEvent(BaseAdaptationSet *, mtime_t, mtime_t);
             enum
             {
                 DISCONTINUITY,
                 SWITCHING,
                 FORMATCHANGE,
+                BUFFERING_STATE,
             } type;
             union
             {
@@ -79,6 +81,12 @@ namespace adaptative
                {
                     const StreamFormat *f;
                } format;
+               struct
+               {
+                    BaseAdaptationSet *adaptSet;
+                    mtime_t current; /* downloaded ahead of the reader */
+                    mtime_t duration; /* of the segment, 0 if unknown */
+               } buffering;
             } u;
     };
 
@@ -103,6 +111,7 @@ namespace adaptative
             mtime_t getMinAheadTime() const;
             void registerListener(SegmentTrackerListenerInterface *);
             void updateSelected();
+            void notifyBufferingLevel(mtime_t, mtime_t);
 
         private:
             void notify(const SegmentTrackerEvent &);
@@ -42,6 +42,9 @@ AbstractStream::AbstractStream(demux_t * demux_, const StreamFormat &format_)
     discontinuity = false;
     segmentTracker = NULL;
     pcr = VLC_TS_INVALID;
+    downloadstats.segments = 0;
+    downloadstats.ttfb = 0;
+    downloadstats.stalled = 0;
 
     demuxer = NULL;
     fakeesout = NULL;
@@ -286,7 +289,11 @@ AbstractStream::status AbstractStream::demux(mtime_t nz_deadline, bool send)
 block_t * AbstractStream::readNextBlock()
 {
     if (currentChunk == NULL && !eof)
+    {
         currentChunk = segmentTracker->getNextChunk(!fakeesout->restarting(), connManager);
+        if(currentChunk)
+            currentChunk->setPriority(getDownloadPriority());
+    }
 
     if(discontinuity)
     {
@@ -304,17 +311,15 @@ block_t * AbstractStream::readNextBlock()
     const bool b_segment_head_chunk = (currentChunk->getBytesRead() == 0);
 
     block_t *block = currentChunk->readBlock();
-    if(block == NULL)
-    {
-        delete currentChunk;
-        currentChunk = NULL;
-        return NULL;
-    }
-
-    if (currentChunk->isEmpty())
+    segmentTracker->notifyBufferingLevel(currentChunk->getBufferedDuration(),
+                                         currentChunk->getDuration());
+    if(block == NULL || currentChunk->isEmpty())
     {
+        updateDownloadStats(currentChunk);
         delete currentChunk;
         currentChunk = NULL;
+        if(block == NULL)
+            return NULL;
     }
 
     block = checkBlock(block, b_segment_head_chunk);
@@ -322,6 +327,31 @@ block_t * AbstractStream::readNextBlock()
     return block;
 }
 
+/* Audio underruns are the most audible, subtitles can wait */
+int AbstractStream::getDownloadPriority() const
+{
+    if(fakeesout->hasEsCategory(VIDEO_ES))
+        return AbstractChunkSource::PRIORITY_NORMAL;
+    else if(fakeesout->hasEsCategory(AUDIO_ES))
+        return AbstractChunkSource::PRIORITY_HIGH;
+    else if(fakeesout->hasEsCategory(SPU_ES))
+        return AbstractChunkSource::PRIORITY_LOW;
+    return AbstractChunkSource::PRIORITY_NORMAL;
+}
+
+void AbstractStream::updateDownloadStats(const SegmentChunk *chunk)
+{
+    downloadstats.segments++;
+    downloadstats.ttfb += chunk->getTimeToFirstByte();
+    downloadstats.stalled += chunk->getStallTime();
+    msg_Dbg(p_realdemux, "%s segment %u ttfb %" PRId64 "ms stalled %" PRId64 "ms "
+                         "(avg ttfb %" PRId64 "ms, total stalled %" PRId64 "ms)",
+            description.c_str(), downloadstats.segments,
+            chunk->getTimeToFirstByte() / 1000, chunk->getStallTime() / 1000,
+            downloadstats.ttfb / downloadstats.segments / 1000,
+            downloadstats.stalled / 1000);
+}
+
 bool AbstractStream::setPosition(mtime_t time, bool tryonly)
 {
     if(!demuxer)
@@ -393,6 +423,7 @@ void AbstractStream::trackerEvent(const SegmentTrackerEvent &event)
             break;
 
         case SegmentTrackerEvent::SWITCHING:
+        case SegmentTrackerEvent::BUFFERING_STATE:
         default:
             break;
     }
@@ -91,6 +91,8 @@ namespace adaptative
         virtual bool restartDemux();
 
         virtual void prepareFormatChange();
+        int getDownloadPriority() const;
+        void updateDownloadStats(const SegmentChunk *);
 
         bool discontinuity;
 
@@ -111,6 +113,13 @@ namespace adaptative
         std::string language;
         std::string description;
 
+        struct
+        {
+            unsigned segments;
+            mtime_t ttfb;
+            mtime_t stalled;
+        } downloadstats;
+
         AbstractDemuxer *demuxer;
         AbstractSourceStream *demuxersource;
         FakeESOut *fakeesout; /* to intercept/proxy what is sent from demuxstream */
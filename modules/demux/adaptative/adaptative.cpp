@@ -72,12 +72,22 @@ static void Close   (vlc_object_t *);
 
 #define ADAPT_LOGIC_TEXT N_("Adaptation Logic")
 
+#define ADAPT_DOWNLOADS_TEXT N_("Concurrent downloads")
+#define ADAPT_DOWNLOADS_LONGTEXT N_("Maximum number of segments downloaded at once, " \
+                                    "across all the streams")
+
+#define ADAPT_READAHEAD_TEXT N_("Read-ahead in seconds")
+#define ADAPT_READAHEAD_LONGTEXT N_("Stop downloading a segment once that much " \
+                                    "of it is buffered, 0 for no limit")
+
 static const int pi_logics[] = {AbstractAdaptationLogic::RateBased,
+                                AbstractAdaptationLogic::Hybrid,
                                 AbstractAdaptationLogic::FixedRate,
                                 AbstractAdaptationLogic::AlwaysLowest,
                                 AbstractAdaptationLogic::AlwaysBest};
 
 static const char *const ppsz_logics[] = { N_("Bandwidth Adaptive"),
+                                           N_("Bandwidth and Buffer Adaptive"),
                                            N_("Fixed Bandwidth"),
                                            N_("Lowest Bandwidth/Quality"),
                                            N_("Highest Bandwith/Quality")};
@@ -94,6 +104,9 @@ vlc_module_begin ()
         add_integer( "adaptative-width",  480, ADAPT_WIDTH_TEXT,  ADAPT_WIDTH_TEXT,  true )
         add_integer( "adaptative-height", 360, ADAPT_HEIGHT_TEXT, ADAPT_HEIGHT_TEXT, true )
         add_integer( "adaptative-bw",     250, ADAPT_BW_TEXT,     ADAPT_BW_LONGTEXT,     false )
+        add_integer_with_range( "adaptative-downloads", 3, 1, 16,
+                                ADAPT_DOWNLOADS_TEXT, ADAPT_DOWNLOADS_LONGTEXT, true )
+        add_integer( "adaptative-readahead", 10, ADAPT_READAHEAD_TEXT, ADAPT_READAHEAD_LONGTEXT, true )
         set_callbacks( Open, Close )
 vlc_module_end ()
 
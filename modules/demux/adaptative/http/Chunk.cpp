@@ -97,6 +97,36 @@ bool AbstractChunk::isEmpty() const
     return !source->hasMoreData();
 }
 
+void AbstractChunk::setPriority(int priority)
+{
+    source->setPriority(priority);
+}
+
+void AbstractChunk::setBitrate(size_t bitrate)
+{
+    source->setBitrate(bitrate);
+}
+
+mtime_t AbstractChunk::getTimeToFirstByte() const
+{
+    return source->getTimeToFirstByte();
+}
+
+mtime_t AbstractChunk::getStallTime() const
+{
+    return source->getStallTime();
+}
+
+mtime_t AbstractChunk::getBufferedDuration() const
+{
+    return source->getBufferedDuration();
+}
+
+mtime_t AbstractChunk::getDuration() const
+{
+    return source->getDuration();
+}
+
 block_t * AbstractChunk::readBlock()
 {
     return doRead(0, true);
@@ -116,14 +146,24 @@ HTTPChunkSource::HTTPChunkSource(const std::string& url, HTTPConnectionManager *
 {
     prepared = false;
     eof = false;
+    cancelled = false;
     if(!init(url))
         throw VLC_EGENERIC;
 }
 
 HTTPChunkSource::~HTTPChunkSource()
+{
+    releaseConnection();
+}
+
+/* Hands the connection back to the pool as soon as the reply is read */
+void HTTPChunkSource::releaseConnection()
 {
     if(connection)
-        connection->setUsed(false);
+    {
+        connManager->releaseConnection(connection);
+        connection = NULL;
+    }
 }
 
 bool HTTPChunkSource::init(const std::string &url)
@@ -179,9 +219,10 @@ block_t * HTTPChunkSource::read(size_t readsize)
         return NULL;
     }
 
-    if(consumed == contentLength && consumed > 0)
+    if((consumed == contentLength && consumed > 0) || !connection)
     {
         eof = true;
+        releaseConnection();
         return NULL;
     }
 
@@ -192,6 +233,7 @@ block_t * HTTPChunkSource::read(size_t readsize)
     if(!p_block)
     {
         eof = true;
+        releaseConnection();
         return NULL;
     }
 
@@ -213,6 +255,9 @@ block_t * HTTPChunkSource::read(size_t readsize)
         connManager->updateDownloadRate(p_block->i_buffer, time);
     }
 
+    if(eof || (contentLength && consumed == contentLength))
+        releaseConnection();
+
     return p_block;
 }
 
@@ -221,22 +266,35 @@ bool HTTPChunkSource::prepare()
     if(prepared)
         return true;
 
+    if(!connect(&contentLength))
+        return false;
+    prepared = true;
+
+    return true;
+}
+
+/* Gets a connection and sends the query, returning the content length */
+bool HTTPChunkSource::connect(size_t *pi_length)
+{
     if(!connManager)
         return false;
 
     if(!connection)
     {
-        connection = connManager->getConnection(scheme, hostname, port);
+        connection = connManager->getConnection(scheme, hostname, port,
+                                                path, bytesRange, &cancelled);
         if(!connection)
             return false;
     }
 
     if( connection->query(path, bytesRange) != VLC_SUCCESS )
+    {
+        releaseConnection();
         return false;
+    }
     /* Because we don't know Chunk size at start, we need to get size
            from content length */
-    contentLength = connection->getContentLength();
-    prepared = true;
+    *pi_length = connection->getContentLength();
 
     return true;
 }
@@ -257,10 +315,22 @@ HTTPChunkBufferedSource::HTTPChunkBufferedSource(const std::string& url, HTTPCon
     done = false;
     eof = false;
     downloadstart = 0;
+    ttfb = 0;
+    stalled = 0;
+    bitrate = 0;
+    priority = PRIORITY_NORMAL;
+    waiting = false;
+    throttled = false;
+    held = false;
 }
 
 HTTPChunkBufferedSource::~HTTPChunkBufferedSource()
 {
+    /* don't let a download thread wait for a connection on our behalf,
+     * then no download thread can append to the chain past that point */
+    connManager->cancelWait(&cancelled);
+    connManager->downloader->cancel(this);
+
     vlc_mutex_lock(&lock);
     if(p_head)
     {
@@ -272,8 +342,6 @@ HTTPChunkBufferedSource::~HTTPChunkBufferedSource()
     buffered = 0;
     vlc_mutex_unlock(&lock);
 
-    connManager->downloader->cancel(this);
-
     vlc_cond_destroy(&avail);
     vlc_mutex_destroy(&lock);
 }
@@ -287,22 +355,128 @@ bool HTTPChunkBufferedSource::isDone() const
     return b_done;
 }
 
-void HTTPChunkBufferedSource::bufferize(size_t readsize)
+/* Called by the downloader. Holds back sources which already have
+ * readahead worth of data queued, unless their reader is starving. */
+bool HTTPChunkBufferedSource::canBufferize(mtime_t readahead)
+{
+    vlc_mutex_lock(&lock);
+    throttled = !done && !waiting && bitrate && readahead &&
+                (mtime_t)(buffered * 8 * CLOCK_FREQ / bitrate) >= readahead;
+    bool b_can = !throttled;
+    vlc_mutex_unlock(&lock);
+    return b_can;
+}
+
+bool HTTPChunkBufferedSource::isWaited() const
+{
+    bool b_waited;
+    vlc_mutex_lock(const_cast<vlc_mutex_t *>(&lock));
+    b_waited = waiting;
+    vlc_mutex_unlock(const_cast<vlc_mutex_t *>(&lock));
+    return b_waited;
+}
+
+int HTTPChunkBufferedSource::getPriority() const
+{
+    int i_priority;
+    vlc_mutex_lock(const_cast<vlc_mutex_t *>(&lock));
+    i_priority = priority;
+    vlc_mutex_unlock(const_cast<vlc_mutex_t *>(&lock));
+    return i_priority;
+}
+
+void HTTPChunkBufferedSource::setPriority(int priority_)
+{
+    vlc_mutex_lock(&lock);
+    priority = priority_;
+    vlc_mutex_unlock(&lock);
+}
+
+void HTTPChunkBufferedSource::setBitrate(size_t bitrate_)
 {
     vlc_mutex_lock(&lock);
+    bitrate = bitrate_;
+    vlc_mutex_unlock(&lock);
+}
+
+mtime_t HTTPChunkBufferedSource::getTimeToFirstByte() const
+{
+    mtime_t time;
+    vlc_mutex_lock(const_cast<vlc_mutex_t *>(&lock));
+    time = ttfb;
+    vlc_mutex_unlock(const_cast<vlc_mutex_t *>(&lock));
+    return time;
+}
+
+mtime_t HTTPChunkBufferedSource::getStallTime() const
+{
+    mtime_t time;
+    vlc_mutex_lock(const_cast<vlc_mutex_t *>(&lock));
+    time = stalled;
+    vlc_mutex_unlock(const_cast<vlc_mutex_t *>(&lock));
+    return time;
+}
+
+/* Playback time held in the read cache, from the representation bitrate */
+mtime_t HTTPChunkBufferedSource::getBufferedDuration() const
+{
+    mtime_t time = 0;
+    vlc_mutex_lock(const_cast<vlc_mutex_t *>(&lock));
+    if(bitrate)
+        time = (mtime_t)(buffered * 8 * CLOCK_FREQ / bitrate);
+    vlc_mutex_unlock(const_cast<vlc_mutex_t *>(&lock));
+    return time;
+}
+
+/* Playback time of the whole chunk, known once its data started coming */
+mtime_t HTTPChunkBufferedSource::getDuration() const
+{
+    mtime_t time = 0;
+    vlc_mutex_lock(const_cast<vlc_mutex_t *>(&lock));
+    if(bitrate)
+        time = (mtime_t)(contentLength * 8 * CLOCK_FREQ / bitrate);
+    vlc_mutex_unlock(const_cast<vlc_mutex_t *>(&lock));
+    return time;
+}
+
+/* Waits for data with the lock held. A throttled source gets the downloader
+ * woken up first, as the lock order forbids calling it from the wait. */
+void HTTPChunkBufferedSource::waitData()
+{
+    const mtime_t start = mdate();
+    waiting = true;
+    if(throttled)
+    {
+        throttled = false;
+        vlc_mutex_unlock(&lock);
+        connManager->downloader->wakeUp();
+        vlc_mutex_lock(&lock);
+    }
+    else
+        vlc_cond_wait(&avail, &lock);
+    stalled += mdate() - start;
+}
+
+void HTTPChunkBufferedSource::bufferize(size_t readsize)
+{
+    /* Not locked: the pool can make us wait for a connection, and
+     * prepare() only takes the lock to publish its results */
     if(!prepare())
     {
+        vlc_mutex_lock(&lock);
         done = true;
         vlc_cond_signal(&avail);
         vlc_mutex_unlock(&lock);
         return;
     }
 
+    vlc_mutex_lock(&lock);
+
     if(readsize < HTTPChunkSource::CHUNK_SIZE)
         readsize = HTTPChunkSource::CHUNK_SIZE;
 
-    if(contentLength && readsize > contentLength - buffered)
-        readsize = contentLength - buffered;
+    if(contentLength && readsize > contentLength - buffered - consumed)
+        readsize = contentLength - buffered - consumed;
 
     vlc_mutex_unlock(&lock);
 
@@ -320,6 +494,7 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
     if(ret <= 0)
     {
         block_Release(p_block);
+        releaseConnection();
         vlc_mutex_lock(&lock);
         done = true;
         rate.size = buffered + consumed;
@@ -331,16 +506,23 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
     {
         p_block->i_buffer = (size_t) ret;
         vlc_mutex_lock(&lock);
+        if(buffered + consumed == 0)
+            ttfb = mdate() - downloadstart;
         buffered += p_block->i_buffer;
         block_ChainLastAppend(&pp_tail, p_block);
-        if((size_t) ret < readsize)
+        if((size_t) ret < readsize ||
+           (contentLength && buffered + consumed >= contentLength))
         {
             done = true;
             rate.size = buffered + consumed;
             rate.time = mdate() - downloadstart;
             downloadstart = 0;
         }
+        const bool b_done = done;
         vlc_mutex_unlock(&lock);
+
+        if(b_done)
+            releaseConnection();
     }
 
     if(rate.size)
@@ -351,13 +533,24 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
     vlc_cond_signal(&avail);
 }
 
+/* Only called by the downloading thread, which also owns the connection,
+ * but the readers look at the content length and the start time */
 bool HTTPChunkBufferedSource::prepare()
 {
-    if(!prepared)
-    {
-        downloadstart = mdate();
-        return HTTPChunkSource::prepare();
-    }
+    if(prepared)
+        return true;
+
+    const mtime_t start = mdate();
+    size_t length;
+    if(!connect(&length))
+        return false;
+
+    vlc_mutex_lock(&lock);
+    contentLength = length;
+    downloadstart = start;
+    prepared = true;
+    vlc_mutex_unlock(&lock);
+
     return true;
 }
 
@@ -377,7 +570,8 @@ block_t * HTTPChunkBufferedSource::readBlock()
     vlc_mutex_lock(&lock);
 
     while(!p_head && !done)
-        vlc_cond_wait(&avail, &lock);
+        waitData();
+    waiting = false;
 
     if(!p_head && done)
     {
@@ -402,8 +596,15 @@ block_t * HTTPChunkBufferedSource::readBlock()
     consumed += p_block->i_buffer;
     buffered -= p_block->i_buffer;
 
+    /* room for reading ahead again */
+    const bool b_wakeup = throttled;
+    throttled = false;
+
     vlc_mutex_unlock(&lock);
 
+    if(b_wakeup)
+        connManager->downloader->wakeUp();
+
     return p_block;
 }
 
@@ -412,7 +613,8 @@ block_t * HTTPChunkBufferedSource::read(size_t readsize)
     vlc_mutex_lock(&lock);
 
     while(readsize > buffered && !done)
-        vlc_cond_wait(&avail, &lock);
+        waitData();
+    waiting = false;
 
     block_t *p_block = NULL;
     if(!readsize || !buffered || !(p_block = block_Alloc(readsize)) )
@@ -449,8 +651,14 @@ block_t * HTTPChunkBufferedSource::read(size_t readsize)
     if(copied < readsize)
         eof = true;
 
+    const bool b_wakeup = throttled;
+    throttled = false;
+
     vlc_mutex_unlock(&lock);
 
+    if(b_wakeup)
+        connManager->downloader->wakeUp();
+
     return p_block;
 }
 
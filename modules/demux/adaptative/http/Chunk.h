@@ -51,6 +51,18 @@ namespace adaptative
                 void                setBytesRange   (const BytesRange &);
                 const BytesRange &  getBytesRange   () const;
 
+                /* scheduling hints and transfer stats, for buffered sources */
+                virtual void        setPriority     (int) {}
+                virtual void        setBitrate      (size_t) {}
+                virtual mtime_t     getTimeToFirstByte() const { return 0; }
+                virtual mtime_t     getStallTime    () const { return 0; }
+                virtual mtime_t     getBufferedDuration() const { return 0; }
+                virtual mtime_t     getDuration     () const { return 0; }
+
+                static const int    PRIORITY_HIGH   = 0; /* audio */
+                static const int    PRIORITY_NORMAL = 1; /* video, muxed */
+                static const int    PRIORITY_LOW    = 2; /* subtitles */
+
             protected:
                 size_t              contentLength;
                 BytesRange          bytesRange;
@@ -63,6 +75,12 @@ namespace adaptative
 
                 size_t              getBytesRead            () const;
                 bool                isEmpty                 () const;
+                void                setPriority             (int);
+                void                setBitrate              (size_t);
+                mtime_t             getTimeToFirstByte      () const;
+                mtime_t             getStallTime            () const;
+                mtime_t             getBufferedDuration     () const;
+                mtime_t             getDuration             () const;
 
                 virtual block_t *   readBlock       ();
                 virtual block_t *   read            (size_t);
@@ -91,11 +109,14 @@ namespace adaptative
 
             protected:
                 virtual bool      prepare();
+                bool              connect(size_t *);
+                void              releaseConnection();
                 HTTPConnection     *connection;
                 HTTPConnectionManager *connManager;
                 size_t              consumed; /* read pointer */
                 bool                prepared;
                 bool                eof;
+                bool                cancelled; /* connection pool lock */
 
             private:
                 bool init(const std::string &);
@@ -116,11 +137,20 @@ namespace adaptative
                 virtual block_t *  readBlock       (); /* reimpl */
                 virtual block_t *  read            (size_t); /* reimpl */
                 virtual bool       hasMoreData     () const; /* impl */
+                virtual void       setPriority     (int); /* reimpl */
+                virtual void       setBitrate      (size_t); /* reimpl */
+                virtual mtime_t    getTimeToFirstByte() const; /* reimpl */
+                virtual mtime_t    getStallTime    () const; /* reimpl */
+                virtual mtime_t    getBufferedDuration() const; /* reimpl */
+                virtual mtime_t    getDuration     () const; /* reimpl */
 
             protected:
                 virtual bool       prepare(); /* reimpl */
                 void               bufferize(size_t);
                 bool               isDone() const;
+                bool               canBufferize(mtime_t);
+                bool               isWaited() const;
+                int                getPriority() const;
 
             private:
                 block_t            *p_head; /* read cache buffer */
@@ -129,8 +159,16 @@ namespace adaptative
                 bool                done;
                 bool                eof;
                 mtime_t             downloadstart;
+                mtime_t             ttfb; /* time to first byte */
+                mtime_t             stalled; /* time the reader waited */
+                size_t              bitrate; /* bits/s, 0 if unknown */
+                int                 priority;
+                bool                waiting; /* reader blocked on us */
+                bool                throttled; /* read ahead enough */
+                bool                held; /* being downloaded, downloader lock */
                 vlc_mutex_t         lock;
                 vlc_cond_t          avail;
+                void               waitData();
         };
 
         class HTTPChunk : public AbstractChunk
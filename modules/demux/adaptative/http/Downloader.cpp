@@ -24,30 +24,40 @@
 
 using namespace adaptative::http;
 
-Downloader::Downloader()
+Downloader::Downloader(unsigned maxdownloads_, mtime_t readahead_)
 {
     vlc_mutex_init(&lock);
     vlc_cond_init(&waitcond);
+    vlc_cond_init(&releasecond);
+    maxdownloads = maxdownloads_ ? maxdownloads_ : 1;
+    readahead = readahead_;
     killed = false;
 }
 
 bool Downloader::start()
 {
-    if(vlc_clone(&thread_handle, downloaderThread,
-                 reinterpret_cast<void *>(this), VLC_THREAD_PRIORITY_INPUT))
+    for(unsigned i=0; i<maxdownloads; i++)
     {
-        return false;
+        vlc_thread_t thread_handle;
+        if(vlc_clone(&thread_handle, downloaderThread,
+                     reinterpret_cast<void *>(this), VLC_THREAD_PRIORITY_INPUT))
+            break;
+        thread_handles.push_back(thread_handle);
     }
-    return true;
+    return !thread_handles.empty();
 }
 
 Downloader::~Downloader()
 {
+    vlc_mutex_lock(&lock);
     killed = true;
-    vlc_cond_signal(&waitcond);
-    vlc_join(thread_handle, NULL);
+    vlc_cond_broadcast(&waitcond);
+    vlc_mutex_unlock(&lock);
+    for(size_t i=0; i<thread_handles.size(); i++)
+        vlc_join(thread_handles[i], NULL);
     vlc_mutex_destroy(&lock);
     vlc_cond_destroy(&waitcond);
+    vlc_cond_destroy(&releasecond);
 }
 void Downloader::schedule(HTTPChunkBufferedSource *source)
 {
@@ -60,10 +70,20 @@ void Downloader::schedule(HTTPChunkBufferedSource *source)
 void Downloader::cancel(HTTPChunkBufferedSource *source)
 {
     vlc_mutex_lock(&lock);
+    /* wait for the thread downloading it, if any */
+    while(source->held)
+        vlc_cond_wait(&releasecond, &lock);
     chunks.remove(source);
     vlc_mutex_unlock(&lock);
 }
 
+void Downloader::wakeUp()
+{
+    vlc_mutex_lock(&lock);
+    vlc_cond_broadcast(&waitcond);
+    vlc_mutex_unlock(&lock);
+}
+
 void * Downloader::downloaderThread(void *opaque)
 {
     Downloader *instance = reinterpret_cast<Downloader *>(opaque);
@@ -79,31 +99,62 @@ void Downloader::DownloadSource(HTTPChunkBufferedSource *source)
         source->bufferize(HTTPChunkSource::CHUNK_SIZE);
 }
 
-void Downloader::Run()
+/* Most urgent first: sources a reader is waiting on, then by priority
+ * (audio before video before subtitles), then in scheduling order.
+ * Sources already read ahead enough are left alone. */
+HTTPChunkBufferedSource * Downloader::nextSource()
 {
-    while(1)
+    HTTPChunkBufferedSource *best = NULL;
+    bool bestwaited = false;
+    int bestpriority = 0;
+
+    std::list<HTTPChunkBufferedSource *>::const_iterator it;
+    for(it = chunks.begin(); it != chunks.end(); ++it)
     {
-        vlc_mutex_lock(&lock);
-        if(killed)
-            break;
+        HTTPChunkBufferedSource *source = *it;
+        if(source->held || !source->canBufferize(readahead))
+            continue;
 
-        while(chunks.empty() && !killed)
+        bool waited = source->isWaited();
+        int priority = source->getPriority();
+        if(!best || (waited && !bestwaited) ||
+           (waited == bestwaited && priority < bestpriority))
         {
-            vlc_cond_wait(&waitcond, &lock);
+            best = source;
+            bestwaited = waited;
+            bestpriority = priority;
         }
+    }
 
-        if(killed)
-            break;
+    return best;
+}
 
-        if(!chunks.empty())
+void Downloader::Run()
+{
+    vlc_mutex_lock(&lock);
+    while(!killed)
+    {
+        HTTPChunkBufferedSource *source = nextSource();
+        if(!source)
         {
-            HTTPChunkBufferedSource *source = chunks.front();
-            DownloadSource(source);
-            if(source->isDone())
-                chunks.pop_front();
+            vlc_cond_wait(&waitcond, &lock);
+            continue;
         }
 
+        /* Download a slice without the lock, so that other threads can serve
+         * other sources, and priorities are reconsidered for each slice */
+        source->held = true;
         vlc_mutex_unlock(&lock);
+
+        DownloadSource(source);
+
+        vlc_mutex_lock(&lock);
+        source->held = false;
+        if(source->isDone())
+            chunks.remove(source);
+        else
+            vlc_cond_signal(&waitcond);
+        vlc_cond_broadcast(&releasecond);
     }
     vlc_mutex_unlock(&lock);
 }
@@ -28,6 +28,7 @@
 
 #include <vlc_common.h>
 #include <list>
+#include <vector>
 
 namespace adaptative
 {
@@ -38,20 +39,24 @@ namespace adaptative
         class Downloader
         {
             public:
-                Downloader();
+                Downloader(unsigned, mtime_t);
                 ~Downloader();
                 bool start();
                 void schedule(HTTPChunkBufferedSource *);
                 void cancel(HTTPChunkBufferedSource *);
+                void wakeUp();
 
             private:
                 static void * downloaderThread(void *);
                 void Run();
                 void DownloadSource(HTTPChunkBufferedSource *);
-                vlc_thread_t thread_handle;
+                HTTPChunkBufferedSource * nextSource();
+                std::vector<vlc_thread_t> thread_handles;
+                unsigned     maxdownloads;
+                mtime_t      readahead;
                 vlc_mutex_t  lock;
                 vlc_cond_t   waitcond;
-                vlc_mutex_t  processlock;
+                vlc_cond_t   releasecond;
                 bool         killed;
                 std::list<HTTPChunkBufferedSource *> chunks;
         };
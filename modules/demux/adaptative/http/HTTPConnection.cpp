@@ -26,24 +26,37 @@
 
 using namespace adaptative::http;
 
-HTTPConnection::HTTPConnection(vlc_object_t *stream_, Socket *socket_, bool persistent)
+HTTPConnection::HTTPConnection(vlc_object_t *stream_, Socket *socket_,
+                               const std::string &hostname_, uint16_t port_,
+                               bool persistent_)
 {
     socket = socket_;
     stream = stream_;
+    hostname = hostname_;
+    port = port_;
     psz_useragent = var_InheritString(stream, "http-user-agent");
     bytesRead = 0;
     contentLength = 0;
     queryOk = false;
     retries = 0;
+    persistent = persistent_;
     connectionClose = !persistent;
-    port = 80;
+    requests = 0;
+    idleSince = 0;
+    keepAliveTimeout = 0;
     available = true;
+    vlc_mutex_init(&lock);
+    pipelinable = false;
+    pending = false;
+    sending = false;
+    pendingOrphan = false;
 }
 
 HTTPConnection::~HTTPConnection()
 {
     free(psz_useragent);
     delete socket;
+    vlc_mutex_destroy(&lock);
 }
 
 bool HTTPConnection::compare(const std::string &hostname, uint16_t port, int type) const
@@ -53,13 +66,12 @@ bool HTTPConnection::compare(const std::string &hostname, uint16_t port, int typ
              port == this->port );
 }
 
-bool HTTPConnection::connect(const std::string &hostname, uint16_t port)
+bool HTTPConnection::connect()
 {
     if(!socket->connect(stream, hostname.c_str(), port))
         return false;
 
-    this->hostname = hostname;
-    this->port = port;
+    requests = 0;
 
     return true;
 }
@@ -75,58 +87,184 @@ void HTTPConnection::disconnect()
     bytesRead = 0;
     contentLength = 0;
     bytesRange = BytesRange();
+    closeSocket();
+}
+
+void HTTPConnection::closeSocket()
+{
+    vlc_mutex_lock(&lock);
+    pipelinable = false;
+    pending = false;
+    pendingOrphan = false;
+    requests = 0;
     socket->disconnect();
+    vlc_mutex_unlock(&lock);
 }
 
 int HTTPConnection::query(const std::string &path, const BytesRange &range)
 {
     queryOk = false;
 
-    msg_Dbg(stream, "Retrieving ://%s:%u%s @%zu", hostname.c_str(), port, path.c_str(),
-            range.isValid() ? range.getStartByte() : 0);
+    const bool b_pipelined = takePendingRequest(path, range);
+
+    msg_Dbg(stream, "Retrieving ://%s:%u%s @%zu%s", hostname.c_str(), port, path.c_str(),
+            range.isValid() ? range.getStartByte() : 0, b_pipelined ? " (pipelined)" : "");
 
-    if(!connected() && ( hostname.empty() || !connect(hostname, port) ))
+    if(!b_pipelined && !connected() && ( hostname.empty() || !connect() ))
         return VLC_EGENERIC;
 
+    const bool b_reused = (requests > 0);
+
     bytesRange = range;
+    contentLength = 0;
     if(range.isValid() && range.getEndByte() > 0)
         contentLength = range.getEndByte() - range.getStartByte() + 1;
+    connectionClose = !persistent;
+    keepAliveTimeout = 0;
 
-    std::string header = buildRequestHeader(path);
-    if(connectionClose)
-        header.append("Connection: close\r\n");
-    header.append("\r\n");
-
-    if(!send( header ))
+    if(!b_pipelined && !send( buildRequestHeader(path, range) ))
     {
-        socket->disconnect();
-        if(!connectionClose)
-        {
-            /* server closed connection pipeline after last req. need new */
-            connectionClose = true;
-            return query(path, range);
-        }
-        return VLC_EGENERIC;
+        disconnect();
+        return retryQuery(path, range, b_reused);
     }
 
     int i_ret = parseReply();
     if(i_ret == VLC_SUCCESS)
     {
         queryOk = true;
+        vlc_mutex_lock(&lock);
+        requests++;
+        pipelinable = !connectionClose && contentLength > 0;
+        vlc_mutex_unlock(&lock);
     }
     else if(i_ret == VLC_EGENERIC)
     {
-        socket->disconnect();
-        if(!connectionClose)
-        {
-            connectionClose = true;
-            return query(path, range);
-        }
+        disconnect();
+        return retryQuery(path, range, b_reused);
+    }
+    else
+    {
+        /* the rest of the error reply is still pending */
+        disconnect();
     }
 
     return i_ret;
 }
 
+int HTTPConnection::retryQuery(const std::string &path, const BytesRange &range,
+                               bool b_reused)
+{
+    /* the server most likely dropped that connection while idle */
+    if(b_reused)
+        return query(path, range);
+
+    if(persistent)
+    {
+        /* fails on a fresh connection, don't ask to keep it alive anymore */
+        persistent = false;
+        return query(path, range);
+    }
+
+    return VLC_EGENERIC;
+}
+
+/* Claims the reply to the request sent ahead by the pool. Any other pending
+ * reply would need to be skipped, so the connection is dropped instead. */
+bool HTTPConnection::takePendingRequest(const std::string &path, const BytesRange &range)
+{
+    vlc_mutex_lock(&lock);
+    const bool b_pending = pending;
+    const bool b_match = pendingMatches(path, range);
+    pending = false;
+    vlc_mutex_unlock(&lock);
+
+    if(b_pending && !b_match)
+        disconnect();
+
+    return b_match && connected();
+}
+
+/* lock held */
+bool HTTPConnection::pendingMatches(const std::string &path, const BytesRange &range) const
+{
+    return pending && !pendingOrphan && pendingPath == path &&
+           pendingRange.isValid() == range.isValid() &&
+           pendingRange.getStartByte() == range.getStartByte() &&
+           pendingRange.getEndByte() == range.getEndByte();
+}
+
+bool HTTPConnection::reservePipeline(const std::string &path, const BytesRange &range)
+{
+    bool b_ret = false;
+
+    vlc_mutex_lock(&lock);
+    if(pipelinable && !pending && socket->connected())
+    {
+        pending = true;
+        sending = true;
+        pendingOrphan = false;
+        pendingPath = path;
+        pendingRange = range;
+        b_ret = true;
+    }
+    vlc_mutex_unlock(&lock);
+
+    return b_ret;
+}
+
+/* The request header fits in the socket buffer, so holding the connection
+ * lock while sending it hardly delays closing that socket */
+bool HTTPConnection::sendPipelined()
+{
+    bool b_ret = false;
+
+    vlc_mutex_lock(&lock);
+    /* the reader may have dropped the connection meanwhile */
+    if(pending && socket->connected())
+    {
+        const std::string header = buildRequestHeader(pendingPath, pendingRange);
+        b_ret = socket->send(stream, header.c_str(), header.length());
+        if(!b_ret) /* maybe sent in part, drop it after the current reply */
+            pendingOrphan = true;
+    }
+    sending = false;
+    vlc_mutex_unlock(&lock);
+
+    return b_ret;
+}
+
+bool HTTPConnection::hasPendingRequest() const
+{
+    bool b_pending;
+    vlc_mutex_lock(const_cast<vlc_mutex_t *>(&lock));
+    b_pending = pending || sending;
+    vlc_mutex_unlock(const_cast<vlc_mutex_t *>(&lock));
+    return b_pending;
+}
+
+bool HTTPConnection::hasPendingRequest(const std::string &path, const BytesRange &range) const
+{
+    bool b_pending;
+    vlc_mutex_lock(const_cast<vlc_mutex_t *>(&lock));
+    b_pending = pendingMatches(path, range);
+    vlc_mutex_unlock(const_cast<vlc_mutex_t *>(&lock));
+    return b_pending;
+}
+
+void HTTPConnection::abandonPendingRequest()
+{
+    vlc_mutex_lock(&lock);
+    pendingOrphan = pending;
+    vlc_mutex_unlock(&lock);
+}
+
+bool HTTPConnection::isIdleExpired(mtime_t now, mtime_t timeout) const
+{
+    if(keepAliveTimeout && keepAliveTimeout < timeout)
+        timeout = keepAliveTimeout;
+    return now - idleSince >= timeout;
+}
+
 ssize_t HTTPConnection::read(void *p_buffer, size_t len)
 {
     if( !connected() ||
@@ -151,7 +289,7 @@ ssize_t HTTPConnection::read(void *p_buffer, size_t len)
 
     if(ret < 0 || (size_t)ret < len) /* set EOF */
     {
-        socket->disconnect();
+        closeSocket();
         return ret;
     }
 
@@ -216,7 +354,14 @@ void HTTPConnection::setUsed( bool b )
     available = !b;
     if(available)
     {
-        if(!connectionClose && contentLength == bytesRead )
+        idleSince = mdate();
+
+        vlc_mutex_lock(&lock);
+        const bool b_orphan = pending && pendingOrphan;
+        pipelinable = false;
+        vlc_mutex_unlock(&lock);
+
+        if(!connectionClose && contentLength == bytesRead && !b_orphan)
         {
             queryOk = false;
             bytesRead = 0;
@@ -247,27 +392,46 @@ void HTTPConnection::onHeader(const std::string &key,
     {
         connectionClose = true;
     }
+    else if (key == "Keep-Alive")
+    {
+        size_t pos = value.find("timeout=");
+        if(pos != std::string::npos)
+        {
+            std::istringstream ss(value.substr(pos + 8));
+            unsigned timeout = 0;
+            ss >> timeout;
+            /* don't reuse it right when the server is about to close */
+            if(timeout > 1)
+                keepAliveTimeout = CLOCK_FREQ * (timeout - 1);
+            else if(timeout)
+                keepAliveTimeout = CLOCK_FREQ / 2;
+        }
+    }
 }
 
-std::string HTTPConnection::buildRequestHeader(const std::string &path) const
+std::string HTTPConnection::buildRequestHeader(const std::string &path,
+                                               const BytesRange &range) const
 {
     std::stringstream req;
     req << "GET " << path << " HTTP/1.1\r\n" <<
            "Host: " << hostname << "\r\n" <<
            "Cache-Control: no-cache" << "\r\n" <<
            "User-Agent: " << std::string(psz_useragent) << "\r\n";
-    req << extraRequestHeaders();
+    req << extraRequestHeaders(range);
+    if(!persistent)
+        req << "Connection: close\r\n";
+    req << "\r\n";
     return req.str();
 }
 
-std::string HTTPConnection::extraRequestHeaders() const
+std::string HTTPConnection::extraRequestHeaders(const BytesRange &range) const
 {
     std::stringstream ss;
-    if(bytesRange.isValid())
+    if(range.isValid())
     {
-        ss << "Range: bytes=" << bytesRange.getStartByte() << "-";
-        if(bytesRange.getEndByte())
-            ss << bytesRange.getEndByte();
+        ss << "Range: bytes=" << range.getStartByte() << "-";
+        if(range.getEndByte())
+            ss << range.getEndByte();
         ss << "\r\n";
     }
     return ss.str();
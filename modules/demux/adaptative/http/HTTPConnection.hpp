@@ -42,11 +42,13 @@ namespace adaptative
         class HTTPConnection
         {
             public:
-                HTTPConnection(vlc_object_t *stream, Socket *, bool = false);
+                HTTPConnection(vlc_object_t *stream, Socket *,
+                               const std::string &hostname, uint16_t port,
+                               bool = false);
                 virtual ~HTTPConnection();
 
                 virtual bool    compare     (const std::string &, uint16_t, int) const;
-                virtual bool    connect     (const std::string& hostname, uint16_t port = 80);
+                virtual bool    connect     ();
                 virtual bool    connected   () const;
                 virtual int     query       (const std::string& path, const BytesRange & = BytesRange());
                 virtual bool    send        (const void *buf, size_t size);
@@ -58,14 +60,25 @@ namespace adaptative
                 bool isAvailable () const;
                 void setUsed( bool );
 
+                /* Pool side, while another thread reads the current reply.
+                 * The request is reserved under the pool lock, then sent. */
+                bool reservePipeline( const std::string &path, const BytesRange & = BytesRange() );
+                bool sendPipelined();
+                bool hasPendingRequest() const;
+                bool hasPendingRequest( const std::string &, const BytesRange & ) const;
+                void abandonPendingRequest();
+                bool isIdleExpired( mtime_t now, mtime_t timeout ) const;
+
             protected:
 
                 virtual void    onHeader    (const std::string &line,
                                              const std::string &value);
-                virtual std::string extraRequestHeaders() const;
-                virtual std::string buildRequestHeader(const std::string &path) const;
+                virtual std::string extraRequestHeaders(const BytesRange &) const;
+                virtual std::string buildRequestHeader(const std::string &path,
+                                                       const BytesRange &) const;
 
                 int parseReply();
+                int retryQuery(const std::string &path, const BytesRange &, bool);
                 std::string readLine();
                 std::string hostname;
                 uint16_t port;
@@ -76,13 +89,27 @@ namespace adaptative
                 BytesRange bytesRange;
                 bool available;
 
-                bool                connectionClose;
+                bool                persistent; /* keep-alive policy */
+                bool                connectionClose; /* current reply */
                 bool                queryOk;
+                unsigned            requests; /* replies read on that socket */
+                mtime_t             idleSince;
+                mtime_t             keepAliveTimeout; /* server side, 0 if unknown */
                 int                 retries;
                 static const int    retryCount = 5;
 
             private:
+                void closeSocket();
+                bool takePendingRequest(const std::string &, const BytesRange &);
+                bool pendingMatches(const std::string &, const BytesRange &) const;
                 Socket *socket;
+                vlc_mutex_t lock; /* socket and pipelining state */
+                bool pipelinable; /* reply length known, can queue behind it */
+                bool pending;
+                bool sending; /* reserved, not sent yet */
+                bool pendingOrphan; /* nobody waits for that reply anymore */
+                std::string pendingPath;
+                BytesRange pendingRange;
        };
     }
 }
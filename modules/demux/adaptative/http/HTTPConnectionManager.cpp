@@ -31,6 +31,8 @@
 #include "Downloader.hpp"
 #include <vlc_url.h>
 
+#include <algorithm>
+
 using namespace adaptative::http;
 
 HTTPConnectionManager::HTTPConnectionManager    (vlc_object_t *stream) :
@@ -38,13 +40,19 @@ HTTPConnectionManager::HTTPConnectionManager    (vlc_object_t *stream) :
                        rateObserver             (NULL)
 {
     vlc_mutex_init(&lock);
-    downloader = new (std::nothrow) Downloader();
+    vlc_cond_init(&releasecond);
+    maxConnectionsPerHost = defaultMaxConnectionsPerHost;
+    idleTimeout = defaultIdleTimeout;
+    downloader = new (std::nothrow) Downloader(
+                    var_InheritInteger(stream, "adaptative-downloads"),
+                    var_InheritInteger(stream, "adaptative-readahead") * CLOCK_FREQ);
     downloader->start();
 }
 HTTPConnectionManager::~HTTPConnectionManager   ()
 {
     delete downloader;
     this->closeAllConnections();
+    vlc_cond_destroy(&releasecond);
     vlc_mutex_destroy(&lock);
 }
 
@@ -63,64 +71,247 @@ void HTTPConnectionManager::releaseAllConnections()
         (*it)->setUsed(false);
 }
 
+void HTTPConnectionManager::setMaxConnectionsPerHost(unsigned max)
+{
+    vlc_mutex_lock(&lock);
+    maxConnectionsPerHost = max ? max : 1;
+    vlc_mutex_unlock(&lock);
+}
+
+void HTTPConnectionManager::setIdleTimeout(mtime_t timeout)
+{
+    vlc_mutex_lock(&lock);
+    idleTimeout = timeout;
+    vlc_mutex_unlock(&lock);
+}
+
+/* Closes the connections the servers will soon drop anyway */
+void HTTPConnectionManager::expireIdleConnections(mtime_t now)
+{
+    std::vector<HTTPConnection *>::iterator it = connectionPool.begin();
+    while(it != connectionPool.end())
+    {
+        HTTPConnection *conn = *it;
+        if(conn->isAvailable() && !conn->hasPendingRequest() &&
+           conn->isIdleExpired(now, idleTimeout))
+        {
+            delete conn;
+            it = connectionPool.erase(it);
+        }
+        else ++it;
+    }
+}
+
 HTTPConnection * HTTPConnectionManager::getConnection(const std::string &hostname, uint16_t port, int sockettype)
 {
     std::vector<HTTPConnection *>::const_iterator it;
     for(it = connectionPool.begin(); it != connectionPool.end(); ++it)
     {
         HTTPConnection *conn = *it;
-        if(conn->isAvailable() && conn->compare(hostname, port, sockettype))
+        if(conn->isAvailable() && !conn->hasPendingRequest() &&
+           conn->compare(hostname, port, sockettype))
             return conn;
     }
     return NULL;
 }
 
+unsigned HTTPConnectionManager::countConnections(const std::string &hostname, uint16_t port,
+                                                 int sockettype) const
+{
+    unsigned count = 0;
+    std::vector<HTTPConnection *>::const_iterator it;
+    for(it = connectionPool.begin(); it != connectionPool.end(); ++it)
+        if((*it)->compare(hostname, port, sockettype))
+            count++;
+    return count;
+}
+
+/* Books the request on a busy connection, behind the reply being read.
+ * It is sent without the pool lock. */
+HTTPConnection * HTTPConnectionManager::reservePipeline(const std::string &hostname, uint16_t port,
+                                                        int sockettype, const std::string &path,
+                                                        const BytesRange &range)
+{
+    if(path.empty())
+        return NULL;
+
+    std::vector<HTTPConnection *>::const_iterator it;
+    for(it = connectionPool.begin(); it != connectionPool.end(); ++it)
+    {
+        HTTPConnection *conn = *it;
+        if(!conn->isAvailable() && conn->compare(hostname, port, sockettype) &&
+           conn->reservePipeline(path, range))
+            return conn;
+    }
+    return NULL;
+}
+
+/* Looked up again on every wakeup, as the connection can be dropped
+ * along with our request meanwhile */
+HTTPConnection * HTTPConnectionManager::getPipelinedConnection(const std::string &hostname,
+                                                               uint16_t port, int sockettype,
+                                                               const std::string &path,
+                                                               const BytesRange &range)
+{
+    std::vector<HTTPConnection *>::const_iterator it;
+    for(it = connectionPool.begin(); it != connectionPool.end(); ++it)
+        if((*it)->compare(hostname, port, sockettype) &&
+           (*it)->hasPendingRequest(path, range))
+            return *it;
+    return NULL;
+}
+
 HTTPConnection * HTTPConnectionManager::getConnection(const std::string &scheme,
                                                       const std::string &hostname,
-                                                      uint16_t port)
+                                                      uint16_t port,
+                                                      const std::string &path,
+                                                      const BytesRange &range,
+                                                      const bool *cancelled)
 {
     if((scheme != "http" && scheme != "https") || hostname.empty())
         return NULL;
 
     const int sockettype = (scheme == "https") ? TLSSocket::TLS : Socket::REGULAR;
+    const mtime_t deadline = mdate() + connectionWait;
+    HTTPConnection *conn = NULL;
+    bool b_pipelined = false;
+
     vlc_mutex_lock(&lock);
-    HTTPConnection *conn = getConnection(hostname, port, sockettype);
-    if(!conn)
+    expireIdleConnections(mdate());
+    for(;;)
     {
-        Socket *socket = (sockettype == TLSSocket::TLS) ? new (std::nothrow) TLSSocket()
-                                                        : new (std::nothrow) Socket();
-        if(!socket)
+        if(cancelled && *cancelled)
         {
+            if(b_pipelined)
+            {
+                conn = getPipelinedConnection(hostname, port, sockettype, path, range);
+                if(conn)
+                    conn->abandonPendingRequest();
+            }
             vlc_mutex_unlock(&lock);
             return NULL;
         }
-        /* disable pipelined tls until we have ticket/resume session support */
-        conn = new (std::nothrow) HTTPConnection(stream, socket, sockettype != TLSSocket::TLS);
-        if(!conn)
+
+        if(b_pipelined)
         {
-            delete socket;
-            vlc_mutex_unlock(&lock);
-            return NULL;
+            conn = getPipelinedConnection(hostname, port, sockettype, path, range);
+            if(conn && conn->isAvailable())
+                break;
+            b_pipelined = (conn != NULL);
+            conn = NULL;
         }
 
-        connectionPool.push_back(conn);
+        if(!b_pipelined)
+        {
+            conn = getConnection(hostname, port, sockettype);
+            if(conn || countConnections(hostname, port, sockettype) < maxConnectionsPerHost)
+                break;
+            /* At the host limit: queue our request behind a running one,
+             * then wait for that connection to be handed over */
+            HTTPConnection *busy = reservePipeline(hostname, port, sockettype, path, range);
+            if(busy)
+            {
+                /* the reservation keeps it in the pool meanwhile */
+                vlc_mutex_unlock(&lock);
+                b_pipelined = busy->sendPipelined();
+                vlc_mutex_lock(&lock);
+                if(!b_pipelined) /* others skipped it while reserved */
+                    vlc_cond_broadcast(&releasecond);
+                continue;
+            }
+        }
 
-        if (!conn->connect(hostname, port))
+        if(vlc_cond_timedwait(&releasecond, &lock, deadline))
         {
-            vlc_mutex_unlock(&lock);
-            return NULL;
+            /* Don't stall on a transfer paused by its reader */
+            if(b_pipelined)
+            {
+                conn = getPipelinedConnection(hostname, port, sockettype, path, range);
+                if(conn && conn->isAvailable())
+                    break;
+                if(conn)
+                    conn->abandonPendingRequest();
+            }
+            conn = getConnection(hostname, port, sockettype);
+            if(!conn)
+                msg_Dbg(stream, "no connection to %s released in time, opening one more",
+                        hostname.c_str());
+            break;
         }
     }
 
+    if(conn)
+    {
+        conn->setUsed(true);
+        vlc_mutex_unlock(&lock);
+        return conn;
+    }
+
+    Socket *socket = (sockettype == TLSSocket::TLS) ? new (std::nothrow) TLSSocket()
+                                                    : new (std::nothrow) Socket();
+    if(!socket)
+    {
+        vlc_mutex_unlock(&lock);
+        return NULL;
+    }
+    /* disable pipelined tls until we have ticket/resume session support */
+    conn = new (std::nothrow) HTTPConnection(stream, socket, hostname, port,
+                                             sockettype != TLSSocket::TLS);
+    if(!conn)
+    {
+        delete socket;
+        vlc_mutex_unlock(&lock);
+        return NULL;
+    }
+
+    /* counts against the host limit while connecting */
     conn->setUsed(true);
+    connectionPool.push_back(conn);
     vlc_mutex_unlock(&lock);
+
+    if (!conn->connect())
+    {
+        vlc_mutex_lock(&lock);
+        connectionPool.erase(std::find(connectionPool.begin(), connectionPool.end(), conn));
+        delete conn;
+        vlc_cond_broadcast(&releasecond);
+        vlc_mutex_unlock(&lock);
+        return NULL;
+    }
+
     return conn;
 }
 
+/* Makes a getConnection() call with that flag give up waiting */
+void HTTPConnectionManager::cancelWait(bool *cancelled)
+{
+    vlc_mutex_lock(&lock);
+    *cancelled = true;
+    vlc_cond_broadcast(&releasecond);
+    vlc_mutex_unlock(&lock);
+}
+
+void HTTPConnectionManager::releaseConnection(HTTPConnection *conn)
+{
+    vlc_mutex_lock(&lock);
+    conn->setUsed(false);
+    if(!conn->connected() && !conn->hasPendingRequest())
+    {
+        /* the reply wasn't read through */
+        connectionPool.erase(std::find(connectionPool.begin(), connectionPool.end(), conn));
+        delete conn;
+    }
+    vlc_cond_broadcast(&releasecond);
+    vlc_mutex_unlock(&lock);
+}
+
 void HTTPConnectionManager::updateDownloadRate(size_t size, mtime_t time)
 {
+    /* reported by all download threads */
+    vlc_mutex_lock(&lock);
     if(rateObserver)
         rateObserver->updateDownloadRate(size, time);
+    vlc_mutex_unlock(&lock);
 }
 
 void HTTPConnectionManager::setDownloadRateObserver(IDownloadRateObserver *obs)
@@ -30,6 +30,7 @@
 #endif
 
 #include "../logic/IDownloadRateObserver.h"
+#include "BytesRange.hpp"
 
 #include <vlc_common.h>
 #include <vector>
@@ -51,19 +52,39 @@ namespace adaptative
                 void    closeAllConnections ();
                 HTTPConnection * getConnection(const std::string &scheme,
                                                const std::string &hostname,
-                                               uint16_t port);
+                                               uint16_t port,
+                                               const std::string &path = std::string(),
+                                               const BytesRange & = BytesRange(),
+                                               const bool *cancelled = NULL);
+                void    cancelWait          (bool *cancelled);
+                void    releaseConnection   (HTTPConnection *);
+                void    setMaxConnectionsPerHost(unsigned);
+                void    setIdleTimeout      (mtime_t);
 
                 virtual void updateDownloadRate(size_t, mtime_t); /* reimpl */
                 void setDownloadRateObserver(IDownloadRateObserver *);
                 Downloader *downloader;
 
+                static const unsigned   defaultMaxConnectionsPerHost = 2;
+                static const mtime_t    defaultIdleTimeout = CLOCK_FREQ * 10;
+                static const mtime_t    connectionWait = CLOCK_FREQ;
+
             private:
                 void    releaseAllConnections ();
+                void    expireIdleConnections (mtime_t);
                 vlc_mutex_t                                         lock;
+                vlc_cond_t                                          releasecond;
                 std::vector<HTTPConnection *>                       connectionPool;
                 vlc_object_t                                       *stream;
                 IDownloadRateObserver                              *rateObserver;
+                unsigned                                            maxConnectionsPerHost;
+                mtime_t                                             idleTimeout;
                 HTTPConnection * getConnection(const std::string &hostname, uint16_t port, int);
+                HTTPConnection * reservePipeline(const std::string &hostname, uint16_t port, int,
+                                                 const std::string &path, const BytesRange &);
+                HTTPConnection * getPipelinedConnection(const std::string &hostname, uint16_t port, int,
+                                                        const std::string &path, const BytesRange &);
+                unsigned countConnections(const std::string &hostname, uint16_t port, int) const;
         };
     }
 }
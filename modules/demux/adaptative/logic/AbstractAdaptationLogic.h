@@ -57,7 +57,8 @@ namespace adaptative
                     AlwaysBest,
                     AlwaysLowest,
                     RateBased,
-                    FixedRate
+                    FixedRate,
+                    Hybrid
                 };
         };
     }
@@ -0,0 +1,181 @@
+/*
+ * BandwidthEstimators.cpp
+ *****************************************************************************
+ * Copyright (C) 2016 - VideoLAN and VLC authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "BandwidthEstimators.hpp"
+
+#include <cmath>
+
+using namespace adaptative::logic;
+
+AbstractBandwidthEstimator::AbstractBandwidthEstimator()
+{
+    dlsize = 0;
+    dllength = 0;
+}
+
+AbstractBandwidthEstimator::~AbstractBandwidthEstimator()
+{
+}
+
+void AbstractBandwidthEstimator::push(size_t size, mtime_t time)
+{
+    if(unlikely(time == 0))
+        return;
+    /* Accumulate up to observation window */
+    dllength += time;
+    dlsize += size;
+
+    if(dllength < MINSAMPLE)
+        return;
+
+    addSample(CLOCK_FREQ * dlsize * 8 / dllength, dllength);
+    dlsize = dllength = 0;
+}
+
+VHFBandwidthEstimator::VHFBandwidthEstimator() :
+    AbstractBandwidthEstimator()
+{
+    for(unsigned i=0; i<TOTALOBS; i++) window[i].bw = window[i].diff = 0;
+    window_idx = 0;
+    prevbps = 0;
+    bpsAvg = 0;
+}
+
+size_t VHFBandwidthEstimator::getEstimate() const
+{
+    return bpsAvg;
+}
+
+void VHFBandwidthEstimator::addSample(size_t bps, mtime_t)
+{
+    /* set window value */
+    if(window[0].bw == 0)
+    {
+        for(unsigned i=0; i<TOTALOBS; i++) window[i].bw = bps;
+    }
+    else
+    {
+        window_idx = (window_idx + 1) % TOTALOBS;
+        window[window_idx].bw = bps;
+        window[window_idx].diff = bps >= prevbps ? bps - prevbps : prevbps - bps;
+    }
+
+    /* compute for deltamax */
+    size_t diffsum = 0;
+    size_t omin = SIZE_MAX;
+    size_t omax = 0;
+    for(unsigned i=0; i < TOTALOBS; i++)
+    {
+        /* Find max and min */
+        if(window[i].bw > omax)
+            omax = window[i].bw;
+        if(window[i].bw < omin)
+            omin = window[i].bw;
+        diffsum += window[i].diff;
+    }
+
+    /* Vertical Horizontal Filter / Moving Average
+     *
+     * Bandwith stability during observation window alters the alpha parameter
+     * and then defines how fast we adapt to current bandwidth */
+    const size_t deltamax = omax - omin;
+    double alpha = (diffsum) ? 0.33 * ((double)deltamax / diffsum) : 0.5;
+
+    bpsAvg = alpha * bpsAvg + (1.0 - alpha) * bps;
+    prevbps = bps;
+}
+
+EWMABandwidthEstimator::Average::Average(mtime_t halflife_)
+{
+    halflife = halflife_;
+    estimate = 0.0;
+    weight = 0.0;
+}
+
+void EWMABandwidthEstimator::Average::add(double bps, mtime_t duration)
+{
+    /* longer samples weight more, a sample lasting the
+     * half-life has the same weight as all the previous ones */
+    const double alpha = pow(0.5, (double) duration / halflife);
+    estimate = alpha * estimate + (1.0 - alpha) * bps;
+    weight = alpha * weight + (1.0 - alpha);
+}
+
+double EWMABandwidthEstimator::Average::get() const
+{
+    return (weight > 0.0) ? estimate / weight : 0.0;
+}
+
+EWMABandwidthEstimator::EWMABandwidthEstimator(mtime_t fasthalflife, mtime_t slowhalflife) :
+    AbstractBandwidthEstimator(),
+    fast(fasthalflife),
+    slow(slowhalflife)
+{
+}
+
+size_t EWMABandwidthEstimator::getEstimate() const
+{
+    return __MIN(fast.get(), slow.get());
+}
+
+void EWMABandwidthEstimator::addSample(size_t bps, mtime_t duration)
+{
+    fast.add(bps, duration);
+    slow.add(bps, duration);
+}
+
+HarmonicMeanBandwidthEstimator::HarmonicMeanBandwidthEstimator(unsigned count) :
+    AbstractBandwidthEstimator()
+{
+    maxsamples = __MAX(count, 1);
+    index = 0;
+}
+
+size_t HarmonicMeanBandwidthEstimator::getEstimate() const
+{
+    if(samples.empty())
+        return 0;
+
+    double inverses = 0.0;
+    std::vector<size_t>::const_iterator it;
+    for(it = samples.begin(); it != samples.end(); ++it)
+        inverses += 1.0 / *it;
+
+    return samples.size() / inverses;
+}
+
+void HarmonicMeanBandwidthEstimator::addSample(size_t bps, mtime_t)
+{
+    if(bps == 0) /* stalled, and would zero the mean */
+        bps = 1;
+
+    if(samples.size() < maxsamples)
+    {
+        samples.push_back(bps);
+    }
+    else
+    {
+        samples[index] = bps;
+        index = (index + 1) % maxsamples;
+    }
+}
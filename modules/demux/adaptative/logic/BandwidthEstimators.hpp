@@ -0,0 +1,128 @@
+/*
+ * BandwidthEstimators.hpp
+ *****************************************************************************
+ * Copyright (C) 2016 - VideoLAN and VLC authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef BANDWIDTHESTIMATORS_HPP
+#define BANDWIDTHESTIMATORS_HPP
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vector>
+
+namespace adaptative
+{
+    namespace logic
+    {
+        /* Turns the download rate reports into a throughput estimate.
+         * Reports are accumulated into samples of at least MINSAMPLE
+         * so tiny reads do not skew the estimate. Not thread safe. */
+        class AbstractBandwidthEstimator
+        {
+            public:
+                AbstractBandwidthEstimator();
+                virtual ~AbstractBandwidthEstimator();
+
+                void            push(size_t, mtime_t); /* bytes, time taken */
+                virtual size_t  getEstimate() const = 0; /* bits/s, 0 if unknown */
+
+                static const mtime_t MINSAMPLE = CLOCK_FREQ / 4;
+
+            protected:
+                virtual void    addSample(size_t, mtime_t) = 0; /* bits/s, duration */
+
+            private:
+                size_t          dlsize;
+                mtime_t         dllength;
+        };
+
+        /* Moving average which weight is set by a vertical horizontal
+         * filter over the last samples: the more stable the bandwidth,
+         * the faster it follows. */
+        class VHFBandwidthEstimator : public AbstractBandwidthEstimator
+        {
+            public:
+                VHFBandwidthEstimator();
+                virtual size_t  getEstimate() const; /* impl */
+
+            protected:
+                virtual void    addSample(size_t, mtime_t); /* impl */
+
+            private:
+                static const unsigned   TOTALOBS = 10;
+                struct
+                {
+                    size_t bw;
+                    size_t diff;
+                } window[TOTALOBS];
+                unsigned                window_idx;
+                size_t                  prevbps;
+                size_t                  bpsAvg;
+        };
+
+        /* Pair of exponentially weighted moving averages with half-lives
+         * in download time, keeping the lowest: drops are followed fast
+         * while increases need to last. */
+        class EWMABandwidthEstimator : public AbstractBandwidthEstimator
+        {
+            public:
+                EWMABandwidthEstimator(mtime_t = 2 * CLOCK_FREQ, mtime_t = 5 * CLOCK_FREQ);
+                virtual size_t  getEstimate() const; /* impl */
+
+            protected:
+                virtual void    addSample(size_t, mtime_t); /* impl */
+
+            private:
+                class Average
+                {
+                    public:
+                        Average(mtime_t);
+                        void   add(double, mtime_t);
+                        double get() const;
+
+                    private:
+                        mtime_t halflife;
+                        double  estimate;
+                        double  weight; /* unbiases the early estimates */
+                };
+                Average fast;
+                Average slow;
+        };
+
+        /* Harmonic mean of the last samples, which outliers above
+         * the mean barely move. */
+        class HarmonicMeanBandwidthEstimator : public AbstractBandwidthEstimator
+        {
+            public:
+                HarmonicMeanBandwidthEstimator(unsigned = 5);
+                virtual size_t  getEstimate() const; /* impl */
+
+            protected:
+                virtual void    addSample(size_t, mtime_t); /* impl */
+
+            private:
+                std::vector<size_t> samples;
+                unsigned        maxsamples;
+                unsigned        index;
+        };
+    }
+}
+
+#endif // BANDWIDTHESTIMATORS_HPP
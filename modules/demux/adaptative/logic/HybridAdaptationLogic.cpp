@@ -0,0 +1,155 @@
+/*
+ * HybridAdaptationLogic.cpp
+ *****************************************************************************
+ * Copyright (C) 2016 - VideoLAN and VLC authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "HybridAdaptationLogic.hpp"
+
+#include "../playlist/BaseRepresentation.h"
+#include "../playlist/BaseAdaptationSet.h"
+#include "../tools/Debug.hpp"
+
+#include <algorithm>
+
+using namespace adaptative::logic;
+
+HybridAdaptationLogic::AdaptationState::AdaptationState(mtime_t target) :
+    selector(target)
+{
+    level = 0;
+    duration = 0;
+}
+
+HybridAdaptationLogic::HybridAdaptationLogic(vlc_object_t *p_obj_, int w, int h,
+                                             AbstractBandwidthEstimator *estimator_,
+                                             mtime_t target_) :
+    AbstractAdaptationLogic()
+{
+    width = w;
+    height = h;
+    usedBps = 0;
+    target = target_;
+    p_obj = p_obj_;
+    estimator = estimator_;
+    vlc_mutex_init(&lock);
+}
+
+HybridAdaptationLogic::~HybridAdaptationLogic()
+{
+    delete estimator;
+    vlc_mutex_destroy(&lock);
+}
+
+static bool bandwidthLess(const BaseRepresentation *a, const BaseRepresentation *b)
+{
+    return a->getBandwidth() < b->getBandwidth();
+}
+
+HybridAdaptationLogic::AdaptationState &
+HybridAdaptationLogic::getState(const BaseAdaptationSet *adaptSet) const
+{
+    std::map<const BaseAdaptationSet *, AdaptationState>::iterator it = states.find(adaptSet);
+    if(it == states.end())
+        it = states.insert(std::make_pair(adaptSet, AdaptationState(target))).first;
+    return it->second;
+}
+
+BaseRepresentation *HybridAdaptationLogic::getNextRepresentation(BaseAdaptationSet *adaptSet, BaseRepresentation *currep) const
+{
+    if(adaptSet == NULL)
+        return NULL;
+
+    /* subset matching WxH */
+    std::vector<BaseRepresentation *> reps;
+    std::vector<BaseRepresentation *>::const_iterator repIt;
+    for(repIt=adaptSet->getRepresentations().begin(); repIt!=adaptSet->getRepresentations().end(); ++repIt)
+    {
+        if((*repIt)->getWidth() == width && (*repIt)->getHeight() == height)
+            reps.push_back(*repIt);
+    }
+    if(reps.empty())
+        reps = adaptSet->getRepresentations();
+    if(reps.empty())
+        return NULL;
+
+    std::stable_sort(reps.begin(), reps.end(), bandwidthLess);
+
+    std::vector<uint64_t> bitrates;
+    unsigned current = reps.size();
+    for(unsigned i=0; i<reps.size(); i++)
+    {
+        bitrates.push_back(reps[i]->getBandwidth());
+        if(reps[i] == currep)
+            current = i;
+    }
+
+    vlc_mutex_lock(const_cast<vlc_mutex_t *>(&lock));
+
+    size_t availBps = estimator->getEstimate() + ((currep) ? currep->getBandwidth() : 0);
+    if(availBps > usedBps)
+        availBps -= usedBps;
+    else
+        availBps = 0;
+
+    AdaptationState &state = getState(adaptSet);
+    state.selector.setTarget((state.duration > 0) ? __MIN(target, state.duration) : target);
+    unsigned index = state.selector.select(bitrates, current, state.level, availBps);
+
+    BwDebug(msg_Info(p_obj, "Buffered %" PRId64 "ms, %zu KiB/s available, %s %" PRIu64 " KiB/s",
+                     state.level / 1000, availBps / 8192,
+                     state.selector.isBufferBased() ? "buffer picks" : "rate picks",
+                     bitrates[index] / 8192));
+    state.level = 0;
+
+    vlc_mutex_unlock(const_cast<vlc_mutex_t *>(&lock));
+
+    return reps[index];
+}
+
+void HybridAdaptationLogic::updateDownloadRate(size_t size, mtime_t time)
+{
+    vlc_mutex_lock(&lock);
+    estimator->push(size, time);
+    vlc_mutex_unlock(&lock);
+}
+
+void HybridAdaptationLogic::trackerEvent(const SegmentTrackerEvent &event)
+{
+    if(event.type == SegmentTrackerEvent::SWITCHING)
+    {
+        vlc_mutex_lock(&lock);
+        if(event.u.switching.prev)
+            usedBps -= event.u.switching.prev->getBandwidth();
+        if(event.u.switching.next)
+            usedBps += event.u.switching.next->getBandwidth();
+        vlc_mutex_unlock(&lock);
+    }
+    else if(event.type == SegmentTrackerEvent::BUFFERING_STATE)
+    {
+        vlc_mutex_lock(&lock);
+        AdaptationState &state = getState(event.u.buffering.adaptSet);
+        if(event.u.buffering.current > state.level)
+            state.level = event.u.buffering.current;
+        if(event.u.buffering.duration > 0)
+            state.duration = event.u.buffering.duration;
+        vlc_mutex_unlock(&lock);
+    }
+}
@@ -0,0 +1,73 @@
+/*
+ * HybridAdaptationLogic.hpp
+ *****************************************************************************
+ * Copyright (C) 2016 - VideoLAN and VLC authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef HYBRIDADAPTATIONLOGIC_HPP
+#define HYBRIDADAPTATIONLOGIC_HPP
+
+#include "AbstractAdaptationLogic.h"
+#include "BandwidthEstimators.hpp"
+#include "HybridSelector.hpp"
+
+#include <map>
+
+namespace adaptative
+{
+    namespace logic
+    {
+        /* Throughput and buffer occupancy logic, see HybridSelector.
+         * The buffer level of each adaptation set is the most the segment
+         * downloads got ahead of the reader since the previous decision.
+         * Segments are fetched one at a time, so the target is capped by
+         * the segment duration. */
+        class HybridAdaptationLogic : public AbstractAdaptationLogic
+        {
+            public:
+                HybridAdaptationLogic(vlc_object_t *, int, int,
+                                      AbstractBandwidthEstimator *, mtime_t);
+                virtual ~HybridAdaptationLogic();
+
+                BaseRepresentation *getNextRepresentation(BaseAdaptationSet *, BaseRepresentation *) const;
+                virtual void updateDownloadRate(size_t, mtime_t); /* reimpl */
+                virtual void trackerEvent(const SegmentTrackerEvent &); /* reimpl */
+
+            private:
+                class AdaptationState
+                {
+                    public:
+                        AdaptationState(mtime_t);
+                        HybridSelector selector;
+                        mtime_t        level;
+                        mtime_t        duration; /* of the last segment */
+                };
+                AdaptationState & getState(const BaseAdaptationSet *) const;
+
+                int                     width;
+                int                     height;
+                size_t                  usedBps;
+                mtime_t                 target;
+                vlc_object_t *          p_obj;
+                AbstractBandwidthEstimator *estimator;
+                mutable std::map<const BaseAdaptationSet *, AdaptationState> states;
+
+                vlc_mutex_t             lock;
+        };
+    }
+}
+
+#endif // HYBRIDADAPTATIONLOGIC_HPP
@@ -0,0 +1,119 @@
+/*
+ * HybridSelector.cpp
+ *****************************************************************************
+ * Copyright (C) 2016 - VideoLAN and VLC authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "HybridSelector.hpp"
+
+#include <cmath>
+
+using namespace adaptative::logic;
+
+HybridSelector::HybridSelector(mtime_t target_)
+{
+    setTarget(target_);
+    bufferbased = false;
+}
+
+void HybridSelector::setTarget(mtime_t target_)
+{
+    target = __MAX(target_, CLOCK_FREQ);
+    minimum = target / 2;
+}
+
+bool HybridSelector::isBufferBased() const
+{
+    return bufferbased;
+}
+
+unsigned HybridSelector::select(const std::vector<uint64_t> &bitrates, unsigned current,
+                                mtime_t level, uint64_t bandwidth)
+{
+    if(bitrates.empty())
+        return 0;
+
+    if(bufferbased && level < target / 4)
+        bufferbased = false;
+    else if(!bufferbased && level >= minimum)
+        bufferbased = true;
+
+    /* the downloads barely kept ahead of the reader: no room to hold on */
+    if(!bufferbased)
+        return selectByRate(bitrates, bitrates.size(), bandwidth);
+
+    /* the buffer can only keep the current one above the throughput pick */
+    const unsigned byrate = selectByRate(bitrates, current, bandwidth);
+    if(current >= bitrates.size())
+        return byrate;
+    const unsigned bybuffer = selectByBuffer(bitrates, level);
+    return __MAX(byrate, __MIN(bybuffer, current));
+}
+
+/* Highest bitrate within 3/4 of the bandwidth, but keeps
+ * the current one as long as it fits in 9/10 */
+unsigned HybridSelector::selectByRate(const std::vector<uint64_t> &bitrates, unsigned current,
+                                      uint64_t bandwidth)
+{
+    unsigned index = 0;
+    for(unsigned i=1; i<bitrates.size(); i++)
+    {
+        if(bitrates[i] * 4 <= bandwidth * 3)
+            index = i;
+    }
+
+    if(current < bitrates.size() && index < current &&
+       bitrates[current] * 10 <= bandwidth * 9)
+        index = current;
+
+    return index;
+}
+
+/* BOLA: maximizes (V * (utility + gamma * p) - buffer) / size, with the
+ * utility being the log of the bitrate ratio to the lowest one, and the
+ * V and gamma * p parameters set so the lowest bitrate is picked with
+ * less than the minimum buffering, and the highest one at the target. */
+unsigned HybridSelector::selectByBuffer(const std::vector<uint64_t> &bitrates,
+                                        mtime_t level) const
+{
+    const double lowest = __MAX(bitrates.front(), 1);
+    const double highest = log(__MAX(bitrates.back(), 1) / lowest) + 1.0;
+    const double gp = (highest - 1.0) / ((double) target / minimum - 1.0);
+    if(gp <= 0.0)
+        return 0;
+    const double vp = (double) minimum / CLOCK_FREQ / gp;
+    const double buffer = (double) level / CLOCK_FREQ;
+
+    unsigned index = 0;
+    double best = 0.0;
+    for(unsigned i=0; i<bitrates.size(); i++)
+    {
+        const double bitrate = __MAX(bitrates[i], 1);
+        const double utility = log(bitrate / lowest) + 1.0;
+        const double score = (vp * (utility + gp) - buffer) / bitrate;
+        if(i == 0 || score >= best)
+        {
+            index = i;
+            best = score;
+        }
+    }
+
+    return index;
+}
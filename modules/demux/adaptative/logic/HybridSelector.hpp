@@ -0,0 +1,65 @@
+/*
+ * HybridSelector.hpp
+ *****************************************************************************
+ * Copyright (C) 2016 - VideoLAN and VLC authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef HYBRIDSELECTOR_HPP
+#define HYBRIDSELECTOR_HPP
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vector>
+
+namespace adaptative
+{
+    namespace logic
+    {
+        /* Decision part of the hybrid logic, independent of the playlist:
+         * works on indexes in the ascending list of the representations
+         * bitrates, an index out of range meaning no current one.
+         *
+         * Below half the buffering target, picks from the throughput.
+         * Once there, and until the buffer falls under a quarter of the
+         * target, the throughput pick gets a margin to switch up and a
+         * smaller one to stay (hysteresis), and the BOLA buffer based
+         * utility can keep the current representation above it. BOLA never
+         * picks below the throughput, nor switches up (BOLA-O). */
+        class HybridSelector
+        {
+            public:
+                HybridSelector(mtime_t);
+                void     setTarget(mtime_t);
+
+                unsigned select(const std::vector<uint64_t> &, unsigned,
+                                mtime_t, uint64_t);
+                bool     isBufferBased() const;
+
+                static unsigned selectByRate(const std::vector<uint64_t> &, unsigned, uint64_t);
+                unsigned selectByBuffer(const std::vector<uint64_t> &, mtime_t) const;
+
+            private:
+                mtime_t  target;
+                mtime_t  minimum;
+                bool     bufferbased;
+        };
+    }
+}
+
+#endif // HYBRIDSELECTOR_HPP
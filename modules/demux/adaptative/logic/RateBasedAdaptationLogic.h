@@ -26,6 +26,7 @@
 #define RATEBASEDADAPTATIONLOGIC_H_
 
 #include "AbstractAdaptationLogic.h"
+#include "BandwidthEstimators.hpp"
 
 namespace adaptative
 {
@@ -50,17 +51,7 @@ namespace adaptative
                 size_t                  usedBps;
                 vlc_object_t *          p_obj;
 
-                static const unsigned   TOTALOBS = 10;
-                struct
-                {
-                    size_t bw;
-                    size_t diff;
-                } window[TOTALOBS];
-                unsigned                window_idx;
-                size_t                  prevbps;
-
-                size_t                  dlsize;
-                mtime_t                 dllength;
+                VHFBandwidthEstimator   estimator;
 
                 vlc_mutex_t             lock;
         };
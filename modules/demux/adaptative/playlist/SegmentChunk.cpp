@@ -43,6 +43,8 @@ SegmentChunk::~SegmentChunk()
 void SegmentChunk::setRepresentation(BaseRepresentation *rep_)
 {
     rep = rep_;
+    if(rep)
+        setBitrate(rep->getBandwidth());
 }
 
 void SegmentChunk::onDownload(block_t **pp_block)
@@ -453,6 +453,11 @@ void SegmentInformation::setSegmentList(SegmentList *list)
     }
 }
 
+const SegmentList * SegmentInformation::getSegmentList() const
+{
+    return segmentList;
+}
+
 void SegmentInformation::setSegmentBase(SegmentBase *base)
 {
     if(segmentBase)
@@ -99,6 +99,7 @@ namespace adaptative
 
             public:
                 void setSegmentList(SegmentList *);
+                const SegmentList * getSegmentList() const;
                 void setSegmentBase(SegmentBase *);
                 void setSegmentTemplate(MediaSegmentTemplate *);
                 void setSwitchPolicy(SwitchPolicy);
@@ -28,6 +28,8 @@
 #include "SegmentTimeline.h"
 #include "SegmentInformation.hpp"
 
+#include <algorithm>
+
 using namespace adaptative::playlist;
 
 BaseSegmentTemplate::BaseSegmentTemplate( ICanonicalUrl *parent ) :
@@ -51,13 +53,19 @@ void MediaSegmentTemplate::mergeWith(MediaSegmentTemplate *updated, mtime_t prun
     SegmentTimeline *timeline = segmentTimeline.Get();
     if(timeline && updated->segmentTimeline.Get())
     {
+        /* Existing elements are kept and only the new ones appended,
+         * then the ones which left the updated window are dropped, but
+         * never past the barrier */
+        const stime_t windowstart = updated->segmentTimeline.Get()->scaledStart();
         timeline->mergeWith(*updated->segmentTimeline.Get());
         if(prunebarrier)
         {
             const uint64_t timescale = timeline->inheritTimescale();
             const uint64_t number =
                     timeline->getElementNumberByScaledPlaybackTime(prunebarrier * timescale / CLOCK_FREQ);
-            timeline->pruneBySequenceNumber(number);
+            const uint64_t windownumber =
+                    timeline->getElementNumberByScaledPlaybackTime(windowstart);
+            timeline->pruneBySequenceNumber(std::min(number, windownumber));
         }
     }
 }
@@ -85,28 +85,21 @@ mtime_t SegmentTimeline::getMinAheadScaledTime(uint64_t number) const
 
 uint64_t SegmentTimeline::getElementNumberByScaledPlaybackTime(stime_t scaled) const
 {
-    uint64_t prevnumber = 0;
+    const Element *prev = NULL;
     std::list<Element *>::const_iterator it;
     for(it = elements.begin(); it != elements.end(); ++it)
     {
         const Element *el = *it;
-        if(it == elements.begin())
-            scaled -= el->t;
+        if(scaled < el->t) /* before start, or in a discontinuity */
+            return (prev) ? prev->number + prev->r : el->number;
 
-        for(uint64_t repeat = 1 + el->r; repeat; repeat--)
-        {
-            if(el->d >= scaled)
-                return prevnumber;
-
-            scaled -= el->d;
-            prevnumber++;
-        }
+        if(el->contains(scaled))
+            return el->number + (scaled - el->t) / el->d;
 
-        /* might have been discontinuity */
-        prevnumber = el->number;
+        prev = el;
     }
 
-    return prevnumber;
+    return (prev) ? prev->number + prev->r : 0;
 }
 
 stime_t SegmentTimeline::getScaledPlaybackTimeByElementNumber(uint64_t number) const
@@ -183,9 +176,9 @@ size_t SegmentTimeline::pruneBySequenceNumber(uint64_t number)
         }
         else
         {
+            prunednow += el->r + 1;
             delete el;
             elements.pop_front();
-            prunednow += el->r + 1;
         }
     }
 
@@ -229,11 +222,18 @@ void SegmentTimeline::mergeWith(SegmentTimeline &other)
     }
 }
 
+stime_t SegmentTimeline::scaledStart() const
+{
+    if(elements.empty())
+        return 0;
+    return elements.front()->t;
+}
+
 mtime_t SegmentTimeline::start() const
 {
     if(elements.empty())
         return 0;
-    return elements.front()->t * CLOCK_FREQ / inheritTimescale();
+    return scaledStart() * CLOCK_FREQ / inheritTimescale();
 }
 
 mtime_t SegmentTimeline::end() const
@@ -53,6 +53,7 @@ namespace adaptative
                 void pruneByPlaybackTime(mtime_t);
                 size_t pruneBySequenceNumber(uint64_t);
                 void mergeWith(SegmentTimeline &);
+                stime_t scaledStart() const;
                 mtime_t start() const;
                 mtime_t end() const;
                 void debug(vlc_object_t *, int = 0) const;
@@ -201,6 +201,15 @@ bool FakeESOut::hasSelectedEs() const
     return b_selected;
 }
 
+bool FakeESOut::hasEsCategory( int i_cat ) const
+{
+    std::list<FakeESOutID *>::const_iterator it;
+    for( it=fakeesidlist.begin(); it!=fakeesidlist.end(); ++it )
+        if( (*it)->getFmt()->i_cat == i_cat )
+            return true;
+    return false;
+}
+
 bool FakeESOut::restarting() const
 {
     return !recycle_candidates.empty();
@@ -44,6 +44,7 @@ namespace adaptative
             void setTimestampOffset( mtime_t );
             size_t esCount() const;
             bool hasSelectedEs() const;
+            bool hasEsCategory( int ) const;
             bool restarting() const;
             void setExtraInfoProvider( ExtraFMTInfoInterface * );
 
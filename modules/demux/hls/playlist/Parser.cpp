@@ -193,12 +193,8 @@ bool M3U8Parser::appendSegmentsFromPlaylistURI(vlc_object_t *p_obj, Representati
         stream_t *substream = stream_MemoryNew(p_obj, p_block->p_buffer, p_block->i_buffer, true);
         if(substream)
         {
-            std::list<Tag *> tagslist = parseEntries(substream);
+            appendSegmentsFromStream(p_obj, rep, substream);
             stream_Delete(substream);
-
-            parseSegments(p_obj, rep, tagslist);
-
-            releaseTagsList(tagslist);
             return true;
         }
         block_Release(p_block);
@@ -206,6 +202,13 @@ bool M3U8Parser::appendSegmentsFromPlaylistURI(vlc_object_t *p_obj, Representati
     return false;
 }
 
+void M3U8Parser::appendSegmentsFromStream(vlc_object_t *p_obj, Representation *rep, stream_t *p_stream)
+{
+    std::list<Tag *> tagslist = parseEntries(p_stream);
+    parseSegments(p_obj, rep, tagslist);
+    releaseTagsList(tagslist);
+}
+
 void M3U8Parser::parseSegments(vlc_object_t *p_obj, Representation *rep, const std::list<Tag *> &tagslist)
 {
     SegmentList *segmentList = new (std::nothrow) SegmentList(rep);
@@ -213,6 +216,17 @@ void M3U8Parser::parseSegments(vlc_object_t *p_obj, Representation *rep, const s
     rep->timescale.Set(100);
     rep->b_loaded = true;
 
+    /* On refresh, the segments we already have are only walked through, for
+     * timings and byte ranges, and not created again: the list is only
+     * appended the new ones, and pruned of the ones which expired. */
+    const ISegment *lastKnown = NULL;
+    uint64_t lastKnownNumber = 0; /* as in the playlist */
+    if(rep->getSegmentList() && !rep->getSegmentList()->getSegments().empty())
+    {
+        lastKnown = rep->getSegmentList()->getSegments().back();
+        lastKnownNumber = lastKnown->getSequenceNumber() - HLSSegment::SEQUENCE_FIRST;
+    }
+
     mtime_t totalduration = 0;
     mtime_t nzStartTime = 0;
     mtime_t absReferenceTime = VLC_TS_INVALID;
@@ -221,6 +235,7 @@ void M3U8Parser::parseSegments(vlc_object_t *p_obj, Representation *rep, const s
     std::size_t prevbyterangeoffset = 0;
     const SingleValueTag *ctx_byterange = NULL;
     SegmentEncryption encryption;
+    std::string keyurl; /* key retrieved once a new segment needs it */
     const ValuesListTag *ctx_extinf = NULL;
 
     std::list<Tag *>::const_iterator it;
@@ -252,6 +267,36 @@ void M3U8Parser::parseSegments(vlc_object_t *p_obj, Representation *rep, const s
                     break;
                 }
 
+                if(lastKnown && sequenceNumber <= lastKnownNumber)
+                {
+                    mtime_t nzDuration = 0;
+                    if(ctx_extinf && ctx_extinf->getAttributeByName("DURATION"))
+                        nzDuration = CLOCK_FREQ * ctx_extinf->getAttributeByName("DURATION")->floatingPoint();
+                    totalduration += nzDuration;
+                    if(absReferenceTime > VLC_TS_INVALID)
+                        absReferenceTime += nzDuration;
+                    /* new segments follow the timeline of the known ones */
+                    if(sequenceNumber == lastKnownNumber)
+                        nzStartTime = CLOCK_FREQ * (lastKnown->startTime.Get() +
+                                                    lastKnown->duration.Get()) / rep->timescale.Get();
+                    else
+                        nzStartTime += nzDuration;
+
+                    if(ctx_byterange)
+                    {
+                        std::pair<std::size_t,std::size_t> range = ctx_byterange->getValue().getByteRange();
+                        if(range.first == 0)
+                            range.first = prevbyterangeoffset;
+                        prevbyterangeoffset = range.first + range.second;
+                    }
+
+                    sequenceNumber++;
+                    discontinuity = false;
+                    ctx_extinf = NULL;
+                    ctx_byterange = NULL;
+                    break;
+                }
+
                 HLSSegment *segment = new (std::nothrow) HLSSegment(rep, sequenceNumber++);
                 if(!segment)
                     break;
@@ -298,7 +343,23 @@ void M3U8Parser::parseSegments(vlc_object_t *p_obj, Representation *rep, const s
                 }
 
                 if(encryption.method != SegmentEncryption::NONE)
+                {
+                    if(!keyurl.empty())
+                    {
+                        block_t *p_block = Retrieve::HTTP(p_obj, keyurl);
+                        if(p_block)
+                        {
+                            if(p_block->i_buffer == 16)
+                            {
+                                encryption.key.resize(16);
+                                memcpy(&encryption.key[0], p_block->p_buffer, 16);
+                            }
+                            block_Release(p_block);
+                        }
+                        keyurl.clear();
+                    }
                     segment->setEncryption(encryption);
+                }
             }
             break;
 
@@ -330,22 +391,12 @@ void M3U8Parser::parseSegments(vlc_object_t *p_obj, Representation *rep, const s
                     encryption.method = SegmentEncryption::AES_128;
                     encryption.key.clear();
 
-                    Url keyurl(keytag->getAttributeByName("URI")->quotedString());
-                    if(!keyurl.hasScheme())
-                    {
-                        keyurl.prepend(Helper::getDirectoryPath(rep->getPlaylistUrl().toString()).append("/"));
-                    }
-
-                    block_t *p_block = Retrieve::HTTP(p_obj, keyurl.toString());
-                    if(p_block)
+                    Url url(keytag->getAttributeByName("URI")->quotedString());
+                    if(!url.hasScheme())
                     {
-                        if(p_block->i_buffer == 16)
-                        {
-                            encryption.key.resize(16);
-                            memcpy(&encryption.key[0], p_block->p_buffer, 16);
-                        }
-                        block_Release(p_block);
+                        url.prepend(Helper::getDirectoryPath(rep->getPlaylistUrl().toString()).append("/"));
                     }
+                    keyurl = url.toString();
 
                     if(keytag->getAttributeByName("IV"))
                     {
@@ -359,6 +410,7 @@ void M3U8Parser::parseSegments(vlc_object_t *p_obj, Representation *rep, const s
                     encryption.method = SegmentEncryption::NONE;
                     encryption.key.clear();
                     encryption.iv.clear();
+                    keyurl.clear();
                 }
             }
             break;
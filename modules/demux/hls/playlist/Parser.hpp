@@ -61,6 +61,7 @@ namespace hls
 
                 M3U8 *             parse  (stream_t *p_stream, const std::string &);
                 bool appendSegmentsFromPlaylistURI(vlc_object_t *, Representation *);
+                void appendSegmentsFromStream(vlc_object_t *, Representation *, stream_t *);
 
             private:
                 Representation * createRepresentation(BaseAdaptationSet *, const AttributesTag *);
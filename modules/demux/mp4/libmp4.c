@@ -2295,6 +2295,51 @@ static int MP4_ReadBox_stsz( stream_t *p_stream, MP4_Box_t *p_box )
     MP4_READBOX_EXIT( 1 );
 }
 
+static void MP4_FreeBox_stz2( MP4_Box_t *p_box )
+{
+    FREENULL( p_box->data.p_stz2->p_entries );
+}
+
+static int MP4_ReadBox_stz2( stream_t *p_stream, MP4_Box_t *p_box )
+{
+    MP4_READBOX_ENTER( MP4_Box_data_stz2_t, MP4_FreeBox_stz2 );
+    MP4_Box_data_stz2_t *p_stz2 = p_box->data.p_stz2;
+    uint32_t i_reserved;
+
+    MP4_GETVERSIONFLAGS( p_stz2 );
+
+    MP4_GET3BYTES( i_reserved );
+    MP4_GET1BYTE( p_stz2->i_field_size );
+    MP4_GET4BYTES( p_stz2->i_sample_count );
+    VLC_UNUSED( i_reserved );
+
+    if( p_stz2->i_field_size != 4 && p_stz2->i_field_size != 8 &&
+        p_stz2->i_field_size != 16 )
+        MP4_READBOX_EXIT( 0 );
+
+    /* keep the table packed, entries are extracted on access */
+    uint64_t i_size = ( (uint64_t)p_stz2->i_sample_count *
+                        p_stz2->i_field_size + 7 ) / 8;
+    if( i_read < 0 || i_size > (uint64_t)i_read )
+        MP4_READBOX_EXIT( 0 );
+
+    if( i_size > 0 )
+    {
+        p_stz2->p_entries = malloc( i_size );
+        if( unlikely( !p_stz2->p_entries ) )
+            MP4_READBOX_EXIT( 0 );
+        memcpy( p_stz2->p_entries, p_peek, i_size );
+    }
+
+#ifdef MP4_VERBOSE
+    msg_Dbg( p_stream, "read box: \"stz2\" field-size %d sample-count %d",
+                      p_stz2->i_field_size,
+                      p_stz2->i_sample_count );
+
+#endif
+    MP4_READBOX_EXIT( 1 );
+}
+
 static void MP4_FreeBox_stsc( MP4_Box_t *p_box )
 {
     FREENULL( p_box->data.p_stsc->i_first_chunk );
@@ -3662,6 +3707,7 @@ static const struct
     { ATOM_ctts,    MP4_ReadBox_ctts,         ATOM_stbl },
     { ATOM_stsd,    MP4_ReadBox_LtdContainer, ATOM_stbl },
     { ATOM_stsz,    MP4_ReadBox_stsz,         ATOM_stbl },
+    { ATOM_stz2,    MP4_ReadBox_stz2,         ATOM_stbl },
     { ATOM_stsc,    MP4_ReadBox_stsc,         ATOM_stbl },
     { ATOM_stco,    MP4_ReadBox_stco_co64,    ATOM_stbl },
     { ATOM_co64,    MP4_ReadBox_stco_co64,    ATOM_stbl },
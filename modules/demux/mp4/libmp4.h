@@ -725,11 +725,10 @@ typedef struct MP4_Box_data_stz2_s
     uint8_t  i_version;
     uint32_t i_flags;
 
-    uint32_t i_sample_size; /* 24 bits */
-    uint8_t  i_field_size;
+    uint8_t  i_field_size; /* 4, 8 or 16 */
     uint32_t i_sample_count;
 
-    uint32_t *i_entry_size; /* array: unsigned int(i_field_size) entry_size */
+    uint8_t  *p_entries; /* packed i_field_size bits entries, as stored */
 
 } MP4_Box_data_stz2_t;
 
@@ -1618,6 +1617,21 @@ static inline uint32_t Get24bBE( const uint8_t *p )
     return( ( p[0] <<16 ) + ( p[1] <<8 ) + p[2] );
 }
 
+static inline uint32_t MP4_stz2_GetEntry( const MP4_Box_data_stz2_t *p_stz2,
+                                          uint32_t i_sample )
+{
+    switch( p_stz2->i_field_size )
+    {
+        case 4:
+            return ( p_stz2->p_entries[i_sample >> 1] >>
+                     ( ( i_sample & 1 ) ? 0 : 4 ) ) & 0x0F;
+        case 8:
+            return p_stz2->p_entries[i_sample];
+        default:
+            return GetWBE( &p_stz2->p_entries[i_sample << 1] );
+    }
+}
+
 static inline void GetUUID( UUID_t *p_uuid, const uint8_t *p_buff )
 {
     memcpy( p_uuid, p_buff, 16 );
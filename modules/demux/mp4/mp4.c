@@ -209,6 +209,141 @@ static MP4_Box_t * MP4_GetTrakByTrackID( MP4_Box_t *p_moov, const uint32_t i_id
     return p_trak;
 }
 
+static inline uint32_t MP4_TrackGetSampleSize( const mp4_track_t *p_track,
+                                               uint32_t i_sample )
+{
+    if( p_track->i_sample_size )
+        return p_track->i_sample_size;
+    if( p_track->p_sample_size )
+        return p_track->p_sample_size[i_sample];
+    return MP4_stz2_GetEntry( p_track->p_stz2, i_sample );
+}
+
+/* Extracts the i_sample_count samples starting at (i_index, i_skip) from a
+ * stts/ctts table into count/value pairs, or only counts them when
+ * pi_count is NULL. */
+static uint32_t xTTS_Extract( const uint32_t *pi_table_count,
+                              const uint32_t *pi_table_value,
+                              uint32_t i_table_count,
+                              uint32_t i_index, uint32_t i_skip,
+                              uint32_t i_sample_count,
+                              uint32_t *pi_count, uint32_t *pi_value )
+{
+    uint32_t i_entries = 0;
+
+    while( i_sample_count > 0 && i_index < i_table_count )
+    {
+        uint32_t i_run = __MIN( pi_table_count[i_index] - i_skip, i_sample_count );
+        if( pi_count )
+        {
+            pi_count[i_entries] = i_run;
+            pi_value[i_entries] = pi_table_value[i_index];
+        }
+        i_entries++;
+        i_sample_count -= i_run;
+        i_index++;
+        i_skip = 0;
+    }
+    return i_entries;
+}
+
+static void DestroyChunkTimes( mp4_chunk_t *ck )
+{
+    FREENULL( ck->p_sample_count_dts );
+    FREENULL( ck->p_sample_delta_dts );
+    FREENULL( ck->p_sample_count_pts );
+    FREENULL( ck->p_sample_offset_pts );
+    ck->i_entries_dts = 0;
+    ck->i_entries_pts = 0;
+}
+
+static int TrackDecodeChunkTimes( demux_t *p_demux, const mp4_track_t *p_track,
+                                  mp4_chunk_t *ck )
+{
+    const MP4_Box_t *p_stts = MP4_BoxGet( p_track->p_stbl, "stts" );
+    const MP4_Box_t *p_ctts = MP4_BoxGet( p_track->p_stbl, "ctts" );
+
+    if( p_stts && BOXDATA(p_stts) )
+    {
+        const MP4_Box_data_stts_t *stts = BOXDATA(p_stts);
+        const uint32_t *pi_delta = (const uint32_t *)stts->pi_sample_delta;
+        uint32_t i_entries = xTTS_Extract( stts->pi_sample_count, pi_delta,
+                                           stts->i_entry_count,
+                                           ck->i_stts_index, ck->i_stts_skip,
+                                           ck->i_sample_count, NULL, NULL );
+        if( i_entries )
+        {
+            ck->p_sample_count_dts = malloc( i_entries * sizeof( uint32_t ) );
+            ck->p_sample_delta_dts = malloc( i_entries * sizeof( uint32_t ) );
+            if( !ck->p_sample_count_dts || !ck->p_sample_delta_dts )
+                goto error;
+            xTTS_Extract( stts->pi_sample_count, pi_delta, stts->i_entry_count,
+                          ck->i_stts_index, ck->i_stts_skip, ck->i_sample_count,
+                          ck->p_sample_count_dts, ck->p_sample_delta_dts );
+        }
+        ck->i_entries_dts = i_entries;
+    }
+
+    if( p_ctts && BOXDATA(p_ctts) )
+    {
+        const MP4_Box_data_ctts_t *ctts = BOXDATA(p_ctts);
+        const uint32_t *pi_offset = (const uint32_t *)ctts->pi_sample_offset;
+        uint32_t i_entries = xTTS_Extract( ctts->pi_sample_count, pi_offset,
+                                           ctts->i_entry_count,
+                                           ck->i_ctts_index, ck->i_ctts_skip,
+                                           ck->i_sample_count, NULL, NULL );
+        if( i_entries )
+        {
+            ck->p_sample_count_pts = malloc( i_entries * sizeof( uint32_t ) );
+            ck->p_sample_offset_pts = malloc( i_entries * sizeof( int32_t ) );
+            if( !ck->p_sample_count_pts || !ck->p_sample_offset_pts )
+                goto error;
+            xTTS_Extract( ctts->pi_sample_count, pi_offset, ctts->i_entry_count,
+                          ck->i_ctts_index, ck->i_ctts_skip, ck->i_sample_count,
+                          ck->p_sample_count_pts,
+                          (uint32_t *)ck->p_sample_offset_pts );
+        }
+        ck->i_entries_pts = i_entries;
+    }
+
+    return VLC_SUCCESS;
+
+error:
+    msg_Err( p_demux, "can't allocate memory for chunk times" );
+    DestroyChunkTimes( ck );
+    return VLC_ENOMEM;
+}
+
+/* Return a moov chunk with its dts/pts extracts decoded. Only the last
+ * MP4_TIMED_CHUNKS chunks used by a track keep them. */
+static mp4_chunk_t *TrackGetTimedChunk( demux_t *p_demux, mp4_track_t *p_track,
+                                        uint32_t i_chunk )
+{
+    mp4_chunk_t *ck = &p_track->chunk[i_chunk];
+    unsigned i;
+
+    for( i = 0; i < p_track->i_timed_chunks; i++ )
+        if( p_track->timed_chunk[i] == i_chunk )
+            break;
+
+    if( i == p_track->i_timed_chunks )
+    {
+        if( TrackDecodeChunkTimes( p_demux, p_track, ck ) != VLC_SUCCESS )
+            return ck; /* without extracts, dts will be the chunk first one */
+
+        if( i == MP4_TIMED_CHUNKS )
+            DestroyChunkTimes( &p_track->chunk[p_track->timed_chunk[--i]] );
+        else
+            p_track->i_timed_chunks++;
+    }
+
+    memmove( &p_track->timed_chunk[1], &p_track->timed_chunk[0],
+             i * sizeof( *p_track->timed_chunk ) );
+    p_track->timed_chunk[0] = i_chunk;
+
+    return ck;
+}
+
 /* Return time in microsecond of a track */
 static inline int64_t MP4_TrackGetDTS( demux_t *p_demux, mp4_track_t *p_track )
 {
@@ -217,7 +352,7 @@ static inline int64_t MP4_TrackGetDTS( demux_t *p_demux, mp4_track_t *p_track )
     if( p_sys->b_fragmented )
         p_chunk = p_track->cchunk;
     else
-        p_chunk = &p_track->chunk[p_track->i_chunk];
+        p_chunk = TrackGetTimedChunk( p_demux, p_track, p_track->i_chunk );
 
     unsigned int i_index = 0;
     unsigned int i_sample = p_track->i_sample - p_chunk->i_sample_first;
@@ -271,7 +406,7 @@ static inline bool MP4_TrackGetPTSDelta( demux_t *p_demux, mp4_track_t *p_track,
     if( p_sys->b_fragmented )
         ck = p_track->cchunk;
     else
-        ck = &p_track->chunk[p_track->i_chunk];
+        ck = TrackGetTimedChunk( p_demux, p_track, p_track->i_chunk );
 
     unsigned int i_index = 0;
     unsigned int i_sample = p_track->i_sample - ck->i_sample_first;
@@ -1764,12 +1899,11 @@ static void LoadChapter( demux_t  *p_demux )
 static bool MP4_TrackIsInterleaved( const mp4_track_t *p_track )
 {
     const MP4_Box_t *p_stsc = MP4_BoxGet( p_track->p_stbl, "stsc" );
-    const MP4_Box_t *p_stsz = MP4_BoxGet( p_track->p_stbl, "stsz" );
-    if( p_stsc && BOXDATA(p_stsc) && p_stsz && BOXDATA(p_stsz) )
+    if( p_stsc && BOXDATA(p_stsc) )
     {
         if( BOXDATA(p_stsc)->i_entry_count == 1 &&
-            BOXDATA(p_stsz)->i_sample_count > 1 &&
-            BOXDATA(p_stsc)->i_samples_per_chunk[0] == BOXDATA(p_stsz)->i_sample_count )
+            p_track->i_sample_count > 1 &&
+            BOXDATA(p_stsc)->i_samples_per_chunk[0] == p_track->i_sample_count )
             return false;
     }
 
@@ -1872,98 +2006,42 @@ static int TrackCreateChunksIndex( demux_t *p_demux,
     return VLC_SUCCESS;
 }
 
-static int xTTS_CountEntries( demux_t *p_demux, uint32_t *pi_entry /* out */,
-                              const uint32_t i_index,
-                              uint32_t i_index_samples_left,
-                              uint32_t i_sample_count,
-                              const uint32_t *pi_index_sample_count,
-                              const uint32_t i_table_count )
-{
-    uint32_t i_array_offset;
-    while( i_sample_count > 0 )
-    {
-        if ( likely((UINT32_MAX - i_index) >= *pi_entry) )
-            i_array_offset = i_index + *pi_entry;
-        else
-            return VLC_EGENERIC;
-
-        if ( i_array_offset >= i_table_count )
-        {
-            msg_Err( p_demux, "invalid index counting total samples %u %u", i_array_offset,  i_table_count );
-            return VLC_ENOVAR;
-        }
-
-        if ( i_index_samples_left )
-        {
-            if ( i_index_samples_left > i_sample_count )
-            {
-                i_index_samples_left -= i_sample_count;
-                i_sample_count = 0;
-                *pi_entry +=1; /* No samples left, go copy */
-                break;
-            }
-            else
-            {
-                i_sample_count -= i_index_samples_left;
-                i_index_samples_left = 0;
-                *pi_entry += 1;
-                continue;
-            }
-        }
-        else
-        {
-            i_sample_count -= __MIN( i_sample_count, pi_index_sample_count[i_array_offset] );
-            *pi_entry += 1;
-        }
-    }
-
-    return VLC_SUCCESS;
-}
-
 static int TrackCreateSamplesIndex( demux_t *p_demux,
                                     mp4_track_t *p_demux_track )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
 
     MP4_Box_t *p_box;
-    MP4_Box_data_stsz_t *stsz;
-    /* TODO use also stss and stsh table for seeking */
     /* FIXME use edit table */
 
-    /* Find stsz
-     *  Gives the sample size for each samples. There is also a stz2 table
-     *  (compressed form) that we need to implement TODO */
-    p_box = MP4_BoxGet( p_demux_track->p_stbl, "stsz" );
-    if( !p_box )
+    /* Find stsz or stz2
+     *  Gives the sample size for each samples. Both tables are used in place
+     *  and the compact stz2 one is only unpacked on access */
+    p_demux_track->p_sample_size = NULL;
+    p_demux_track->p_stz2 = NULL;
+    if( ( p_box = MP4_BoxGet( p_demux_track->p_stbl, "stsz" ) ) &&
+        p_box->data.p_stsz )
     {
-        /* FIXME and stz2 */
-        msg_Warn( p_demux, "cannot find STSZ box" );
-        return VLC_EGENERIC;
-    }
-    stsz = p_box->data.p_stsz;
+        MP4_Box_data_stsz_t *stsz = p_box->data.p_stsz;
 
-    /* Use stsz table to create a sample number -> sample size table */
-    p_demux_track->i_sample_count = stsz->i_sample_count;
-    if( stsz->i_sample_size )
-    {
-        /* 1: all sample have the same size, so no need to construct a table */
+        p_demux_track->i_sample_count = stsz->i_sample_count;
+        /* 1: all sample have the same size, so no need for a table
+         * 2: each sample can have a different size */
         p_demux_track->i_sample_size = stsz->i_sample_size;
-        p_demux_track->p_sample_size = NULL;
+        if( !stsz->i_sample_size )
+            p_demux_track->p_sample_size = stsz->i_entry_size;
     }
-    else
+    else if( ( p_box = MP4_BoxGet( p_demux_track->p_stbl, "stz2" ) ) &&
+             p_box->data.p_stz2 )
     {
-        /* 2: each sample can have a different size */
+        p_demux_track->i_sample_count = p_box->data.p_stz2->i_sample_count;
         p_demux_track->i_sample_size = 0;
-        p_demux_track->p_sample_size =
-            calloc( p_demux_track->i_sample_count, sizeof( uint32_t ) );
-        if( p_demux_track->p_sample_size == NULL )
-            return VLC_ENOMEM;
-
-        for( uint32_t i_sample = 0; i_sample < p_demux_track->i_sample_count; i_sample++ )
-        {
-            p_demux_track->p_sample_size[i_sample] =
-                    stsz->i_entry_size[i_sample];
-        }
+        p_demux_track->p_stz2 = p_box->data.p_stz2;
+    }
+    else
+    {
+        msg_Warn( p_demux, "cannot find STSZ or STZ2 box" );
+        return VLC_EGENERIC;
     }
 
     if ( p_demux_track->i_chunk_count )
@@ -1977,16 +2055,17 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
         }
         else
         {
-            if( (uint64_t)lastchunk->i_sample_count + p_demux_track->i_chunk_count - 1 > stsz->i_sample_count )
+            if( (uint64_t)lastchunk->i_sample_count + p_demux_track->i_chunk_count - 1 >
+                p_demux_track->i_sample_count )
             {
                 msg_Err( p_demux, "invalid samples table: stsz table is too small" );
                 return VLC_EGENERIC;
             }
 
-            for( uint32_t i=stsz->i_sample_count - lastchunk->i_sample_count;
-                 i<stsz->i_sample_count; i++)
+            for( uint32_t i=p_demux_track->i_sample_count - lastchunk->i_sample_count;
+                 i<p_demux_track->i_sample_count; i++)
             {
-                i_total_size += stsz->i_entry_size[i];
+                i_total_size += MP4_TrackGetSampleSize( p_demux_track, i );
             }
         }
 
@@ -1996,19 +2075,17 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
 
     /* Use stts table to create a sample number -> dts table.
      * XXX: if we don't want to waste too much memory, we can't expand
-     *  the box! so each chunk will contain an "extract" of this table
-     *  for fast research (problem with raw stream where a sample is sometime
-     *  just channels*bits_per_sample/8 */
-
-     /* FIXME: refactor STTS & CTTS, STTS having now only few extra lines and
-      *        differing in 2/2 fields and 1 signedness */
+     *  the box! so each chunk only remembers where it starts in the table,
+     *  and its "extract" of it is decoded when the chunk is used (problem
+     *  with raw stream where a sample is sometime just
+     *  channels*bits_per_sample/8) */
 
     mtime_t i_next_dts = 0;
     /* Find stts
      *  Gives mapping between sample and decoding time
      */
     p_box = MP4_BoxGet( p_demux_track->p_stbl, "stts" );
-    if( !p_box )
+    if( !p_box || !p_box->data.p_stts )
     {
         msg_Warn( p_demux, "cannot find STTS box" );
         return VLC_EGENERIC;
@@ -2019,96 +2096,42 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
 
         msg_Warn( p_demux, "STTS table of %"PRIu32" entries", stts->i_entry_count );
 
-        /* Create sample -> dts table per chunk */
+        /* Save each chunk start in the table, and its first/last dts */
         uint32_t i_index = 0;
-        uint32_t i_current_index_samples_left = 0;
+        uint32_t i_skip = 0;
 
         for( uint32_t i_chunk = 0; i_chunk < p_demux_track->i_chunk_count; i_chunk++ )
         {
             mp4_chunk_t *ck = &p_demux_track->chunk[i_chunk];
-            uint32_t i_sample_count;
+            uint32_t i_sample_count = ck->i_sample_count;
 
-            /* save first dts */
             ck->i_first_dts = i_next_dts;
             ck->i_last_dts  = i_next_dts;
+            ck->i_stts_index = i_index;
+            ck->i_stts_skip = i_skip;
 
-            /* count how many entries are needed for this chunk
-             * for p_sample_delta_dts and p_sample_count_dts */
-            ck->i_entries_dts = 0;
-
-            int i_ret = xTTS_CountEntries( p_demux, &ck->i_entries_dts, i_index,
-                                           i_current_index_samples_left,
-                                           ck->i_sample_count,
-                                           stts->pi_sample_count,
-                                           stts->i_entry_count );
-            if ( i_ret == VLC_EGENERIC )
-                return i_ret;
-
-            /* allocate them */
-            ck->p_sample_count_dts = calloc( ck->i_entries_dts, sizeof( uint32_t ) );
-            ck->p_sample_delta_dts = calloc( ck->i_entries_dts, sizeof( uint32_t ) );
-            if( !ck->p_sample_count_dts || !ck->p_sample_delta_dts )
+            while( i_sample_count > 0 )
             {
-                free( ck->p_sample_count_dts );
-                free( ck->p_sample_delta_dts );
-                msg_Err( p_demux, "can't allocate memory for i_entry=%"PRIu32, ck->i_entries_dts );
-                ck->i_entries_dts = 0;
-                return VLC_ENOMEM;
-            }
-
-            /* now copy */
-            i_sample_count = ck->i_sample_count;
-
-            for( uint32_t i = 0; i < ck->i_entries_dts; i++ )
-            {
-                if ( i_current_index_samples_left )
+                if( i_index >= stts->i_entry_count )
                 {
-                    if ( i_current_index_samples_left > i_sample_count )
-                    {
-                        if ( i_sample_count ) ck->i_last_dts = i_next_dts;
-                        ck->p_sample_count_dts[i] = i_sample_count;
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        i_current_index_samples_left -= i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == ck->i_entries_dts - 1 );
-                        break;
-                    }
-                    else
-                    {
-                        if ( i_current_index_samples_left ) ck->i_last_dts = i_next_dts;
-                        ck->p_sample_count_dts[i] = i_current_index_samples_left;
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        i_sample_count -= i_current_index_samples_left;
-                        i_current_index_samples_left = 0;
-                        i_index++;
-                    }
+                    msg_Err( p_demux, "invalid index counting total samples %u %u",
+                             i_index, stts->i_entry_count );
+                    break;
                 }
-                else
+
+                uint32_t i_run = __MIN( stts->pi_sample_count[i_index] - i_skip,
+                                        i_sample_count );
+                uint32_t i_delta = stts->pi_sample_delta[i_index];
+                if( i_run )
+                    ck->i_last_dts = i_next_dts + (uint64_t)( i_run - 1 ) * i_delta;
+                i_next_dts += (uint64_t)i_run * i_delta;
+                i_sample_count -= i_run;
+                i_skip += i_run;
+                if( i_skip == stts->pi_sample_count[i_index] )
                 {
-                    if ( stts->pi_sample_count[i_index] > i_sample_count )
-                    {
-                        if ( i_sample_count ) ck->i_last_dts = i_next_dts;
-                        ck->p_sample_count_dts[i] = i_sample_count;
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        i_current_index_samples_left = stts->pi_sample_count[i_index] - i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == ck->i_entries_dts - 1 );
-                        // keep building from same index
-                    }
-                    else
-                    {
-                        if ( stts->pi_sample_count[i_index] ) ck->i_last_dts = i_next_dts;
-                        ck->p_sample_count_dts[i] = stts->pi_sample_count[i_index];
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        i_sample_count -= stts->pi_sample_count[i_index];
-                        i_index++;
-                    }
+                    i_index++;
+                    i_skip = 0;
                 }
-
             }
         }
     }
@@ -2124,84 +2147,29 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
 
         msg_Warn( p_demux, "CTTS table of %"PRIu32" entries", ctts->i_entry_count );
 
-        /* Create pts-dts table per chunk */
+        /* Save each chunk start in the table */
         uint32_t i_index = 0;
-        uint32_t i_current_index_samples_left = 0;
+        uint32_t i_skip = 0;
 
         for( uint32_t i_chunk = 0; i_chunk < p_demux_track->i_chunk_count; i_chunk++ )
         {
             mp4_chunk_t *ck = &p_demux_track->chunk[i_chunk];
-            uint32_t i_sample_count;
-
-            /* count how many entries are needed for this chunk
-             * for p_sample_offset_pts and p_sample_count_pts */
-            ck->i_entries_pts = 0;
-            int i_ret = xTTS_CountEntries( p_demux, &ck->i_entries_pts, i_index,
-                                           i_current_index_samples_left,
-                                           ck->i_sample_count,
-                                           ctts->pi_sample_count,
-                                           ctts->i_entry_count );
-            if ( i_ret == VLC_EGENERIC )
-                return i_ret;
-
-            /* allocate them */
-            ck->p_sample_count_pts = calloc( ck->i_entries_pts, sizeof( uint32_t ) );
-            ck->p_sample_offset_pts = calloc( ck->i_entries_pts, sizeof( int32_t ) );
-            if( !ck->p_sample_count_pts || !ck->p_sample_offset_pts )
-            {
-                free( ck->p_sample_count_pts );
-                free( ck->p_sample_offset_pts );
-                msg_Err( p_demux, "can't allocate memory for i_entry=%"PRIu32, ck->i_entries_pts );
-                ck->i_entries_pts = 0;
-                return VLC_ENOMEM;
-            }
+            uint32_t i_sample_count = ck->i_sample_count;
 
-            /* now copy */
-            i_sample_count = ck->i_sample_count;
+            ck->i_ctts_index = i_index;
+            ck->i_ctts_skip = i_skip;
 
-            for( uint32_t i = 0; i < ck->i_entries_pts; i++ )
+            while( i_sample_count > 0 && i_index < ctts->i_entry_count )
             {
-                if ( i_current_index_samples_left )
+                uint32_t i_run = __MIN( ctts->pi_sample_count[i_index] - i_skip,
+                                        i_sample_count );
+                i_sample_count -= i_run;
+                i_skip += i_run;
+                if( i_skip == ctts->pi_sample_count[i_index] )
                 {
-                    if ( i_current_index_samples_left > i_sample_count )
-                    {
-                        ck->p_sample_count_pts[i] = i_sample_count;
-                        ck->p_sample_offset_pts[i] = ctts->pi_sample_offset[i_index];
-                        i_current_index_samples_left -= i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == ck->i_entries_pts - 1 );
-                        break;
-                    }
-                    else
-                    {
-                        ck->p_sample_count_pts[i] = i_current_index_samples_left;
-                        ck->p_sample_offset_pts[i] = ctts->pi_sample_offset[i_index];
-                        i_sample_count -= i_current_index_samples_left;
-                        i_current_index_samples_left = 0;
-                        i_index++;
-                    }
+                    i_index++;
+                    i_skip = 0;
                 }
-                else
-                {
-                    if ( ctts->pi_sample_count[i_index] > i_sample_count )
-                    {
-                        ck->p_sample_count_pts[i] = i_sample_count;
-                        ck->p_sample_offset_pts[i] = ctts->pi_sample_offset[i_index];
-                        i_current_index_samples_left = ctts->pi_sample_count[i_index] - i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == ck->i_entries_pts - 1 );
-                        // keep building from same index
-                    }
-                    else
-                    {
-                        ck->p_sample_count_pts[i] = ctts->pi_sample_count[i_index];
-                        ck->p_sample_offset_pts[i] = ctts->pi_sample_offset[i_index];
-                        i_sample_count -= ctts->pi_sample_count[i_index];
-                        i_index++;
-                    }
-                }
-
-
             }
         }
     }
@@ -2361,6 +2329,36 @@ static int TrackCreateES( demux_t *p_demux, mp4_track_t *p_track,
     return VLC_SUCCESS;
 }
 
+/* Return the last chunk starting at or before i_dts (track timescale) */
+static uint32_t TrackDtsToChunk( const mp4_track_t *p_track, uint64_t i_dts )
+{
+    uint32_t i_low = 1, i_high = p_track->i_chunk_count;
+    while( i_low < i_high )
+    {
+        uint32_t i_mid = i_low + ( i_high - i_low ) / 2;
+        if( p_track->chunk[i_mid].i_first_dts <= i_dts )
+            i_low = i_mid + 1;
+        else
+            i_high = i_mid;
+    }
+    return i_low - 1;
+}
+
+/* Return the chunk holding i_sample */
+static uint32_t TrackSampleToChunk( const mp4_track_t *p_track, uint32_t i_sample )
+{
+    uint32_t i_low = 1, i_high = p_track->i_chunk_count;
+    while( i_low < i_high )
+    {
+        uint32_t i_mid = i_low + ( i_high - i_low ) / 2;
+        if( p_track->chunk[i_mid].i_sample_first <= i_sample )
+            i_low = i_mid + 1;
+        else
+            i_high = i_mid;
+    }
+    return i_low - 1;
+}
+
 /* given a time it return sample/chunk
  * it also update elst field of the track
  */
@@ -2417,49 +2415,35 @@ static int TrackTimeToSampleChunk( demux_t *p_demux, mp4_track_t *p_track,
         i_start = i_start * p_track->i_timescale / CLOCK_FREQ;
     }
 
-    /* we start from sample 0/chunk 0, hope it won't take too much time */
-    /* *** find good chunk *** */
-    for( i_chunk = 0; ; i_chunk++ )
-    {
-        if( i_chunk + 1 >= p_track->i_chunk_count )
-        {
-            /* at the end and can't check if i_start in this chunk,
-               it will be check while searching i_sample */
-            i_chunk = p_track->i_chunk_count - 1;
-            break;
-        }
-
-        if( (uint64_t)i_start >= p_track->chunk[i_chunk].i_first_dts &&
-            (uint64_t)i_start <  p_track->chunk[i_chunk + 1].i_first_dts )
-        {
-            break;
-        }
-    }
+    /* *** find good chunk: the last one starting at or before i_start *** */
+    i_chunk = TrackDtsToChunk( p_track, i_start );
 
     /* *** find sample in the chunk *** */
-    i_sample = p_track->chunk[i_chunk].i_sample_first;
-    i_dts    = p_track->chunk[i_chunk].i_first_dts;
-    for( i_index = 0; i_sample < p_track->chunk[i_chunk].i_sample_count; )
+    const mp4_chunk_t *ck = TrackGetTimedChunk( p_demux, p_track, i_chunk );
+    i_sample = ck->i_sample_first;
+    i_dts    = ck->i_first_dts;
+    for( i_index = 0; i_sample < ck->i_sample_count &&
+                      (uint32_t)i_index < ck->i_entries_dts; )
     {
         if( i_dts +
-            p_track->chunk[i_chunk].p_sample_count_dts[i_index] *
-            p_track->chunk[i_chunk].p_sample_delta_dts[i_index] < (uint64_t)i_start )
+            ck->p_sample_count_dts[i_index] *
+            ck->p_sample_delta_dts[i_index] < (uint64_t)i_start )
         {
             i_dts    +=
-                p_track->chunk[i_chunk].p_sample_count_dts[i_index] *
-                p_track->chunk[i_chunk].p_sample_delta_dts[i_index];
+                ck->p_sample_count_dts[i_index] *
+                ck->p_sample_delta_dts[i_index];
 
-            i_sample += p_track->chunk[i_chunk].p_sample_count_dts[i_index];
+            i_sample += ck->p_sample_count_dts[i_index];
             i_index++;
         }
         else
         {
-            if( p_track->chunk[i_chunk].p_sample_delta_dts[i_index] <= 0 )
+            if( ck->p_sample_delta_dts[i_index] <= 0 )
             {
                 break;
             }
             i_sample += ( i_start - i_dts ) /
-                p_track->chunk[i_chunk].p_sample_delta_dts[i_index];
+                ck->p_sample_delta_dts[i_index];
             break;
         }
     }
@@ -2474,37 +2458,30 @@ static int TrackTimeToSampleChunk( demux_t *p_demux, mp4_track_t *p_track,
 
 
     /* *** Try to find nearest sync points *** */
-    if( ( p_box_stss = MP4_BoxGet( p_track->p_stbl, "stss" ) ) )
+    if( ( p_box_stss = MP4_BoxGet( p_track->p_stbl, "stss" ) ) &&
+        p_box_stss->data.p_stss->i_entry_count > 0 )
     {
         MP4_Box_data_stss_t *p_stss = p_box_stss->data.p_stss;
         msg_Dbg( p_demux, "track[Id 0x%x] using Sync Sample Box (stss)",
                  p_track->i_track_ID );
-        for( unsigned i_index = 0; i_index < p_stss->i_entry_count; i_index++ )
-        {
-            if( i_index >= p_stss->i_entry_count - 1 ||
-                i_sample < p_stss->i_sample_number[i_index+1] )
-            {
-                unsigned i_sync_sample = p_stss->i_sample_number[i_index];
-                msg_Dbg( p_demux, "stss gives %d --> %d (sample number)",
-                         i_sample, i_sync_sample );
 
-                if( i_sync_sample <= i_sample )
-                {
-                    while( i_chunk > 0 &&
-                           i_sync_sample < p_track->chunk[i_chunk].i_sample_first )
-                        i_chunk--;
-                }
-                else
-                {
-                    while( i_chunk < p_track->i_chunk_count - 1 &&
-                           i_sync_sample >= p_track->chunk[i_chunk].i_sample_first +
-                                            p_track->chunk[i_chunk].i_sample_count )
-                        i_chunk++;
-                }
-                i_sample = i_sync_sample;
-                break;
-            }
+        /* the last sync sample at or before i_sample, or the first one */
+        uint32_t i_low = 0, i_high = p_stss->i_entry_count;
+        while( i_low < i_high )
+        {
+            uint32_t i_mid = i_low + ( i_high - i_low ) / 2;
+            if( p_stss->i_sample_number[i_mid] <= i_sample )
+                i_low = i_mid + 1;
+            else
+                i_high = i_mid;
         }
+
+        unsigned i_sync_sample = p_stss->i_sample_number[i_low ? i_low - 1 : 0];
+        msg_Dbg( p_demux, "stss gives %d --> %d (sample number)",
+                 i_sample, i_sync_sample );
+
+        i_chunk = TrackSampleToChunk( p_track, i_sync_sample );
+        i_sample = i_sync_sample;
     }
     else
     {
@@ -2872,10 +2849,7 @@ static void MP4_TrackCreate( demux_t *p_demux, mp4_track_t *p_track,
 
 static void DestroyChunk( mp4_chunk_t *ck )
 {
-    free( ck->p_sample_count_dts );
-    free( ck->p_sample_delta_dts );
-    free( ck->p_sample_count_pts );
-    free( ck->p_sample_offset_pts );
+    DestroyChunkTimes( ck );
 
     if( ck->p_sample_data )
     {
@@ -2912,9 +2886,6 @@ static void MP4_TrackDestroy( demux_t *p_demux, mp4_track_t *p_track )
         free( p_track->cchunk );
     }
 
-    if( !p_track->i_sample_size )
-        free( p_track->p_sample_size );
-
     if ( p_track->asfinfo.p_frame )
         block_ChainRelease( p_track->asfinfo.p_frame );
 }
@@ -3037,7 +3008,7 @@ static uint32_t MP4_TrackGetReadSize( mp4_track_t *p_track, uint32_t *pi_nb_samp
         *pi_nb_samples = 1;
 
         if( p_track->i_sample_size == 0 ) /* all sizes are different */
-            return p_track->p_sample_size[p_track->i_sample];
+            return MP4_TrackGetSampleSize( p_track, p_track->i_sample );
         else
             return p_track->i_sample_size;
     }
@@ -3064,7 +3035,7 @@ static uint32_t MP4_TrackGetReadSize( mp4_track_t *p_track, uint32_t *pi_nb_samp
         if( p_track->i_sample_size == 0 )
         {
             *pi_nb_samples = 1;
-            return p_track->p_sample_size[p_track->i_sample];
+            return MP4_TrackGetSampleSize( p_track, p_track->i_sample );
         }
 
         if( p_soun->i_qt_version == 1 )
@@ -3075,7 +3046,7 @@ static uint32_t MP4_TrackGetReadSize( mp4_track_t *p_track, uint32_t *pi_nb_samp
                 if ( p_track->i_sample_size )
                     return p_track->i_sample_size;
                 else
-                    return p_track->p_sample_size[p_track->i_sample];
+                    return MP4_TrackGetSampleSize( p_track, p_track->i_sample );
             }
             else if ( p_soun->i_compressionid != 0 || p_soun->i_bytes_per_sample > 1 ) /* compressed */
             {
@@ -3146,7 +3117,7 @@ static uint32_t MP4_TrackGetReadSize( mp4_track_t *p_track, uint32_t *pi_nb_samp
         {
             (*pi_nb_samples)++;
             if ( p_track->i_sample_size == 0 )
-                i_size += p_track->p_sample_size[i];
+                i_size += MP4_TrackGetSampleSize( p_track, i );
             else
                 i_size += MP4_GetFixedSampleSize( p_track, p_soun );
 
@@ -3213,7 +3184,7 @@ static uint64_t MP4_TrackGetPos( mp4_track_t *p_track )
         for( i_sample = p_track->chunk[p_track->i_chunk].i_sample_first;
              i_sample < p_track->i_sample; i_sample++ )
         {
-            i_pos += p_track->p_sample_size[i_sample];
+            i_pos += MP4_TrackGetSampleSize( p_track, i_sample );
         }
     }
 
@@ -4262,28 +4233,24 @@ static int LeafMOOVGetSamplesSize( const mp4_track_t *p_track, const uint32_t i_
                            uint32_t *pi_samplestoread, uint32_t *pi_samplessize,
                            const uint32_t i_maxbytes, const uint32_t i_maxsamples )
 {
-    MP4_Box_t *p_stsz = MP4_BoxGet( p_track->p_stbl, "stsz" );
-    if ( !p_stsz )
-        return VLC_EGENERIC;
-
-    if ( BOXDATA(p_stsz)->i_sample_size == 0 )
+    if ( p_track->i_sample_size == 0 )
     {
         uint32_t i_entry = i_sample;
         uint32_t i_totalbytes = 0;
         *pi_samplestoread = 1;
 
-        if ( i_sample >= BOXDATA(p_stsz)->i_sample_count )
+        if ( i_sample >= p_track->i_sample_count )
             return VLC_EGENERIC;
 
-        *pi_samplessize = BOXDATA(p_stsz)->i_entry_size[i_sample];
+        *pi_samplessize = MP4_TrackGetSampleSize( p_track, i_sample );
         i_totalbytes += *pi_samplessize;
 
         if ( *pi_samplessize > i_maxbytes )
             return VLC_EGENERIC;
 
         i_entry++;
-        while( i_entry < BOXDATA(p_stsz)->i_sample_count &&
-               *pi_samplessize == BOXDATA(p_stsz)->i_entry_size[i_entry] &&
+        while( i_entry < p_track->i_sample_count &&
+               *pi_samplessize == MP4_TrackGetSampleSize( p_track, i_entry ) &&
                i_totalbytes + *pi_samplessize < i_maxbytes &&
                *pi_samplestoread < i_maxsamples
               )
@@ -4297,8 +4264,8 @@ static int LeafMOOVGetSamplesSize( const mp4_track_t *p_track, const uint32_t i_
     else
     {
         /* all samples have same size */
-        *pi_samplessize = BOXDATA(p_stsz)->i_sample_size;
-        *pi_samplestoread = __MIN( i_maxsamples, BOXDATA(p_stsz)->i_sample_count );
+        *pi_samplessize = p_track->i_sample_size;
+        *pi_samplestoread = __MIN( i_maxsamples, p_track->i_sample_count );
         *pi_samplestoread = __MIN( i_maxbytes / *pi_samplessize, *pi_samplestoread );
         *pi_samplessize = *pi_samplessize * *pi_samplestoread;
     }
@@ -4311,7 +4278,7 @@ static inline mtime_t LeafGetMOOVTimeInChunk( const mp4_chunk_t *p_chunk, uint32
     mtime_t i_time = 0;
     uint32_t i_index = 0;
 
-    while( i_sample > 0 )
+    while( i_sample > 0 && i_index < p_chunk->i_entries_dts )
     {
         if( i_sample > p_chunk->p_sample_count_dts[i_index] )
         {
@@ -4383,7 +4350,7 @@ static int LeafParseMDATwithMOOV( demux_t *p_demux )
         }
         /**/
 
-        mp4_chunk_t *p_chunk = &p_track->chunk[i_chunk];
+        const mp4_chunk_t *p_chunk = TrackGetTimedChunk( p_demux, p_track, i_chunk );
 
         uint32_t i_nb_samples_at_chunk_start = p_chunk->i_sample_first;
         uint32_t i_nb_samples_in_chunk = p_chunk->i_sample_count;
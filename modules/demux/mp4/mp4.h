@@ -34,6 +34,9 @@
 #include "fragments.h"
 #include "../asf/asfpacket.h"
 
+/* How many chunks per track keep their dts/pts extracts decoded */
+#define MP4_TIMED_CHUNKS 8
+
 /* Contain all information about a chunk */
 typedef struct
 {
@@ -50,6 +53,13 @@ typedef struct
     uint64_t     i_first_dts;   /* DTS of the first sample */
     uint64_t     i_last_dts;    /* DTS of the last sample */
 
+    /* where the first sample of this chunk lies in the stts and ctts tables:
+       the extracts below are only decoded on demand for moov chunks */
+    uint32_t     i_stts_index;
+    uint32_t     i_stts_skip;
+    uint32_t     i_ctts_index;
+    uint32_t     i_ctts_skip;
+
     uint32_t     i_entries_dts;
     uint32_t     *p_sample_count_dts;
     uint32_t     *p_sample_delta_dts;   /* dts delta */
@@ -108,11 +118,16 @@ typedef struct
     mp4_chunk_t    *chunk; /* always defined  for each chunk */
     mp4_chunk_t    *cchunk; /* current chunk if b_fragmented is true */
 
-    /* sample size, p_sample_size defined only if i_sample_size == 0
-        else i_sample_size is size for all sample */
+    /* sample size, p_sample_size (stsz) or p_stz2 defined only if
+        i_sample_size == 0 else i_sample_size is size for all sample */
     uint32_t         i_sample_size;
-    uint32_t         *p_sample_size; /* XXX perhaps add file offset if take
+    const uint32_t   *p_sample_size; /* XXX perhaps add file offset if take
                                     too much time to do sumations each time*/
+    const MP4_Box_data_stz2_t *p_stz2;
+
+    /* chunks with decoded dts/pts extracts, most recently used first */
+    uint32_t         timed_chunk[MP4_TIMED_CHUNKS];
+    unsigned         i_timed_chunks;
 
     uint32_t     i_sample_first; /* i_sample_first value
                                                    of the next chunk */
@@ -32,9 +32,12 @@
 
 #include <vlc_common.h>
 #include <vlc_plugin.h>
+#include <vlc_atomic.h>
 
 #include <assert.h>
+#include <errno.h>
 #include <time.h>
+#include <sys/stat.h>
 
 #include <vlc_access.h>    /* DVB-specific things */
 #include <vlc_demux.h>
@@ -42,6 +45,8 @@
 #include <vlc_epg.h>
 #include <vlc_charset.h>   /* FromCharset, for EIT */
 #include <vlc_bits.h>
+#include <vlc_fs.h>
+#include <vlc_md5.h>
 
 #include "../../mux/mpeg/csa.h"
 
@@ -134,6 +139,17 @@ static void Close ( vlc_object_t * );
     "Seek and position based on a percent byte position, not a PCR generated " \
     "time position. If seeking doesn't work property, turn on this option." )
 
+#define SEEK_INDEX_TEXT N_("Keep seek indexes")
+#define SEEK_INDEX_LONGTEXT N_( \
+    "Save the time to position index built while playing a file, and use " \
+    "it to seek and get the duration at once when it is played again." )
+
+#define PROGRAM_THREADS_TEXT N_("Program threads")
+#define PROGRAM_THREADS_LONGTEXT N_( \
+    "Number of threads gathering the elementary streams of live streams, " \
+    "each program being handled by one of them (0 = automatic, " \
+    "1 = everything on the input thread)." )
+
 #define PCR_TEXT N_("Trust in-stream PCR")
 #define PCR_LONGTEXT N_("Use the stream PCR as a reference.")
 
@@ -169,6 +185,9 @@ vlc_module_begin ()
 
     add_bool( "ts-split-es", true, SPLIT_ES_TEXT, SPLIT_ES_LONGTEXT, false )
     add_bool( "ts-seek-percent", false, SEEK_PERCENT_TEXT, SEEK_PERCENT_LONGTEXT, true )
+    add_bool( "ts-seek-index", false, SEEK_INDEX_TEXT, SEEK_INDEX_LONGTEXT, true )
+    add_integer_with_range( "ts-program-threads", 1, 0, 16,
+                            PROGRAM_THREADS_TEXT, PROGRAM_THREADS_LONGTEXT, true )
 
     add_integer( "ts-arib", ARIBMODE_AUTO, SUPPORT_ARIB_TEXT, SUPPORT_ARIB_LONGTEXT, false )
         change_integer_list( arib_mode_list, arib_mode_list_text )
@@ -212,6 +231,7 @@ typedef struct
     /* IOD stuff (mpeg4) */
     od_descriptor_t *iod;
     od_descriptors_t od;
+    bool            b_od_pending; /* ES changes left to the input thread by a worker */
 
     DECL_ARRAY(ts_pid_t *) e_streams;
 
@@ -224,10 +244,13 @@ typedef struct
         mtime_t i_pcroffset;
         bool    b_disable; /* ignore PCR field, use dts */
         bool    b_fix_done;
+        bool    b_fix_pending; /* left to the input thread by a worker */
     } pcr;
 
     mtime_t i_last_dts;
 
+    int     i_worker; /* thread handling the program, -1 if none yet */
+
 } ts_pmt_t;
 
 typedef struct
@@ -339,6 +362,49 @@ typedef struct
     int i_service;
 } vdr_info_t;
 
+typedef struct
+{
+    mtime_t i_pcr;  /* wrapped around like the program one */
+    int64_t i_pos;  /* of the packet carrying it */
+    bool    b_rap;  /* random access indicator set */
+} ts_seekpoint_t;
+
+/* PCR to position index of a program, built while playing */
+typedef struct
+{
+    int     i_number;
+    /* boundaries, to skip probing when the file is played again */
+    mtime_t i_first_pcr;
+    mtime_t i_first_dts;
+    mtime_t i_last_dts;
+
+    ts_seekpoint_t *p_points; /* sorted by PCR and by position */
+    int     i_points;
+    int     i_points_alloc;
+} ts_seekindex_t;
+
+/* Packets of the programs handled by a thread */
+typedef struct
+{
+    demux_t     *p_demux;
+    int          i_index;
+    vlc_thread_t thread;
+
+    vlc_mutex_t  lock;
+    vlc_cond_t   wait;
+    vlc_cond_t   idle;
+    block_t     *p_first;
+    block_t    **pp_last;
+    unsigned     i_depth;
+    bool         b_busy;
+    bool         b_exit;
+
+    /* packets of the current Demux() call, input thread only */
+    block_t     *p_pending;
+    block_t    **pp_pending;
+    unsigned     i_pending;
+} ts_worker_t;
+
 #define MIN_ES_PID 4    /* Should be 32.. broken muxers */
 #define MAX_ES_PID 8190
 #define MIN_PAT_INTERVAL CLOCK_FREQ // DVB is 500ms
@@ -361,8 +427,37 @@ struct demux_sys_t
     /* how many TS packet we read at once */
     unsigned    i_ts_read;
 
+    /* Data read from the stream but not demuxed yet */
+    struct
+    {
+        uint8_t  *p_data;
+        size_t    i_size;  /* allocated bytes */
+        size_t    i_start; /* first byte not demuxed */
+        size_t    i_end;   /* first byte not read */
+    } readbuf;
+
     bool        b_force_seek_per_percent;
 
+    /* Program threads, for live streams */
+    struct
+    {
+        ts_worker_t *p_elems;
+        int          i_count;
+        int          i_next; /* for the next program */
+        atomic_bool  b_pcrfix;
+        atomic_bool  b_odupdate;
+    } workers;
+
+    /* Seek indexes, and the cache file keeping them */
+    struct
+    {
+        DECL_ARRAY(ts_seekindex_t *) programs;
+        char       *psz_path; /* NULL if not kept */
+        int64_t     i_size;
+        int64_t     i_mtime;
+        bool        b_dirty;
+    } seekindex;
+
     struct
     {
         arib_modes_e e_mode;
@@ -381,9 +476,8 @@ struct demux_sys_t
         ts_pid_t **pp_all;
         int        i_all;
         int        i_all_alloc;
-        /* last recently used */
-        uint16_t   i_last_pid;
-        ts_pid_t  *p_last;
+        /* the same ones, indexed by pid */
+        ts_pid_t  *p_index[0x2000];
     } pids;
 
     bool        b_user_pmt;
@@ -473,17 +567,32 @@ static inline int PIDGet( block_t *p )
     return ( (p->p_buffer[1]&0x1f)<<8 )|p->p_buffer[2];
 }
 
-static bool GatherData( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk );
+static bool GatherData( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk, int i_worker );
 static void AddAndCreateES( demux_t *p_demux, ts_pid_t *pid, bool );
 static void ProgramSetPCR( demux_t *p_demux, ts_pmt_t *p_prg, mtime_t i_pcr );
 
 static block_t* ReadTSPacket( demux_t *p_demux );
+static uint8_t *NextTSPacket( demux_t *p_demux );
 static int ProbeStart( demux_t *p_demux, int i_program );
 static int ProbeEnd( demux_t *p_demux, int i_program );
 static int SeekToTime( demux_t *p_demux, ts_pmt_t *, int64_t time );
+
+static void WorkersStart( demux_t *, unsigned i_count );
+static void WorkersStop( demux_t * );
+static void WorkersDrain( demux_t * );
+static bool WorkersPush( demux_t *, ts_pid_t *, block_t * );
+static void WorkersFlush( demux_t * );
+
+static ts_seekindex_t *SeekIndexGet( demux_sys_t *, int i_number, bool b_create );
+static void SeekIndexPCR( demux_t *, ts_pmt_t *, mtime_t i_pcr, const block_t * );
+static void SeekIndexLoad( demux_t * );
+static void SeekIndexSave( demux_t * );
+static void SeekIndexClean( demux_sys_t * );
 static void ReadyQueuesPostSeek( demux_t *p_demux );
-static void PCRHandle( demux_t *p_demux, ts_pid_t *, block_t * );
+static void PCRHandle( demux_t *p_demux, ts_pid_t *, block_t *, int i_worker );
+static mtime_t GetPCR( block_t * );
 static void PCRFixHandle( demux_t *, ts_pmt_t *, block_t * );
+static void PCRFixApply( demux_t *, ts_pmt_t * );
 static int64_t TimeStampWrapAround( ts_pmt_t *, int64_t );
 
 /* MPEG4 related */
@@ -491,6 +600,7 @@ static const es_mpeg4_descriptor_t * GetMPEG4DescByEsId( const ts_pmt_t *, uint1
 static ts_pes_es_t * GetPMTESBySLEsId( ts_pmt_t *, uint16_t );
 static bool SetupISO14496LogicalStream( demux_t *, const decoder_config_descriptor_t *,
                                         es_format_t * );
+static void ODApply( demux_t *, ts_pmt_t * );
 
 #define TS_USER_PMT_NUMBER (0)
 static int UserPmt( demux_t *p_demux, const char * );
@@ -503,6 +613,11 @@ static int  SetPIDFilter( demux_sys_t *, ts_pid_t *, bool b_selected );
 #define TS_PACKET_SIZE_MAX 204
 #define TS_HEADER_SIZE 4
 
+/* how many TS packets are read from the stream at once: live streams
+ * only read a datagram worth of packets, not to wait for more */
+#define TS_READ_BATCH 256
+#define TS_READ_BATCH_LIVE 7
+
 static int DetectPacketSize( demux_t *p_demux, unsigned *pi_header_size, int i_offset )
 {
     const uint8_t *p_peek;
@@ -989,6 +1104,7 @@ static int Open( vlc_object_t *p_this )
     p_sys->b_access_control = true;
     p_sys->b_end_preparse = false;
     ARRAY_INIT( p_sys->programs );
+    ARRAY_INIT( p_sys->seekindex.programs );
     p_sys->b_default_selection = false;
     p_sys->i_tdt_delta = 0;
     p_sys->i_dvb_start = 0;
@@ -1139,6 +1255,21 @@ static int Open( vlc_object_t *p_this )
     stream_Control( p_sys->stream, STREAM_CAN_SEEK, &p_sys->b_canseek );
     stream_Control( p_sys->stream, STREAM_CAN_FASTSEEK, &p_sys->b_canfastseek );
 
+    atomic_init( &p_sys->workers.b_pcrfix, false );
+    atomic_init( &p_sys->workers.b_odupdate, false );
+    if( !p_sys->b_canseek )
+    {
+        unsigned i_threads = var_InheritInteger( p_demux, "ts-program-threads" );
+        if( i_threads == 0 )
+            i_threads = __MIN( vlc_GetCPUCount(), 8 );
+        if( i_threads > 1 )
+            WorkersStart( p_demux, i_threads );
+    }
+
+    /* Before the PMT, which would probe the boundaries again */
+    if( p_sys->b_canseek && var_InheritBool( p_demux, "ts-seek-index" ) )
+        SeekIndexLoad( p_demux );
+
     /* Preparse time */
     if( p_sys->b_canseek )
     {
@@ -1162,6 +1293,9 @@ static void Close( vlc_object_t *p_this )
     demux_t     *p_demux = (demux_t*)p_this;
     demux_sys_t *p_sys = p_demux->p_sys;
 
+    WorkersStop( p_demux );
+    SeekIndexSave( p_demux );
+
     PIDRelease( p_demux, GetPID(p_sys, 0) );
 
     if( p_sys->b_dvb_meta )
@@ -1206,6 +1340,8 @@ static void Close( vlc_object_t *p_this )
         free( pid );
     }
     free( p_sys->pids.pp_all );
+    free( p_sys->readbuf.p_data );
+    SeekIndexClean( p_sys );
 
     free( p_sys );
 }
@@ -1232,6 +1368,258 @@ static int ChangeKeyCallback( vlc_object_t *p_this, char const *psz_cmd,
     return i_tmp;
 }
 
+/*****************************************************************************
+ * Program threads:
+ *****************************************************************************
+ * On live streams, the packets of the elementary streams can be gathered and
+ * sent by one thread per group of programs, the input thread still reading
+ * the packets and handling the tables. Each program only ever goes to one
+ * thread, which keeps the order of its ES. The workers are drained before
+ * the input thread changes anything they use.
+ *****************************************************************************/
+
+/* how many packets may wait for a worker */
+#define TS_WORKER_QUEUE 4096
+/* the packet only carries a PCR for the programs of that worker */
+#define TS_WORKER_PCR_ONLY (1 << BLOCK_FLAG_PRIVATE_SHIFT)
+
+static void *WorkerThread( void *data )
+{
+    ts_worker_t *p_worker = data;
+    demux_t *p_demux = p_worker->p_demux;
+
+    vlc_mutex_lock( &p_worker->lock );
+    for( ;; )
+    {
+        while( !p_worker->b_exit && p_worker->p_first == NULL )
+            vlc_cond_wait( &p_worker->wait, &p_worker->lock );
+        if( p_worker->b_exit )
+            break;
+
+        block_t *p_chain = p_worker->p_first;
+        p_worker->p_first = NULL;
+        p_worker->pp_last = &p_worker->p_first;
+        p_worker->i_depth = 0;
+        p_worker->b_busy = true;
+        vlc_cond_broadcast( &p_worker->idle );
+        vlc_mutex_unlock( &p_worker->lock );
+
+        while( p_chain )
+        {
+            block_t *p_bk = p_chain;
+            p_chain = p_chain->p_next;
+            p_bk->p_next = NULL;
+
+            /* The pid was seen by the input thread, it cannot be created
+             * there concurrently */
+            ts_pid_t *p_pid = GetPID( p_demux->p_sys, PIDGet( p_bk ) );
+            if( p_bk->i_flags & TS_WORKER_PCR_ONLY )
+            {
+                PCRHandle( p_demux, p_pid, p_bk, p_worker->i_index );
+                block_Release( p_bk );
+            }
+            else
+                GatherData( p_demux, p_pid, p_bk, p_worker->i_index );
+        }
+
+        vlc_mutex_lock( &p_worker->lock );
+        p_worker->b_busy = false;
+        vlc_cond_broadcast( &p_worker->idle );
+    }
+    vlc_mutex_unlock( &p_worker->lock );
+    return NULL;
+}
+
+static void WorkersStart( demux_t *p_demux, unsigned i_count )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    /* a packet goes to the workers of a 32 bits mask */
+    i_count = __MIN( i_count, 32 );
+    p_sys->workers.p_elems = calloc( i_count, sizeof(ts_worker_t) );
+    if( unlikely(p_sys->workers.p_elems == NULL) )
+        return;
+
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        ts_worker_t *p_worker = &p_sys->workers.p_elems[i];
+
+        p_worker->p_demux = p_demux;
+        p_worker->i_index = i;
+        vlc_mutex_init( &p_worker->lock );
+        vlc_cond_init( &p_worker->wait );
+        vlc_cond_init( &p_worker->idle );
+        p_worker->pp_last = &p_worker->p_first;
+        p_worker->pp_pending = &p_worker->p_pending;
+
+        if( vlc_clone( &p_worker->thread, WorkerThread, p_worker,
+                       VLC_THREAD_PRIORITY_INPUT ) )
+        {
+            vlc_cond_destroy( &p_worker->idle );
+            vlc_cond_destroy( &p_worker->wait );
+            vlc_mutex_destroy( &p_worker->lock );
+            break;
+        }
+        p_sys->workers.i_count++;
+    }
+
+    /* A single worker would only add latency */
+    if( p_sys->workers.i_count < 2 )
+        WorkersStop( p_demux );
+    else
+        msg_Dbg( p_demux, "using %d program threads", p_sys->workers.i_count );
+}
+
+static void WorkersStop( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    for( int i = 0; i < p_sys->workers.i_count; i++ )
+    {
+        ts_worker_t *p_worker = &p_sys->workers.p_elems[i];
+
+        vlc_mutex_lock( &p_worker->lock );
+        p_worker->b_exit = true;
+        vlc_cond_signal( &p_worker->wait );
+        vlc_mutex_unlock( &p_worker->lock );
+        vlc_join( p_worker->thread, NULL );
+
+        block_ChainRelease( p_worker->p_first );
+        block_ChainRelease( p_worker->p_pending );
+        vlc_cond_destroy( &p_worker->idle );
+        vlc_cond_destroy( &p_worker->wait );
+        vlc_mutex_destroy( &p_worker->lock );
+    }
+    free( p_sys->workers.p_elems );
+    p_sys->workers.p_elems = NULL;
+    p_sys->workers.i_count = 0;
+}
+
+/* Hands the packets of the current Demux() call to the workers */
+static void WorkersFlush( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    for( int i = 0; i < p_sys->workers.i_count; i++ )
+    {
+        ts_worker_t *p_worker = &p_sys->workers.p_elems[i];
+        if( p_worker->p_pending == NULL )
+            continue;
+
+        vlc_mutex_lock( &p_worker->lock );
+        while( p_worker->i_depth >= TS_WORKER_QUEUE )
+            vlc_cond_wait( &p_worker->idle, &p_worker->lock );
+        *p_worker->pp_last = p_worker->p_pending;
+        p_worker->pp_last = p_worker->pp_pending;
+        p_worker->i_depth += p_worker->i_pending;
+        vlc_cond_signal( &p_worker->wait );
+        vlc_mutex_unlock( &p_worker->lock );
+
+        p_worker->p_pending = NULL;
+        p_worker->pp_pending = &p_worker->p_pending;
+        p_worker->i_pending = 0;
+    }
+}
+
+/* Waits for the workers to be done with all the packets read so far */
+static void WorkersDrain( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    WorkersFlush( p_demux );
+    for( int i = 0; i < p_sys->workers.i_count; i++ )
+    {
+        ts_worker_t *p_worker = &p_sys->workers.p_elems[i];
+
+        vlc_mutex_lock( &p_worker->lock );
+        while( p_worker->p_first != NULL || p_worker->b_busy )
+            vlc_cond_wait( &p_worker->idle, &p_worker->lock );
+        vlc_mutex_unlock( &p_worker->lock );
+    }
+}
+
+/* The workers compare the programs' threads to their own, so a program only
+ * gets one while they are drained */
+static int ProgramWorker( demux_t *p_demux, ts_pmt_t *p_pmt )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( p_pmt->i_worker < 0 )
+    {
+        WorkersDrain( p_demux );
+        p_pmt->i_worker = p_sys->workers.i_next++ % p_sys->workers.i_count;
+    }
+    return p_pmt->i_worker;
+}
+
+/* Queues the packet for the workers of the programs it is for, returns false
+ * if it is for the input thread */
+static bool WorkersPush( demux_t *p_demux, ts_pid_t *p_pid, block_t *p_pkt )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    int i_owner = -1;
+
+    /* Only the PCR of scrambled packets can be used */
+    const bool b_clear = !SCRAMBLED(*p_pid) || p_sys->csa;
+
+    if( b_clear && p_pid->type == TYPE_PES )
+    {
+        p_sys->b_end_preparse = true;
+
+        if( p_sys->es_creation == DELAY_ES ) /* No longer delay ES since that pid's program sends data */
+        {
+            WorkersDrain( p_demux );
+            msg_Dbg( p_demux, "Creating delayed ES" );
+            AddAndCreateES( p_demux, p_pid, true );
+        }
+
+        if( !p_sys->b_access_control && !(p_pid->i_flags & FLAG_FILTERED) )
+            return true;
+
+        i_owner = ProgramWorker( p_demux, p_pid->p_parent->u.p_pmt );
+    }
+    else if( b_clear && p_pid->type != TYPE_FREE ) /* tables */
+        return false;
+
+    /* Every program using that PCR gets it in its own thread */
+    uint32_t i_pcr_workers = 0;
+    if( GetPCR( p_pkt ) >= 0 )
+    {
+        p_pid->probed.i_pcr_count++;
+
+        if( p_sys->i_pmt_es > 0 && GetPID(p_sys, 0)->type == TYPE_PAT )
+        {
+            ts_pat_t *p_pat = GetPID(p_sys, 0)->u.p_pat;
+            for( int i = 0; i < p_pat->programs.i_size; i++ )
+            {
+                ts_pmt_t *p_pmt = p_pat->programs.p_elems[i]->u.p_pmt;
+                if( p_pmt->i_pid_pcr == p_pid->i_pid ||
+                    ( p_pmt->i_pid_pcr == 0x1FFF &&
+                      p_pid->p_parent == p_pat->programs.p_elems[i] ) )
+                    i_pcr_workers |= UINT32_C(1) << ProgramWorker( p_demux, p_pmt );
+            }
+        }
+    }
+
+    for( int i = 0; i < p_sys->workers.i_count; i++ )
+    {
+        if( i != i_owner && !(i_pcr_workers & (UINT32_C(1) << i)) )
+            continue;
+
+        block_t *p_bk = block_Duplicate( p_pkt );
+        if( unlikely(p_bk == NULL) )
+            continue;
+        if( i != i_owner )
+            p_bk->i_flags |= TS_WORKER_PCR_ONLY;
+
+        ts_worker_t *p_worker = &p_sys->workers.p_elems[i];
+        *p_worker->pp_pending = p_bk;
+        p_worker->pp_pending = &p_bk->p_next;
+        p_worker->i_pending++;
+    }
+    return true;
+}
+
 /*****************************************************************************
  * Demux:
  *****************************************************************************/
@@ -1243,20 +1631,61 @@ static int Demux( demux_t *p_demux )
     /* If we had no PAT within MIN_PAT_INTERVAL, create PAT/PMT from probed streams */
     if( p_sys->i_pmt_es == 0 && !SEEN(GetPID(p_sys, 0)) && p_sys->patfix.status == PAT_MISSING )
     {
+        WorkersDrain( p_demux );
         MissingPATPMTFixup( p_demux );
         p_sys->patfix.status = PAT_FIXTRIED;
     }
 
+    /* PCR workarounds left by the workers */
+    if( p_sys->workers.i_count > 0 && atomic_exchange( &p_sys->workers.b_pcrfix, false ) )
+    {
+        WorkersDrain( p_demux );
+        if( GetPID(p_sys, 0)->type == TYPE_PAT )
+        {
+            ts_pat_t *p_pat = GetPID(p_sys, 0)->u.p_pat;
+            for( int i = 0; i < p_pat->programs.i_size; i++ )
+            {
+                ts_pmt_t *p_pmt = p_pat->programs.p_elems[i]->u.p_pmt;
+                if( p_pmt->pcr.b_fix_pending )
+                    PCRFixApply( p_demux, p_pmt );
+            }
+        }
+    }
+
+    /* Object descriptor updates left by the workers */
+    if( p_sys->workers.i_count > 0 && atomic_exchange( &p_sys->workers.b_odupdate, false ) )
+    {
+        WorkersDrain( p_demux );
+        if( GetPID(p_sys, 0)->type == TYPE_PAT )
+        {
+            ts_pat_t *p_pat = GetPID(p_sys, 0)->u.p_pat;
+            for( int i = 0; i < p_pat->programs.i_size; i++ )
+            {
+                ts_pmt_t *p_pmt = p_pat->programs.p_elems[i]->u.p_pmt;
+                if( p_pmt->b_od_pending )
+                    ODApply( p_demux, p_pmt );
+            }
+        }
+    }
+
     /* We read at most 100 TS packet or until a frame is completed */
     for( unsigned i_pkt = 0; i_pkt < p_sys->i_ts_read; i_pkt++ )
     {
         bool         b_frame = false;
-        block_t     *p_pkt;
-        if( !(p_pkt = ReadTSPacket( p_demux )) )
+        block_t      pkt, *p_pkt = &pkt;
+        uint8_t     *p_data;
+
+        if( !(p_data = NextTSPacket( p_demux )) )
         {
+            WorkersFlush( p_demux );
             return VLC_DEMUXER_EOF;
         }
 
+        /* The packet stays in the read buffer: only the packets whose data
+         * is gathered are copied to a block of their own */
+        block_Init( &pkt, p_data + p_sys->i_packet_header_size,
+                    p_sys->i_packet_size - p_sys->i_packet_header_size );
+
         if( p_sys->b_start_record )
         {
             /* Enable recording once synchronized */
@@ -1280,10 +1709,9 @@ static int Demux( demux_t *p_demux )
             p_pid->i_flags |= FLAG_SEEN;
         }
 
-        if ( SCRAMBLED(*p_pid) && !p_demux->p_sys->csa )
+        if ( SCRAMBLED(*p_pid) && !p_demux->p_sys->csa && p_sys->workers.i_count == 0 )
         {
-            PCRHandle( p_demux, p_pid, p_pkt );
-            block_Release( p_pkt );
+            PCRHandle( p_demux, p_pid, p_pkt, -1 );
             continue;
         }
 
@@ -1297,16 +1725,17 @@ static int Demux( demux_t *p_demux )
                       p_pkt->i_buffer - TS_HEADER_SIZE, p_pkt->p_buffer[3] & 0x20 /* Adaptation field */);
         }
 
+        if( p_sys->workers.i_count > 0 && WorkersPush( p_demux, p_pid, p_pkt ) )
+            continue;
+
         switch( p_pid->type )
         {
         case TYPE_PAT:
             dvbpsi_packet_push( p_pid->u.p_pat->handle, p_pkt->p_buffer );
-            block_Release( p_pkt );
             break;
 
         case TYPE_PMT:
             dvbpsi_packet_push( p_pid->u.p_pmt->handle, p_pkt->p_buffer );
-            block_Release( p_pkt );
             break;
 
         case TYPE_PES:
@@ -1321,11 +1750,12 @@ static int Demux( demux_t *p_demux )
             if( !p_sys->b_access_control && !(p_pid->i_flags & FLAG_FILTERED) )
             {
                 /* That packet is for an unselected ES, don't waste time/memory gathering its data */
-                block_Release( p_pkt );
                 continue;
             }
 
-            b_frame = GatherData( p_demux, p_pid, p_pkt );
+            p_pkt = block_Duplicate( p_pkt );
+            if( likely(p_pkt != NULL) )
+                b_frame = GatherData( p_demux, p_pid, p_pkt, -1 );
             break;
 
         case TYPE_SDT:
@@ -1333,13 +1763,11 @@ static int Demux( demux_t *p_demux )
         case TYPE_EIT:
             if( p_sys->b_dvb_meta )
                 dvbpsi_packet_push( p_pid->u.p_psi->handle, p_pkt->p_buffer );
-            block_Release( p_pkt );
             break;
 
         default:
             /* We have to handle PCR if present */
-            PCRHandle( p_demux, p_pid, p_pkt );
-            block_Release( p_pkt );
+            PCRHandle( p_demux, p_pid, p_pkt, -1 );
             break;
         }
 
@@ -1347,6 +1775,7 @@ static int Demux( demux_t *p_demux )
             break;
     }
 
+    WorkersFlush( p_demux );
     demux_UpdateTitleFromStream( p_demux );
     return VLC_DEMUXER_SUCCESS;
 }
@@ -1448,6 +1877,9 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
     ts_pmt_t *p_pmt;
     int i_first_program = ( p_sys->programs.i_size ) ? p_sys->programs.p_elems[0] : 0;
 
+    /* Everything below looks at the programs */
+    WorkersDrain( p_demux );
+
     if( PREPARSING || !i_first_program || p_sys->b_default_selection )
     {
         if( likely(GetPID(p_sys, 0)->type == TYPE_PAT) )
@@ -1502,7 +1934,8 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 
         if( (i64 = stream_Size( p_sys->stream) ) > 0 )
         {
-            int64_t offset = stream_Tell( p_sys->stream );
+            int64_t offset = stream_Tell( p_sys->stream ) -
+                (p_sys->readbuf.i_end - p_sys->readbuf.i_start);
             *pf = (double)offset / (double)i64;
             return VLC_SUCCESS;
         }
@@ -2433,38 +2866,15 @@ static void ParseTableSection( demux_t *p_demux, ts_pid_t *pid, block_t *p_data
             sl_header_data header = DecodeSLHeader( i_data, p_data, &p_mpeg4desc->sl_descr );
 
             DecodeODCommand( VLC_OBJECT(p_demux), p_ods, i_data - header.i_size, &p_data[header.i_size] );
-            bool b_changed = false;
 
-            for( int i=0; i<p_ods->objects.i_size; i++ )
+            if( p_demux->p_sys->workers.i_count > 0 )
             {
-                od_descriptor_t *p_od = p_ods->objects.p_elems[i];
-                for( int j = 0; j < ES_DESCRIPTOR_COUNT && p_od->es_descr[j].b_ok; j++ )
-                {
-                    p_mpeg4desc = &p_od->es_descr[j];
-                    ts_pes_es_t *p_es = GetPMTESBySLEsId( p_pmt, p_mpeg4desc->i_es_id );
-                    es_format_t fmt;
-                    es_format_Init( &fmt, UNKNOWN_ES, 0 );
-                    fmt.i_id = p_es->fmt.i_id;
-                    fmt.i_group = p_es->fmt.i_group;
-
-                    if ( p_mpeg4desc && p_mpeg4desc->b_ok && p_es &&
-                         SetupISO14496LogicalStream( p_demux, &p_mpeg4desc->dec_descr, &fmt ) &&
-                         !es_format_IsSimilar( &fmt, &p_es->fmt ) )
-                    {
-                        es_format_Clean( &p_es->fmt );
-                        p_es->fmt = fmt;
-
-                        es_out_Del( p_demux->out, p_es->id );
-                        p_es->fmt.b_packetized = true; /* Split by access unit, no sync code */
-                        FREENULL( p_es->fmt.psz_description );
-                        p_es->id = es_out_Add( p_demux->out, &p_es->fmt );
-                        b_changed = true;
-                    }
-                }
+                /* It recreates ES and changes the filters */
+                p_pmt->b_od_pending = true;
+                atomic_store( &p_demux->p_sys->workers.b_odupdate, true );
             }
-
-            if( b_changed )
-                UpdatePESFilters( p_demux, p_demux->p_sys->b_es_all );
+            else
+                ODApply( p_demux, p_pmt );
 
             p_ods->i_version = i_version;
         }
@@ -2478,6 +2888,46 @@ static void ParseTableSection( demux_t *p_demux, ts_pid_t *pid, block_t *p_data
         block_Release( p_content );
 }
 
+/* Recreates the ES whose object descriptor changed */
+static void ODApply( demux_t *p_demux, ts_pmt_t *p_pmt )
+{
+    od_descriptors_t *p_ods = &p_pmt->od;
+    p_pmt->b_od_pending = false;
+
+    bool b_changed = false;
+
+    for( int i=0; i<p_ods->objects.i_size; i++ )
+    {
+        od_descriptor_t *p_od = p_ods->objects.p_elems[i];
+        for( int j = 0; j < ES_DESCRIPTOR_COUNT && p_od->es_descr[j].b_ok; j++ )
+        {
+            const es_mpeg4_descriptor_t *p_mpeg4desc = &p_od->es_descr[j];
+            ts_pes_es_t *p_es = GetPMTESBySLEsId( p_pmt, p_mpeg4desc->i_es_id );
+            es_format_t fmt;
+            es_format_Init( &fmt, UNKNOWN_ES, 0 );
+            fmt.i_id = p_es->fmt.i_id;
+            fmt.i_group = p_es->fmt.i_group;
+
+            if ( p_mpeg4desc && p_mpeg4desc->b_ok && p_es &&
+                 SetupISO14496LogicalStream( p_demux, &p_mpeg4desc->dec_descr, &fmt ) &&
+                 !es_format_IsSimilar( &fmt, &p_es->fmt ) )
+            {
+                es_format_Clean( &p_es->fmt );
+                p_es->fmt = fmt;
+
+                es_out_Del( p_demux->out, p_es->id );
+                p_es->fmt.b_packetized = true; /* Split by access unit, no sync code */
+                FREENULL( p_es->fmt.psz_description );
+                p_es->id = es_out_Add( p_demux->out, &p_es->fmt );
+                b_changed = true;
+            }
+        }
+    }
+
+    if( b_changed )
+        UpdatePESFilters( p_demux, p_demux->p_sys->b_es_all );
+}
+
 static void ParseData( demux_t *p_demux, ts_pid_t *pid )
 {
     block_t *p_data = pid->u.p_pes->p_data;
@@ -2580,6 +3030,86 @@ static block_t* ReadTSPacket( demux_t *p_demux )
     return p_pkt;
 }
 
+/* Returns the next packet (including its header, for BluRay streams) from
+ * the read buffer, refilling it with a single stream read when needed.
+ * The packet is valid until the next call. */
+static uint8_t *NextTSPacket( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const size_t i_size = p_sys->i_packet_size;
+    const size_t i_hdr = p_sys->i_packet_header_size;
+    size_t i_garbage = 0;
+    bool b_sync = true;
+
+    if( unlikely(p_sys->readbuf.p_data == NULL) )
+    {
+        p_sys->readbuf.i_size = i_size * ( p_sys->b_canseek ? TS_READ_BATCH
+                                                            : TS_READ_BATCH_LIVE );
+        p_sys->readbuf.p_data = malloc( p_sys->readbuf.i_size );
+        if( unlikely(p_sys->readbuf.p_data == NULL) )
+            return NULL;
+    }
+
+    for( ;; )
+    {
+        uint8_t *p = &p_sys->readbuf.p_data[p_sys->readbuf.i_start];
+        size_t i_avail = p_sys->readbuf.i_end - p_sys->readbuf.i_start;
+
+        if( b_sync && i_avail >= i_size )
+        {
+            if( likely(p[i_hdr] == 0x47) )
+            {
+                p_sys->readbuf.i_start += i_size;
+                return p;
+            }
+
+            /* Drop the packet, then skip the garbage up to two sync bytes
+             * one packet apart */
+            msg_Warn( p_demux, "lost synchro" );
+            p_sys->readbuf.i_start += i_size;
+            b_sync = false;
+            continue;
+        }
+        else if( !b_sync )
+        {
+            size_t i_skip = 0;
+
+            while( i_skip + i_hdr + i_size < i_avail &&
+                   !( p[i_skip + i_hdr] == 0x47 &&
+                      p[i_skip + i_hdr + i_size] == 0x47 ) )
+                i_skip++;
+
+            p_sys->readbuf.i_start += i_skip;
+            i_avail -= i_skip;
+            i_garbage += i_skip;
+            if( i_hdr + i_size < i_avail )
+            {
+                msg_Dbg( p_demux, "skipping %zu bytes of garbage", i_garbage );
+                b_sync = true;
+                continue;
+            }
+        }
+
+        /* Refill the buffer */
+        memmove( p_sys->readbuf.p_data,
+                 &p_sys->readbuf.p_data[p_sys->readbuf.i_start], i_avail );
+        p_sys->readbuf.i_start = 0;
+        p_sys->readbuf.i_end = i_avail;
+
+        ssize_t i_read = stream_Read( p_sys->stream, &p_sys->readbuf.p_data[i_avail],
+                                      p_sys->readbuf.i_size - i_avail );
+        if( i_read <= 0 )
+        {
+            if( stream_Tell( p_sys->stream ) == stream_Size( p_sys->stream ) )
+                msg_Dbg( p_demux, "EOF at %"PRId64, stream_Tell( p_sys->stream ) );
+            else
+                msg_Dbg( p_demux, "Can't read TS packet at %"PRId64, stream_Tell(p_sys->stream) );
+            return NULL;
+        }
+        p_sys->readbuf.i_end += i_read;
+    }
+}
+
 static int64_t TimeStampWrapAround( ts_pmt_t *p_pmt, int64_t i_time )
 {
     int64_t i_adjust = 0;
@@ -2614,6 +3144,8 @@ static void UpdateScrambledState( demux_t *p_demux, ts_pid_t *p_pid, bool b_scra
     if( !SCRAMBLED(*p_pid) == !b_scrambled )
         return;
 
+    WorkersDrain( p_demux );
+
     msg_Warn( p_demux, "scrambled state changed on pid %d (%d->%d)",
               p_pid->i_pid, !!SCRAMBLED(*p_pid), b_scrambled );
 
@@ -2657,6 +3189,9 @@ static void ReadyQueuesPostSeek( demux_t *p_demux )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
 
+    /* The buffered data is from before the seek */
+    p_sys->readbuf.i_start = p_sys->readbuf.i_end = 0;
+
     ts_pat_t *p_pat = GetPID(p_sys, 0)->u.p_pat;
     for( int i=0; i< p_pat->programs.i_size; i++ )
     {
@@ -2693,6 +3228,311 @@ static void ReadyQueuesPostSeek( demux_t *p_demux )
     }
 }
 
+/* A PCR is indexed at most every TS_INDEX_INTERVAL, and a seek within two
+ * intervals of an indexed one goes right to it */
+#define TS_INDEX_INTERVAL   TO_SCALE_NZ(CLOCK_FREQ / 2)
+/* how far before the target a random access point is looked for */
+#define TS_INDEX_RAP_WINDOW TO_SCALE_NZ(3 * CLOCK_FREQ)
+
+#define TS_INDEX_MAGIC      "VLCTSIX1"
+#define TS_INDEX_HEADER     32
+#define TS_INDEX_PROGRAM    32
+#define TS_INDEX_POINT      16
+
+static ts_seekindex_t *SeekIndexGet( demux_sys_t *p_sys, int i_number, bool b_create )
+{
+    for( int i = 0; i < p_sys->seekindex.programs.i_size; i++ )
+    {
+        if( p_sys->seekindex.programs.p_elems[i]->i_number == i_number )
+            return p_sys->seekindex.programs.p_elems[i];
+    }
+
+    if( !b_create )
+        return NULL;
+
+    ts_seekindex_t *p_index = calloc( 1, sizeof(*p_index) );
+    if( unlikely(p_index == NULL) )
+        return NULL;
+    p_index->i_number = i_number;
+    p_index->i_first_pcr = -1;
+    p_index->i_first_dts = VLC_TS_INVALID;
+    p_index->i_last_dts = -1;
+    ARRAY_APPEND( p_sys->seekindex.programs, p_index );
+    return p_index;
+}
+
+/* Returns the first point after the PCR */
+static int SeekIndexUpper( const ts_seekindex_t *p_index, mtime_t i_pcr )
+{
+    int i_low = 0;
+    int i_high = p_index->i_points;
+
+    while( i_low < i_high )
+    {
+        int i_mid = i_low + (i_high - i_low) / 2;
+        if( p_index->p_points[i_mid].i_pcr <= i_pcr )
+            i_low = i_mid + 1;
+        else
+            i_high = i_mid;
+    }
+    return i_low;
+}
+
+static bool SeekIndexAdd( ts_seekindex_t *p_index, mtime_t i_pcr, int64_t i_pos, bool b_rap )
+{
+    const int i = SeekIndexUpper( p_index, i_pcr );
+    ts_seekpoint_t *p_prev = ( i > 0 ) ? &p_index->p_points[i - 1] : NULL;
+    ts_seekpoint_t *p_next = ( i < p_index->i_points ) ? &p_index->p_points[i] : NULL;
+
+    /* Already indexed, or a PCR discontinuity */
+    if( ( p_prev && p_prev->i_pos >= i_pos ) || ( p_next && p_next->i_pos <= i_pos ) )
+        return false;
+
+    if( p_next && p_next->i_pcr - i_pcr < TS_INDEX_INTERVAL )
+        return false;
+
+    if( p_prev && i_pcr - p_prev->i_pcr < TS_INDEX_INTERVAL )
+    {
+        /* Prefer the random access points */
+        if( !b_rap || p_prev->b_rap )
+            return false;
+        p_prev->i_pcr = i_pcr;
+        p_prev->i_pos = i_pos;
+        p_prev->b_rap = true;
+        return true;
+    }
+
+    if( p_index->i_points >= p_index->i_points_alloc )
+    {
+        int i_alloc = p_index->i_points_alloc ? 2 * p_index->i_points_alloc : 256;
+        ts_seekpoint_t *p_realloc = realloc( p_index->p_points,
+                                             i_alloc * sizeof(*p_realloc) );
+        if( unlikely(p_realloc == NULL) )
+            return false;
+        p_index->p_points = p_realloc;
+        p_index->i_points_alloc = i_alloc;
+    }
+
+    memmove( &p_index->p_points[i + 1], &p_index->p_points[i],
+             (p_index->i_points - i) * sizeof(*p_index->p_points) );
+    p_index->p_points[i].i_pcr = i_pcr;
+    p_index->p_points[i].i_pos = i_pos;
+    p_index->p_points[i].b_rap = b_rap;
+    p_index->i_points++;
+    return true;
+}
+
+static void SeekIndexPCR( demux_t *p_demux, ts_pmt_t *p_pmt, mtime_t i_pcr,
+                          const block_t *p_pkt )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( !p_sys->b_canseek )
+        return;
+
+    ts_seekindex_t *p_index = SeekIndexGet( p_sys, p_pmt->i_number, true );
+    if( unlikely(p_index == NULL) )
+        return;
+
+    /* The packet has just been taken from the read buffer */
+    int64_t i_pos = stream_Tell( p_sys->stream ) - p_sys->i_packet_size -
+                    (p_sys->readbuf.i_end - p_sys->readbuf.i_start);
+    /* GetPCR() checked the adaptation field size */
+    bool b_rap = p_pkt->p_buffer[5] & 0x40;
+
+    if( SeekIndexAdd( p_index, i_pcr, i_pos, b_rap ) )
+        p_sys->seekindex.b_dirty = true;
+}
+
+static void SeekIndexLoad( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    struct stat st;
+
+    /* Only local files can be told apart by their size and date */
+    if( p_demux->psz_file == NULL || vlc_stat( p_demux->psz_file, &st ) )
+        return;
+
+    char *psz_dir = config_GetUserDir( VLC_CACHE_DIR );
+    if( psz_dir == NULL )
+        return;
+
+    struct md5_s md5;
+    InitMD5( &md5 );
+    AddMD5( &md5, p_demux->psz_file, strlen( p_demux->psz_file ) );
+    EndMD5( &md5 );
+    char *psz_md5 = psz_md5_hash( &md5 );
+
+    if( psz_md5 == NULL ||
+        asprintf( &p_sys->seekindex.psz_path, "%s"DIR_SEP"ts-index"DIR_SEP"%s",
+                  psz_dir, psz_md5 ) == -1 )
+        p_sys->seekindex.psz_path = NULL;
+    free( psz_md5 );
+    free( psz_dir );
+    if( p_sys->seekindex.psz_path == NULL )
+        return;
+
+    p_sys->seekindex.i_size = st.st_size;
+    p_sys->seekindex.i_mtime = st.st_mtime;
+
+    FILE *p_file = vlc_fopen( p_sys->seekindex.psz_path, "rb" );
+    if( p_file == NULL )
+        return;
+
+    uint8_t hdr[TS_INDEX_HEADER];
+    if( fread( hdr, 1, TS_INDEX_HEADER, p_file ) != TS_INDEX_HEADER ||
+        memcmp( hdr, TS_INDEX_MAGIC, 8 ) ||
+        (int64_t)GetQWBE( &hdr[8] ) != p_sys->seekindex.i_size ||
+        (int64_t)GetQWBE( &hdr[16] ) != p_sys->seekindex.i_mtime ||
+        GetDWBE( &hdr[24] ) != p_sys->i_packet_size )
+    {
+        msg_Dbg( p_demux, "no valid seek index in %s", p_sys->seekindex.psz_path );
+        fclose( p_file );
+        return;
+    }
+
+    for( uint32_t i_programs = GetDWBE( &hdr[28] ); i_programs > 0; i_programs-- )
+    {
+        uint8_t prg[TS_INDEX_PROGRAM];
+        if( fread( prg, 1, TS_INDEX_PROGRAM, p_file ) != TS_INDEX_PROGRAM )
+            break;
+
+        ts_seekindex_t *p_index = SeekIndexGet( p_sys, GetDWBE( &prg[0] ), true );
+        if( unlikely(p_index == NULL) )
+            break;
+        p_index->i_first_pcr = GetQWBE( &prg[8] );
+        p_index->i_first_dts = GetQWBE( &prg[16] );
+        p_index->i_last_dts = GetQWBE( &prg[24] );
+
+        for( uint32_t i_points = GetDWBE( &prg[4] ); i_points > 0; i_points-- )
+        {
+            uint8_t pt[TS_INDEX_POINT];
+            if( fread( pt, 1, TS_INDEX_POINT, p_file ) != TS_INDEX_POINT )
+                break;
+            uint64_t i_pos = GetQWBE( &pt[8] );
+            SeekIndexAdd( p_index, GetQWBE( &pt[0] ), i_pos & INT64_MAX, i_pos >> 63 );
+        }
+
+        msg_Dbg( p_demux, "loaded %d seek points for program %d",
+                 p_index->i_points, p_index->i_number );
+    }
+
+    fclose( p_file );
+}
+
+static void SeekIndexSave( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( p_sys->seekindex.psz_path == NULL )
+        return;
+
+    /* Keep the boundaries probed during this playback */
+    if( GetPID(p_sys, 0)->type == TYPE_PAT )
+    {
+        ts_pat_t *p_pat = GetPID(p_sys, 0)->u.p_pat;
+        for( int i = 0; i < p_pat->programs.i_size; i++ )
+        {
+            ts_pmt_t *p_pmt = p_pat->programs.p_elems[i]->u.p_pmt;
+            if( p_pmt->i_last_dts <= 0 )
+                continue;
+
+            ts_seekindex_t *p_index = SeekIndexGet( p_sys, p_pmt->i_number, true );
+            if( unlikely(p_index == NULL) )
+                continue;
+            if( p_index->i_first_pcr != p_pmt->pcr.i_first ||
+                p_index->i_first_dts != p_pmt->pcr.i_first_dts ||
+                p_index->i_last_dts != p_pmt->i_last_dts )
+            {
+                p_index->i_first_pcr = p_pmt->pcr.i_first;
+                p_index->i_first_dts = p_pmt->pcr.i_first_dts;
+                p_index->i_last_dts = p_pmt->i_last_dts;
+                p_sys->seekindex.b_dirty = true;
+            }
+        }
+    }
+
+    if( !p_sys->seekindex.b_dirty )
+        return;
+
+    char *psz_dir = config_GetUserDir( VLC_CACHE_DIR );
+    char *psz_tmp;
+    if( psz_dir == NULL )
+        return;
+    vlc_mkdir( psz_dir, 0700 );
+    free( psz_dir );
+    psz_dir = strdup( p_sys->seekindex.psz_path );
+    if( likely(psz_dir != NULL) )
+    {
+        *strrchr( psz_dir, DIR_SEP_CHAR ) = '\0';
+        vlc_mkdir( psz_dir, 0700 );
+        free( psz_dir );
+    }
+
+    if( asprintf( &psz_tmp, "%s.part", p_sys->seekindex.psz_path ) == -1 )
+        return;
+
+    FILE *p_file = vlc_fopen( psz_tmp, "wb" );
+    if( p_file == NULL )
+    {
+        msg_Warn( p_demux, "cannot write seek index %s: %s", psz_tmp,
+                  vlc_strerror_c(errno) );
+        free( psz_tmp );
+        return;
+    }
+
+    bool b_error = false;
+    uint8_t hdr[TS_INDEX_HEADER];
+    memcpy( hdr, TS_INDEX_MAGIC, 8 );
+    SetQWBE( &hdr[8], p_sys->seekindex.i_size );
+    SetQWBE( &hdr[16], p_sys->seekindex.i_mtime );
+    SetDWBE( &hdr[24], p_sys->i_packet_size );
+    SetDWBE( &hdr[28], p_sys->seekindex.programs.i_size );
+    b_error |= fwrite( hdr, 1, TS_INDEX_HEADER, p_file ) != TS_INDEX_HEADER;
+
+    for( int i = 0; i < p_sys->seekindex.programs.i_size && !b_error; i++ )
+    {
+        const ts_seekindex_t *p_index = p_sys->seekindex.programs.p_elems[i];
+        uint8_t prg[TS_INDEX_PROGRAM];
+
+        SetDWBE( &prg[0], p_index->i_number );
+        SetDWBE( &prg[4], p_index->i_points );
+        SetQWBE( &prg[8], p_index->i_first_pcr );
+        SetQWBE( &prg[16], p_index->i_first_dts );
+        SetQWBE( &prg[24], p_index->i_last_dts );
+        b_error |= fwrite( prg, 1, TS_INDEX_PROGRAM, p_file ) != TS_INDEX_PROGRAM;
+
+        for( int j = 0; j < p_index->i_points && !b_error; j++ )
+        {
+            const ts_seekpoint_t *p_point = &p_index->p_points[j];
+            uint8_t pt[TS_INDEX_POINT];
+
+            SetQWBE( &pt[0], p_point->i_pcr );
+            SetQWBE( &pt[8], p_point->i_pos | ((uint64_t)p_point->b_rap << 63) );
+            b_error |= fwrite( pt, 1, TS_INDEX_POINT, p_file ) != TS_INDEX_POINT;
+        }
+    }
+
+    b_error |= fclose( p_file ) != 0;
+    if( b_error || vlc_rename( psz_tmp, p_sys->seekindex.psz_path ) )
+    {
+        msg_Warn( p_demux, "cannot write seek index %s", p_sys->seekindex.psz_path );
+        vlc_unlink( psz_tmp );
+    }
+    free( psz_tmp );
+}
+
+static void SeekIndexClean( demux_sys_t *p_sys )
+{
+    for( int i = 0; i < p_sys->seekindex.programs.i_size; i++ )
+    {
+        free( p_sys->seekindex.programs.p_elems[i]->p_points );
+        free( p_sys->seekindex.programs.p_elems[i] );
+    }
+    ARRAY_RESET( p_sys->seekindex.programs );
+    free( p_sys->seekindex.psz_path );
+}
+
 static int SeekToTime( demux_t *p_demux, ts_pmt_t *p_pmt, int64_t i_scaledtime )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
@@ -2701,14 +3541,39 @@ static int SeekToTime( demux_t *p_demux, ts_pmt_t *p_pmt, int64_t i_scaledtime )
     if( p_pmt->pcr.i_first == i_scaledtime && p_sys->b_canseek )
         return stream_Seek( p_sys->stream, 0 );
 
+    /* Go right to the point indexed while playing, if there is one close
+     * enough, preferably a random access point */
+    const ts_seekindex_t *p_index = SeekIndexGet( p_sys, p_pmt->i_number, false );
+    int i_upper = p_index ? SeekIndexUpper( p_index, i_scaledtime ) : 0;
+    if( i_upper > 0 &&
+        i_scaledtime - p_index->p_points[i_upper - 1].i_pcr < 2 * TS_INDEX_INTERVAL )
+    {
+        const ts_seekpoint_t *p_point = &p_index->p_points[i_upper - 1];
+        for( int i = i_upper - 1; i >= 0 &&
+             i_scaledtime - p_index->p_points[i].i_pcr < TS_INDEX_RAP_WINDOW; i-- )
+        {
+            if( p_index->p_points[i].b_rap )
+            {
+                p_point = &p_index->p_points[i];
+                break;
+            }
+        }
+        return stream_Seek( p_sys->stream, p_point->i_pos );
+    }
+
     if( !p_sys->b_canfastseek )
         return VLC_EGENERIC;
 
     int64_t i_initial_pos = stream_Tell( p_sys->stream );
 
-    /* Find the time position by using binary search algorithm. */
+    /* Find the time position by using binary search algorithm, between the
+     * indexed points around it if any. */
     int64_t i_head_pos = 0;
     int64_t i_tail_pos = stream_Size( p_sys->stream ) - p_sys->i_packet_size;
+    if( i_upper > 0 )
+        i_head_pos = p_index->p_points[i_upper - 1].i_pos;
+    if( p_index && i_upper < p_index->i_points )
+        i_tail_pos = __MIN( i_tail_pos, p_index->p_points[i_upper].i_pos );
     if( i_head_pos >= i_tail_pos )
         return VLC_EGENERIC;
 
@@ -2803,21 +3668,12 @@ static ts_pid_t *GetPID( demux_sys_t *p_sys, uint16_t i_pid )
         case 0x1FFF:
             return &p_sys->pids.dummy;
         default:
-            if( p_sys->pids.i_last_pid == i_pid )
-                return p_sys->pids.p_last;
+            assert( i_pid < 0x2000 );
+            if( likely(p_sys->pids.p_index[i_pid] != NULL) )
+                return p_sys->pids.p_index[i_pid];
         break;
     }
 
-    for( int i=0; i < p_sys->pids.i_all; i++ )
-    {
-        if( p_sys->pids.pp_all[i]->i_pid == i_pid )
-        {
-            p_sys->pids.p_last = p_sys->pids.pp_all[i];
-            p_sys->pids.i_last_pid = i_pid;
-            return p_sys->pids.p_last;
-        }
-    }
-
     if( p_sys->pids.i_all >= p_sys->pids.i_all_alloc )
     {
         ts_pid_t **p_realloc = realloc( p_sys->pids.pp_all,
@@ -2837,9 +3693,7 @@ static ts_pid_t *GetPID( demux_sys_t *p_sys, uint16_t i_pid )
 
     p_pid->i_pid = i_pid;
     p_sys->pids.pp_all[p_sys->pids.i_all++] = p_pid;
-
-    p_sys->pids.p_last = p_pid;
-    p_sys->pids.i_last_pid = i_pid;
+    p_sys->pids.p_index[i_pid] = p_pid;
 
     return p_pid;
 }
@@ -3021,11 +3875,15 @@ static void ProgramSetPCR( demux_t *p_demux, ts_pmt_t *p_pmt, mtime_t i_pcr )
     if( p_pmt->pcr.i_current == -1 && p_pmt->pcr.b_fix_done )
     {
         mtime_t i_mindts = -1;
+        const int i_worker = p_pmt->i_worker;
 
         ts_pat_t *p_pat = GetPID(p_sys, 0)->u.p_pat;
         for( int i=0; i< p_pat->programs.i_size; i++ )
         {
             ts_pmt_t *p_pmt = p_pat->programs.p_elems[i]->u.p_pmt;
+            /* The queues of the other threads are not ours to look at */
+            if( p_sys->workers.i_count > 0 && p_pmt->i_worker != i_worker )
+                continue;
             for( int j=0; j<p_pmt->e_streams.i_size; j++ )
             {
                 ts_pid_t *p_pid = p_pmt->e_streams.p_elems[j];
@@ -3059,7 +3917,7 @@ static void ProgramSetPCR( demux_t *p_demux, ts_pmt_t *p_pmt, mtime_t i_pcr )
     }
 }
 
-static void PCRHandle( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk )
+static void PCRHandle( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk, int i_worker )
 {
     demux_sys_t   *p_sys = p_demux->p_sys;
 
@@ -3067,7 +3925,8 @@ static void PCRHandle( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk )
     if( i_pcr < 0 )
         return;
 
-    pid->probed.i_pcr_count++;
+    if( i_worker < 0 ) /* otherwise counted by the input thread */
+        pid->probed.i_pcr_count++;
 
     if( p_sys->i_pmt_es <= 0 )
         return;
@@ -3082,12 +3941,17 @@ static void PCRHandle( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk )
         ts_pmt_t *p_pmt = p_pat->programs.p_elems[i]->u.p_pmt;
         mtime_t i_program_pcr = TimeStampWrapAround( p_pmt, i_pcr );
 
+        /* The other threads got their own copy of the packet */
+        if( i_worker >= 0 && p_pmt->i_worker != i_worker )
+            continue;
+
         if( p_pmt->i_pid_pcr == 0x1FFF ) /* That program has no dedicated PCR pid ISO/IEC 13818-1 2.4.4.9 */
         {
             if( pid->p_parent == p_pat->programs.p_elems[i] ) /* PCR shall be on pid itself */
             {
                 /* ? update PCR for the whole group program ? */
                 ProgramSetPCR( p_demux, p_pmt, i_program_pcr );
+                SeekIndexPCR( p_demux, p_pmt, i_program_pcr, p_bk );
             }
         }
         else /* set PCR provided by current pid to program(s) referencing it */
@@ -3097,6 +3961,7 @@ static void PCRHandle( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk )
             {
                 /* We've found a target group for update */
                 ProgramSetPCR( p_demux, p_pmt, i_program_pcr );
+                SeekIndexPCR( p_demux, p_pmt, i_program_pcr, p_bk );
             }
         }
 
@@ -3145,7 +4010,7 @@ static int FindPCRCandidate( ts_pmt_t *p_pmt )
 /* Tries to reselect a new PCR when none has been received */
 static void PCRFixHandle( demux_t *p_demux, ts_pmt_t *p_pmt, block_t *p_block )
 {
-    if ( p_pmt->pcr.b_disable || p_pmt->pcr.b_fix_done )
+    if ( p_pmt->pcr.b_disable || p_pmt->pcr.b_fix_done || p_pmt->pcr.b_fix_pending )
     {
         return;
     }
@@ -3156,22 +4021,38 @@ static void PCRFixHandle( demux_t *p_demux, ts_pmt_t *p_pmt, block_t *p_block )
     }
     else if( p_block->i_dts - p_pmt->pcr.i_first_dts > CLOCK_FREQ / 2 ) /* "PCR repeat rate shall not exceed 100ms" */
     {
-        if( p_pmt->pcr.i_current < 0 &&
-            GetPID( p_demux->p_sys, p_pmt->i_pid_pcr )->probed.i_pcr_count == 0 )
+        if( p_demux->p_sys->workers.i_count > 0 )
         {
-            int i_cand = FindPCRCandidate( p_pmt );
-            p_pmt->i_pid_pcr = i_cand;
-            if ( GetPID( p_demux->p_sys, p_pmt->i_pid_pcr )->probed.i_pcr_count == 0 )
-                p_pmt->pcr.b_disable = true;
-            msg_Warn( p_demux, "No PCR received for program %d, set up workaround using pid %d",
-                      p_pmt->i_number, i_cand );
-            UpdatePESFilters( p_demux, p_demux->p_sys->b_es_all );
+            /* It looks at other pids and changes the filters */
+            if( !p_pmt->pcr.b_fix_pending )
+            {
+                p_pmt->pcr.b_fix_pending = true;
+                atomic_store( &p_demux->p_sys->workers.b_pcrfix, true );
+            }
         }
-        p_pmt->pcr.b_fix_done = true;
+        else
+            PCRFixApply( p_demux, p_pmt );
     }
 }
 
-static bool GatherData( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk )
+static void PCRFixApply( demux_t *p_demux, ts_pmt_t *p_pmt )
+{
+    if( p_pmt->pcr.i_current < 0 &&
+        GetPID( p_demux->p_sys, p_pmt->i_pid_pcr )->probed.i_pcr_count == 0 )
+    {
+        int i_cand = FindPCRCandidate( p_pmt );
+        p_pmt->i_pid_pcr = i_cand;
+        if ( GetPID( p_demux->p_sys, p_pmt->i_pid_pcr )->probed.i_pcr_count == 0 )
+            p_pmt->pcr.b_disable = true;
+        msg_Warn( p_demux, "No PCR received for program %d, set up workaround using pid %d",
+                  p_pmt->i_number, i_cand );
+        UpdatePESFilters( p_demux, p_demux->p_sys->b_es_all );
+    }
+    p_pmt->pcr.b_fix_done = true;
+    p_pmt->pcr.b_fix_pending = false;
+}
+
+static bool GatherData( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk, int i_worker )
 {
     const uint8_t *p = p_bk->p_buffer;
     const bool b_unit_start = p[1]&0x40;
@@ -3272,7 +4153,7 @@ static bool GatherData( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk )
         }
     }
 
-    PCRHandle( p_demux, pid, p_bk );
+    PCRHandle( p_demux, pid, p_bk, i_worker );
 
     if( i_skip >= 188 )
     {
@@ -5024,6 +5905,9 @@ static void PMTCallBack( void *data, dvbpsi_pmt_t *p_dvbpsipmt )
 
     msg_Dbg( p_demux, "PMTCallBack called" );
 
+    /* The program threads use what is about to change */
+    WorkersDrain( p_demux );
+
     if (unlikely(GetPID(p_sys, 0)->type != TYPE_PAT))
     {
         assert(GetPID(p_sys, 0)->type == TYPE_PAT);
@@ -5435,8 +6319,15 @@ static void PMTCallBack( void *data, dvbpsi_pmt_t *p_dvbpsipmt )
                   p_pmt->i_number, i_cand );
     }
 
-    /* Probe Boundaries */
-    if( p_sys->b_canfastseek && p_pmt->i_last_dts == -1 )
+    /* Probe Boundaries, unless known from a previous playback */
+    const ts_seekindex_t *p_index = SeekIndexGet( p_sys, p_pmt->i_number, false );
+    if( p_pmt->i_last_dts == -1 && p_index && p_index->i_last_dts > 0 )
+    {
+        p_pmt->pcr.i_first = p_index->i_first_pcr;
+        p_pmt->pcr.i_first_dts = p_index->i_first_dts;
+        p_pmt->i_last_dts = p_index->i_last_dts;
+    }
+    else if( p_sys->b_canfastseek && p_pmt->i_last_dts == -1 )
     {
         p_pmt->i_last_dts = 0;
         ProbeStart( p_demux, p_pmt->i_number );
@@ -5474,6 +6365,8 @@ static void PATCallBack( void *data, dvbpsi_pat_t *p_dvbpsipat )
 
     msg_Dbg( p_demux, "PATCallBack called" );
 
+    WorkersDrain( p_demux );
+
     if(unlikely( GetPID(p_sys, 0)->type != TYPE_PAT ))
     {
         msg_Warn( p_demux, "PATCallBack called on invalid pid" );
@@ -5624,6 +6517,7 @@ static ts_pmt_t *ts_pmt_New( demux_t *p_demux )
     pmt->i_pid_pcr  = 0x1FFF;
     pmt->iod        = NULL;
     pmt->od.i_version = -1;
+    pmt->b_od_pending = false;
     ARRAY_INIT( pmt->od.objects );
 
     pmt->i_last_dts = -1;
@@ -5635,6 +6529,9 @@ static ts_pmt_t *ts_pmt_New( demux_t *p_demux )
     pmt->pcr.i_pcroffset = -1;
 
     pmt->pcr.b_fix_done = false;
+    pmt->pcr.b_fix_pending = false;
+
+    pmt->i_worker = -1;
 
     return pmt;
 }
@@ -48,6 +48,8 @@ static int vlclua_httpd_handler_new( lua_State * );
 static int vlclua_httpd_handler_delete( lua_State * );
 static int vlclua_httpd_file_new( lua_State * );
 static int vlclua_httpd_file_delete( lua_State * );
+static int vlclua_httpd_file_path_new( lua_State * );
+static int vlclua_httpd_file_path_delete( lua_State * );
 static int vlclua_httpd_redirect_new( lua_State * );
 static int vlclua_httpd_redirect_delete( lua_State * );
 
@@ -57,6 +59,7 @@ static int vlclua_httpd_redirect_delete( lua_State * );
 static const luaL_Reg vlclua_httpd_reg[] = {
     { "handler", vlclua_httpd_handler_new },
     { "file", vlclua_httpd_file_new },
+    { "file_path", vlclua_httpd_file_path_new },
     { "redirect", vlclua_httpd_redirect_new },
     { NULL, NULL }
 };
@@ -331,6 +334,40 @@ static int vlclua_httpd_file_delete( lua_State *L )
     return 0;
 }
 
+static int vlclua_httpd_file_path_new( lua_State *L )
+{
+    httpd_host_t **pp_host = (httpd_host_t **)luaL_checkudata( L, 1, "httpd_host" );
+    const char *psz_url = luaL_checkstring( L, 2 );
+    const char *psz_mime = luaL_nilorcheckstring( L, 3 );
+    const char *psz_user = luaL_nilorcheckstring( L, 4 );
+    const char *psz_password = luaL_nilorcheckstring( L, 5 );
+    const char *psz_path = luaL_checkstring( L, 6 );
+    httpd_file_t *p_file = httpd_FilePathNew( *pp_host, psz_url, psz_mime,
+                                              psz_user, psz_password,
+                                              psz_path );
+    if( !p_file )
+        return luaL_error( L, "Failed to create HTTPd file." );
+
+    httpd_file_t **pp_file = lua_newuserdata( L, sizeof( httpd_file_t * ) );
+    *pp_file = p_file;
+
+    if( luaL_newmetatable( L, "httpd_file_path" ) )
+    {
+        lua_pushcfunction( L, vlclua_httpd_file_path_delete );
+        lua_setfield( L, -2, "__gc" );
+    }
+
+    lua_setmetatable( L, -2 );
+    return 1;
+}
+
+static int vlclua_httpd_file_path_delete( lua_State *L )
+{
+    httpd_file_t **pp_file = (httpd_file_t**)luaL_checkudata( L, 1, "httpd_file_path" );
+    httpd_FileDelete( *pp_file );
+    return 0;
+}
+
 /*****************************************************************************
  * HTTPd Redirect
  *****************************************************************************/
@@ -26,10 +26,20 @@
 # include "config.h"
 #endif
 
+#include <assert.h>
+
 #include <vlc_common.h>
+#include <vlc_cpu.h>
 
 #include "csa.h"
 
+/* longest keystream of a packet: 188 bytes minus header and first block */
+#define CSA_KEYSTREAM_MAX (188 - 4 - 8)
+
+typedef void (*csa_keystream_t)( const uint8_t ck[8], const uint8_t *const *sb,
+                                 uint8_t *const *cb, unsigned i_lanes,
+                                 unsigned i_bytes );
+
 struct csa_t
 {
     /* odd and even keys */
@@ -47,6 +57,11 @@ struct csa_t
     int     p, q, r;
 
     bool    use_odd;
+
+    /* bitsliced stream cypher, for csa_EncryptBatch() */
+    csa_keystream_t keystream;
+    unsigned        i_lanes;
+    uint8_t         (*p_keystream)[CSA_KEYSTREAM_MAX];
 };
 
 static void csa_ComputeKey( uint8_t kk[57], uint8_t ck[8] );
@@ -55,13 +70,75 @@ static void csa_StreamCypher( csa_t *c, int b_init, uint8_t *ck, uint8_t *sb, ui
 
 static void csa_BlockDecypher( uint8_t kk[57], uint8_t ib[8], uint8_t bd[8] );
 static void csa_BlockCypher( uint8_t kk[57], uint8_t bd[8], uint8_t ib[8] );
+#define CSA_BLOCK_LANES 8
+static void csa_BlockCypherLanes( const uint8_t kk[57],
+                                  uint8_t bd[CSA_BLOCK_LANES][8],
+                                  uint8_t ib[CSA_BLOCK_LANES][8] );
+
+typedef uint64_t csa_word64_t __attribute__ ((vector_size (8)));
+#define BS_WORD csa_word64_t
+#define BS_ATTR
+#define BS_FN(name) csa_bs64_##name
+#include "csa_bs.h"
+#undef BS_FN
+#undef BS_ATTR
+#undef BS_WORD
+
+#ifdef HAVE_SSE2_INTRINSICS
+typedef uint64_t csa_word128_t __attribute__ ((vector_size (16)));
+#define BS_WORD csa_word128_t
+#define BS_ATTR __attribute__ ((__target__ ("sse2")))
+#define BS_FN(name) csa_bs128_##name
+#include "csa_bs.h"
+#undef BS_FN
+#undef BS_ATTR
+#undef BS_WORD
+#endif
+
+#ifdef HAVE_AVX2_INTRINSICS
+typedef uint64_t csa_word256_t __attribute__ ((vector_size (32)));
+#define BS_WORD csa_word256_t
+#define BS_ATTR __attribute__ ((__target__ ("avx2")))
+#define BS_FN(name) csa_bs256_##name
+#include "csa_bs.h"
+#undef BS_FN
+#undef BS_ATTR
+#undef BS_WORD
+#endif
 
 /*****************************************************************************
  * csa_New:
  *****************************************************************************/
 csa_t *csa_New( void )
 {
-    return calloc( 1, sizeof( csa_t ) );
+    csa_t *c = calloc( 1, sizeof( csa_t ) );
+    if( !c )
+        return NULL;
+
+    c->keystream = csa_bs64_keystream;
+    c->i_lanes = 64;
+#ifdef HAVE_SSE2_INTRINSICS
+    if( vlc_CPU_SSE2() )
+    {
+        c->keystream = csa_bs128_keystream;
+        c->i_lanes = 128;
+    }
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+    if( vlc_CPU_AVX2() )
+    {
+        c->keystream = csa_bs256_keystream;
+        c->i_lanes = 256;
+    }
+#endif
+
+    c->p_keystream = malloc( 256 * CSA_KEYSTREAM_MAX );
+    if( !c->p_keystream )
+    {
+        free( c );
+        return NULL;
+    }
+    return c;
 }
 
 /*****************************************************************************
@@ -69,6 +146,7 @@ csa_t *csa_New( void )
  *****************************************************************************/
 void csa_Delete( csa_t *c )
 {
+    free( c->p_keystream );
     free( c );
 }
 
@@ -307,6 +385,136 @@ void csa_Encrypt( csa_t *c, uint8_t *pkt, int i_pkt_size )
     }
 }
 
+/*****************************************************************************
+ * csa_EncryptBatch: same as csa_Encrypt() on each packet
+ *****************************************************************************
+ * The block cypher is interleaved over a few packets, and the stream cypher
+ * runs on as many packets at once as the bitsliced implementation has lanes
+ * (64, 128 or 256, depending on the CPU).
+ *****************************************************************************/
+static void csa_EncryptLanes( csa_t *c, const uint8_t *ck, uint8_t *kk,
+                              uint8_t **pkts, const int *pi_hdr,
+                              unsigned i_lanes, int i_pkt_size )
+{
+    const uint8_t *sb[256] = { NULL };
+    uint8_t *cb[256] = { NULL };
+    int i_bytes = 0;
+
+    /* block cypher, from the last block to the first, in place, on a few
+     * packets at once so that their dependency chains overlap */
+    for( unsigned l0 = 0; l0 < i_lanes; l0 += CSA_BLOCK_LANES )
+    {
+        uint8_t bd[CSA_BLOCK_LANES][8], ib[CSA_BLOCK_LANES][8];
+        int n[CSA_BLOCK_LANES], n_max = 0;
+        unsigned i_group = __MIN( i_lanes - l0, CSA_BLOCK_LANES );
+
+        memset( bd, 0, sizeof( bd ) );
+        memset( ib, 0, sizeof( ib ) );
+        for( unsigned l = 0; l < i_group; l++ )
+        {
+            n[l] = (i_pkt_size - pi_hdr[l0+l]) / 8;
+            n_max = __MAX( n_max, n[l] );
+        }
+
+        for( int t = 0; t < n_max; t++ )
+        {
+            for( unsigned l = 0; l < i_group; l++ )
+            {
+                const int i = n[l] - t;
+                if( i <= 0 )
+                    continue;
+
+                const uint8_t *p = &pkts[l0+l][pi_hdr[l0+l]+8*(i-1)];
+                for( int j = 0; j < 8; j++ )
+                    bd[l][j] = p[j] ^ ib[l][j];
+            }
+
+            csa_BlockCypherLanes( kk, bd, ib );
+
+            for( unsigned l = 0; l < i_group; l++ )
+            {
+                const int i = n[l] - t;
+                if( i > 0 )
+                    memcpy( &pkts[l0+l][pi_hdr[l0+l]+8*(i-1)], ib[l], 8 );
+            }
+        }
+    }
+
+    for( unsigned l = 0; l < i_lanes; l++ )
+    {
+        sb[l] = &pkts[l][pi_hdr[l]];
+        cb[l] = c->p_keystream[l];
+        i_bytes = __MAX( i_bytes, i_pkt_size - pi_hdr[l] - 8 );
+    }
+
+    c->keystream( ck, sb, cb, i_lanes, i_bytes );
+
+    for( unsigned l = 0; l < i_lanes; l++ )
+    {
+        /* all blocks but the first, then the residue */
+        uint8_t *p = &pkts[l][pi_hdr[l] + 8];
+        const int i_len = i_pkt_size - pi_hdr[l] - 8;
+
+        for( int i = 0; i < i_len; i++ )
+            p[i] ^= cb[l][i];
+    }
+}
+
+void csa_EncryptBatch( csa_t *c, uint8_t *const *pkts, int i_pkts,
+                       int i_pkt_size )
+{
+    uint8_t *ck;
+    uint8_t *kk;
+    uint8_t *lanes[256];
+    int      hdr[256];
+    unsigned i_lanes = 0;
+
+    if( c->use_odd )
+    {
+        ck = c->o_ck;
+        kk = c->o_kk;
+    }
+    else
+    {
+        ck = c->e_ck;
+        kk = c->e_kk;
+    }
+
+    for( int k = 0; k < i_pkts; k++ )
+    {
+        uint8_t *pkt = pkts[k];
+
+        /* set transport scrambling control */
+        pkt[3] |= 0x80;
+        if( c->use_odd )
+            pkt[3] |= 0x40;
+
+        /* hdr len */
+        int i_hdr = 4;
+        if( pkt[3]&0x20 )
+        {
+            /* skip adaption field */
+            i_hdr += pkt[4] + 1;
+        }
+        if( i_pkt_size - i_hdr < 8 )
+        {
+            pkt[3] &= 0x3f;
+            continue;
+        }
+
+        lanes[i_lanes] = pkt;
+        hdr[i_lanes] = i_hdr;
+        if( ++i_lanes == c->i_lanes )
+        {
+            csa_EncryptLanes( c, ck, kk, lanes, hdr, i_lanes, i_pkt_size );
+            i_lanes = 0;
+        }
+    }
+
+    if( i_lanes > 0 )
+        csa_EncryptLanes( c, ck, kk, lanes, hdr, i_lanes, i_pkt_size );
+}
+
 /*****************************************************************************
  * Divers
  *****************************************************************************/
@@ -610,3 +818,38 @@ static void csa_BlockCypher( uint8_t kk[57], uint8_t bd[8], uint8_t ib[8] )
     }
 }
 
+/* Same as csa_BlockCypher() on CSA_BLOCK_LANES blocks */
+static void csa_BlockCypherLanes( const uint8_t kk[57],
+                                  uint8_t bd[CSA_BLOCK_LANES][8],
+                                  uint8_t ib[CSA_BLOCK_LANES][8] )
+{
+    uint8_t R[9][CSA_BLOCK_LANES];
+
+    for( int l = 0; l < CSA_BLOCK_LANES; l++ )
+        for( int i = 0; i < 8; i++ )
+            R[i+1][l] = bd[l][i];
+
+    // loop over kk[1]..kk[56]
+    for( int i = 1; i <= 56; i++ )
+    {
+        for( int l = 0; l < CSA_BLOCK_LANES; l++ )
+        {
+            const uint8_t sbox_out = block_sbox[ kk[i]^R[8][l] ];
+            const uint8_t perm_out = block_perm[sbox_out];
+            const uint8_t R1 = R[1][l];
+
+            R[1][l] = R[2][l];
+            R[2][l] = R[3][l] ^ R1;
+            R[3][l] = R[4][l] ^ R1;
+            R[4][l] = R[5][l] ^ R1;
+            R[5][l] = R[6][l];
+            R[6][l] = R[7][l] ^ perm_out;
+            R[7][l] = R[8][l];
+            R[8][l] = R1 ^ sbox_out;
+        }
+    }
+
+    for( int l = 0; l < CSA_BLOCK_LANES; l++ )
+        for( int i = 0; i < 8; i++ )
+            ib[l][i] = R[i+1][l];
+}
@@ -31,6 +31,7 @@ typedef struct csa_t csa_t;
 #define csa_UseKey  __csa_UseKey
 #define csa_Decrypt __csa_decrypt
 #define csa_Encrypt __csa_encrypt
+#define csa_EncryptBatch __csa_encrypt_batch
 
 csa_t *csa_New( void );
 void   csa_Delete( csa_t * );
@@ -40,5 +41,7 @@ int    csa_UseKey( vlc_object_t *p_caller, csa_t *, bool use_odd );
 
 void   csa_Decrypt( csa_t *, uint8_t *pkt, int i_pkt_size );
 void   csa_Encrypt( csa_t *, uint8_t *pkt, int i_pkt_size );
+void   csa_EncryptBatch( csa_t *, uint8_t *const *pkts, int i_pkts,
+                         int i_pkt_size );
 
 #endif /* _CSA_H */
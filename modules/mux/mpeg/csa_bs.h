@@ -0,0 +1,375 @@
+/*****************************************************************************
+ * csa_bs.h: bitsliced CSA stream cypher
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* This file is included by csa.c once per word size, with:
+ *  BS_WORD: a vector of uint64_t, one bit per packet (lane),
+ *  BS_ATTR: the function attributes (target instruction set),
+ *  BS_FN(name): the name of the functions of this instance.
+ *
+ * Each bit of the stream cypher state is stored in a word, and each bit of
+ * a word belongs to a different packet, so that every operation of the
+ * cypher runs on all the packets at once. This is the same algorithm as
+ * csa_StreamCypher(). */
+
+#define BS_LANES (8 * sizeof (BS_WORD))
+
+typedef struct
+{
+    /* A[1..10] and B[1..10] are rings, see BS_A() and BS_B() */
+    BS_WORD A[16][4];
+    BS_WORD B[16][4];
+    BS_WORD X[4], Y[4], Z[4];
+    BS_WORD D[4], E[4], F[4];
+    BS_WORD p, q, r;
+    unsigned pos;
+} BS_FN(state_t);
+
+#define BS_A(k) st->A[(st->pos - (k)) & 15]
+#define BS_B(k) st->B[(st->pos - (k)) & 15]
+
+/* The 7 S-boxes of csa_StreamCypher(), in algebraic normal form: each output
+ * bit is the xor of products of the input bits, x[0] being the least
+ * significant one. s[1] and s[0] are the high and low output bits. */
+static inline BS_ATTR void BS_FN(sbox1)( const BS_WORD x[5], BS_WORD s[2] )
+{
+    const BS_WORD m01 = x[0] & x[1];
+    const BS_WORD m02 = x[0] & x[2];
+    const BS_WORD m12 = x[1] & x[2];
+    const BS_WORD m03 = x[0] & x[3];
+    const BS_WORD m13 = x[1] & x[3];
+    const BS_WORD m23 = x[2] & x[3];
+    const BS_WORD m04 = x[0] & x[4];
+    const BS_WORD m24 = x[2] & x[4];
+    const BS_WORD m34 = x[3] & x[4];
+    const BS_WORD m013 = m01 & x[3];
+    const BS_WORD m023 = m02 & x[3];
+    const BS_WORD m123 = m12 & x[3];
+    const BS_WORD m014 = m01 & x[4];
+    const BS_WORD m124 = m12 & x[4];
+    const BS_WORD m134 = m13 & x[4];
+    const BS_WORD m234 = m23 & x[4];
+    const BS_WORD m0134 = m013 & x[4];
+    const BS_WORD m0234 = m023 & x[4];
+    const BS_WORD m1234 = m123 & x[4];
+    s[1] = ~(x[0] ^ x[1] ^ m01 ^ m02 ^ m12 ^ m03 ^ m13 ^ m23 ^ m023 ^ m123 ^
+             x[4] ^ m014 ^ m24 ^ m124 ^ m34 ^ m134 ^ m0134 ^ m234 ^ m1234);
+    s[0] = x[1] ^ m02 ^ x[3] ^ m03 ^ m013 ^ m04 ^ m34 ^ m134 ^ m234 ^ m0234;
+}
+
+static inline BS_ATTR void BS_FN(sbox2)( const BS_WORD x[5], BS_WORD s[2] )
+{
+    const BS_WORD m01 = x[0] & x[1];
+    const BS_WORD m02 = x[0] & x[2];
+    const BS_WORD m12 = x[1] & x[2];
+    const BS_WORD m03 = x[0] & x[3];
+    const BS_WORD m13 = x[1] & x[3];
+    const BS_WORD m23 = x[2] & x[3];
+    const BS_WORD m24 = x[2] & x[4];
+    const BS_WORD m34 = x[3] & x[4];
+    const BS_WORD m012 = m01 & x[2];
+    const BS_WORD m013 = m01 & x[3];
+    const BS_WORD m023 = m02 & x[3];
+    const BS_WORD m014 = m01 & x[4];
+    const BS_WORD m124 = m12 & x[4];
+    const BS_WORD m034 = m03 & x[4];
+    const BS_WORD m134 = m13 & x[4];
+    const BS_WORD m234 = m23 & x[4];
+    const BS_WORD m0134 = m013 & x[4];
+    const BS_WORD m0234 = m023 & x[4];
+    s[1] = ~(x[0] ^ x[1] ^ m02 ^ m12 ^ m012 ^ x[3] ^ m124 ^ m034 ^ m134 ^
+             m0134 ^ m234);
+    s[0] = ~(x[1] ^ x[2] ^ m02 ^ m013 ^ m023 ^ m014 ^ m24 ^ m34 ^ m0134 ^
+             m0234);
+}
+
+static inline BS_ATTR void BS_FN(sbox3)( const BS_WORD x[5], BS_WORD s[2] )
+{
+    const BS_WORD m01 = x[0] & x[1];
+    const BS_WORD m02 = x[0] & x[2];
+    const BS_WORD m12 = x[1] & x[2];
+    const BS_WORD m03 = x[0] & x[3];
+    const BS_WORD m13 = x[1] & x[3];
+    const BS_WORD m23 = x[2] & x[3];
+    const BS_WORD m14 = x[1] & x[4];
+    const BS_WORD m24 = x[2] & x[4];
+    const BS_WORD m012 = m01 & x[2];
+    const BS_WORD m013 = m01 & x[3];
+    const BS_WORD m123 = m12 & x[3];
+    const BS_WORD m014 = m01 & x[4];
+    const BS_WORD m024 = m02 & x[4];
+    const BS_WORD m124 = m12 & x[4];
+    const BS_WORD m034 = m03 & x[4];
+    const BS_WORD m234 = m23 & x[4];
+    const BS_WORD m0124 = m012 & x[4];
+    const BS_WORD m1234 = m123 & x[4];
+    s[1] = ~(x[0] ^ x[1] ^ m02 ^ m12 ^ m012 ^ x[3] ^ m03 ^ m13 ^ m013 ^ m23 ^
+             m123 ^ x[4] ^ m14 ^ m014 ^ m24 ^ m024 ^ m124 ^ m0124 ^ m034 ^
+             m234 ^ m1234);
+    s[0] = x[1] ^ m01 ^ m02 ^ x[3] ^ x[4];
+}
+
+static inline BS_ATTR void BS_FN(sbox4)( const BS_WORD x[5], BS_WORD s[2] )
+{
+    const BS_WORD m01 = x[0] & x[1];
+    const BS_WORD m12 = x[1] & x[2];
+    const BS_WORD m03 = x[0] & x[3];
+    const BS_WORD m23 = x[2] & x[3];
+    const BS_WORD m04 = x[0] & x[4];
+    const BS_WORD m14 = x[1] & x[4];
+    const BS_WORD m34 = x[3] & x[4];
+    const BS_WORD m012 = m01 & x[2];
+    const BS_WORD m013 = m01 & x[3];
+    const BS_WORD m123 = m12 & x[3];
+    const BS_WORD m034 = m03 & x[4];
+    const BS_WORD m234 = m23 & x[4];
+    const BS_WORD m0124 = m012 & x[4];
+    const BS_WORD m0134 = m013 & x[4];
+    const BS_WORD m1234 = m123 & x[4];
+    s[1] = ~(x[0] ^ m01 ^ x[2] ^ m012 ^ x[3] ^ m123 ^ x[4] ^ m04 ^ m14 ^
+             m0124 ^ m34 ^ m034 ^ m0134 ^ m234 ^ m1234);
+    s[0] = ~(x[1] ^ m01 ^ x[2] ^ m03 ^ m013 ^ m23 ^ m04 ^ m14 ^ m0124 ^ m34 ^
+             m034 ^ m0134 ^ m234 ^ m1234);
+}
+
+static inline BS_ATTR void BS_FN(sbox5)( const BS_WORD x[5], BS_WORD s[2] )
+{
+    const BS_WORD m01 = x[0] & x[1];
+    const BS_WORD m02 = x[0] & x[2];
+    const BS_WORD m12 = x[1] & x[2];
+    const BS_WORD m03 = x[0] & x[3];
+    const BS_WORD m13 = x[1] & x[3];
+    const BS_WORD m04 = x[0] & x[4];
+    const BS_WORD m14 = x[1] & x[4];
+    const BS_WORD m24 = x[2] & x[4];
+    const BS_WORD m34 = x[3] & x[4];
+    const BS_WORD m012 = m01 & x[2];
+    const BS_WORD m013 = m01 & x[3];
+    const BS_WORD m023 = m02 & x[3];
+    const BS_WORD m123 = m12 & x[3];
+    const BS_WORD m024 = m02 & x[4];
+    const BS_WORD m124 = m12 & x[4];
+    const BS_WORD m034 = m03 & x[4];
+    const BS_WORD m134 = m13 & x[4];
+    const BS_WORD m0124 = m012 & x[4];
+    const BS_WORD m0134 = m013 & x[4];
+    const BS_WORD m0234 = m023 & x[4];
+    const BS_WORD m1234 = m123 & x[4];
+    s[1] = ~(x[0] ^ x[1] ^ m01 ^ m02 ^ m12 ^ m012 ^ x[3] ^ m03 ^ m013 ^ m023 ^
+             m123 ^ m04 ^ m14 ^ m24 ^ m124 ^ m0124 ^ m034 ^ m134 ^ m0234 ^
+             m1234);
+    s[0] = m01 ^ x[2] ^ m02 ^ m012 ^ m03 ^ m13 ^ m023 ^ m04 ^ m24 ^ m024 ^
+           m124 ^ m0124 ^ m34 ^ m034 ^ m134 ^ m0134;
+}
+
+static inline BS_ATTR void BS_FN(sbox6)( const BS_WORD x[5], BS_WORD s[2] )
+{
+    const BS_WORD m01 = x[0] & x[1];
+    const BS_WORD m02 = x[0] & x[2];
+    const BS_WORD m12 = x[1] & x[2];
+    const BS_WORD m03 = x[0] & x[3];
+    const BS_WORD m13 = x[1] & x[3];
+    const BS_WORD m23 = x[2] & x[3];
+    const BS_WORD m012 = m01 & x[2];
+    const BS_WORD m013 = m01 & x[3];
+    const BS_WORD m023 = m02 & x[3];
+    const BS_WORD m123 = m12 & x[3];
+    const BS_WORD m014 = m01 & x[4];
+    const BS_WORD m124 = m12 & x[4];
+    const BS_WORD m034 = m03 & x[4];
+    const BS_WORD m0124 = m012 & x[4];
+    const BS_WORD m0134 = m013 & x[4];
+    const BS_WORD m1234 = m123 & x[4];
+    s[1] = x[1] ^ m02 ^ m013 ^ m23 ^ m023 ^ x[4] ^ m014 ^ m034;
+    s[0] = x[0] ^ x[2] ^ m12 ^ m012 ^ m13 ^ m23 ^ m123 ^ m014 ^ m124 ^ m0124 ^
+           m0134 ^ m1234;
+}
+
+static inline BS_ATTR void BS_FN(sbox7)( const BS_WORD x[5], BS_WORD s[2] )
+{
+    const BS_WORD m01 = x[0] & x[1];
+    const BS_WORD m12 = x[1] & x[2];
+    const BS_WORD m13 = x[1] & x[3];
+    const BS_WORD m23 = x[2] & x[3];
+    const BS_WORD m04 = x[0] & x[4];
+    const BS_WORD m24 = x[2] & x[4];
+    const BS_WORD m012 = m01 & x[2];
+    const BS_WORD m013 = m01 & x[3];
+    const BS_WORD m123 = m12 & x[3];
+    const BS_WORD m014 = m01 & x[4];
+    const BS_WORD m124 = m12 & x[4];
+    const BS_WORD m134 = m13 & x[4];
+    const BS_WORD m0124 = m012 & x[4];
+    const BS_WORD m0134 = m013 & x[4];
+    const BS_WORD m1234 = m123 & x[4];
+    s[1] = x[0] ^ x[1] ^ m01 ^ x[2] ^ x[3] ^ m013 ^ m04 ^ m014 ^ m24 ^ m124 ^
+           m0124 ^ m0134 ^ m1234;
+    s[0] = x[0] ^ m01 ^ x[2] ^ m12 ^ m012 ^ x[3] ^ m23 ^ x[4] ^ m134 ^ m0134;
+}
+
+/* One round: 2 bits of output (or input, if in_a and in_b are not NULL) */
+static inline BS_ATTR void BS_FN(round)( BS_FN(state_t) *st,
+                                         const BS_WORD *in_a,
+                                         const BS_WORD *in_b,
+                                         BS_WORD *out1, BS_WORD *out0 )
+{
+    /* 35 bits of A are the inputs of the 7 S-boxes, least significant first */
+    const BS_WORD sin[7][5] = {
+        { BS_A(9)[0], BS_A(7)[3], BS_A(6)[1], BS_A(1)[2], BS_A(4)[0] },
+        { BS_A(9)[1], BS_A(7)[0], BS_A(6)[3], BS_A(3)[2], BS_A(2)[1] },
+        { BS_A(6)[2], BS_A(5)[3], BS_A(5)[1], BS_A(2)[0], BS_A(1)[3] },
+        { BS_A(8)[0], BS_A(4)[2], BS_A(2)[3], BS_A(1)[1], BS_A(3)[3] },
+        { BS_A(9)[2], BS_A(8)[1], BS_A(6)[0], BS_A(4)[3], BS_A(5)[2] },
+        { BS_A(9)[3], BS_A(7)[2], BS_A(5)[0], BS_A(4)[1], BS_A(3)[1] },
+        { BS_A(8)[3], BS_A(8)[2], BS_A(7)[1], BS_A(3)[0], BS_A(2)[2] },
+    };
+    BS_WORD s[7][2];
+
+    BS_FN(sbox1)( sin[0], s[0] );
+    BS_FN(sbox2)( sin[1], s[1] );
+    BS_FN(sbox3)( sin[2], s[2] );
+    BS_FN(sbox4)( sin[3], s[3] );
+    BS_FN(sbox5)( sin[4], s[4] );
+    BS_FN(sbox6)( sin[5], s[5] );
+    BS_FN(sbox7)( sin[6], s[6] );
+
+    /* 4x4 xor to produce extra nibble for T3 */
+    BS_WORD extra_B[4];
+    extra_B[3] = BS_B(3)[0] ^ BS_B(6)[1] ^ BS_B(7)[2] ^ BS_B(9)[3];
+    extra_B[2] = BS_B(6)[0] ^ BS_B(8)[1] ^ BS_B(3)[3] ^ BS_B(4)[2];
+    extra_B[1] = BS_B(5)[3] ^ BS_B(8)[2] ^ BS_B(4)[0] ^ BS_B(5)[1];
+    extra_B[0] = BS_B(9)[2] ^ BS_B(6)[3] ^ BS_B(3)[1] ^ BS_B(8)[0];
+
+    /* T1 and T2 */
+    BS_WORD next_A1[4], next_B1[4], b1[4];
+    for( int i = 0; i < 4; i++ )
+    {
+        next_A1[i] = BS_A(10)[i] ^ st->X[i];
+        b1[i] = BS_B(7)[i] ^ BS_B(10)[i] ^ st->Y[i];
+        if( in_a != NULL )
+        {
+            next_A1[i] ^= st->D[i] ^ in_a[i];
+            b1[i] ^= in_b[i];
+        }
+    }
+    /* if p=1, rotate left */
+    for( int i = 0; i < 4; i++ )
+        next_B1[i] = b1[i] ^ ((b1[i] ^ b1[(i + 3) & 3]) & st->p);
+
+    /* T3 */
+    for( int i = 0; i < 4; i++ )
+        st->D[i] = st->E[i] ^ st->Z[i] ^ extra_B[i];
+
+    /* T4 = sum, carry of Z + E + r, if q=1 */
+    BS_WORD carry = st->r;
+    for( int i = 0; i < 4; i++ )
+    {
+        const BS_WORD t = st->Z[i] ^ st->E[i];
+        const BS_WORD sum = t ^ carry;
+        const BS_WORD next_E = st->F[i];
+
+        carry = (st->Z[i] & st->E[i]) | (carry & t);
+        st->F[i] = st->E[i] ^ ((sum ^ st->E[i]) & st->q);
+        st->E[i] = next_E;
+    }
+    st->r ^= (carry ^ st->r) & st->q;
+
+    st->pos++;
+    memcpy( BS_A(1), next_A1, sizeof (next_A1) );
+    memcpy( BS_B(1), next_B1, sizeof (next_B1) );
+
+    st->X[3] = s[3][0]; st->X[2] = s[2][0]; st->X[1] = s[1][1]; st->X[0] = s[0][1];
+    st->Y[3] = s[5][0]; st->Y[2] = s[4][0]; st->Y[1] = s[3][1]; st->Y[0] = s[2][1];
+    st->Z[3] = s[1][0]; st->Z[2] = s[0][0]; st->Z[1] = s[5][1]; st->Z[0] = s[4][1];
+    st->p = s[6][1];
+    st->q = s[6][0];
+
+    /* 2 output bits are a function of the 4 bits of D */
+    *out1 = st->D[2] ^ st->D[3];
+    *out0 = st->D[0] ^ st->D[1];
+}
+
+/**
+ * Initializes the stream cypher of up to BS_LANES packets with the common
+ * key ck and their own first block sb[lane], then writes i_bytes bytes of
+ * keystream for each packet to cb[lane].
+ */
+static BS_ATTR void BS_FN(keystream)( const uint8_t ck[8],
+                                      const uint8_t *const *sb,
+                                      uint8_t *const *cb,
+                                      unsigned i_lanes, unsigned i_bytes )
+{
+    BS_FN(state_t) state, *st = &state;
+    const BS_WORD zero = { 0 };
+
+    assert( i_lanes <= BS_LANES );
+    memset( st, 0, sizeof (*st) );
+
+    /* load first 32 bits of CK into A[1]..A[8]
+     * load last  32 bits of CK into B[1]..B[8] */
+    for( int i = 0; i < 4; i++ )
+        for( int b = 0; b < 4; b++ )
+        {
+            BS_A(1+2*i)[b] = ((ck[i] >> (4 + b)) & 1) ? ~zero : zero;
+            BS_A(2+2*i)[b] = ((ck[i] >> b) & 1) ? ~zero : zero;
+            BS_B(1+2*i)[b] = ((ck[4+i] >> (4 + b)) & 1) ? ~zero : zero;
+            BS_B(2+2*i)[b] = ((ck[4+i] >> b) & 1) ? ~zero : zero;
+        }
+
+    /* initialization with the first block of each packet */
+    for( int i = 0; i < 8; i++ )
+    {
+        BS_WORD in[8]; /* bit n of byte i of every lane */
+
+        for( int b = 0; b < 8; b++ )
+            in[b] = zero;
+        for( unsigned l = 0; l < i_lanes; l++ )
+            for( int b = 0; b < 8; b++ )
+                in[b][l / 64] |= (uint64_t)((sb[l][i] >> b) & 1) << (l % 64);
+
+        BS_WORD out1, out0;
+        /* high nibble (in1) and low nibble (in2) alternate on both sides */
+        BS_FN(round)( st, &in[4], &in[0], &out1, &out0 );
+        BS_FN(round)( st, &in[0], &in[4], &out1, &out0 );
+        BS_FN(round)( st, &in[4], &in[0], &out1, &out0 );
+        BS_FN(round)( st, &in[0], &in[4], &out1, &out0 );
+    }
+
+    /* generation */
+    for( unsigned i = 0; i < i_bytes; i++ )
+    {
+        BS_WORD out[8];
+
+        for( int j = 0; j < 4; j++ )
+            BS_FN(round)( st, NULL, NULL, &out[7 - 2*j], &out[6 - 2*j] );
+
+        for( unsigned l = 0; l < i_lanes; l++ )
+        {
+            unsigned byte = 0;
+
+            for( int b = 0; b < 8; b++ )
+                byte |= ((out[b][l / 64] >> (l % 64)) & 1) << b;
+            cb[l][i] = byte;
+        }
+    }
+}
+
+#undef BS_A
+#undef BS_B
+#undef BS_LANES
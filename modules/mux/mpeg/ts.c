@@ -33,6 +33,7 @@
 #endif
 
 #include <limits.h>
+#include <assert.h>
 
 #include <vlc_common.h>
 #include <vlc_plugin.h>
@@ -172,6 +173,11 @@ static void    Close  ( vlc_object_t * );
 #define CU_LONGTEXT N_("CSA encryption key used. It can be the odd/first/1 " \
   "(default) or the even/second/2 one.")
 
+#define THREADS_TEXT N_("Packetization threads")
+#define THREADS_LONGTEXT N_("Number of threads splitting the elementary " \
+    "streams into TS packets (0 = automatic, 1 = no extra threads). " \
+    "The output does not depend on this value." )
+
 #define CPKT_TEXT N_("Packet size in bytes to encrypt")
 #define CPKT_LONGTEXT N_("Size of the TS packet to encrypt. " \
     "The encryption routines subtract the TS-header from the value before " \
@@ -223,6 +229,9 @@ vlc_module_begin ()
     add_string( SOUT_CFG_PREFIX "csa-use", "1",  CU_TEXT,   CU_LONGTEXT,   true)
     add_integer(SOUT_CFG_PREFIX "csa-pkt", 188,  CPKT_TEXT, CPKT_LONGTEXT, true)
 
+    add_integer_with_range(SOUT_CFG_PREFIX "threads", 0, 0, 16,
+                           THREADS_TEXT, THREADS_LONGTEXT, true)
+
     set_callbacks( Open, Close )
 vlc_module_end ()
 
@@ -234,7 +243,7 @@ static const char *const ppsz_sout_options[] = {
     "netid", "sdtdesc",
     "es-id-pid", "shaping", "pcr", "bmin", "bmax", "use-key-frames",
     "dts-delay", "csa-ck", "csa2-ck", "csa-use", "csa-pkt", "crypt-audio", "crypt-video",
-    "muxpmt", "program-pmt", "alignment",
+    "muxpmt", "program-pmt", "alignment", "threads",
     NULL
 };
 
@@ -318,11 +327,21 @@ typedef struct
 
 } pes_state_t;
 
+/* TS packets built ahead of the interleaving by a packetization thread */
+typedef struct
+{
+    sout_buffer_chain_t chain;
+    mtime_t             *p_dts; /* stream dts before each packet of chain */
+    size_t              i_dts_max;
+    size_t              i_pos;  /* p_dts index of the first packet of chain */
+} ts_prepared_t;
+
 typedef struct
 {
     ts_stream_t  ts;
     pes_stream_t pes;
     pes_state_t  state;
+    ts_prepared_t prepared;
 } sout_input_sys_t;
 
 struct sout_mux_sys_t
@@ -371,6 +390,21 @@ struct sout_mux_sys_t
     int             i_csa_pkt_size;
     bool            b_crypt_audio;
     bool            b_crypt_video;
+
+    block_pool_t    *p_ts_pool; /* recycled 188 bytes TS packets */
+
+    /* parallel TS packetization */
+    unsigned        i_threads;
+    vlc_thread_t    *p_threads;
+    vlc_mutex_t     jobs_lock;
+    vlc_cond_t      jobs_wait;
+    vlc_cond_t      jobs_done;
+    sout_input_sys_t **pp_jobs;
+    int             i_jobs;
+    int             i_jobs_next;
+    int             i_jobs_left;
+    mtime_t         i_jobs_max_dts;
+    bool            b_jobs_exit;
 };
 
 
@@ -468,6 +502,7 @@ static void GetPMT( sout_mux_t *p_mux, sout_buffer_chain_t *c );
 
 static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream, bool b_pcr );
 static void TSSetPCR( block_t *p_ts, mtime_t i_dts );
+static void *PacketizeThread( void * );
 
 static csa_t *csaSetup( vlc_object_t *p_this )
 {
@@ -724,6 +759,30 @@ static int Open( vlc_object_t *p_this )
 
     p_sys->csa = csaSetup(p_this);
 
+    p_sys->p_ts_pool = block_pool_New( 188, 1024 );
+
+    /* The sout thread takes part in the packetization too */
+    unsigned i_threads = var_GetInteger( p_mux, SOUT_CFG_PREFIX "threads" );
+    if( i_threads == 0 )
+        i_threads = __MIN( vlc_GetCPUCount(), 4 );
+    p_sys->i_threads = 1;
+    if( i_threads > 1 )
+        p_sys->p_threads = malloc( (i_threads - 1) * sizeof(vlc_thread_t) );
+    if( p_sys->p_threads != NULL )
+    {   /* released in Close() even if no thread could be started */
+        vlc_mutex_init( &p_sys->jobs_lock );
+        vlc_cond_init( &p_sys->jobs_wait );
+        vlc_cond_init( &p_sys->jobs_done );
+        for( unsigned i = 0; i < i_threads - 1; i++ )
+        {
+            if( vlc_clone( &p_sys->p_threads[i], PacketizeThread, p_mux,
+                           VLC_THREAD_PRIORITY_OUTPUT ) )
+                break;
+            p_sys->i_threads++;
+        }
+        msg_Dbg( p_mux, "using %u packetization threads", p_sys->i_threads );
+    }
+
     p_mux->pf_control   = Control;
     p_mux->pf_addstream = AddStream;
     p_mux->pf_delstream = DelStream;
@@ -758,6 +817,32 @@ static void Close( vlc_object_t * p_this )
         free( p_sys->sdt.desc[i].psz_provider );
     }
 
+    if( p_sys->p_threads )
+    {
+        vlc_mutex_lock( &p_sys->jobs_lock );
+        p_sys->b_jobs_exit = true;
+        vlc_cond_broadcast( &p_sys->jobs_wait );
+        vlc_mutex_unlock( &p_sys->jobs_lock );
+
+        for( unsigned i = 0; i < p_sys->i_threads - 1; i++ )
+            vlc_join( p_sys->p_threads[i], NULL );
+        free( p_sys->p_threads );
+        free( p_sys->pp_jobs );
+        vlc_cond_destroy( &p_sys->jobs_done );
+        vlc_cond_destroy( &p_sys->jobs_wait );
+        vlc_mutex_destroy( &p_sys->jobs_lock );
+    }
+
+    if( p_sys->p_ts_pool )
+    {
+        uint64_t i_hits, i_misses;
+
+        block_pool_GetStats( p_sys->p_ts_pool, &i_hits, &i_misses );
+        msg_Dbg( p_mux, "TS packet pool: %"PRIu64" recycled, %"PRIu64
+                 " allocated", i_hits, i_misses );
+        block_pool_Release( p_sys->p_ts_pool );
+    }
+
     free( p_sys );
 }
 
@@ -1087,6 +1172,7 @@ static int AddStream( sout_mux_t *p_mux, sout_input_t *p_input )
 
     /* Init pes chain */
     BufferChainInit( &p_stream->state.chain_pes );
+    BufferChainInit( &p_stream->prepared.chain );
 
     /* We only change PMT version (PAT isn't changed) */
     p_sys->i_pmt_version_number = ( p_sys->i_pmt_version_number + 1 )%32;
@@ -1165,6 +1251,8 @@ static void DelStream( sout_mux_t *p_mux, sout_input_t *p_input )
 
     /* Empty all data in chain_pes */
     BufferChainClean( &p_stream->state.chain_pes );
+    BufferChainClean( &p_stream->prepared.chain );
+    free( p_stream->prepared.p_dts );
 
     free(p_stream->pes.lang);
     free( p_stream->pes.p_extra );
@@ -1221,6 +1309,113 @@ static block_t *Pack_Opus(block_t *p_data)
     return p_data;
 }
 
+/* Builds all the TS packets the interleaving loop of MuxStreams() would take
+ * from a non-PCR stream, that is while its dts is not after i_max_dts.
+ * Without PCR, TSNew() only depends on the state of its own stream, so the
+ * packets are the same whatever the order streams are packetized in. */
+static void PacketizeStream( sout_mux_t *p_mux, sout_input_sys_t *p_stream,
+                             mtime_t i_max_dts )
+{
+    ts_prepared_t *p_prep = &p_stream->prepared;
+    size_t i_count = 0;
+
+    assert( p_prep->chain.i_depth == 0 );
+    p_prep->i_pos = 0;
+
+    while( p_stream->state.i_pes_dts != 0 &&
+           p_stream->state.i_pes_dts <= i_max_dts )
+    {
+        if( i_count == p_prep->i_dts_max )
+        {
+            size_t i_max = p_prep->i_dts_max ? 2 * p_prep->i_dts_max : 256;
+            mtime_t *p_dts = realloc( p_prep->p_dts, i_max * sizeof(*p_dts) );
+            if( unlikely(p_dts == NULL) )
+                break; /* the rest is packetized by MuxStreams() */
+            p_prep->p_dts = p_dts;
+            p_prep->i_dts_max = i_max;
+        }
+        p_prep->p_dts[i_count++] = p_stream->state.i_pes_dts;
+        BufferChainAppend( &p_prep->chain, TSNew( p_mux, p_stream, false ) );
+    }
+}
+
+static void *PacketizeThread( void *data )
+{
+    sout_mux_t *p_mux = data;
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+
+    vlc_mutex_lock( &p_sys->jobs_lock );
+    for( ;; )
+    {
+        while( !p_sys->b_jobs_exit && p_sys->i_jobs_next >= p_sys->i_jobs )
+            vlc_cond_wait( &p_sys->jobs_wait, &p_sys->jobs_lock );
+        if( p_sys->b_jobs_exit )
+            break;
+
+        sout_input_sys_t *p_stream = p_sys->pp_jobs[p_sys->i_jobs_next++];
+        mtime_t i_max_dts = p_sys->i_jobs_max_dts;
+
+        vlc_mutex_unlock( &p_sys->jobs_lock );
+        PacketizeStream( p_mux, p_stream, i_max_dts );
+        vlc_mutex_lock( &p_sys->jobs_lock );
+
+        if( --p_sys->i_jobs_left == 0 )
+            vlc_cond_signal( &p_sys->jobs_done );
+    }
+    vlc_mutex_unlock( &p_sys->jobs_lock );
+    return NULL;
+}
+
+/* Packetizes the non-PCR streams ahead of the interleaving, in parallel */
+static void PacketizeStreams( sout_mux_t *p_mux, mtime_t i_max_dts )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    sout_input_sys_t *p_pcr_stream = p_sys->p_pcr_input->p_sys;
+
+    if( p_sys->i_threads <= 1 )
+        return;
+
+    sout_input_sys_t **pp_jobs = realloc( p_sys->pp_jobs,
+                                    p_mux->i_nb_inputs * sizeof(*pp_jobs) );
+    if( unlikely(pp_jobs == NULL) )
+        return;
+    p_sys->pp_jobs = pp_jobs;
+
+    int i_jobs = 0;
+    for( int i = 0; i < p_mux->i_nb_inputs; i++ )
+    {
+        sout_input_sys_t *p_stream = p_mux->pp_inputs[i]->p_sys;
+
+        if( p_stream != p_pcr_stream && p_stream->state.i_pes_dts != 0 &&
+            p_stream->state.i_pes_dts <= i_max_dts )
+            pp_jobs[i_jobs++] = p_stream;
+    }
+    if( i_jobs < 2 )
+        return; /* nothing to gain */
+
+    vlc_mutex_lock( &p_sys->jobs_lock );
+    p_sys->i_jobs = i_jobs;
+    p_sys->i_jobs_next = 0;
+    p_sys->i_jobs_left = i_jobs;
+    p_sys->i_jobs_max_dts = i_max_dts;
+    vlc_cond_broadcast( &p_sys->jobs_wait );
+
+    while( p_sys->i_jobs_next < p_sys->i_jobs )
+    {
+        sout_input_sys_t *p_stream = pp_jobs[p_sys->i_jobs_next++];
+
+        vlc_mutex_unlock( &p_sys->jobs_lock );
+        PacketizeStream( p_mux, p_stream, i_max_dts );
+        vlc_mutex_lock( &p_sys->jobs_lock );
+        p_sys->i_jobs_left--;
+    }
+
+    while( p_sys->i_jobs_left > 0 )
+        vlc_cond_wait( &p_sys->jobs_done, &p_sys->jobs_lock );
+    p_sys->i_jobs = p_sys->i_jobs_next = 0;
+    vlc_mutex_unlock( &p_sys->jobs_lock );
+}
+
 /* returns true if needs more data */
 static bool MuxStreams(sout_mux_t *p_mux )
 {
@@ -1494,6 +1689,7 @@ static bool MuxStreams(sout_mux_t *p_mux )
     /* msg_Dbg( p_mux, "estimated pck=%d", i_packet_count ); */
 
     const mtime_t i_pcr_dts = p_pcr_stream->state.i_pes_dts;
+    PacketizeStreams( p_mux, i_pcr_dts + i_pcr_length );
     for (;;)
     {
         int          i_stream = -1;
@@ -1505,15 +1701,19 @@ static bool MuxStreams(sout_mux_t *p_mux )
         {
             p_stream = (sout_input_sys_t*)p_mux->pp_inputs[i]->p_sys;
 
-            if( p_stream->state.i_pes_dts == 0 )
+            const ts_prepared_t *p_prep = &p_stream->prepared;
+            mtime_t i_stream_dts = p_prep->chain.i_depth > 0
+                                 ? p_prep->p_dts[p_prep->i_pos]
+                                 : p_stream->state.i_pes_dts;
+            if( i_stream_dts == 0 )
             {
                 continue;
             }
 
-            if( i_stream == -1 || p_stream->state.i_pes_dts < i_dts )
+            if( i_stream == -1 || i_stream_dts < i_dts )
             {
                 i_stream = i;
-                i_dts = p_stream->state.i_pes_dts;
+                i_dts = i_stream_dts;
             }
         }
         if( i_stream == -1 || i_dts > i_pcr_dts + i_pcr_length )
@@ -1534,8 +1734,15 @@ static bool MuxStreams(sout_mux_t *p_mux )
                 i_pcr_length / i_packet_count;
         }
 
-        /* Build the TS packet */
-        block_t *p_ts = TSNew( p_mux, p_stream, b_pcr );
+        /* Build the TS packet, unless it was already */
+        block_t *p_ts;
+        if( p_stream->prepared.chain.i_depth > 0 )
+        {
+            p_ts = BufferChainGet( &p_stream->prepared.chain );
+            p_stream->prepared.i_pos++;
+        }
+        else
+            p_ts = TSNew( p_mux, p_stream, b_pcr );
         if( p_sys->csa != NULL &&
              (p_input->p_fmt->i_cat != AUDIO_ES || p_sys->b_crypt_audio) &&
              (p_input->p_fmt->i_cat != VIDEO_ES || p_sys->b_crypt_video) )
@@ -1755,6 +1962,34 @@ static void TSSchedule( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
         TSDate( p_mux, &new_chain, i_pcr_length, i_pcr_dts );
 }
 
+#define TS_SCRAMBLE_BATCH 256
+
+static void TSScramble( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    uint8_t *pp_pkts[TS_SCRAMBLE_BATCH];
+    int i_pkts = 0;
+
+    vlc_mutex_lock( &p_sys->csa_lock );
+    for( block_t *p_ts = p_chain_ts->p_first; p_ts != NULL; p_ts = p_ts->p_next )
+    {
+        if( !(p_ts->i_flags & BLOCK_FLAG_SCRAMBLED) )
+            continue;
+
+        pp_pkts[i_pkts++] = p_ts->p_buffer;
+        if( i_pkts == TS_SCRAMBLE_BATCH )
+        {
+            csa_EncryptBatch( p_sys->csa, pp_pkts, i_pkts,
+                              p_sys->i_csa_pkt_size );
+            i_pkts = 0;
+        }
+    }
+    if( i_pkts > 0 )
+        csa_EncryptBatch( p_sys->csa, pp_pkts, i_pkts,
+                          p_sys->i_csa_pkt_size );
+    vlc_mutex_unlock( &p_sys->csa_lock );
+}
+
 static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
                     mtime_t i_pcr_length, mtime_t i_pcr_dts )
 {
@@ -1780,6 +2015,11 @@ static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
         i_pcr_length = i_packet_count;
     }
 
+    /* scramble the whole chain at once: the cypher runs on many packets
+     * in parallel, and only the payload (not the PCR) is scrambled */
+    if( p_sys->csa != NULL )
+        TSScramble( p_mux, p_chain_ts );
+
     /* msg_Dbg( p_mux, "real pck=%d", i_packet_count ); */
     for (int i = 0; i < i_packet_count; i++ )
     {
@@ -1794,12 +2034,6 @@ static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
             /* msg_Dbg( p_mux, "pcr=%lld ms", p_ts->i_dts / 1000 ); */
             TSSetPCR( p_ts, p_ts->i_dts - p_sys->i_dts_delay - p_sys->first_dts );
         }
-        if( p_ts->i_flags & BLOCK_FLAG_SCRAMBLED )
-        {
-            vlc_mutex_lock( &p_sys->csa_lock );
-            csa_Encrypt( p_sys->csa, p_ts->p_buffer, p_sys->i_csa_pkt_size );
-            vlc_mutex_unlock( &p_sys->csa_lock );
-        }
 
         /* latency */
         p_ts->i_dts += p_sys->i_shaping_delay * 3 / 2;
@@ -1811,7 +2045,7 @@ static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
 static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream,
                        bool b_pcr )
 {
-    VLC_UNUSED(p_mux);
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
     block_t *p_pes = p_stream->state.chain_pes.p_first;
 
     bool b_new_pes = false;
@@ -1831,7 +2065,8 @@ static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream,
         b_adaptation_field = true;
     }
 
-    block_t *p_ts = block_Alloc( 188 );
+    block_t *p_ts = p_sys->p_ts_pool ? block_pool_Alloc( p_sys->p_ts_pool )
+                                     : block_Alloc( 188 );
 
     if (b_new_pes && !(p_pes->i_flags & BLOCK_FLAG_NO_KEYFRAME) && p_pes->i_flags & BLOCK_FLAG_TYPE_I)
     {
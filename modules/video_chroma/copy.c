@@ -27,13 +27,15 @@
 
 #include <vlc_common.h>
 #include <vlc_picture.h>
+#include <vlc_filter.h>
 #include <vlc_cpu.h>
 #include <assert.h>
 
 #include "copy.h"
 
-int CopyInitCache(copy_cache_t *cache, unsigned width)
+int CopyInitCache(copy_cache_t *cache, unsigned width, vlc_object_t *obj)
 {
+    cache->obj = obj;
 #ifdef CAN_COMPILE_SSE2
     cache->size = __MAX((width + 0x3f) & ~ 0x3f, 4096);
     cache->buffer = vlc_memalign(64, cache->size);
@@ -177,10 +179,14 @@ VLC_SSE
 static void SSE_SplitUV(uint8_t *dstu, size_t dstu_pitch,
                         uint8_t *dstv, size_t dstv_pitch,
                         const uint8_t *src, size_t src_pitch,
-                        unsigned width, unsigned height, unsigned cpu)
+                        unsigned width, unsigned height, unsigned cpu,
+                        bool uswc)
 {
 #ifndef CAN_COMPILE_SSSE3
     VLC_UNUSED(cpu);
+#endif
+#ifndef CAN_COMPILE_SSE4_1
+    VLC_UNUSED(uswc);
 #endif
     const uint8_t shuffle[] = { 0, 2, 4, 6, 8, 10, 12, 14,
                                 1, 3, 5, 7, 9, 11, 13, 15 };
@@ -192,11 +198,11 @@ static void SSE_SplitUV(uint8_t *dstu, size_t dstu_pitch,
     for (unsigned y = 0; y < height; y++) {
         unsigned x = 0;
 
-#define LOAD64 \
-    "movdqa  0(%[src]), %%xmm0\n" \
-    "movdqa 16(%[src]), %%xmm1\n" \
-    "movdqa 32(%[src]), %%xmm2\n" \
-    "movdqa 48(%[src]), %%xmm3\n"
+#define LOAD64(load) \
+    load "  0(%[src]), %%xmm0\n" \
+    load " 16(%[src]), %%xmm1\n" \
+    load " 32(%[src]), %%xmm2\n" \
+    load " 48(%[src]), %%xmm3\n"
 
 #define STORE2X32 \
     "movq   %%xmm0,   0(%[dst1])\n" \
@@ -208,13 +214,30 @@ static void SSE_SplitUV(uint8_t *dstu, size_t dstu_pitch,
     "movhpd %%xmm2,  16(%[dst2])\n" \
     "movhpd %%xmm3,  24(%[dst2])\n"
 
+#if defined(CAN_COMPILE_SSSE3) && defined(CAN_COMPILE_SSE4_1)
+        if (uswc && vlc_CPU_SSE4_1())
+        {
+            /* Streaming loads straight from the surface */
+            for (x = 0; x < (width & ~31); x += 32) {
+                asm volatile (
+                    "movdqu (%[shuffle]), %%xmm7\n"
+                    LOAD64("movntdqa")
+                    "pshufb  %%xmm7, %%xmm0\n"
+                    "pshufb  %%xmm7, %%xmm1\n"
+                    "pshufb  %%xmm7, %%xmm2\n"
+                    "pshufb  %%xmm7, %%xmm3\n"
+                    STORE2X32
+                    : : [dst1]"r"(&dstu[x]), [dst2]"r"(&dstv[x]), [src]"r"(&src[2*x]), [shuffle]"r"(shuffle) : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm7");
+            }
+        } else
+#endif
 #ifdef CAN_COMPILE_SSSE3
         if (vlc_CPU_SSSE3())
         {
             for (x = 0; x < (width & ~31); x += 32) {
                 asm volatile (
                     "movdqu (%[shuffle]), %%xmm7\n"
-                    LOAD64
+                    LOAD64("movdqa")
                     "pshufb  %%xmm7, %%xmm0\n"
                     "pshufb  %%xmm7, %%xmm1\n"
                     "pshufb  %%xmm7, %%xmm2\n"
@@ -228,7 +251,7 @@ static void SSE_SplitUV(uint8_t *dstu, size_t dstu_pitch,
             for (x = 0; x < (width & ~31); x += 32) {
                 asm volatile (
                     "movdqu (%[mask]), %%xmm7\n"
-                    LOAD64
+                    LOAD64("movdqa")
                     "movdqa   %%xmm0, %%xmm4\n"
                     "movdqa   %%xmm1, %%xmm5\n"
                     "movdqa   %%xmm2, %%xmm6\n"
@@ -261,26 +284,71 @@ static void SSE_SplitUV(uint8_t *dstu, size_t dstu_pitch,
     }
 }
 
+struct copy_slice
+{
+    uint8_t       *dst[2];
+    size_t         dst_pitch[2];
+    const uint8_t *src;
+    size_t         src_pitch;
+    unsigned       width;
+    unsigned       cpu;
+};
+
+static void SSE_CopyPlaneSlice(void *data, unsigned first, unsigned end)
+{
+    const struct copy_slice *slice = data;
+
+    CopyFromUswc(slice->dst[0] + first * slice->dst_pitch[0],
+                 slice->dst_pitch[0],
+                 slice->src + first * slice->src_pitch, slice->src_pitch,
+                 slice->width, end - first, slice->cpu);
+}
+
+static void SSE_SplitPlanesSlice(void *data, unsigned first, unsigned end)
+{
+    const struct copy_slice *slice = data;
+
+    asm volatile ("mfence");
+    SSE_SplitUV(slice->dst[0] + first * slice->dst_pitch[0],
+                slice->dst_pitch[0],
+                slice->dst[1] + first * slice->dst_pitch[1],
+                slice->dst_pitch[1],
+                slice->src + first * slice->src_pitch, slice->src_pitch,
+                slice->width, end - first, slice->cpu, true);
+    asm volatile ("mfence");
+}
+
 static void SSE_CopyPlane(uint8_t *dst, size_t dst_pitch,
                           const uint8_t *src, size_t src_pitch,
-                          uint8_t *cache, size_t cache_size,
+                          const copy_cache_t *cache,
                           unsigned width, unsigned height, unsigned cpu)
 {
+    if (cache->obj != NULL && (((uintptr_t)dst | dst_pitch) & 0x0f) == 0) {
+        /* No need for the cache, bands go straight to the destination */
+        struct copy_slice slice = {
+            .dst = { dst }, .dst_pitch = { dst_pitch },
+            .src = src, .src_pitch = src_pitch,
+            .width = width, .cpu = cpu,
+        };
+        vlc_Slice(cache->obj, height, 1, SSE_CopyPlaneSlice, &slice);
+        return;
+    }
+
     const unsigned w16 = (width+15) & ~15;
-    const unsigned hstep = cache_size / w16;
+    const unsigned hstep = cache->size / w16;
     assert(hstep > 0);
 
     for (unsigned y = 0; y < height; y += hstep) {
         const unsigned hblock =  __MIN(hstep, height - y);
 
         /* Copy a bunch of line into our cache */
-        CopyFromUswc(cache, w16,
+        CopyFromUswc(cache->buffer, w16,
                      src, src_pitch,
                      width, hblock, cpu);
 
         /* Copy from our cache to the destination */
         Copy2d(dst, dst_pitch,
-               cache, w16,
+               cache->buffer, w16,
                width, hblock);
 
         /* */
@@ -292,23 +360,34 @@ static void SSE_CopyPlane(uint8_t *dst, size_t dst_pitch,
 static void SSE_SplitPlanes(uint8_t *dstu, size_t dstu_pitch,
                             uint8_t *dstv, size_t dstv_pitch,
                             const uint8_t *src, size_t src_pitch,
-                            uint8_t *cache, size_t cache_size,
+                            const copy_cache_t *cache,
                             unsigned width, unsigned height, unsigned cpu)
 {
+    if (cache->obj != NULL && (((uintptr_t)src | src_pitch) & 0x0f) == 0) {
+        /* Split the surface lines with streaming loads, without the cache */
+        struct copy_slice slice = {
+            .dst = { dstu, dstv }, .dst_pitch = { dstu_pitch, dstv_pitch },
+            .src = src, .src_pitch = src_pitch,
+            .width = width, .cpu = cpu,
+        };
+        vlc_Slice(cache->obj, height, 1, SSE_SplitPlanesSlice, &slice);
+        return;
+    }
+
     const unsigned w16 = (2*width+15) & ~15;
-    const unsigned hstep = cache_size / w16;
+    const unsigned hstep = cache->size / w16;
     assert(hstep > 0);
 
     for (unsigned y = 0; y < height; y += hstep) {
         const unsigned hblock =  __MIN(hstep, height - y);
 
         /* Copy a bunch of line into our cache */
-        CopyFromUswc(cache, w16, src, src_pitch,
+        CopyFromUswc(cache->buffer, w16, src, src_pitch,
                      2*width, hblock, cpu);
 
         /* Copy from our cache to the destination */
         SSE_SplitUV(dstu, dstu_pitch, dstv, dstv_pitch,
-                    cache, w16, width, hblock, cpu);
+                    cache->buffer, w16, width, hblock, cpu, false);
 
         /* */
         src  += src_pitch  * hblock;
@@ -324,12 +403,12 @@ static void SSE_CopyFromNv12(picture_t *dst,
 {
     SSE_CopyPlane(dst->p[0].p_pixels, dst->p[0].i_pitch,
                   src[0], src_pitch[0],
-                  cache->buffer, cache->size,
+                  cache,
                   width, height, cpu);
     SSE_SplitPlanes(dst->p[2].p_pixels, dst->p[2].i_pitch,
                     dst->p[1].p_pixels, dst->p[1].i_pitch,
                     src[1], src_pitch[1],
-                    cache->buffer, cache->size,
+                    cache,
                     (width+1)/2, (height+1)/2, cpu);
     asm volatile ("emms");
 }
@@ -343,7 +422,7 @@ static void SSE_CopyFromYv12(picture_t *dst,
         const unsigned d = n > 0 ? 2 : 1;
         SSE_CopyPlane(dst->p[n].p_pixels, dst->p[n].i_pitch,
                       src[n], src_pitch[n],
-                      cache->buffer, cache->size,
+                      cache,
                       (width+d-1)/d, (height+d-1)/d, cpu);
     }
     asm volatile ("emms");
@@ -357,11 +436,11 @@ static void SSE_CopyFromNv12ToNv12(picture_t *dst,
 {
     SSE_CopyPlane(dst->p[0].p_pixels, dst->p[0].i_pitch,
                   src[0], src_pitch[0],
-                  cache->buffer, cache->size,
+                  cache,
                   width, height, cpu);
     SSE_CopyPlane(dst->p[1].p_pixels, dst->p[1].i_pitch,
                   src[1], src_pitch[1],
-                  cache->buffer, cache->size,
+                  cache,
                   width, height/2, cpu);
     asm volatile ("emms");
 }
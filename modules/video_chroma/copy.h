@@ -29,9 +29,13 @@ typedef struct {
     uint8_t *buffer;
     size_t  size;
 # endif
+    vlc_object_t *obj;
 } copy_cache_t;
 
-int  CopyInitCache(copy_cache_t *cache, unsigned width);
+/* If obj is not NULL, the planes are split across the slice threads of its
+ * LibVLC instance, and copied straight into the destination pictures when
+ * their lines are aligned. */
+int  CopyInitCache(copy_cache_t *cache, unsigned width, vlc_object_t *obj);
 void CopyCleanCache(copy_cache_t *cache);
 
 /* Copy planes from NV12 to YV12 */
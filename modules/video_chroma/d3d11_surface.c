@@ -262,7 +262,8 @@ static int OpenConverter( vlc_object_t *obj )
     filter_sys_t *p_sys = calloc(1, sizeof(filter_sys_t));
     if (!p_sys)
          return VLC_ENOMEM;
-    CopyInitCache(&p_sys->cache, p_filter->fmt_in.video.i_width );
+    CopyInitCache(&p_sys->cache, p_filter->fmt_in.video.i_width,
+                  VLC_OBJECT(p_filter));
     vlc_mutex_init(&p_sys->staging_lock);
     p_filter->p_sys = p_sys;
 
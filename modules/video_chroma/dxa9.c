@@ -191,7 +191,8 @@ static int OpenConverter( vlc_object_t *obj )
     copy_cache_t *p_copy_cache = calloc(1, sizeof(*p_copy_cache));
     if (!p_copy_cache)
          return VLC_ENOMEM;
-    CopyInitCache(p_copy_cache, p_filter->fmt_in.video.i_width );
+    CopyInitCache(p_copy_cache, p_filter->fmt_in.video.i_width,
+                  VLC_OBJECT(p_filter));
     p_filter->p_sys = (filter_sys_t*) p_copy_cache;
 
     return VLC_SUCCESS;
@@ -0,0 +1,296 @@
+/*****************************************************************************
+ * i420_rgb_avx2.c : AVX2 YUV to 32-bit RGB conversion module for vlc
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <immintrin.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_filter.h>
+#include <vlc_cpu.h>
+
+/*
+ * This uses the fixed point arithmetic of the SSE2 i420_rgb module, so that
+ * both give the same pictures. It only handles unscaled 32-bit RGB, which
+ * is what most video outputs want: anything else is left to the other
+ * converters. Lines are converted on the slice threads.
+ */
+
+/* Byte offsets of blue, green, red and the (zero) alpha in a pixel */
+typedef struct
+{
+    uint8_t b, g, r, a;
+} rgb32_layout_t;
+
+static const rgb32_layout_t layout_argb = { 0, 1, 2, 3 };
+static const rgb32_layout_t layout_rgba = { 1, 2, 3, 0 };
+static const rgb32_layout_t layout_bgra = { 3, 2, 1, 0 };
+static const rgb32_layout_t layout_abgr = { 2, 1, 0, 3 };
+
+/*****************************************************************************
+ * Local and extern prototypes.
+ *****************************************************************************/
+static int  Activate ( vlc_object_t * );
+
+static void I420_A8R8G8B8( filter_t *, picture_t *, picture_t *, unsigned );
+static void I420_R8G8B8A8( filter_t *, picture_t *, picture_t *, unsigned );
+static void I420_B8G8R8A8( filter_t *, picture_t *, picture_t *, unsigned );
+static void I420_A8B8G8R8( filter_t *, picture_t *, picture_t *, unsigned );
+static picture_t *I420_A8R8G8B8_Filter( filter_t *, picture_t * );
+static picture_t *I420_R8G8B8A8_Filter( filter_t *, picture_t * );
+static picture_t *I420_B8G8R8A8_Filter( filter_t *, picture_t * );
+static picture_t *I420_A8B8G8R8_Filter( filter_t *, picture_t * );
+
+/*****************************************************************************
+ * Module descriptor.
+ *****************************************************************************/
+vlc_module_begin ()
+    set_description( N_( "AVX2 I420,IYUV,YV12 to RV32 conversions") )
+    /* above swscale: this one is faster, and runs on the slice threads */
+    set_capability( "video filter2", 160 )
+    set_callbacks( Activate, NULL )
+vlc_module_end ()
+
+/*****************************************************************************
+ * Activate: allocate a chroma function
+ *****************************************************************************
+ * This function allocates and initializes a chroma function
+ *****************************************************************************/
+static int Activate( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+    const video_format_t *p_fmt_in = &p_filter->fmt_in.video;
+    const video_format_t *p_fmt_out = &p_filter->fmt_out.video;
+
+    if( !vlc_CPU_AVX2() )
+        return VLC_EGENERIC;
+    if( p_fmt_in->i_width & 1 || p_fmt_in->i_height & 1 )
+        return VLC_EGENERIC;
+
+    /* No scaling */
+    if( p_fmt_in->i_width != p_fmt_out->i_width
+     || p_fmt_in->i_height != p_fmt_out->i_height
+     || p_fmt_in->orientation != p_fmt_out->orientation )
+        return VLC_EGENERIC;
+
+    if( p_fmt_in->i_chroma != VLC_CODEC_I420
+     && p_fmt_in->i_chroma != VLC_CODEC_YV12 )
+        return VLC_EGENERIC;
+    if( p_fmt_out->i_chroma != VLC_CODEC_RGB32 )
+        return VLC_EGENERIC;
+
+    if( p_fmt_out->i_rmask == 0x00ff0000
+     && p_fmt_out->i_gmask == 0x0000ff00
+     && p_fmt_out->i_bmask == 0x000000ff )
+        p_filter->pf_video_filter = I420_A8R8G8B8_Filter;
+    else if( p_fmt_out->i_rmask == 0xff000000
+          && p_fmt_out->i_gmask == 0x00ff0000
+          && p_fmt_out->i_bmask == 0x0000ff00 )
+        p_filter->pf_video_filter = I420_R8G8B8A8_Filter;
+    else if( p_fmt_out->i_rmask == 0x0000ff00
+          && p_fmt_out->i_gmask == 0x00ff0000
+          && p_fmt_out->i_bmask == 0xff000000 )
+        p_filter->pf_video_filter = I420_B8G8R8A8_Filter;
+    else if( p_fmt_out->i_rmask == 0x000000ff
+          && p_fmt_out->i_gmask == 0x0000ff00
+          && p_fmt_out->i_bmask == 0x00ff0000 )
+        p_filter->pf_video_filter = I420_A8B8G8R8_Filter;
+    else
+        return VLC_EGENERIC;
+
+    return VLC_SUCCESS;
+}
+
+/* Following functions are local */
+
+static inline int16_t SatS16( int i )
+{
+    return i > INT16_MAX ? INT16_MAX : i < INT16_MIN ? INT16_MIN : i;
+}
+
+static inline uint8_t SatU8( int i )
+{
+    return i > 255 ? 255 : i < 0 ? 0 : i;
+}
+
+static inline int MulHi( int a, int16_t b )
+{
+    return (a * b) >> 16;
+}
+
+/*****************************************************************************
+ * I420_RGB32_Line_C: converts a line, exactly like the SIMD versions
+ *****************************************************************************/
+static void I420_RGB32_Line_C( uint8_t *p_out, const uint8_t *p_y,
+                               const uint8_t *p_u, const uint8_t *p_v,
+                               unsigned i_width, rgb32_layout_t layout )
+{
+    for( unsigned i_x = 0; i_x < i_width; i_x++ )
+    {
+        const int u = (p_u[i_x / 2] - 128) * 8;
+        const int v = (p_v[i_x / 2] - 128) * 8;
+        const int y = MulHi( (p_y[i_x] > 16 ? p_y[i_x] - 16 : 0) * 8,
+                             0x253f );
+        const int g = SatS16( MulHi( u, (int16_t)0xf37d )
+                            + MulHi( v, (int16_t)0xe5fc ) );
+        uint8_t *p = &p_out[4 * i_x];
+
+        p[layout.b] = SatU8( SatS16( MulHi( u, 0x4093 ) + y ) );
+        p[layout.g] = SatU8( SatS16( g + y ) );
+        p[layout.r] = SatU8( SatS16( MulHi( v, 0x3312 ) + y ) );
+        p[layout.a] = 0;
+    }
+}
+
+/*****************************************************************************
+ * I420_RGB32_Line_AVX2: converts a line, 32 pixels at once
+ *****************************************************************************/
+VLC_AVX2
+static void I420_RGB32_Line_AVX2( uint8_t *p_out, const uint8_t *p_y,
+                                  const uint8_t *p_u, const uint8_t *p_v,
+                                  unsigned i_width, rgb32_layout_t layout )
+{
+    const __m256i c128 = _mm256_set1_epi16( 128 );
+    const __m256i c16 = _mm256_set1_epi8( 16 );
+    const __m256i mask = _mm256_set1_epi16( 0x00ff );
+    const __m256i zero = _mm256_setzero_si256();
+    unsigned i_x = 0;
+
+    for( ; i_x + 32 <= i_width; i_x += 32 )
+    {
+        __m256i u = _mm256_cvtepu8_epi16(
+                        _mm_loadu_si128( (__m128i *)&p_u[i_x / 2] ) );
+        __m256i v = _mm256_cvtepu8_epi16(
+                        _mm_loadu_si128( (__m128i *)&p_v[i_x / 2] ) );
+        __m256i y = _mm256_loadu_si256( (__m256i *)&p_y[i_x] );
+
+        u = _mm256_slli_epi16( _mm256_sub_epi16( u, c128 ), 3 );
+        v = _mm256_slli_epi16( _mm256_sub_epi16( v, c128 ), 3 );
+
+        __m256i g = _mm256_adds_epi16(
+            _mm256_mulhi_epi16( u, _mm256_set1_epi16( 0xf37d ) ),
+            _mm256_mulhi_epi16( v, _mm256_set1_epi16( 0xe5fc ) ) );
+        __m256i b = _mm256_mulhi_epi16( u, _mm256_set1_epi16( 0x4093 ) );
+        __m256i r = _mm256_mulhi_epi16( v, _mm256_set1_epi16( 0x3312 ) );
+
+        /* even and odd pixels share the chroma of their 16-bit word */
+        y = _mm256_subs_epu8( y, c16 );
+        __m256i ye = _mm256_slli_epi16( _mm256_and_si256( y, mask ), 3 );
+        __m256i yo = _mm256_slli_epi16( _mm256_srli_epi16( y, 8 ), 3 );
+        ye = _mm256_mulhi_epi16( ye, _mm256_set1_epi16( 0x253f ) );
+        yo = _mm256_mulhi_epi16( yo, _mm256_set1_epi16( 0x253f ) );
+
+        /* pixels 0-15 in the low lane, 16-31 in the high lane */
+#define COMPONENT( c ) \
+        _mm256_unpacklo_epi8( \
+            _mm256_packus_epi16( _mm256_adds_epi16( c, ye ), zero ), \
+            _mm256_packus_epi16( _mm256_adds_epi16( c, yo ), zero ) )
+        __m256i comp[4];
+        comp[layout.b] = COMPONENT( b );
+        comp[layout.g] = COMPONENT( g );
+        comp[layout.r] = COMPONENT( r );
+        comp[layout.a] = zero;
+#undef COMPONENT
+
+        __m256i lo01 = _mm256_unpacklo_epi8( comp[0], comp[1] );
+        __m256i lo23 = _mm256_unpacklo_epi8( comp[2], comp[3] );
+        __m256i hi01 = _mm256_unpackhi_epi8( comp[0], comp[1] );
+        __m256i hi23 = _mm256_unpackhi_epi8( comp[2], comp[3] );
+        /* pixels 0-3, 4-7, 8-11 and 12-15 of each lane */
+        __m256i p0 = _mm256_unpacklo_epi16( lo01, lo23 );
+        __m256i p1 = _mm256_unpackhi_epi16( lo01, lo23 );
+        __m256i p2 = _mm256_unpacklo_epi16( hi01, hi23 );
+        __m256i p3 = _mm256_unpackhi_epi16( hi01, hi23 );
+
+        __m256i *p = (__m256i *)&p_out[4 * i_x];
+        _mm256_storeu_si256( p + 0, _mm256_permute2x128_si256( p0, p1, 0x20 ) );
+        _mm256_storeu_si256( p + 1, _mm256_permute2x128_si256( p2, p3, 0x20 ) );
+        _mm256_storeu_si256( p + 2, _mm256_permute2x128_si256( p0, p1, 0x31 ) );
+        _mm256_storeu_si256( p + 3, _mm256_permute2x128_si256( p2, p3, 0x31 ) );
+    }
+
+    I420_RGB32_Line_C( &p_out[4 * i_x], &p_y[i_x], &p_u[i_x / 2],
+                       &p_v[i_x / 2], i_width - i_x, layout );
+}
+
+/*****************************************************************************
+ * I420_RGB32: planar YUV 4:2:0 to packed 32-bit RGB
+ *****************************************************************************/
+static void I420_RGB32( filter_t *p_filter, picture_t *p_src,
+                        picture_t *p_dest, unsigned i_lines,
+                        rgb32_layout_t layout )
+{
+    const uint8_t *p_u = p_src->U_PIXELS;
+    const uint8_t *p_v = p_src->V_PIXELS;
+    int i_pitch_u = p_src->p[U_PLANE].i_pitch;
+    int i_pitch_v = p_src->p[V_PLANE].i_pitch;
+
+    if( p_filter->fmt_in.video.i_chroma == VLC_CODEC_YV12 )
+    {
+        const uint8_t *p_tmp = p_u;
+        p_u = p_v;
+        p_v = p_tmp;
+        i_pitch_u = p_src->p[V_PLANE].i_pitch;
+        i_pitch_v = p_src->p[U_PLANE].i_pitch;
+    }
+
+    for( unsigned i_y = 0; i_y < i_lines; i_y++ )
+        I420_RGB32_Line_AVX2( p_dest->p->p_pixels + i_y * p_dest->p->i_pitch,
+                              p_src->Y_PIXELS + i_y * p_src->p[Y_PLANE].i_pitch,
+                              p_u + i_y / 2 * i_pitch_u,
+                              p_v + i_y / 2 * i_pitch_v,
+                              p_filter->fmt_in.video.i_width, layout );
+}
+
+static void I420_A8R8G8B8( filter_t *p_filter, picture_t *p_src,
+                           picture_t *p_dest, unsigned i_lines )
+{
+    I420_RGB32( p_filter, p_src, p_dest, i_lines, layout_argb );
+}
+
+static void I420_R8G8B8A8( filter_t *p_filter, picture_t *p_src,
+                           picture_t *p_dest, unsigned i_lines )
+{
+    I420_RGB32( p_filter, p_src, p_dest, i_lines, layout_rgba );
+}
+
+static void I420_B8G8R8A8( filter_t *p_filter, picture_t *p_src,
+                           picture_t *p_dest, unsigned i_lines )
+{
+    I420_RGB32( p_filter, p_src, p_dest, i_lines, layout_bgra );
+}
+
+static void I420_A8B8G8R8( filter_t *p_filter, picture_t *p_src,
+                           picture_t *p_dest, unsigned i_lines )
+{
+    I420_RGB32( p_filter, p_src, p_dest, i_lines, layout_abgr );
+}
+
+VIDEO_FILTER_WRAPPER_SLICE( I420_A8R8G8B8 )
+VIDEO_FILTER_WRAPPER_SLICE( I420_R8G8B8A8 )
+VIDEO_FILTER_WRAPPER_SLICE( I420_B8G8R8A8 )
+VIDEO_FILTER_WRAPPER_SLICE( I420_A8B8G8R8 )
@@ -38,6 +38,9 @@
 #if defined (MODULE_NAME_IS_i420_yuy2_altivec) && defined(HAVE_ALTIVEC_H)
 #   include <altivec.h>
 #endif
+#if defined (MODULE_NAME_IS_i420_yuy2_sse2) && defined(HAVE_AVX2_INTRINSICS)
+#   include <immintrin.h>
+#endif
 
 #include "i420_yuy2.h"
 
@@ -62,18 +65,18 @@
  *****************************************************************************/
 static int  Activate ( vlc_object_t * );
 
-static void I420_YUY2           ( filter_t *, picture_t *, picture_t * );
-static void I420_YVYU           ( filter_t *, picture_t *, picture_t * );
-static void I420_UYVY           ( filter_t *, picture_t *, picture_t * );
+static void I420_YUY2 ( filter_t *, picture_t *, picture_t *, unsigned );
+static void I420_YVYU ( filter_t *, picture_t *, picture_t *, unsigned );
+static void I420_UYVY ( filter_t *, picture_t *, picture_t *, unsigned );
 static picture_t *I420_YUY2_Filter    ( filter_t *, picture_t * );
 static picture_t *I420_YVYU_Filter    ( filter_t *, picture_t * );
 static picture_t *I420_UYVY_Filter    ( filter_t *, picture_t * );
 #if !defined (MODULE_NAME_IS_i420_yuy2_altivec)
-static void I420_IUYV           ( filter_t *, picture_t *, picture_t * );
+static void I420_IUYV ( filter_t *, picture_t *, picture_t *, unsigned );
 static picture_t *I420_IUYV_Filter    ( filter_t *, picture_t * );
 #endif
 #if defined (MODULE_NAME_IS_i420_yuy2)
-static void I420_Y211           ( filter_t *, picture_t *, picture_t * );
+static void I420_Y211 ( filter_t *, picture_t *, picture_t *, unsigned );
 static picture_t *I420_Y211_Filter    ( filter_t *, picture_t * );
 #endif
 
@@ -183,14 +186,90 @@ static inline unsigned long long read_cycles(void)
 
 /* Following functions are local */
 
-VIDEO_FILTER_WRAPPER( I420_YUY2 )
-VIDEO_FILTER_WRAPPER( I420_YVYU )
-VIDEO_FILTER_WRAPPER( I420_UYVY )
+VIDEO_FILTER_WRAPPER_SLICE( I420_YUY2 )
+VIDEO_FILTER_WRAPPER_SLICE( I420_YVYU )
+VIDEO_FILTER_WRAPPER_SLICE( I420_UYVY )
 #if !defined (MODULE_NAME_IS_i420_yuy2_altivec)
-VIDEO_FILTER_WRAPPER( I420_IUYV )
+VIDEO_FILTER_WRAPPER_SLICE( I420_IUYV )
 #endif
 #if defined (MODULE_NAME_IS_i420_yuy2)
-VIDEO_FILTER_WRAPPER( I420_Y211 )
+VIDEO_FILTER_WRAPPER_SLICE( I420_Y211 )
+#endif
+
+#if defined (MODULE_NAME_IS_i420_yuy2_sse2) && defined(HAVE_AVX2_INTRINSICS)
+enum { PACKED_YUYV, PACKED_YVYU, PACKED_UYVY };
+
+/*****************************************************************************
+ * I420_Packed_AVX2: planar YUV 4:2:0 to packed YUV 4:2:2, 32 pixels at once
+ *****************************************************************************/
+VLC_AVX2
+static void I420_Packed_AVX2( picture_t *p_source, picture_t *p_dest,
+                              unsigned i_lines, unsigned i_width,
+                              int i_layout )
+{
+    for( unsigned i_y = 0; i_y < i_lines; i_y++ )
+    {
+        const uint8_t *p_y = p_source->Y_PIXELS
+                           + i_y * p_source->p[Y_PLANE].i_pitch;
+        const uint8_t *p_u = p_source->U_PIXELS
+                           + i_y / 2 * p_source->p[U_PLANE].i_pitch;
+        const uint8_t *p_v = p_source->V_PIXELS
+                           + i_y / 2 * p_source->p[V_PLANE].i_pitch;
+        uint8_t *p_line = p_dest->p->p_pixels + i_y * p_dest->p->i_pitch;
+        unsigned i_x = 0;
+
+        if( i_layout == PACKED_YVYU )
+        {
+            const uint8_t *p_tmp = p_u;
+            p_u = p_v;
+            p_v = p_tmp;
+        }
+
+        for( ; i_x + 32 <= i_width; i_x += 32 )
+        {
+            __m128i u = _mm_loadu_si128( (__m128i *)&p_u[i_x / 2] );
+            __m128i v = _mm_loadu_si128( (__m128i *)&p_v[i_x / 2] );
+            __m256i y = _mm256_loadu_si256( (__m256i *)&p_y[i_x] );
+            __m256i uv = _mm256_set_m128i( _mm_unpackhi_epi8( u, v ),
+                                           _mm_unpacklo_epi8( u, v ) );
+
+            /* unpack works within 128-bit lanes: pair the quadwords of
+             * each lane with the matching pixels first */
+            y = _mm256_permute4x64_epi64( y, 0xd8 );
+            uv = _mm256_permute4x64_epi64( uv, 0xd8 );
+
+            __m256i lo, hi;
+            if( i_layout == PACKED_UYVY )
+            {
+                lo = _mm256_unpacklo_epi8( uv, y );
+                hi = _mm256_unpackhi_epi8( uv, y );
+            }
+            else
+            {
+                lo = _mm256_unpacklo_epi8( y, uv );
+                hi = _mm256_unpackhi_epi8( y, uv );
+            }
+            _mm256_storeu_si256( (__m256i *)&p_line[2 * i_x], lo );
+            _mm256_storeu_si256( (__m256i *)&p_line[2 * i_x + 32], hi );
+        }
+
+        for( ; i_x < i_width; i_x += 2 )
+        {
+            uint8_t *p = &p_line[2 * i_x];
+
+            if( i_layout == PACKED_UYVY )
+            {
+                p[0] = p_u[i_x / 2]; p[1] = p_y[i_x];
+                p[2] = p_v[i_x / 2]; p[3] = p_y[i_x + 1];
+            }
+            else
+            {
+                p[0] = p_y[i_x];     p[1] = p_u[i_x / 2];
+                p[2] = p_y[i_x + 1]; p[3] = p_v[i_x / 2];
+            }
+        }
+    }
+}
 #endif
 
 /*****************************************************************************
@@ -198,8 +277,16 @@ VIDEO_FILTER_WRAPPER( I420_Y211 )
  *****************************************************************************/
 VLC_TARGET
 static void I420_YUY2( filter_t *p_filter, picture_t *p_source,
-                                           picture_t *p_dest )
+                                           picture_t *p_dest, unsigned i_lines )
 {
+#if defined (MODULE_NAME_IS_i420_yuy2_sse2) && defined(HAVE_AVX2_INTRINSICS)
+    if( vlc_CPU_AVX2() )
+    {
+        I420_Packed_AVX2( p_source, p_dest, i_lines,
+                          p_filter->fmt_in.video.i_width, PACKED_YUYV );
+        return;
+    }
+#endif
     uint8_t *p_line1, *p_line2 = p_dest->p->p_pixels;
     uint8_t *p_y1, *p_y2 = p_source->Y_PIXELS;
     uint8_t *p_u = p_source->U_PIXELS;
@@ -233,10 +320,10 @@ static void I420_YUY2( filter_t *p_filter, picture_t *p_source,
     vector unsigned char y_vec;
 
     if( !( ( p_filter->fmt_in.video.i_width % 32 ) |
-           ( p_filter->fmt_in.video.i_height % 2 ) ) )
+           ( i_lines % 2 ) ) )
     {
         /* Width is a multiple of 32, we take 2 lines at a time */
-        for( i_y = p_filter->fmt_in.video.i_height / 2 ; i_y-- ; )
+        for( i_y = i_lines / 2 ; i_y-- ; )
         {
             VEC_NEXT_LINES( );
             for( i_x = p_filter->fmt_in.video.i_width / 32 ; i_x-- ; )
@@ -250,10 +337,10 @@ static void I420_YUY2( filter_t *p_filter, picture_t *p_source,
 #warning FIXME: converting widths % 16 but !widths % 32 is broken on altivec
 #if 0
     else if( !( ( p_filter->fmt_in.video.i_width % 16 ) |
-                ( p_filter->fmt_in.video.i_height % 4 ) ) )
+                ( i_lines % 4 ) ) )
     {
         /* Width is only a multiple of 16, we take 4 lines at a time */
-        for( i_y = p_filter->fmt_in.video.i_height / 4 ; i_y-- ; )
+        for( i_y = i_lines / 4 ; i_y-- ; )
         {
             /* Line 1 and 2, pixels 0 to ( width - 16 ) */
             VEC_NEXT_LINES( );
@@ -298,7 +385,7 @@ static void I420_YUY2( filter_t *p_filter, picture_t *p_source,
                                - p_dest->p->i_visible_pitch;
 
 #if !defined(MODULE_NAME_IS_i420_yuy2_sse2)
-    for( i_y = p_filter->fmt_in.video.i_height / 2 ; i_y-- ; )
+    for( i_y = i_lines / 2 ; i_y-- ; )
     {
         p_line1 = p_line2;
         p_line2 += p_dest->p->i_pitch;
@@ -352,7 +439,7 @@ static void I420_YUY2( filter_t *p_filter, picture_t *p_source,
         ((intptr_t)p_line2|(intptr_t)p_y2))) )
     {
         /* use faster SSE2 aligned fetch and store */
-        for( i_y = p_filter->fmt_in.video.i_height / 2 ; i_y-- ; )
+        for( i_y = i_lines / 2 ; i_y-- ; )
         {
             p_line1 = p_line2;
             p_line2 += p_dest->p->i_pitch;
@@ -380,7 +467,7 @@ static void I420_YUY2( filter_t *p_filter, picture_t *p_source,
     else
     {
         /* use slower SSE2 unaligned fetch and store */
-        for( i_y = p_filter->fmt_in.video.i_height / 2 ; i_y-- ; )
+        for( i_y = i_lines / 2 ; i_y-- ; )
         {
             p_line1 = p_line2;
             p_line2 += p_dest->p->i_pitch;
@@ -416,8 +503,16 @@ static void I420_YUY2( filter_t *p_filter, picture_t *p_source,
  *****************************************************************************/
 VLC_TARGET
 static void I420_YVYU( filter_t *p_filter, picture_t *p_source,
-                                           picture_t *p_dest )
+                                           picture_t *p_dest, unsigned i_lines )
 {
+#if defined (MODULE_NAME_IS_i420_yuy2_sse2) && defined(HAVE_AVX2_INTRINSICS)
+    if( vlc_CPU_AVX2() )
+    {
+        I420_Packed_AVX2( p_source, p_dest, i_lines,
+                          p_filter->fmt_in.video.i_width, PACKED_YVYU );
+        return;
+    }
+#endif
     uint8_t *p_line1, *p_line2 = p_dest->p->p_pixels;
     uint8_t *p_y1, *p_y2 = p_source->Y_PIXELS;
     uint8_t *p_u = p_source->U_PIXELS;
@@ -451,10 +546,10 @@ static void I420_YVYU( filter_t *p_filter, picture_t *p_source,
     vector unsigned char y_vec;
 
     if( !( ( p_filter->fmt_in.video.i_width % 32 ) |
-           ( p_filter->fmt_in.video.i_height % 2 ) ) )
+           ( i_lines % 2 ) ) )
     {
         /* Width is a multiple of 32, we take 2 lines at a time */
-        for( i_y = p_filter->fmt_in.video.i_height / 2 ; i_y-- ; )
+        for( i_y = i_lines / 2 ; i_y-- ; )
         {
             VEC_NEXT_LINES( );
             for( i_x = p_filter->fmt_in.video.i_width / 32 ; i_x-- ; )
@@ -466,10 +561,10 @@ static void I420_YVYU( filter_t *p_filter, picture_t *p_source,
         }
     }
     else if( !( ( p_filter->fmt_in.video.i_width % 16 ) |
-                ( p_filter->fmt_in.video.i_height % 4 ) ) )
+                ( i_lines % 4 ) ) )
     {
         /* Width is only a multiple of 16, we take 4 lines at a time */
-        for( i_y = p_filter->fmt_in.video.i_height / 4 ; i_y-- ; )
+        for( i_y = i_lines / 4 ; i_y-- ; )
         {
             /* Line 1 and 2, pixels 0 to ( width - 16 ) */
             VEC_NEXT_LINES( );
@@ -513,7 +608,7 @@ static void I420_YVYU( filter_t *p_filter, picture_t *p_source,
                                - p_dest->p->i_visible_pitch;
 
 #if !defined(MODULE_NAME_IS_i420_yuy2_sse2)
-    for( i_y = p_filter->fmt_in.video.i_height / 2 ; i_y-- ; )
+    for( i_y = i_lines / 2 ; i_y-- ; )
     {
         p_line1 = p_line2;
         p_line2 += p_dest->p->i_pitch;
@@ -563,7 +658,7 @@ static void I420_YVYU( filter_t *p_filter, picture_t *p_source,
         ((intptr_t)p_line2|(intptr_t)p_y2))) )
     {
         /* use faster SSE2 aligned fetch and store */
-        for( i_y = p_filter->fmt_in.video.i_height / 2 ; i_y-- ; )
+        for( i_y = i_lines / 2 ; i_y-- ; )
         {
             p_line1 = p_line2;
             p_line2 += p_dest->p->i_pitch;
@@ -591,7 +686,7 @@ static void I420_YVYU( filter_t *p_filter, picture_t *p_source,
     else
     {
         /* use slower SSE2 unaligned fetch and store */
-        for( i_y = p_filter->fmt_in.video.i_height / 2 ; i_y-- ; )
+        for( i_y = i_lines / 2 ; i_y-- ; )
         {
             p_line1 = p_line2;
             p_line2 += p_dest->p->i_pitch;
@@ -626,8 +721,16 @@ static void I420_YVYU( filter_t *p_filter, picture_t *p_source,
  *****************************************************************************/
 VLC_TARGET
 static void I420_UYVY( filter_t *p_filter, picture_t *p_source,
-                                           picture_t *p_dest )
+                                           picture_t *p_dest, unsigned i_lines )
 {
+#if defined (MODULE_NAME_IS_i420_yuy2_sse2) && defined(HAVE_AVX2_INTRINSICS)
+    if( vlc_CPU_AVX2() )
+    {
+        I420_Packed_AVX2( p_source, p_dest, i_lines,
+                          p_filter->fmt_in.video.i_width, PACKED_UYVY );
+        return;
+    }
+#endif
     uint8_t *p_line1, *p_line2 = p_dest->p->p_pixels;
     uint8_t *p_y1, *p_y2 = p_source->Y_PIXELS;
     uint8_t *p_u = p_source->U_PIXELS;
@@ -661,10 +764,10 @@ static void I420_UYVY( filter_t *p_filter, picture_t *p_source,
     vector unsigned char y_vec;
 
     if( !( ( p_filter->fmt_in.video.i_width % 32 ) |
-           ( p_filter->fmt_in.video.i_height % 2 ) ) )
+           ( i_lines % 2 ) ) )
     {
         /* Width is a multiple of 32, we take 2 lines at a time */
-        for( i_y = p_filter->fmt_in.video.i_height / 2 ; i_y-- ; )
+        for( i_y = i_lines / 2 ; i_y-- ; )
         {
             VEC_NEXT_LINES( );
             for( i_x = p_filter->fmt_in.video.i_width / 32 ; i_x-- ; )
@@ -676,10 +779,10 @@ static void I420_UYVY( filter_t *p_filter, picture_t *p_source,
         }
     }
     else if( !( ( p_filter->fmt_in.video.i_width % 16 ) |
-                ( p_filter->fmt_in.video.i_height % 4 ) ) )
+                ( i_lines % 4 ) ) )
     {
         /* Width is only a multiple of 16, we take 4 lines at a time */
-        for( i_y = p_filter->fmt_in.video.i_height / 4 ; i_y-- ; )
+        for( i_y = i_lines / 4 ; i_y-- ; )
         {
             /* Line 1 and 2, pixels 0 to ( width - 16 ) */
             VEC_NEXT_LINES( );
@@ -723,7 +826,7 @@ static void I420_UYVY( filter_t *p_filter, picture_t *p_source,
                                - p_dest->p->i_visible_pitch;
 
 #if !defined(MODULE_NAME_IS_i420_yuy2_sse2)
-    for( i_y = p_filter->fmt_in.video.i_height / 2 ; i_y-- ; )
+    for( i_y = i_lines / 2 ; i_y-- ; )
     {
         p_line1 = p_line2;
         p_line2 += p_dest->p->i_pitch;
@@ -773,7 +876,7 @@ static void I420_UYVY( filter_t *p_filter, picture_t *p_source,
         ((intptr_t)p_line2|(intptr_t)p_y2))) )
     {
         /* use faster SSE2 aligned fetch and store */
-        for( i_y = p_filter->fmt_in.video.i_height / 2 ; i_y-- ; )
+        for( i_y = i_lines / 2 ; i_y-- ; )
         {
             p_line1 = p_line2;
             p_line2 += p_dest->p->i_pitch;
@@ -801,7 +904,7 @@ static void I420_UYVY( filter_t *p_filter, picture_t *p_source,
     else
     {
         /* use slower SSE2 unaligned fetch and store */
-        for( i_y = p_filter->fmt_in.video.i_height / 2 ; i_y-- ; )
+        for( i_y = i_lines / 2 ; i_y-- ; )
         {
             p_line1 = p_line2;
             p_line2 += p_dest->p->i_pitch;
@@ -836,9 +939,9 @@ static void I420_UYVY( filter_t *p_filter, picture_t *p_source,
  * I420_IUYV: planar YUV 4:2:0 to interleaved packed UYVY 4:2:2
  *****************************************************************************/
 static void I420_IUYV( filter_t *p_filter, picture_t *p_source,
-                                           picture_t *p_dest )
+                                           picture_t *p_dest, unsigned i_lines )
 {
-    VLC_UNUSED(p_source); VLC_UNUSED(p_dest);
+    VLC_UNUSED(p_source); VLC_UNUSED(p_dest); VLC_UNUSED(i_lines);
     /* FIXME: TODO ! */
     msg_Err( p_filter, "I420_IUYV unimplemented, please harass <sam@zoy.org>" );
 }
@@ -849,7 +952,7 @@ static void I420_IUYV( filter_t *p_filter, picture_t *p_source,
  *****************************************************************************/
 #if defined (MODULE_NAME_IS_i420_yuy2)
 static void I420_Y211( filter_t *p_filter, picture_t *p_source,
-                                           picture_t *p_dest )
+                                           picture_t *p_dest, unsigned i_lines )
 {
     uint8_t *p_line1, *p_line2 = p_dest->p->p_pixels;
     uint8_t *p_y1, *p_y2 = p_source->Y_PIXELS;
@@ -865,7 +968,7 @@ static void I420_Y211( filter_t *p_filter, picture_t *p_source,
     const int i_dest_margin = p_dest->p->i_pitch
                                - p_dest->p->i_visible_pitch;
 
-    for( i_y = p_filter->fmt_in.video.i_height / 2 ; i_y-- ; )
+    for( i_y = i_lines / 2 ; i_y-- ; )
     {
         p_line1 = p_line2;
         p_line2 += p_dest->p->i_pitch;
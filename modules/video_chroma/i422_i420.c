@@ -42,9 +42,9 @@
  *****************************************************************************/
 static int  Activate ( vlc_object_t * );
 
-static void I422_I420( filter_t *, picture_t *, picture_t * );
-static void I422_YV12( filter_t *, picture_t *, picture_t * );
-static void I422_YUVA( filter_t *, picture_t *, picture_t * );
+static void I422_I420( filter_t *, picture_t *, picture_t *, unsigned );
+static void I422_YV12( filter_t *, picture_t *, picture_t *, unsigned );
+static void I422_YUVA( filter_t *, picture_t *, picture_t *, unsigned );
 static picture_t *I422_I420_Filter( filter_t *, picture_t * );
 static picture_t *I422_YV12_Filter( filter_t *, picture_t * );
 static picture_t *I422_YUVA_Filter( filter_t *, picture_t * );
@@ -109,22 +109,22 @@ static int Activate( vlc_object_t *p_this )
 }
 
 /* Following functions are local */
-VIDEO_FILTER_WRAPPER( I422_I420 )
-VIDEO_FILTER_WRAPPER( I422_YV12 )
-VIDEO_FILTER_WRAPPER( I422_YUVA )
+VIDEO_FILTER_WRAPPER_SLICE( I422_I420 )
+VIDEO_FILTER_WRAPPER_SLICE( I422_YV12 )
+VIDEO_FILTER_WRAPPER_SLICE( I422_YUVA )
 
 /*****************************************************************************
  * I422_I420: planar YUV 4:2:2 to planar I420 4:2:0 Y:U:V
  *****************************************************************************/
 static void I422_I420( filter_t *p_filter, picture_t *p_source,
-                                           picture_t *p_dest )
+                                           picture_t *p_dest, unsigned i_lines )
 {
     uint16_t i_dpy = p_dest->p[Y_PLANE].i_pitch;
     uint16_t i_spy = p_source->p[Y_PLANE].i_pitch;
     uint16_t i_dpuv = p_dest->p[U_PLANE].i_pitch;
     uint16_t i_spuv = p_source->p[U_PLANE].i_pitch;
     uint16_t i_width = p_filter->fmt_in.video.i_width;
-    uint16_t i_y = p_filter->fmt_in.video.i_height;
+    uint16_t i_y = i_lines;
     uint8_t *p_dy = p_dest->Y_PIXELS + (i_y-1)*i_dpy;
     uint8_t *p_y = p_source->Y_PIXELS + (i_y-1)*i_spy;
     uint8_t *p_du = p_dest->U_PIXELS + (i_y/2-1)*i_dpuv;
@@ -146,14 +146,14 @@ static void I422_I420( filter_t *p_filter, picture_t *p_source,
  * I422_YV12: planar YUV 4:2:2 to planar YV12 4:2:0 Y:V:U
  *****************************************************************************/
 static void I422_YV12( filter_t *p_filter, picture_t *p_source,
-                                           picture_t *p_dest )
+                                           picture_t *p_dest, unsigned i_lines )
 {
     uint16_t i_dpy = p_dest->p[Y_PLANE].i_pitch;
     uint16_t i_spy = p_source->p[Y_PLANE].i_pitch;
     uint16_t i_dpuv = p_dest->p[U_PLANE].i_pitch;
     uint16_t i_spuv = p_source->p[U_PLANE].i_pitch;
     uint16_t i_width = p_filter->fmt_in.video.i_width;
-    uint16_t i_y = p_filter->fmt_in.video.i_height;
+    uint16_t i_y = i_lines;
     uint8_t *p_dy = p_dest->Y_PIXELS + (i_y-1)*i_dpy;
     uint8_t *p_y = p_source->Y_PIXELS + (i_y-1)*i_spy;
     uint8_t *p_du = p_dest->V_PIXELS + (i_y/2-1)*i_dpuv; /* U and V are swapped */
@@ -175,9 +175,9 @@ static void I422_YV12( filter_t *p_filter, picture_t *p_source,
  * I422_YUVA: planar YUV 4:2:2 to planar YUVA 4:2:0:4 Y:U:V:A
  *****************************************************************************/
 static void I422_YUVA( filter_t *p_filter, picture_t *p_source,
-                                           picture_t *p_dest )
+                                           picture_t *p_dest, unsigned i_lines )
 {
-    I422_I420( p_filter, p_source, p_dest );
+    I422_I420( p_filter, p_source, p_dest, i_lines );
     memset( p_dest->p[A_PLANE].p_pixels, 0xff,
-                p_dest->p[A_PLANE].i_lines * p_dest->p[A_PLANE].i_pitch );
+                i_lines * p_dest->p[A_PLANE].i_pitch );
 }
@@ -32,6 +32,11 @@
 #include <vlc_common.h>
 #include <vlc_plugin.h>
 #include <vlc_filter.h>
+#include <vlc_cpu.h>
+
+#ifdef HAVE_AVX2_INTRINSICS
+#   include <immintrin.h>
+#endif
 
 #define SRC_FOURCC "YUY2,YUNV,YVYU,UYVY,UYNV,Y422"
 #define DEST_FOURCC  "I420"
@@ -41,9 +46,9 @@
  *****************************************************************************/
 static int  Activate ( vlc_object_t * );
 
-static void YUY2_I420           ( filter_t *, picture_t *, picture_t * );
-static void YVYU_I420           ( filter_t *, picture_t *, picture_t * );
-static void UYVY_I420           ( filter_t *, picture_t *, picture_t * );
+static void YUY2_I420 ( filter_t *, picture_t *, picture_t *, unsigned );
+static void YVYU_I420 ( filter_t *, picture_t *, picture_t *, unsigned );
+static void UYVY_I420 ( filter_t *, picture_t *, picture_t *, unsigned );
 
 static picture_t *YUY2_I420_Filter    ( filter_t *, picture_t * );
 static picture_t *YVYU_I420_Filter    ( filter_t *, picture_t * );
@@ -107,16 +112,110 @@ static int Activate( vlc_object_t *p_this )
 }
 
 /* Following functions are local */
-VIDEO_FILTER_WRAPPER( YUY2_I420 )
-VIDEO_FILTER_WRAPPER( YVYU_I420 )
-VIDEO_FILTER_WRAPPER( UYVY_I420 )
+VIDEO_FILTER_WRAPPER_SLICE( YUY2_I420 )
+VIDEO_FILTER_WRAPPER_SLICE( YVYU_I420 )
+VIDEO_FILTER_WRAPPER_SLICE( UYVY_I420 )
+
+#ifdef HAVE_AVX2_INTRINSICS
+/*****************************************************************************
+ * Packed_I420_AVX2: packed YUV 4:2:2 to planar YUV 4:2:0, 32 pixels at once
+ *****************************************************************************
+ * i_y_offset is the offset of the first luma byte in a macropixel (0 or 1),
+ * p_c1 and p_c2 receive the first and second chroma bytes of a macropixel.
+ * The chroma of the odd lines is dropped, like the C versions do.
+ *****************************************************************************/
+VLC_AVX2
+static void Packed_I420_AVX2( picture_t *p_source, picture_t *p_dest,
+                              unsigned i_lines, unsigned i_width,
+                              int i_y_offset, uint8_t *p_c1, uint8_t *p_c2 )
+{
+    const __m256i mask = _mm256_set1_epi16( 0x00ff );
+    const int i_c_offset = 1 - i_y_offset;
+
+    for( unsigned i_y = 0; i_y < i_lines; i_y++ )
+    {
+        const uint8_t *p_line = p_source->p->p_pixels
+                              + i_y * p_source->p->i_pitch;
+        uint8_t *p_y = p_dest->Y_PIXELS + i_y * p_dest->p[Y_PLANE].i_pitch;
+        const bool b_chroma = !(i_y & 1);
+        unsigned i_x = 0;
+
+        for( ; i_x + 32 <= i_width; i_x += 32 )
+        {
+            __m256i a = _mm256_loadu_si256( (__m256i *)&p_line[2 * i_x] );
+            __m256i b = _mm256_loadu_si256( (__m256i *)&p_line[2 * i_x + 32] );
+            __m256i ya, yb, ca, cb;
+
+            if( i_y_offset == 0 )
+            {
+                ya = _mm256_and_si256( a, mask );
+                yb = _mm256_and_si256( b, mask );
+                ca = _mm256_srli_epi16( a, 8 );
+                cb = _mm256_srli_epi16( b, 8 );
+            }
+            else
+            {
+                ya = _mm256_srli_epi16( a, 8 );
+                yb = _mm256_srli_epi16( b, 8 );
+                ca = _mm256_and_si256( a, mask );
+                cb = _mm256_and_si256( b, mask );
+            }
+            /* packus works within 128-bit lanes: put the quadwords back in
+             * order */
+            __m256i y = _mm256_permute4x64_epi64(
+                            _mm256_packus_epi16( ya, yb ), 0xd8 );
+            _mm256_storeu_si256( (__m256i *)&p_y[i_x], y );
+
+            if( b_chroma )
+            {
+                __m256i c = _mm256_permute4x64_epi64(
+                                _mm256_packus_epi16( ca, cb ), 0xd8 );
+                c = _mm256_permute4x64_epi64(
+                        _mm256_packus_epi16( _mm256_and_si256( c, mask ),
+                                             _mm256_srli_epi16( c, 8 ) ),
+                        0xd8 );
+                _mm_storeu_si128( (__m128i *)&p_c1[i_x / 2],
+                                  _mm256_castsi256_si128( c ) );
+                _mm_storeu_si128( (__m128i *)&p_c2[i_x / 2],
+                                  _mm256_extracti128_si256( c, 1 ) );
+            }
+        }
+
+        for( ; i_x < i_width; i_x += 2 )
+        {
+            p_y[i_x] = p_line[2 * i_x + i_y_offset];
+            p_y[i_x + 1] = p_line[2 * i_x + 2 + i_y_offset];
+            if( b_chroma )
+            {
+                p_c1[i_x / 2] = p_line[2 * i_x + i_c_offset];
+                p_c2[i_x / 2] = p_line[2 * i_x + 2 + i_c_offset];
+            }
+        }
+
+        if( !b_chroma )
+        {
+            p_c1 += p_dest->p[U_PLANE].i_pitch;
+            p_c2 += p_dest->p[V_PLANE].i_pitch;
+        }
+    }
+}
+#endif
 
 /*****************************************************************************
  * YUY2_I420: packed YUY2 4:2:2 to planar YUV 4:2:0
  *****************************************************************************/
 static void YUY2_I420( filter_t *p_filter, picture_t *p_source,
-                                           picture_t *p_dest )
+                                           picture_t *p_dest, unsigned i_lines )
 {
+#ifdef HAVE_AVX2_INTRINSICS
+    if( vlc_CPU_AVX2() )
+    {
+        Packed_I420_AVX2( p_source, p_dest, i_lines,
+                          p_filter->fmt_out.video.i_width, 0, p_dest->U_PIXELS, p_dest->V_PIXELS );
+        return;
+    }
+#endif
+
     uint8_t *p_line = p_source->p->p_pixels;
 
     uint8_t *p_y = p_dest->Y_PIXELS;
@@ -134,7 +233,7 @@ static void YUY2_I420( filter_t *p_filter, picture_t *p_source,
 
     bool b_skip = false;
 
-    for( i_y = p_filter->fmt_out.video.i_height ; i_y-- ; )
+    for( i_y = i_lines ; i_y-- ; )
     {
         if( b_skip )
         {
@@ -172,8 +271,11 @@ static void YUY2_I420( filter_t *p_filter, picture_t *p_source,
         }
         p_line += i_source_margin;
         p_y += i_dest_margin;
-        p_u += i_dest_margin_c;
-        p_v += i_dest_margin_c;
+        if( b_skip )
+        {
+            p_u += i_dest_margin_c;
+            p_v += i_dest_margin_c;
+        }
 
         b_skip = !b_skip;
     }
@@ -183,8 +285,17 @@ static void YUY2_I420( filter_t *p_filter, picture_t *p_source,
  * YVYU_I420: packed YVYU 4:2:2 to planar YUV 4:2:0
  *****************************************************************************/
 static void YVYU_I420( filter_t *p_filter, picture_t *p_source,
-                                           picture_t *p_dest )
+                                           picture_t *p_dest, unsigned i_lines )
 {
+#ifdef HAVE_AVX2_INTRINSICS
+    if( vlc_CPU_AVX2() )
+    {
+        Packed_I420_AVX2( p_source, p_dest, i_lines,
+                          p_filter->fmt_out.video.i_width, 0, p_dest->V_PIXELS, p_dest->U_PIXELS );
+        return;
+    }
+#endif
+
     uint8_t *p_line = p_source->p->p_pixels;
 
     uint8_t *p_y = p_dest->Y_PIXELS;
@@ -202,7 +313,7 @@ static void YVYU_I420( filter_t *p_filter, picture_t *p_source,
 
     bool b_skip = false;
 
-    for( i_y = p_filter->fmt_out.video.i_height ; i_y-- ; )
+    for( i_y = i_lines ; i_y-- ; )
     {
         if( b_skip )
         {
@@ -240,8 +351,11 @@ static void YVYU_I420( filter_t *p_filter, picture_t *p_source,
         }
         p_line += i_source_margin;
         p_y += i_dest_margin;
-        p_u += i_dest_margin_c;
-        p_v += i_dest_margin_c;
+        if( b_skip )
+        {
+            p_u += i_dest_margin_c;
+            p_v += i_dest_margin_c;
+        }
 
         b_skip = !b_skip;
     }
@@ -251,8 +365,17 @@ static void YVYU_I420( filter_t *p_filter, picture_t *p_source,
  * UYVY_I420: packed UYVY 4:2:2 to planar YUV 4:2:0
  *****************************************************************************/
 static void UYVY_I420( filter_t *p_filter, picture_t *p_source,
-                                           picture_t *p_dest )
+                                           picture_t *p_dest, unsigned i_lines )
 {
+#ifdef HAVE_AVX2_INTRINSICS
+    if( vlc_CPU_AVX2() )
+    {
+        Packed_I420_AVX2( p_source, p_dest, i_lines,
+                          p_filter->fmt_out.video.i_width, 1, p_dest->U_PIXELS, p_dest->V_PIXELS );
+        return;
+    }
+#endif
+
     uint8_t *p_line = p_source->p->p_pixels;
 
     uint8_t *p_y = p_dest->Y_PIXELS;
@@ -270,15 +393,15 @@ static void UYVY_I420( filter_t *p_filter, picture_t *p_source,
 
     bool b_skip = false;
 
-    for( i_y = p_filter->fmt_out.video.i_height ; i_y-- ; )
+    for( i_y = i_lines ; i_y-- ; )
     {
         if( b_skip )
         {
             for( i_x = p_filter->fmt_out.video.i_width / 8 ; i_x-- ; )
             {
     #define C_UYVY_YUV422_skip( p_line, p_y, p_u, p_v )      \
-                *p_u++ = *p_line++; p_line++; \
-                *p_v++ = *p_line++; p_line++
+                p_line++; *p_y++ = *p_line++; \
+                p_line++; *p_y++ = *p_line++
                 C_UYVY_YUV422_skip( p_line, p_y, p_u, p_v );
                 C_UYVY_YUV422_skip( p_line, p_y, p_u, p_v );
                 C_UYVY_YUV422_skip( p_line, p_y, p_u, p_v );
@@ -308,8 +431,11 @@ static void UYVY_I420( filter_t *p_filter, picture_t *p_source,
         }
         p_line += i_source_margin;
         p_y += i_dest_margin;
-        p_u += i_dest_margin_c;
-        p_v += i_dest_margin_c;
+        if( b_skip )
+        {
+            p_u += i_dest_margin_c;
+            p_v += i_dest_margin_c;
+        }
 
         b_skip = !b_skip;
     }
@@ -38,7 +38,7 @@
 /*****************************************************************************
  * Local prototypes
  *****************************************************************************/
-static int GetLuminanceAvg( picture_t * p_pic );
+static int GetLuminanceAvg( filter_t *, picture_t * p_pic );
 static picture_t *Filter( filter_t *, picture_t * );
 static int AntiFlickerCallback( vlc_object_t *p_this, char const *psz_var,
                            vlc_value_t oldval, vlc_value_t newval,
@@ -167,27 +167,135 @@ static void Destroy( vlc_object_t *p_this )
 }
 
 /*****************************************************************************
- * GetLuminanceAvg : The funtion returns the luminance average for a picture
+ * Slices of a picture
  *****************************************************************************/
-static int GetLuminanceAvg( picture_t *p_pic )
+typedef struct
+{
+    picture_t *p_pic;
+    picture_t *p_outpic;
+    atomic_uint lum_sum;
+    bool scene_changed;
+    int scale_num;
+    int i_softening;
+} antiflicker_slice_t;
+
+static void LuminanceSlice( filter_t *p_filter, void *p_data,
+                            unsigned i_first, unsigned i_end )
 {
+    antiflicker_slice_t *p_slice = p_data;
+    picture_t *p_pic = p_slice->p_pic;
     uint8_t *p_yplane_out = p_pic->p[Y_PLANE].p_pixels;
 
-    int i_num_lines = p_pic->p[Y_PLANE].i_visible_lines;
     int i_num_cols = p_pic->p[Y_PLANE].i_visible_pitch;
     int i_in_pitch = p_pic->p[Y_PLANE].i_pitch;
 
-    if( i_num_lines == 0 || i_num_cols == 0 )
-        return 0;
+    VLC_UNUSED(p_filter);
 
     unsigned lum_sum = 0;
-    for( int i_line = 0 ; i_line < i_num_lines ; ++i_line )
+    for( unsigned i_line = i_first ; i_line < i_end ; ++i_line )
     {
         for( int i_col = 0 ; i_col < i_num_cols; ++i_col )
         {
             lum_sum += p_yplane_out[i_line*i_in_pitch+i_col];
         }
     }
+    atomic_fetch_add( &p_slice->lum_sum, lum_sum );
+}
+
+static void AdjustSlice( filter_t *p_filter, void *p_data,
+                         unsigned i_first, unsigned i_end )
+{
+    antiflicker_slice_t *p_slice = p_data;
+    picture_t in, out;
+
+    filter_SlicePicture( &in, p_slice->p_pic, i_first, i_end );
+    filter_SlicePicture( &out, p_slice->p_outpic, i_first, i_end );
+
+    uint8_t *p_yplane_in = in.p[Y_PLANE].p_pixels;
+    uint8_t *p_yplane_out = out.p[Y_PLANE].p_pixels;
+
+    int i_num_lines = in.p[Y_PLANE].i_visible_lines;
+    int i_num_cols = in.p[Y_PLANE].i_visible_pitch;
+    int i_in_pitch = in.p[Y_PLANE].i_pitch;
+    int i_out_pitch = out.p[Y_PLANE].i_pitch;
+
+    if ( p_slice->scene_changed )
+    {
+        plane_CopyPixels( &out.p[Y_PLANE], &in.p[Y_PLANE] );
+    }
+    else
+    {
+        /******* Apply the adjustment factor to each pixel on Y_PLANE ********/
+        uint8_t shift = 8;
+        int scale_num = p_slice->scale_num;
+
+        for( int i_line = 0 ; i_line < i_num_lines ; i_line++ )
+        {
+            for( int i_col = 0; i_col < i_num_cols  ; i_col++ )
+            {
+                uint8_t pixel_data = p_yplane_in[i_line*i_in_pitch+i_col];
+                int pixel_val = ( scale_num * pixel_data +
+                       (1<<(shift -1)) ) >> shift;
+                p_yplane_out[i_line*i_out_pitch+i_col] =
+                       (pixel_val>255) ? 255:pixel_val;
+            }
+        }
+    }
+
+    /***************** Copy the UV plane as such *****************************/
+    plane_CopyPixels( &out.p[U_PLANE], &in.p[U_PLANE] );
+    plane_CopyPixels( &out.p[V_PLANE], &in.p[V_PLANE] );
+
+    int i_softening = p_slice->i_softening;
+    if (p_slice->scene_changed || i_softening == 0)
+        return;
+
+    /******* Temporal softening phase. Adapted from code by Steven Don ******/
+    int i_video_width = p_filter->fmt_in.video.i_width;
+    uint8_t *p_yplane_out_old = p_filter->p_sys->p_old_data
+                              + i_first * i_video_width;
+
+    for( int i_line = 0 ; i_line < i_num_lines ; i_line++ )
+    {
+        for( int i_col = 0; i_col < i_num_cols  ; i_col++ )
+        {
+            uint8_t pixel_data = p_yplane_out[i_line*i_out_pitch+i_col];
+            uint8_t pixel_old = p_yplane_out_old[i_line*i_video_width+i_col];
+            int diff = abs(pixel_data - pixel_old);
+            if (diff < i_softening)
+            {
+                if (diff > (i_softening >> 1))
+                {
+                    p_yplane_out_old[i_line*i_video_width+i_col] =
+                        ((pixel_data * 2) + pixel_old) /3;
+                }
+            }
+            else
+            {
+                p_yplane_out_old[i_line*i_video_width+i_col] = pixel_data;
+            }
+            p_yplane_out[i_line*i_out_pitch+i_col] =
+                p_yplane_out_old[i_line*i_video_width+i_col];
+        }
+    }
+}
+
+/*****************************************************************************
+ * GetLuminanceAvg : The funtion returns the luminance average for a picture
+ *****************************************************************************/
+static int GetLuminanceAvg( filter_t *p_filter, picture_t *p_pic )
+{
+    int i_num_lines = p_pic->p[Y_PLANE].i_visible_lines;
+    int i_num_cols = p_pic->p[Y_PLANE].i_visible_pitch;
+
+    if( i_num_lines == 0 || i_num_cols == 0 )
+        return 0;
+
+    antiflicker_slice_t slice = { .p_pic = p_pic };
+    atomic_init( &slice.lum_sum, 0 );
+    filter_Slice( p_filter, i_num_lines, 1, LuminanceSlice, &slice );
+
+    unsigned lum_sum = atomic_load( &slice.lum_sum );
     unsigned div = i_num_lines * i_num_cols;
     return (lum_sum + (div>>1)) / div;
 }
@@ -214,17 +322,11 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
     int i_window_size = atomic_load( &p_filter->p_sys->i_window_size );
     int i_softening = atomic_load( &p_filter->p_sys->i_softening );
 
-    uint8_t *p_yplane_in = p_pic->p[Y_PLANE].p_pixels;
-    uint8_t *p_yplane_out = p_outpic->p[Y_PLANE].p_pixels;
     bool scene_changed = false;
-
-    int i_num_lines = p_pic->p[Y_PLANE].i_visible_lines;
-    int i_num_cols = p_pic->p[Y_PLANE].i_visible_pitch;
-    int i_in_pitch = p_pic->p[Y_PLANE].i_pitch;
-    int i_out_pitch = p_outpic->p[Y_PLANE].i_pitch;
+    int scale_num = 0;
 
     /******** Get the luminance average for the current picture ********/
-    int lum_avg = GetLuminanceAvg(p_pic);
+    int lum_avg = GetLuminanceAvg(p_filter, p_pic);
 
     /*Identify as scene change if the luminance average deviates
      more than the threshold value or if it is the first frame*/
@@ -241,7 +343,6 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
         //reset the luminance data
         for (int i = 0; i < i_window_size; ++i)
             p_filter->p_sys->ia_luminance_data[i] = lum_avg;
-        plane_CopyPixels( &p_outpic->p[Y_PLANE], &p_pic->p[Y_PLANE] );
     }
     else
     {
@@ -261,59 +362,20 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
              scale = filt/(i_window_size*lum_avg);
         }
 
-        /******* Apply the adjustment factor to each pixel on Y_PLANE ********/
         uint8_t shift = 8;
-        int scale_num = __MIN(scale,255) * ( 1 << shift );
-
-        for( int i_line = 0 ; i_line < i_num_lines ; i_line++ )
-        {
-            for( int i_col = 0; i_col < i_num_cols  ; i_col++ )
-            {
-                uint8_t pixel_data = p_yplane_in[i_line*i_in_pitch+i_col];
-                int pixel_val = ( scale_num * pixel_data +
-                       (1<<(shift -1)) ) >> shift;
-                p_yplane_out[i_line*i_out_pitch+i_col] =
-                       (pixel_val>255) ? 255:pixel_val;
-            }
-        }
+        scale_num = __MIN(scale,255) * ( 1 << shift );
     }
 
-    /***************** Copy the UV plane as such *****************************/
-    plane_CopyPixels( &p_outpic->p[U_PLANE], &p_pic->p[U_PLANE] );
-    plane_CopyPixels( &p_outpic->p[V_PLANE], &p_pic->p[V_PLANE] );
-
-    if (scene_changed || i_softening == 0)
-    {
-       return CopyInfoAndRelease( p_outpic, p_pic );
-    }
-
-    /******* Temporal softening phase. Adapted from code by Steven Don ******/
-    uint8_t *p_yplane_out_old = p_filter->p_sys->p_old_data;
-    int i_video_width = p_filter->fmt_in.video.i_width;
-
-    for( int i_line = 0 ; i_line < i_num_lines ; i_line++ )
-    {
-        for( int i_col = 0; i_col < i_num_cols  ; i_col++ )
-        {
-            uint8_t pixel_data = p_yplane_out[i_line*i_out_pitch+i_col];
-            uint8_t pixel_old = p_yplane_out_old[i_line*i_video_width+i_col];
-            int diff = abs(pixel_data - pixel_old);
-            if (diff < i_softening)
-            {
-                if (diff > (i_softening >> 1))
-                {
-                    p_yplane_out_old[i_line*i_video_width+i_col] =
-                        ((pixel_data * 2) + pixel_old) /3;
-                }
-            }
-            else
-            {
-                p_yplane_out_old[i_line*i_video_width+i_col] = pixel_data;
-            }
-            p_yplane_out[i_line*i_out_pitch+i_col] =
-                p_yplane_out_old[i_line*i_video_width+i_col];
-        }
-    }
+    /******* Adjust, copy the UV planes and soften, slice by slice ********/
+    antiflicker_slice_t slice = {
+        .p_pic = p_pic,
+        .p_outpic = p_outpic,
+        .scene_changed = scene_changed,
+        .scale_num = scale_num,
+        .i_softening = i_softening,
+    };
+    filter_Slice( p_filter, p_pic->p[Y_PLANE].i_visible_lines,
+                  filter_SliceAlignment( p_pic ), AdjustSlice, &slice );
 
     return CopyInfoAndRelease( p_outpic, p_pic );
 }
@@ -29,6 +29,10 @@
 #   include "mmx.h"
 #endif
 
+#ifdef HAVE_AVX2_INTRINSICS
+#   include <immintrin.h>
+#endif
+
 #include <stdint.h>
 #include <assert.h>
 
@@ -268,6 +272,105 @@ static void DarkenFieldMMX( picture_t *p_dst,
 }
 #endif
 
+#ifdef HAVE_AVX2_INTRINSICS
+VLC_AVX2
+static void DarkenFieldAVX2( picture_t *p_dst,
+                             const int i_field, const int i_strength,
+                             bool process_chroma )
+{
+    assert( p_dst != NULL );
+    assert( i_field == 0 || i_field == 1 );
+    assert( i_strength >= 1 && i_strength <= 3 );
+
+    /* Same as the MMX version, 32 pixels at a time: there is no 8-bit
+       shift, so shift 16-bit words and clear the bits coming from the
+       neighbouring byte. */
+    const uint8_t remove_high_u8 = 0xFF >> i_strength;
+    const __m128i strength = _mm_cvtsi32_si128( i_strength );
+    const __m256i remove_high = _mm256_set1_epi8( remove_high_u8 );
+    const __m256i b128 = _mm256_set1_epi8( (char)0x80 );
+
+    int i_plane = Y_PLANE;
+    uint8_t *p_out, *p_out_end;
+    int w = p_dst->p[i_plane].i_visible_pitch;
+    p_out = p_dst->p[i_plane].p_pixels;
+    p_out_end = p_out + p_dst->p[i_plane].i_pitch
+                      * p_dst->p[i_plane].i_visible_lines;
+
+    /* skip first line for bottom field */
+    if( i_field == 1 )
+        p_out += p_dst->p[i_plane].i_pitch;
+
+    int w32 = w - w % 32; /* part of width that is divisible by 32 */
+    for( ; p_out < p_out_end ; p_out += 2*p_dst->p[i_plane].i_pitch )
+    {
+        int x = 0;
+
+        for( ; x < w32; x += 32 )
+        {
+            __m256i *po = (__m256i *)&p_out[x];
+            __m256i v = _mm256_loadu_si256( po );
+
+            v = _mm256_and_si256( _mm256_srl_epi16( v, strength ),
+                                  remove_high );
+            _mm256_storeu_si256( po, v );
+        }
+
+        /* handle the width remainder */
+        for( ; x < w; ++x )
+            p_out[x] = ( (p_out[x] >> i_strength) & remove_high_u8 );
+    }
+
+    /* Process chroma if the field chromas are independent. */
+    if( process_chroma )
+    {
+        for( i_plane++ /* luma already handled */;
+             i_plane < p_dst->i_planes;
+             i_plane++ )
+        {
+            int w = p_dst->p[i_plane].i_visible_pitch;
+            int w32 = w - w % 32;
+
+            p_out = p_dst->p[i_plane].p_pixels;
+            p_out_end = p_out + p_dst->p[i_plane].i_pitch
+                              * p_dst->p[i_plane].i_visible_lines;
+
+            /* skip first line for bottom field */
+            if( i_field == 1 )
+                p_out += p_dst->p[i_plane].i_pitch;
+
+            for( ; p_out < p_out_end ; p_out += 2*p_dst->p[i_plane].i_pitch )
+            {
+                int x = 0;
+
+                for( ; x < w32; x += 32 )
+                {
+                    __m256i *po = (__m256i *)&p_out[x];
+                    __m256i v = _mm256_loadu_si256( po );
+
+                    /* max(data - 128, 0) and max(128 - data, 0) */
+                    __m256i pos = _mm256_subs_epu8( v, b128 );
+                    __m256i neg = _mm256_subs_epu8( b128, v );
+
+                    pos = _mm256_and_si256( _mm256_srl_epi16( pos, strength ),
+                                            remove_high );
+                    neg = _mm256_and_si256( _mm256_srl_epi16( neg, strength ),
+                                            remove_high );
+
+                    /* collect results from pos./neg. parts */
+                    v = _mm256_add_epi8( _mm256_sub_epi8( pos, neg ), b128 );
+                    _mm256_storeu_si256( po, v );
+                }
+
+                /* C version - handle the width remainder */
+                for( ; x < w; ++x )
+                    p_out[x] = 128 + ( (p_out[x] - 128) / (1 << i_strength) );
+            } /* for p_out... */
+        } /* for i_plane... */
+    } /* if process_chroma */
+}
+#endif
+
 /*****************************************************************************
  * Public functions
  *****************************************************************************/
@@ -353,6 +456,13 @@ int RenderPhosphor( filter_t *p_filter,
     */
     if( p_sys->phosphor.i_dimmer_strength > 0 )
     {
+#ifdef HAVE_AVX2_INTRINSICS
+        if( vlc_CPU_AVX2() )
+            DarkenFieldAVX2( p_dst, !i_field, p_sys->phosphor.i_dimmer_strength,
+                p_sys->chroma->p[1].h.num == p_sys->chroma->p[1].h.den &&
+                p_sys->chroma->p[2].h.num == p_sys->chroma->p[2].h.den );
+        else
+#endif
 #ifdef CAN_COMPILE_MMXEXT
         if( vlc_CPU_MMXEXT() )
             DarkenFieldMMX( p_dst, !i_field, p_sys->phosphor.i_dimmer_strength,
@@ -158,6 +158,29 @@ void Merge8BitSSE2( void *, const void *, const void *, size_t );
 void Merge16BitSSE2( void *, const void *, const void *, size_t );
 #endif
 
+#if defined(HAVE_AVX2_INTRINSICS)
+/**
+ * AVX2 routine to blend pixels from two picture lines.
+ * Unlike the other SIMD versions, it rounds exactly like the C version.
+ *
+ * @param _p_dest Target
+ * @param _p_s1 Source line A
+ * @param _p_s2 Source line B
+ * @param i_bytes Number of bytes to merge
+ */
+void Merge8BitAVX2( void *, const void *, const void *, size_t );
+/**
+ * AVX2 routine to blend pixels from two picture lines.
+ * Unlike the other SIMD versions, it rounds exactly like the C version.
+ *
+ * @param _p_dest Target
+ * @param _p_s1 Source line A
+ * @param _p_s2 Source line B
+ * @param i_bytes Number of bytes to merge
+ */
+void Merge16BitAVX2( void *, const void *, const void *, size_t );
+#endif
+
 #if defined(CAN_COMPILE_ARM)
 /**
  * ARM NEON routine to blend pixels from two picture lines.
@@ -31,6 +31,8 @@
 # include "config.h"
 #endif
 
+#include <assert.h>
+
 #include <vlc_common.h>
 #include <vlc_plugin.h>
 #include <vlc_cpu.h>
@@ -106,6 +108,11 @@ struct filter_sys_t {
     int              radius;
     const vlc_chroma_description_t *chroma;
     struct vf_priv_s cfg;
+
+    /* Blur buffers, one per band that may be filtered at the same time */
+    uint16_t         *work;
+    unsigned         work_free; /* number of unused buffers, under lock */
+    uint16_t         *work_unused[];
 };
 
 static int Open(vlc_object_t *object)
@@ -119,22 +126,33 @@ static int Open(vlc_object_t *object)
         return VLC_EGENERIC;
     }
 
-    filter_sys_t *sys = malloc(sizeof(*sys));
+    const unsigned threads = vlc_SliceThreads(object);
+    filter_sys_t *sys = malloc(sizeof(*sys) + threads * sizeof(uint16_t *));
     if (!sys)
         return VLC_ENOMEM;
 
+    /* Large enough for the widest plane with the largest radius */
+    size_t work_size = (((filter->fmt_in.video.i_width + 15) & ~15)
+                        * (RADIUS_MAX + 1) / 2 + 32 + 7) & ~7;
+    sys->work = vlc_memalign(16, threads * work_size * sizeof(*sys->work));
+    if (!sys->work) {
+        free(sys);
+        return VLC_ENOMEM;
+    }
+    for (unsigned i = 0; i < threads; i++)
+        sys->work_unused[i] = &sys->work[i * work_size];
+    sys->work_free = threads;
+
     vlc_mutex_init(&sys->lock);
     sys->chroma   = chroma;
     sys->strength = var_CreateGetFloatCommand(filter,   CFG_PREFIX "strength");
     sys->radius   = var_CreateGetIntegerCommand(filter, CFG_PREFIX "radius");
     var_AddCallback(filter, CFG_PREFIX "strength", Callback, NULL);
     var_AddCallback(filter, CFG_PREFIX "radius",   Callback, NULL);
-    sys->cfg.buf = NULL;
 
     struct vf_priv_s *cfg = &sys->cfg;
     cfg->thresh      = 0.0;
     cfg->radius      = 0;
-    cfg->buf         = NULL;
 
 #if HAVE_SSE2 && HAVE_6REGS
     if (vlc_CPU_SSE2())
@@ -166,11 +184,71 @@ static void Close(vlc_object_t *object)
 
     var_DelCallback(filter, CFG_PREFIX "radius",   Callback, NULL);
     var_DelCallback(filter, CFG_PREFIX "strength", Callback, NULL);
-    vlc_free(sys->cfg.buf);
     vlc_mutex_destroy(&sys->lock);
+    vlc_free(sys->work);
     free(sys);
 }
 
+struct gradfun_slice {
+    picture_t *src;
+    picture_t *dst;
+};
+
+static void FilterSlice(filter_t *filter, void *data,
+                        unsigned first, unsigned end)
+{
+    filter_sys_t *sys = filter->p_sys;
+    const struct gradfun_slice *slice = data;
+    const video_format_t *fmt = &filter->fmt_in.video;
+    const struct vf_priv_s *cfg = &sys->cfg;
+
+    vlc_mutex_lock(&sys->lock);
+    assert(sys->work_free > 0);
+    uint16_t *work = sys->work_unused[--sys->work_free];
+    vlc_mutex_unlock(&sys->lock);
+
+    for (int i = 0; i < slice->dst->i_planes; i++) {
+        const plane_t *srcp = &slice->src->p[i];
+        plane_t       *dstp = &slice->dst->p[i];
+
+        const vlc_chroma_description_t *chroma = sys->chroma;
+        int w = fmt->i_width  * chroma->p[i].w.num / chroma->p[i].w.den;
+        int h = fmt->i_height * chroma->p[i].h.num / chroma->p[i].h.den;
+        int r = (cfg->radius  * chroma->p[i].w.num / chroma->p[i].w.den +
+                 cfg->radius  * chroma->p[i].h.num / chroma->p[i].h.den) / 2;
+        r = VLC_CLIP((r + 1) & ~1, RADIUS_MIN, RADIUS_MAX);
+
+        int y_first = first * chroma->p[i].h.num / chroma->p[i].h.den;
+        int y_end   = end   * chroma->p[i].h.num / chroma->p[i].h.den;
+        if (end >= fmt->i_height || y_end > h)
+            y_end = h;
+        if (y_first >= y_end)
+            continue;
+
+        if (__MIN(w, h) > 2 * r) {
+            /* The blur of a line depends on the r lines above and below, and
+             * the dithering on the line number modulo 8 */
+            int ctx_first = __MAX(y_first - 2 * r, 0) & ~7;
+            int ctx_end   = __MIN(y_end + 2 * r, h);
+
+            filter_plane(cfg, work,
+                         &dstp->p_pixels[ctx_first * dstp->i_pitch],
+                         &srcp->p_pixels[ctx_first * srcp->i_pitch],
+                         w, ctx_end - ctx_first, dstp->i_pitch, srcp->i_pitch,
+                         r, y_first - ctx_first, y_end - ctx_first);
+        } else {
+            for (int y = y_first; y < y_end; y++)
+                memcpy(&dstp->p_pixels[y * dstp->i_pitch],
+                       &srcp->p_pixels[y * srcp->i_pitch],
+                       __MIN(dstp->i_visible_pitch, srcp->i_visible_pitch));
+        }
+    }
+
+    vlc_mutex_lock(&sys->lock);
+    sys->work_unused[sys->work_free++] = work;
+    vlc_mutex_unlock(&sys->lock);
+}
+
 static picture_t *Filter(filter_t *filter, picture_t *src)
 {
     filter_sys_t *sys = filter->p_sys;
@@ -190,29 +268,15 @@ static picture_t *Filter(filter_t *filter, picture_t *src)
     struct vf_priv_s *cfg = &sys->cfg;
 
     cfg->thresh = (1 << 15) / strength;
-    if (cfg->radius != radius) {
-        cfg->radius = radius;
-        cfg->buf    = vlc_memalign(16,
-                                   (((fmt->i_width + 15) & ~15) * (cfg->radius + 1) / 2 + 32) * sizeof(*cfg->buf));
-    }
+    cfg->radius = radius;
 
-    for (int i = 0; i < dst->i_planes; i++) {
-        const plane_t *srcp = &src->p[i];
-        plane_t       *dstp = &dst->p[i];
+    /* The slices start on a multiple of 8 lines of every plane */
+    unsigned align = 1;
+    for (unsigned i = 0; i < sys->chroma->plane_count; i++)
+        align = __MAX(align, sys->chroma->p[i].h.den / sys->chroma->p[i].h.num);
 
-        const vlc_chroma_description_t *chroma = sys->chroma;
-        int w = fmt->i_width  * chroma->p[i].w.num / chroma->p[i].w.den;
-        int h = fmt->i_height * chroma->p[i].h.num / chroma->p[i].h.den;
-        int r = (cfg->radius  * chroma->p[i].w.num / chroma->p[i].w.den +
-                 cfg->radius  * chroma->p[i].h.num / chroma->p[i].h.den) / 2;
-        r = VLC_CLIP((r + 1) & ~1, RADIUS_MIN, RADIUS_MAX);
-        if (__MIN(w, h) > 2 * r && cfg->buf) {
-            filter_plane(cfg, dstp->p_pixels, srcp->p_pixels,
-                         w, h, dstp->i_pitch, srcp->i_pitch, r);
-        } else {
-            plane_CopyPixels(dstp, srcp);
-        }
-    }
+    struct gradfun_slice slice = { .src = src, .dst = dst };
+    filter_Slice(filter, fmt->i_height, 8 * align, FilterSlice, &slice);
 
     picture_CopyProperties(dst, src);
     picture_Release(src);
@@ -31,7 +31,6 @@
 struct vf_priv_s {
     int thresh;
     int radius;
-    uint16_t *buf;
     void (*filter_line)(uint8_t *dst, uint8_t *src, uint16_t *dc,
                         int width, int thresh, const uint16_t *dithers);
     void (*blur_line)(uint16_t *dc, uint16_t *buf, uint16_t *buf1,
@@ -222,15 +221,25 @@ static void blur_line_sse2(uint16_t *dc, uint16_t *buf, uint16_t *buf1,
 }
 #endif // HAVE_6REGS && HAVE_SSE2
 
-static void filter_plane(struct vf_priv_s *ctx, uint8_t *dst, uint8_t *src,
-                         int width, int height, int dstride, int sstride, int r)
+/* Only the lines [first, end) are written to dst, the other lines of src
+ * are only read as context. */
+static void filter_plane(const struct vf_priv_s *ctx, uint16_t *work,
+                         uint8_t *dst, uint8_t *src,
+                         int width, int height, int dstride, int sstride, int r,
+                         int first, int end)
 {
     int bstride = ((width+15)&~15)/2;
     int y;
     uint32_t dc_factor = (1<<21)/(r*r);
-    uint16_t *dc = ctx->buf+16;
-    uint16_t *buf = ctx->buf+bstride+32;
+    uint16_t *dc = work+16;
+    uint16_t *buf = work+bstride+32;
     int thresh = ctx->thresh;
+#define filter_line_in(y) \
+    do { \
+        if ((y) >= first && (y) < end) \
+            ctx->filter_line(dst+(y)*dstride, src+(y)*sstride, dc-r/2, width, \
+                             thresh, dither[(y)&7]); \
+    } while (0)
 
     memset(dc, 0, (bstride+16)*sizeof(*buf));
     for (y=0; y<r; y++)
@@ -255,12 +264,14 @@ static void filter_plane(struct vf_priv_s *ctx, uint8_t *dst, uint8_t *src,
         }
         if (y == r) {
             for (y=0; y<r; y++)
-                ctx->filter_line(dst+y*dstride, src+y*sstride, dc-r/2, width, thresh, dither[y&7]);
+                filter_line_in(y);
         }
-        ctx->filter_line(dst+y*dstride, src+y*sstride, dc-r/2, width, thresh, dither[y&7]);
+        if (y >= end) break;
+        filter_line_in(y);
         if (++y >= height) break;
-        ctx->filter_line(dst+y*dstride, src+y*sstride, dc-r/2, width, thresh, dither[y&7]);
+        filter_line_in(y);
         if (++y >= height) break;
     }
+#undef filter_line_in
 }
 
@@ -249,6 +249,42 @@ static void PlaneFilter(filter_t *filter,
         sys->emms();
 }
 
+struct grain_slice {
+    picture_t *src;
+    picture_t *dst;
+    uint32_t  seed;
+};
+
+static void FilterSlice(filter_t *filter, void *data,
+                        unsigned first, unsigned end)
+{
+    filter_sys_t *sys = filter->p_sys;
+    const struct grain_slice *slice = data;
+    picture_t src, dst;
+
+    filter_SlicePicture(&src, slice->src, first, end);
+    filter_SlicePicture(&dst, slice->dst, first, end);
+
+    /* Every slice has its own noise sequence */
+    uint32_t seed = slice->seed ^ (first * 2654435761u);
+    if (seed == 0)
+        seed = URAND_SEED;
+
+    for (int i = 0; i < dst.i_planes; i++) {
+        const plane_t *srcp = &src.p[i];
+        plane_t       *dstp = &dst.p[i];
+
+        if (i == 0 || sys->is_uv_filtered) {
+            int16_t *bank = i == 0 ? sys->bank_y :
+                                     sys->bank_uv;
+            PlaneFilter(filter, dstp, srcp, bank, &seed);
+        }
+        else {
+            plane_CopyPixels(dstp, srcp);
+        }
+    }
+}
+
 static picture_t *Filter(filter_t *filter, picture_t *src)
 {
     filter_sys_t *sys = filter->p_sys;
@@ -270,19 +306,13 @@ static picture_t *Filter(filter_t *filter, picture_t *src)
         Scale(sys->bank_uv, sys->bank, sys->scale / 2);
     }
 
-    for (int i = 0; i < dst->i_planes; i++) {
-        const plane_t *srcp = &src->p[i];
-        plane_t       *dstp = &dst->p[i];
-
-        if (i == 0 || sys->is_uv_filtered) {
-            int16_t *bank = i == 0 ? sys->bank_y :
-                                     sys->bank_uv;
-            PlaneFilter(filter, dstp, srcp, bank, &sys->seed);
-        }
-        else {
-            plane_CopyPixels(dstp, srcp);
-        }
-    }
+    struct grain_slice slice = {
+        .src  = src,
+        .dst  = dst,
+        .seed = urand(&sys->seed),
+    };
+    filter_Slice(filter, src->p[0].i_visible_lines,
+                 BLEND_SIZE * filter_SliceAlignment(src), FilterSlice, &slice);
 
     picture_CopyProperties(dst, src);
     picture_Release(src);
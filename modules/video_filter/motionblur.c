@@ -43,7 +43,7 @@
 static int  Create       ( vlc_object_t * );
 static void Destroy      ( vlc_object_t * );
 static picture_t *Filter ( filter_t *, picture_t * );
-static void RenderBlur   ( filter_sys_t *, picture_t *, picture_t * );
+static void RenderBlur   ( filter_t *, picture_t *, picture_t * );
 static int MotionBlurCallback( vlc_object_t *, char const *,
                                vlc_value_t, vlc_value_t, void * );
 
@@ -161,7 +161,7 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
     }
 
     /* Get a new picture */
-    RenderBlur( p_sys, p_pic, p_outpic );
+    RenderBlur( p_filter, p_pic, p_outpic );
 
     picture_CopyPixels( p_sys->p_tmp, p_outpic );
 
@@ -171,22 +171,35 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
 /*****************************************************************************
  * RenderBlur: renders a blurred picture
  *****************************************************************************/
-static void RenderBlur( filter_sys_t *p_sys, picture_t *p_newpic,
-                        picture_t *p_outpic )
+struct blur_slice
 {
-    const int i_oldfactor = atomic_load( &p_sys->i_factor );
+    picture_t *p_newpic;
+    picture_t *p_outpic;
+    int i_oldfactor;
+};
+
+static void RenderBlurSlice( filter_t *p_filter, void *p_data,
+                             unsigned i_first, unsigned i_end )
+{
+    const struct blur_slice *p_slice = p_data;
+    const int i_oldfactor = p_slice->i_oldfactor;
     int i_newfactor = 128 - i_oldfactor;
+    picture_t oldpic, newpic, outpic;
+
+    filter_SlicePicture( &oldpic, p_filter->p_sys->p_tmp, i_first, i_end );
+    filter_SlicePicture( &newpic, p_slice->p_newpic, i_first, i_end );
+    filter_SlicePicture( &outpic, p_slice->p_outpic, i_first, i_end );
 
-    for( int i_plane = 0; i_plane < p_outpic->i_planes; i_plane++ )
+    for( int i_plane = 0; i_plane < outpic.i_planes; i_plane++ )
     {
         uint8_t *p_old, *p_new, *p_out, *p_out_end, *p_out_line_end;
-        const int i_visible_pitch = p_outpic->p[i_plane].i_visible_pitch;
-        const int i_visible_lines = p_outpic->p[i_plane].i_visible_lines;
+        const int i_visible_pitch = outpic.p[i_plane].i_visible_pitch;
+        const int i_visible_lines = outpic.p[i_plane].i_visible_lines;
 
-        p_out = p_outpic->p[i_plane].p_pixels;
-        p_new = p_newpic->p[i_plane].p_pixels;
-        p_old = p_sys->p_tmp->p[i_plane].p_pixels;
-        p_out_end = p_out + p_outpic->p[i_plane].i_pitch * i_visible_lines;
+        p_out = outpic.p[i_plane].p_pixels;
+        p_new = newpic.p[i_plane].p_pixels;
+        p_old = oldpic.p[i_plane].p_pixels;
+        p_out_end = p_out + outpic.p[i_plane].i_pitch * i_visible_lines;
         while ( p_out < p_out_end )
         {
             p_out_line_end = p_out + i_visible_pitch;
@@ -197,13 +210,26 @@ static void RenderBlur( filter_sys_t *p_sys, picture_t *p_newpic,
                             ((*p_new++) * i_newfactor)) >> 7;
             }
 
-            p_old += p_sys->p_tmp->p[i_plane].i_pitch - i_visible_pitch;
-            p_new += p_newpic->p[i_plane].i_pitch     - i_visible_pitch;
-            p_out += p_outpic->p[i_plane].i_pitch     - i_visible_pitch;
+            p_old += oldpic.p[i_plane].i_pitch - i_visible_pitch;
+            p_new += newpic.p[i_plane].i_pitch - i_visible_pitch;
+            p_out += outpic.p[i_plane].i_pitch - i_visible_pitch;
         }
     }
 }
 
+static void RenderBlur( filter_t *p_filter, picture_t *p_newpic,
+                        picture_t *p_outpic )
+{
+    struct blur_slice slice = {
+        .p_newpic = p_newpic,
+        .p_outpic = p_outpic,
+        .i_oldfactor = atomic_load( &p_filter->p_sys->i_factor ),
+    };
+
+    filter_Slice( p_filter, p_outpic->p[0].i_visible_lines,
+                  filter_SliceAlignment( p_outpic ), RenderBlurSlice, &slice );
+}
+
 static int MotionBlurCallback( vlc_object_t *p_this, char const *psz_var,
                                vlc_value_t oldval, vlc_value_t newval,
                                void *p_data )
@@ -151,25 +151,75 @@ static void Destroy( vlc_object_t *p_this )
 /*****************************************************************************
  * Filter YUV Planar/Packed
  *****************************************************************************/
-static void PreparePlanar( filter_t *p_filter, picture_t *p_inpic )
+struct diff_slice
+{
+    const picture_t *p_inpic;
+    int i_u_offset;
+    int i_v_offset;
+    int i_y_offset;
+};
+
+static void DiffPlanarSlice( filter_t *p_filter, void *p_data,
+                             unsigned i_first, unsigned i_end )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
+    const struct diff_slice *p_slice = p_data;
     const video_format_t *p_fmt = &p_filter->fmt_in.video;
 
     uint8_t *p_oldpix   = p_sys->p_old->p[Y_PLANE].p_pixels;
     const int i_old_pitch = p_sys->p_old->p[Y_PLANE].i_pitch;
 
-    const uint8_t *p_inpix = p_inpic->p[Y_PLANE].p_pixels;
-    const int i_src_pitch = p_inpic->p[Y_PLANE].i_pitch;
+    const uint8_t *p_inpix = p_slice->p_inpic->p[Y_PLANE].p_pixels;
+    const int i_src_pitch = p_slice->p_inpic->p[Y_PLANE].i_pitch;
 
-    /**
-     * Substract Y planes
-     */
-    for( unsigned y = 0; y < p_fmt->i_height; y++ )
+    for( unsigned y = i_first; y < i_end; y++ )
     {
         for( unsigned x = 0; x < p_fmt->i_width; x++ )
             p_sys->p_buf2[y*p_fmt->i_width+x] = abs( p_inpix[y*i_src_pitch+x] - p_oldpix[y*i_old_pitch+x] );
     }
+}
+
+static void DiffPackedSlice( filter_t *p_filter, void *p_data,
+                             unsigned i_first, unsigned i_end )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const struct diff_slice *p_slice = p_data;
+    const video_format_t *p_fmt = &p_filter->fmt_in.video;
+    const int i_y_offset = p_slice->i_y_offset;
+    const int i_u_offset = p_slice->i_u_offset;
+    const int i_v_offset = p_slice->i_v_offset;
+
+    uint8_t *p_oldpix   = p_sys->p_old->p[Y_PLANE].p_pixels;
+    const int i_old_pitch = p_sys->p_old->p[Y_PLANE].i_pitch;
+
+    const uint8_t *p_inpix = p_slice->p_inpic->p[Y_PLANE].p_pixels;
+    const int i_src_pitch = p_slice->p_inpic->p[Y_PLANE].i_pitch;
+
+    for( unsigned y = i_first; y < i_end; y++ )
+    {
+        for( unsigned x = 0; x < p_fmt->i_width; x+=2 )
+        {
+            int d;
+            d = abs( p_inpix[y*i_src_pitch+2*x+i_u_offset] - p_oldpix[y*i_old_pitch+2*x+i_u_offset] ) +
+                abs( p_inpix[y*i_src_pitch+2*x+i_v_offset] - p_oldpix[y*i_old_pitch+2*x+i_v_offset] );
+
+            for( int i = 0; i < 2; i++ )
+                p_sys->p_buf2[y*p_fmt->i_width+x+i] =
+                    abs( p_inpix[y*i_src_pitch+2*(x+i)+i_y_offset] - p_oldpix[y*i_old_pitch+2*(x+i)+i_y_offset] ) + d;
+        }
+    }
+}
+
+static void PreparePlanar( filter_t *p_filter, picture_t *p_inpic )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const video_format_t *p_fmt = &p_filter->fmt_in.video;
+
+    /**
+     * Substract Y planes
+     */
+    struct diff_slice slice = { .p_inpic = p_inpic };
+    filter_Slice( p_filter, p_fmt->i_height, 1, DiffPlanarSlice, &slice );
 
     int i_chroma_dx;
     int i_chroma_dy;
@@ -221,7 +271,6 @@ static void PreparePlanar( filter_t *p_filter, picture_t *p_inpic )
 
 static int PreparePacked( filter_t *p_filter, picture_t *p_inpic, int *pi_pix_offset )
 {
-    filter_sys_t *p_sys = p_filter->p_sys;
     const video_format_t *p_fmt = &p_filter->fmt_in.video;
 
     int i_y_offset, i_u_offset, i_v_offset;
@@ -235,25 +284,13 @@ static int PreparePacked( filter_t *p_filter, picture_t *p_inpic, int *pi_pix_of
     *pi_pix_offset = i_y_offset;
 
     /* Substract all planes at once */
-    uint8_t *p_oldpix   = p_sys->p_old->p[Y_PLANE].p_pixels;
-    const int i_old_pitch = p_sys->p_old->p[Y_PLANE].i_pitch;
-
-    const uint8_t *p_inpix = p_inpic->p[Y_PLANE].p_pixels;
-    const int i_src_pitch = p_inpic->p[Y_PLANE].i_pitch;
-
-    for( unsigned y = 0; y < p_fmt->i_height; y++ )
-    {
-        for( unsigned x = 0; x < p_fmt->i_width; x+=2 )
-        {
-            int d;
-            d = abs( p_inpix[y*i_src_pitch+2*x+i_u_offset] - p_oldpix[y*i_old_pitch+2*x+i_u_offset] ) +
-                abs( p_inpix[y*i_src_pitch+2*x+i_v_offset] - p_oldpix[y*i_old_pitch+2*x+i_v_offset] );
-
-            for( int i = 0; i < 2; i++ )
-                p_sys->p_buf2[y*p_fmt->i_width+x+i] =
-                    abs( p_inpix[y*i_src_pitch+2*(x+i)+i_y_offset] - p_oldpix[y*i_old_pitch+2*(x+i)+i_y_offset] ) + d;
-        }
-    }
+    struct diff_slice slice = {
+        .p_inpic = p_inpic,
+        .i_u_offset = i_u_offset,
+        .i_v_offset = i_v_offset,
+        .i_y_offset = i_y_offset,
+    };
+    filter_Slice( p_filter, p_fmt->i_height, 1, DiffPackedSlice, &slice );
     return VLC_SUCCESS;
 }
 
@@ -224,6 +224,13 @@ function file(h,path,url,mime)
 end
 
 function rawfile(h,path,url)
+    if password and password ~= "" then
+        -- Let the HTTP daemon send the file itself, with range support.
+        -- Without a password, h:file() answers every request with the
+        -- "password not set" page instead of the file, which the daemon
+        -- cannot do for a file path: it would serve the file to anybody.
+        return h:file_path(url or path,nil,nil,password,path)
+    end
     local filename = path
     local mtime = 0    -- vlc.net.stat(filename).modification_time
     local page = false -- io.open(filename):read("*a")
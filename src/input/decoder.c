@@ -86,6 +86,22 @@ struct decoder_owner_sys_t
     /* fifo */
     block_fifo_t *p_fifo;
 
+    /* Decoded buffers waiting for the output (play) thread */
+    struct
+    {
+        vlc_thread_t thread;
+        vlc_mutex_t  lock;
+        vlc_cond_t   wait_data; /* the play thread waits for buffers */
+        vlc_cond_t   wait_room; /* the decoder thread waits for the output */
+        void       **pp_elems; /* picture_t or block_t, depending on i_cat */
+        int          i_cat;
+        unsigned     i_size; /* 0 if the output is played synchronously */
+        unsigned     i_start;
+        unsigned     i_count;
+        bool         b_busy;
+        bool         b_exit;
+    } queue;
+
     /* Lock for communication with decoder thread */
     vlc_mutex_t lock;
     vlc_cond_t  wait_request;
@@ -211,6 +227,135 @@ static void DecoderUpdateFormatLocked( decoder_t *p_dec )
     p_owner->b_fmt_description = true;
 }
 
+/*****************************************************************************
+ * Queue of the decoded buffers, between the decoder and the play threads
+ *****************************************************************************/
+static void DecoderUpdateStatQueue( decoder_owner_sys_t *p_owner,
+                                    int i_queued, mtime_t i_stall )
+{
+    input_thread_t *p_input = p_owner->p_input;
+
+    if( p_input == NULL )
+        return;
+
+    vlc_mutex_lock( &p_input->p->counters.counters_lock );
+    stats_Update( p_input->p->counters.p_decoder_queued, i_queued, NULL );
+    if( i_stall > 0 )
+        stats_Update( p_input->p->counters.p_decoder_stall, i_stall, NULL );
+    vlc_mutex_unlock( &p_input->p->counters.counters_lock );
+}
+
+static void DecoderQueueRelease( decoder_owner_sys_t *p_owner, void *p_elem )
+{
+    if( p_owner->queue.i_cat == VIDEO_ES )
+        picture_Release( p_elem );
+    else
+        block_Release( p_elem );
+}
+
+/* Releases all the queued buffers, and returns their number */
+static unsigned DecoderQueueClear( decoder_owner_sys_t *p_owner )
+{
+    const unsigned i_count = p_owner->queue.i_count;
+
+    while( p_owner->queue.i_count > 0 )
+    {
+        DecoderQueueRelease( p_owner,
+                             p_owner->queue.pp_elems[p_owner->queue.i_start] );
+        p_owner->queue.i_start = (p_owner->queue.i_start + 1)
+                               % p_owner->queue.i_size;
+        p_owner->queue.i_count--;
+    }
+    return i_count;
+}
+
+/**
+ * Hands a decoded picture or audio buffer over to the play thread.
+ * Blocks while the queue is full, i.e. while the output lags behind.
+ */
+static void DecoderQueuePush( decoder_t *p_dec, void *p_elem )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+    mtime_t i_stall = 0;
+
+    assert( p_owner->queue.i_size > 0 );
+
+    vlc_mutex_lock( &p_owner->queue.lock );
+    if( p_owner->queue.i_count == p_owner->queue.i_size
+     && !p_owner->queue.b_exit )
+    {
+        const mtime_t i_start = mdate();
+
+        do
+            vlc_cond_wait( &p_owner->queue.wait_room, &p_owner->queue.lock );
+        while( p_owner->queue.i_count == p_owner->queue.i_size
+            && !p_owner->queue.b_exit );
+        i_stall = mdate() - i_start;
+    }
+
+    if( unlikely(p_owner->queue.b_exit) )
+    {
+        DecoderQueueRelease( p_owner, p_elem );
+        vlc_mutex_unlock( &p_owner->queue.lock );
+        return;
+    }
+
+    const unsigned i_end = (p_owner->queue.i_start + p_owner->queue.i_count)
+                         % p_owner->queue.i_size;
+    p_owner->queue.pp_elems[i_end] = p_elem;
+    p_owner->queue.i_count++;
+    vlc_cond_signal( &p_owner->queue.wait_data );
+    vlc_mutex_unlock( &p_owner->queue.lock );
+
+    DecoderUpdateStatQueue( p_owner, 1, i_stall );
+}
+
+static bool DecoderQueueIsEmpty( decoder_owner_sys_t *p_owner )
+{
+    vlc_mutex_lock( &p_owner->queue.lock );
+    bool b_empty = p_owner->queue.i_count == 0 && !p_owner->queue.b_busy;
+    vlc_mutex_unlock( &p_owner->queue.lock );
+    return b_empty;
+}
+
+/**
+ * Waits until the play thread has output all the queued buffers.
+ */
+static void DecoderQueueWait( decoder_t *p_dec )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    if( p_owner->queue.i_size == 0 )
+        return;
+
+    vlc_mutex_lock( &p_owner->queue.lock );
+    while( (p_owner->queue.i_count > 0 || p_owner->queue.b_busy)
+        && !p_owner->queue.b_exit )
+        vlc_cond_wait( &p_owner->queue.wait_room, &p_owner->queue.lock );
+    vlc_mutex_unlock( &p_owner->queue.lock );
+}
+
+/**
+ * Discards the queued buffers, and waits for the buffer being output (if any).
+ * The play thread does not wait for the clock while flushing.
+ */
+static void DecoderQueueFlush( decoder_t *p_dec )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    if( p_owner->queue.i_size == 0 )
+        return;
+
+    vlc_mutex_lock( &p_owner->queue.lock );
+    const unsigned i_flushed = DecoderQueueClear( p_owner );
+    while( p_owner->queue.b_busy && !p_owner->queue.b_exit )
+        vlc_cond_wait( &p_owner->queue.wait_room, &p_owner->queue.lock );
+    vlc_mutex_unlock( &p_owner->queue.lock );
+
+    if( i_flushed > 0 )
+        DecoderUpdateStatQueue( p_owner, -(int)i_flushed, 0 );
+}
+
 /*****************************************************************************
  * Buffers allocation callbacks for the decoders
  *****************************************************************************/
@@ -238,7 +383,9 @@ static int aout_update_format( decoder_t *p_dec )
     {
         audio_output_t *p_aout = p_owner->p_aout;
 
-        /* Parameters changed, restart the aout */
+        /* Parameters changed, restart the aout once the queued buffers
+         * were played */
+        DecoderQueueWait( p_dec );
         vlc_mutex_lock( &p_owner->lock );
         p_owner->p_aout = NULL;
         vlc_mutex_unlock( &p_owner->lock );
@@ -394,6 +541,8 @@ static int vout_update_format( decoder_t *p_dec )
         vlc_ureduce( &fmt.i_sar_num, &fmt.i_sar_den,
                      fmt.i_sar_num, fmt.i_sar_den, 50000 );
 
+        /* The queued pictures belong to the current vout */
+        DecoderQueueWait( p_dec );
         vlc_mutex_lock( &p_owner->lock );
 
         p_vout = p_owner->p_vout;
@@ -421,7 +570,8 @@ static int vout_update_format( decoder_t *p_dec )
         p_vout = input_resource_RequestVout( p_owner->p_resource,
                                              p_vout, &fmt,
                                              dpb_size +
-                                             p_dec->i_extra_picture_buffers + 1,
+                                             p_dec->i_extra_picture_buffers +
+                                             p_owner->queue.i_size + 1,
                                              true );
         vlc_mutex_lock( &p_owner->lock );
         p_owner->p_vout = p_vout;
@@ -816,6 +966,18 @@ static void DecoderGetCc( decoder_t *p_dec, decoder_t *p_dec_cc )
         block_Release( p_cc );
 }
 
+/* Counts a decoded picture while stepping frame by frame */
+static void DecoderCountFrame( decoder_t *p_dec )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    /* FIXME: The *input* FIFO should not be locked here. */
+    vlc_fifo_Lock( p_owner->p_fifo );
+    if( unlikely(p_owner->paused) && likely(p_owner->frames_countdown > 0) )
+        p_owner->frames_countdown--;
+    vlc_fifo_Unlock( p_owner->p_fifo );
+}
+
 static void DecoderPlayVideo( decoder_t *p_dec, picture_t *p_picture,
                               int *pi_played_sum, int *pi_lost_sum )
 {
@@ -857,12 +1019,9 @@ static void DecoderPlayVideo( decoder_t *p_dec, picture_t *p_picture,
 
     vlc_mutex_unlock( &p_owner->lock );
 
-    /* FIXME: The *input* FIFO should not be locked here. This will not work
-     * properly if/when pictures are queued asynchronously. */
-    vlc_fifo_Lock( p_owner->p_fifo );
-    if( unlikely(p_owner->paused) && likely(p_owner->frames_countdown > 0) )
-        p_owner->frames_countdown--;
-    vlc_fifo_Unlock( p_owner->p_fifo );
+    /* Queued pictures were already counted by the decoder thread */
+    if( p_owner->queue.i_size == 0 )
+        DecoderCountFrame( p_dec );
 
     /* */
     if( p_picture->b_force || p_picture->date > VLC_TS_INVALID )
@@ -894,6 +1053,24 @@ static void DecoderPlayVideo( decoder_t *p_dec, picture_t *p_picture,
     *pi_lost_sum += i_tmp_lost;
 }
 
+static void DecoderUpdateStatVideo( decoder_owner_sys_t *p_owner,
+                                    int i_decoded, int i_lost,
+                                    int i_displayed )
+{
+    input_thread_t *p_input = p_owner->p_input;
+
+    /* Update ugly stat */
+    if( p_input != NULL && (i_decoded > 0 || i_lost > 0 || i_displayed > 0) )
+    {
+        vlc_mutex_lock( &p_input->p->counters.counters_lock );
+        stats_Update( p_input->p->counters.p_decoded_video, i_decoded, NULL );
+        stats_Update( p_input->p->counters.p_lost_pictures, i_lost , NULL);
+        stats_Update( p_input->p->counters.p_displayed_pictures,
+                      i_displayed, NULL);
+        vlc_mutex_unlock( &p_input->p->counters.counters_lock );
+    }
+}
+
 static void DecoderDecodeVideo( decoder_t *p_dec, block_t *p_block )
 {
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
@@ -927,21 +1104,16 @@ static void DecoderDecodeVideo( decoder_t *p_dec, block_t *p_block )
             ( !p_owner->p_packetizer || !p_owner->p_packetizer->pf_get_cc ) )
             DecoderGetCc( p_dec, p_dec );
 
-        DecoderPlayVideo( p_dec, p_pic, &i_displayed, &i_lost );
+        if( p_owner->queue.i_size > 0 )
+        {
+            DecoderCountFrame( p_dec );
+            DecoderQueuePush( p_dec, p_pic );
+        }
+        else
+            DecoderPlayVideo( p_dec, p_pic, &i_displayed, &i_lost );
     }
 
-    /* Update ugly stat */
-    input_thread_t *p_input = p_owner->p_input;
-
-    if( p_input != NULL && (i_decoded > 0 || i_lost > 0 || i_displayed > 0) )
-    {
-        vlc_mutex_lock( &p_input->p->counters.counters_lock );
-        stats_Update( p_input->p->counters.p_decoded_video, i_decoded, NULL );
-        stats_Update( p_input->p->counters.p_lost_pictures, i_lost , NULL);
-        stats_Update( p_input->p->counters.p_displayed_pictures,
-                      i_displayed, NULL);
-        vlc_mutex_unlock( &p_input->p->counters.counters_lock );
-    }
+    DecoderUpdateStatVideo( p_owner, i_decoded, i_lost, i_displayed );
 }
 
 /* This function process a video block
@@ -1043,6 +1215,22 @@ static void DecoderPlayAudio( decoder_t *p_dec, block_t *p_audio,
     *pi_lost_sum += aout_DecGetResetLost( p_aout );
 }
 
+static void DecoderUpdateStatAudio( decoder_owner_sys_t *p_owner,
+                                    int i_decoded, int i_lost, int i_played )
+{
+    input_thread_t *p_input = p_owner->p_input;
+
+    /* Update ugly stat */
+    if( p_input != NULL && (i_decoded > 0 || i_lost > 0 || i_played > 0) )
+    {
+        vlc_mutex_lock( &p_input->p->counters.counters_lock);
+        stats_Update( p_input->p->counters.p_lost_abuffers, i_lost, NULL );
+        stats_Update( p_input->p->counters.p_played_abuffers, i_played, NULL );
+        stats_Update( p_input->p->counters.p_decoded_audio, i_decoded, NULL );
+        vlc_mutex_unlock( &p_input->p->counters.counters_lock);
+    }
+}
+
 static void DecoderDecodeAudio( decoder_t *p_dec, block_t *p_block )
 {
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
@@ -1071,20 +1259,13 @@ static void DecoderDecodeAudio( decoder_t *p_dec, block_t *p_block )
             p_owner->i_preroll_end = VLC_TS_INVALID;
         }
 
-        DecoderPlayAudio( p_dec, p_aout_buf, &i_played, &i_lost );
+        if( p_owner->queue.i_size > 0 )
+            DecoderQueuePush( p_dec, p_aout_buf );
+        else
+            DecoderPlayAudio( p_dec, p_aout_buf, &i_played, &i_lost );
     }
 
-    /* Update ugly stat */
-    input_thread_t  *p_input = p_owner->p_input;
-
-    if( p_input != NULL && (i_decoded > 0 || i_lost > 0 || i_played > 0) )
-    {
-        vlc_mutex_lock( &p_input->p->counters.counters_lock);
-        stats_Update( p_input->p->counters.p_lost_abuffers, i_lost, NULL );
-        stats_Update( p_input->p->counters.p_played_abuffers, i_played, NULL );
-        stats_Update( p_input->p->counters.p_decoded_audio, i_decoded, NULL );
-        vlc_mutex_unlock( &p_input->p->counters.counters_lock);
-    }
+    DecoderUpdateStatAudio( p_owner, i_decoded, i_lost, i_played );
 }
 
 /* This function process a audio block
@@ -1134,6 +1315,122 @@ static void DecoderProcessAudio( decoder_t *p_dec, block_t *p_block )
     }
 }
 
+/**
+ * The output loop, when the decoder runs ahead of the output
+ *
+ * \param p_dec the decoder
+ */
+static void *DecoderPlayThread( void *p_data )
+{
+    decoder_t *p_dec = (decoder_t *)p_data;
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    vlc_mutex_lock( &p_owner->queue.lock );
+    for( ;; )
+    {
+        while( p_owner->queue.i_count == 0 && !p_owner->queue.b_exit )
+            vlc_cond_wait( &p_owner->queue.wait_data, &p_owner->queue.lock );
+        if( p_owner->queue.b_exit )
+            break;
+
+        void *p_elem = p_owner->queue.pp_elems[p_owner->queue.i_start];
+        p_owner->queue.i_start = (p_owner->queue.i_start + 1)
+                               % p_owner->queue.i_size;
+        p_owner->queue.i_count--;
+        p_owner->queue.b_busy = true;
+        vlc_cond_broadcast( &p_owner->queue.wait_room );
+        vlc_mutex_unlock( &p_owner->queue.lock );
+
+        int i_played = 0;
+        int i_lost = 0;
+
+        if( p_owner->queue.i_cat == VIDEO_ES )
+        {
+            DecoderPlayVideo( p_dec, p_elem, &i_played, &i_lost );
+            DecoderUpdateStatVideo( p_owner, 0, i_lost, i_played );
+        }
+        else
+        {
+            DecoderPlayAudio( p_dec, p_elem, &i_played, &i_lost );
+            DecoderUpdateStatAudio( p_owner, 0, i_lost, i_played );
+        }
+        DecoderUpdateStatQueue( p_owner, -1, 0 );
+
+        vlc_mutex_lock( &p_owner->queue.lock );
+        p_owner->queue.b_busy = false;
+        vlc_cond_broadcast( &p_owner->queue.wait_room );
+    }
+    vlc_mutex_unlock( &p_owner->queue.lock );
+    return NULL;
+}
+
+/**
+ * Spawns the play thread if a queue is configured for the ES category.
+ * Without it (or if it cannot be spawned), the decoder thread plays the
+ * decoded buffers itself.
+ */
+static void DecoderQueueStart( decoder_t *p_dec, int i_priority )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+    int64_t i_size;
+
+    if( p_owner->p_sout != NULL )
+        return;
+
+    if( p_dec->fmt_out.i_cat == VIDEO_ES )
+        i_size = var_InheritInteger( p_dec, "video-decoder-queue" );
+    else if( p_dec->fmt_out.i_cat == AUDIO_ES )
+        i_size = var_InheritInteger( p_dec, "audio-decoder-queue" );
+    else
+        return;
+    if( i_size <= 0 )
+        return;
+
+    p_owner->queue.pp_elems = malloc( i_size * sizeof(void *) );
+    if( unlikely(p_owner->queue.pp_elems == NULL) )
+        return;
+    p_owner->queue.i_cat = p_dec->fmt_out.i_cat;
+    p_owner->queue.i_size = i_size;
+
+    if( vlc_clone( &p_owner->queue.thread, DecoderPlayThread, p_dec,
+                   i_priority ) )
+    {
+        msg_Warn( p_dec, "cannot spawn play thread" );
+        free( p_owner->queue.pp_elems );
+        p_owner->queue.pp_elems = NULL;
+        p_owner->queue.i_size = 0;
+        return;
+    }
+    msg_Dbg( p_dec, "decoding up to %u buffers ahead of the output",
+             p_owner->queue.i_size );
+}
+
+static void DecoderQueueStop( decoder_t *p_dec )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    if( p_owner->queue.i_size == 0 )
+        return;
+
+    /* Signal DecoderTimedWait */
+    vlc_fifo_Lock( p_owner->p_fifo );
+    p_owner->flushing = true;
+    vlc_cond_signal( &p_owner->wait_timed );
+    vlc_fifo_Unlock( p_owner->p_fifo );
+
+    vlc_mutex_lock( &p_owner->queue.lock );
+    p_owner->queue.b_exit = true;
+    vlc_cond_broadcast( &p_owner->queue.wait_data );
+    vlc_cond_broadcast( &p_owner->queue.wait_room );
+    vlc_mutex_unlock( &p_owner->queue.lock );
+
+    vlc_join( p_owner->queue.thread, NULL );
+
+    const unsigned i_released = DecoderQueueClear( p_owner );
+    if( i_released > 0 )
+        DecoderUpdateStatQueue( p_owner, -(int)i_released, 0 );
+}
+
 static void DecoderPlaySpu( decoder_t *p_dec, subpicture_t *p_subpic )
 {
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
@@ -1274,6 +1571,9 @@ static void DecoderProcessFlush( decoder_t *p_dec )
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
     decoder_t *p_packetizer = p_owner->p_packetizer;
 
+    /* Drop the buffers decoded ahead of the output */
+    DecoderQueueFlush( p_dec );
+
     if( p_dec->b_error )
         return;
 
@@ -1402,7 +1702,9 @@ static void *DecoderThread( void *p_data )
 
         if( p_block == NULL )
         {   /* Draining: the decoder is drained and all decoded buffers are
-             * queued to the output at this point. Now drain the output. */
+             * queued to the output (or to the play thread) at this point.
+             * Now drain the output. */
+            DecoderQueueWait( p_dec );
             if( p_owner->p_aout != NULL )
                 aout_DecFlush( p_owner->p_aout, true );
         }
@@ -1495,6 +1797,17 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
     vlc_cond_init( &p_owner->wait_fifo );
     vlc_cond_init( &p_owner->wait_timed );
 
+    vlc_mutex_init( &p_owner->queue.lock );
+    vlc_cond_init( &p_owner->queue.wait_data );
+    vlc_cond_init( &p_owner->queue.wait_room );
+    p_owner->queue.pp_elems = NULL;
+    p_owner->queue.i_cat = UNKNOWN_ES;
+    p_owner->queue.i_size = 0;
+    p_owner->queue.i_start = 0;
+    p_owner->queue.i_count = 0;
+    p_owner->queue.b_busy = false;
+    p_owner->queue.b_exit = false;
+
     /* Set buffers allocation callbacks for the decoders */
     p_dec->pf_aout_format_update = aout_update_format;
     p_dec->pf_vout_format_update = vout_update_format;
@@ -1637,6 +1950,11 @@ static void DeleteDecoder( decoder_t * p_dec )
         vlc_object_release( p_owner->p_packetizer );
     }
 
+    free( p_owner->queue.pp_elems );
+    vlc_cond_destroy( &p_owner->queue.wait_room );
+    vlc_cond_destroy( &p_owner->queue.wait_data );
+    vlc_mutex_destroy( &p_owner->queue.lock );
+
     vlc_cond_destroy( &p_owner->wait_timed );
     vlc_cond_destroy( &p_owner->wait_fifo );
     vlc_cond_destroy( &p_owner->wait_acknowledge );
@@ -1703,10 +2021,13 @@ static decoder_t *decoder_New( vlc_object_t *p_parent, input_thread_t *p_input,
     else
         i_priority = VLC_THREAD_PRIORITY_VIDEO;
 
-    /* Spawn the decoder thread */
+    /* Spawn the play thread (if any), then the decoder thread */
+    DecoderQueueStart( p_dec, i_priority );
+
     if( vlc_clone( &p_dec->p_owner->thread, DecoderThread, p_dec, i_priority ) )
     {
         msg_Err( p_dec, "cannot spawn decoder thread" );
+        DecoderQueueStop( p_dec );
         DeleteDecoder( p_dec );
         return NULL;
     }
@@ -1776,6 +2097,7 @@ void input_DecoderDelete( decoder_t *p_dec )
     vlc_mutex_unlock( &p_owner->lock );
 
     vlc_join( p_owner->thread, NULL );
+    DecoderQueueStop( p_dec );
 
     /* */
     if( p_dec->p_owner->cc.b_supported )
@@ -1835,6 +2157,9 @@ bool input_DecoderIsEmpty( decoder_t * p_dec )
     if( block_FifoCount( p_dec->p_owner->p_fifo ) > 0 )
         return false;
 
+    if( !DecoderQueueIsEmpty( p_owner ) )
+        return false;
+
     bool b_empty;
 
     vlc_mutex_lock( &p_owner->lock );
@@ -2044,7 +2369,8 @@ void input_DecoderWait( decoder_t *p_dec )
         if( p_owner->paused )
             break;
         vlc_fifo_Lock( p_owner->p_fifo );
-        if( p_owner->b_idle && vlc_fifo_IsEmpty( p_owner->p_fifo ) )
+        if( p_owner->b_idle && vlc_fifo_IsEmpty( p_owner->p_fifo )
+         && DecoderQueueIsEmpty( p_owner ) )
         {
             msg_Err( p_dec, "buffer deadlock prevented" );
             vlc_fifo_Unlock( p_owner->p_fifo );
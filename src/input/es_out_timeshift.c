@@ -37,6 +37,11 @@
 #endif
 #include <sys/stat.h>
 #include <unistd.h>
+#if defined(HAVE_MMAP) && defined(HAVE_POSIX_FALLOCATE)
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  define TS_STORAGE_MMAP 1
+#endif
 
 #include <vlc_common.h>
 #include <vlc_fs.h>
@@ -162,6 +167,10 @@ struct ts_storage_t
 #endif
     size_t  i_file_max; /* Max size in bytes */
     int64_t i_file_size;/* Current size in bytes */
+#ifdef TS_STORAGE_MMAP
+    int     fd;         /* File descriptor of the mapped data, or -1 */
+    uint8_t *p_map;     /* Shared mapping of i_file_max bytes, or NULL */
+#endif
     FILE    *p_filew;   /* FILE handle for data writing */
     FILE    *p_filer;   /* FILE handle for data reading */
 
@@ -1093,6 +1102,33 @@ static void *TsRun( void *p_data )
 /*****************************************************************************
  *
  *****************************************************************************/
+#ifdef TS_STORAGE_MMAP
+/* (Re)maps the storage file, growing it to at least i_size bytes */
+static int TsStorageMap( ts_storage_t *p_storage, size_t i_size )
+{
+    if( i_size > p_storage->i_file_max )
+    {
+        /* The blocks are reserved: writing to a hole of the mapping when
+         * the disk is full would raise SIGBUS */
+        if( posix_fallocate( p_storage->fd, 0, i_size ) )
+            return VLC_EGENERIC;
+        if( p_storage->p_map != NULL )
+            munmap( p_storage->p_map, p_storage->i_file_max );
+        p_storage->p_map = NULL;
+        p_storage->i_file_max = i_size;
+    }
+    if( p_storage->p_map == NULL )
+    {
+        void *p_map = mmap( NULL, p_storage->i_file_max, PROT_READ|PROT_WRITE,
+                            MAP_SHARED, p_storage->fd, 0 );
+        if( p_map == MAP_FAILED )
+            return VLC_EGENERIC;
+        p_storage->p_map = p_map;
+    }
+    return VLC_SUCCESS;
+}
+#endif
+
 static ts_storage_t *TsStorageNew( const char *psz_tmp_path, int64_t i_tmp_size_max )
 {
     ts_storage_t *p_storage = malloc( sizeof (*p_storage) );
@@ -1107,6 +1143,19 @@ static ts_storage_t *TsStorageNew( const char *psz_tmp_path, int64_t i_tmp_size_
         return NULL;
     }
 
+#ifdef TS_STORAGE_MMAP
+    p_storage->fd = fd;
+    p_storage->p_map = NULL;
+    p_storage->i_file_max = 0;
+    if( !TsStorageMap( p_storage, i_tmp_size_max ) )
+    {
+        vlc_unlink( psz_file );
+        free( psz_file );
+        goto done;
+    }
+    /* The storage could not be reserved or mapped: write it as it comes */
+    p_storage->fd = -1;
+#endif
     p_storage->p_filew = fdopen( fd, "w+b" );
     if( p_storage->p_filew == NULL )
     {
@@ -1128,11 +1177,14 @@ static ts_storage_t *TsStorageNew( const char *psz_tmp_path, int64_t i_tmp_size_
     free( psz_file );
 #else
     p_storage->psz_file = psz_file;
+#endif
+    p_storage->i_file_max = i_tmp_size_max;
+#ifdef TS_STORAGE_MMAP
+done:
 #endif
     p_storage->p_next = NULL;
 
     /* */
-    p_storage->i_file_max = i_tmp_size_max;
     p_storage->i_file_size = 0;
 
     /* */
@@ -1166,8 +1218,19 @@ static void TsStorageDelete( ts_storage_t *p_storage )
     }
     free( p_storage->p_cmd );
 
-    fclose( p_storage->p_filer );
-    fclose( p_storage->p_filew );
+#ifdef TS_STORAGE_MMAP
+    if( p_storage->fd != -1 )
+    {
+        if( p_storage->p_map != NULL )
+            munmap( p_storage->p_map, p_storage->i_file_max );
+        close( p_storage->fd );
+    }
+    else
+#endif
+    {
+        fclose( p_storage->p_filer );
+        fclose( p_storage->p_filew );
+    }
 #ifdef _WIN32
     vlc_unlink( p_storage->psz_file );
     free( p_storage->psz_file );
@@ -1186,12 +1249,22 @@ static void TsStoragePack( ts_storage_t *p_storage )
     ts_cmd_t *p_new = realloc( p_storage->p_cmd, p_storage->i_cmd_max * sizeof(*p_storage->p_cmd) );
     if( p_new )
         p_storage->p_cmd = p_new;
+
+#ifdef TS_STORAGE_MMAP
+    /* Release the address space until the data is read back, so that long
+     * pauses do not exhaust it (on 32-bits systems) */
+    if( p_storage->p_map != NULL )
+    {
+        munmap( p_storage->p_map, p_storage->i_file_max );
+        p_storage->p_map = NULL;
+    }
+#endif
 }
 static bool TsStorageIsFull( ts_storage_t *p_storage, const ts_cmd_t *p_cmd )
 {
     if( p_cmd && p_cmd->i_type == C_SEND && p_storage->i_cmd_w > 0 )
     {
-        size_t i_size = sizeof(*p_cmd->u.send.p_block) + p_cmd->u.send.p_block->i_buffer;
+        size_t i_size = sizeof(block_t) + p_cmd->u.send.p_block->i_buffer;
 
         if( p_storage->i_file_size + i_size >= p_storage->i_file_max )
             return true;
@@ -1213,6 +1286,32 @@ static void TsStoragePushCmd( ts_storage_t *p_storage, const ts_cmd_t *p_cmd, bo
         block_t *p_block = cmd.u.send.p_block;
 
         cmd.u.send.p_block = NULL;
+#ifdef TS_STORAGE_MMAP
+        if( p_storage->fd != -1 )
+        {
+            cmd.u.send.i_offset = p_storage->i_file_size;
+
+            const size_t i_size = sizeof(*p_block) + p_block->i_buffer;
+            /* Only the first block of a storage may not fit */
+            if( ( p_storage->i_file_size + i_size > p_storage->i_file_max &&
+                  TsStorageMap( p_storage, p_storage->i_file_size + i_size ) ) ||
+                ( p_storage->p_map == NULL &&
+                  TsStorageMap( p_storage, p_storage->i_file_max ) ) )
+            {
+                block_Release( p_block );
+                return;
+            }
+
+            uint8_t *p = &p_storage->p_map[p_storage->i_file_size];
+            memcpy( p, p_block, sizeof(*p_block) );
+            if( p_block->i_buffer > 0 )
+                memcpy( p + sizeof(*p_block), p_block->p_buffer, p_block->i_buffer );
+            p_storage->i_file_size += i_size;
+            block_Release( p_block );
+            p_storage->p_cmd[p_storage->i_cmd_w++] = cmd;
+            return;
+        }
+#endif
         cmd.u.send.i_offset = ftell( p_storage->p_filew );
 
         if( fwrite( p_block, sizeof(*p_block), 1, p_storage->p_filew ) != 1 )
@@ -1246,6 +1345,35 @@ static void TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_fl
     {
         block_t block;
 
+#ifdef TS_STORAGE_MMAP
+        if( p_storage->fd != -1 )
+        {
+            if( b_flush ||
+                ( p_storage->p_map == NULL &&
+                  TsStorageMap( p_storage, p_storage->i_file_max ) ) )
+            {
+                p_cmd->u.send.p_block = block_Alloc( 1 );
+                return;
+            }
+
+            const uint8_t *p = &p_storage->p_map[p_cmd->u.send.i_offset];
+
+            memcpy( &block, p, sizeof(block) );
+
+            block_t *p_block = block_Alloc( block.i_buffer );
+            if( p_block )
+            {
+                p_block->i_dts      = block.i_dts;
+                p_block->i_pts      = block.i_pts;
+                p_block->i_flags    = block.i_flags;
+                p_block->i_length   = block.i_length;
+                p_block->i_nb_samples = block.i_nb_samples;
+                memcpy( p_block->p_buffer, p + sizeof(block), block.i_buffer );
+            }
+            p_cmd->u.send.p_block = p_block;
+            return;
+        }
+#endif
         if( !b_flush &&
             !fseek( p_storage->p_filer, p_cmd->u.send.i_offset, SEEK_SET ) &&
             fread( &block, sizeof(block), 1, p_storage->p_filer ) == 1 )
@@ -789,6 +789,8 @@ static void InitStatistics( input_thread_t * p_input )
         INIT_COUNTER( decoded_audio, COUNTER );
         INIT_COUNTER( decoded_video, COUNTER );
         INIT_COUNTER( decoded_sub, COUNTER );
+        INIT_COUNTER( decoder_queued, COUNTER );
+        INIT_COUNTER( decoder_stall, COUNTER );
         p_input->p->counters.p_sout_send_bitrate = NULL;
         p_input->p->counters.p_sout_sent_packets = NULL;
         p_input->p->counters.p_sout_sent_bytes = NULL;
@@ -1266,6 +1268,8 @@ error:
         EXIT_COUNTER( decoded_audio );
         EXIT_COUNTER( decoded_video );
         EXIT_COUNTER( decoded_sub );
+        EXIT_COUNTER( decoder_queued );
+        EXIT_COUNTER( decoder_stall );
 
         if( p_input->p->p_sout )
         {
@@ -1331,6 +1335,8 @@ static void End( input_thread_t * p_input )
             CL_CO( decoded_audio) ;
             CL_CO( decoded_video );
             CL_CO( decoded_sub) ;
+            CL_CO( decoder_queued );
+            CL_CO( decoder_stall );
         }
 
         /* Close optional stream output instance */
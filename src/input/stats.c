@@ -98,6 +98,8 @@ void stats_ComputeInputStats(input_thread_t *input, input_stats_t *st)
     /* Decoders */
     st->i_decoded_video = stats_GetTotal(input->p->counters.p_decoded_video);
     st->i_decoded_audio = stats_GetTotal(input->p->counters.p_decoded_audio);
+    st->i_decoder_queued = stats_GetTotal(input->p->counters.p_decoder_queued);
+    st->i_decoder_stall = stats_GetTotal(input->p->counters.p_decoder_stall);
 
     /* Sout */
     if (input->p->counters.p_sout_send_bitrate)
@@ -130,6 +132,7 @@ void stats_ReinitInputStats( input_stats_t *p_stats )
     p_stats->i_displayed_pictures = p_stats->i_lost_pictures =
     p_stats->i_played_abuffers = p_stats->i_lost_abuffers =
     p_stats->i_decoded_video = p_stats->i_decoded_audio =
+    p_stats->i_decoder_queued = p_stats->i_decoder_stall =
     p_stats->i_sent_bytes = p_stats->i_sent_packets = p_stats->f_send_bitrate
      = 0;
     vlc_mutex_unlock( &p_stats->lock );
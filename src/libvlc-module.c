@@ -379,6 +379,11 @@ static const char *const ppsz_pos_descriptions[] =
     "picture quality, for instance deinterlacing, or distort " \
     "the video.")
 
+#define VIDEO_FILTER_THREADS_TEXT N_("Video filter threads")
+#define VIDEO_FILTER_THREADS_LONGTEXT N_( \
+    "Number of threads that the video filters supporting it may use to " \
+    "process the pictures in horizontal slices (0 for one per CPU core).")
+
 #define SNAP_PATH_TEXT N_("Video snapshot directory (or filename)")
 #define SNAP_PATH_LONGTEXT N_( \
     "Directory where the video snapshots will be stored.")
@@ -804,6 +809,11 @@ static const char *const ppsz_prefres[] = {
     "Specify an IP address (e.g. ::1 or 127.0.0.1) or a host name " \
     "(e.g. localhost) to restrict them to a specific network interface." )
 
+#define HTTP_THREADS_TEXT N_( "HTTP server threads" )
+#define HTTP_THREADS_LONGTEXT N_( \
+    "Number of threads serving the clients of each HTTP and RTSP server. " \
+    "Connections are spread over the threads." )
+
 #define HTTP_PORT_TEXT N_( "HTTP server port" )
 #define HTTP_PORT_LONGTEXT N_( \
     "The HTTP server will listen on this TCP port. " \
@@ -897,6 +907,18 @@ static const char *const ppsz_prefres[] = {
     "This allows you to select a list of encoders that VLC will use in " \
     "priority.")
 
+#define VIDEO_QUEUE_TEXT N_("Decoded video queue")
+#define VIDEO_QUEUE_LONGTEXT N_( \
+    "Number of decoded pictures that the video decoder may produce ahead " \
+    "of the video output. This lets the decoder keep working while the " \
+    "output waits for the display time or is slowed down by filters, at " \
+    "the cost of more picture buffers (0 to disable).")
+
+#define AUDIO_QUEUE_TEXT N_("Decoded audio queue")
+#define AUDIO_QUEUE_LONGTEXT N_( \
+    "Number of decoded audio buffers that the audio decoder may produce " \
+    "ahead of the audio output (0 to disable).")
+
 /*****************************************************************************
  * Sout
  ****************************************************************************/
@@ -1597,6 +1619,9 @@ vlc_module_begin ()
     set_subcategory( SUBCAT_VIDEO_VFILTER )
     add_module_list_cat( "video-filter", SUBCAT_VIDEO_VFILTER, NULL,
                 VIDEO_FILTER_TEXT, VIDEO_FILTER_LONGTEXT, false )
+    add_integer_with_range( "video-filter-threads", 0, 0, 64,
+                            VIDEO_FILTER_THREADS_TEXT,
+                            VIDEO_FILTER_THREADS_LONGTEXT, true )
 
     set_subcategory( SUBCAT_VIDEO_SPLITTER )
     add_module_list( "video-splitter", "video splitter", NULL,
@@ -1734,6 +1759,9 @@ vlc_module_begin ()
         change_integer_range( 1, 65535 )
     add_integer( "https-port", 8443, HTTPS_PORT_TEXT, HTTPS_PORT_LONGTEXT, true )
         change_integer_range( 1, 65535 )
+    add_integer( "http-threads", 1, HTTP_THREADS_TEXT,
+                 HTTP_THREADS_LONGTEXT, true )
+        change_integer_range( 1, 64 )
     add_string( "rtsp-host", NULL, RTSP_HOST_TEXT, RTSP_HOST_LONGTEXT, true )
     add_integer( "rtsp-port", 554, RTSP_PORT_TEXT, RTSP_PORT_LONGTEXT, true )
         change_integer_range( 1, 65535 )
@@ -1859,6 +1887,10 @@ vlc_module_begin ()
                 CODEC_LONGTEXT, true )
     add_string( "encoder",  NULL, ENCODER_TEXT,
                 ENCODER_LONGTEXT, true )
+    add_integer_with_range( "video-decoder-queue", 0, 0, 64,
+                            VIDEO_QUEUE_TEXT, VIDEO_QUEUE_LONGTEXT, true )
+    add_integer_with_range( "audio-decoder-queue", 0, 0, 64,
+                            AUDIO_QUEUE_TEXT, AUDIO_QUEUE_LONGTEXT, true )
 
     set_subcategory( SUBCAT_INPUT_ACCESS )
     add_category_hint( N_("Input"), INPUT_CAT_LONGTEXT , false )
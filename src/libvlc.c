@@ -102,6 +102,7 @@ libvlc_int_t * libvlc_InternalCreate( void )
     priv->playlist = NULL;
     priv->p_dialog_provider = NULL;
     priv->p_vlm = NULL;
+    priv->slicer = NULL;
 
     vlc_ExitInit( &priv->exit );
 
@@ -527,6 +528,7 @@ void libvlc_InternalCleanup( libvlc_int_t *p_libvlc )
         playlist_preparser_Delete(priv->parser);
 
     vlc_DeinitActions( p_libvlc, priv->actions );
+    filter_SliceCleanup( p_libvlc );
 
     /* Save the configuration */
     if( !var_InheritBool( p_libvlc, "ignore-config" ) )
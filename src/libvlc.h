@@ -152,6 +152,7 @@ typedef struct libvlc_priv_t
     struct playlist_t *playlist; ///< Playlist for interfaces
     struct playlist_preparser_t *parser; ///< Input item meta data handler
     struct vlc_actions *actions; ///< Hotkeys handler
+    struct vlc_slicer *slicer; ///< Video filter slice threads (or NULL)
 
     /* Exit callback */
     vlc_exit_t       exit;
@@ -168,6 +169,11 @@ void intf_DestroyAll( libvlc_int_t * );
 
 #define libvlc_stats( o ) (libvlc_priv((VLC_OBJECT(o))->p_libvlc)->b_stats)
 
+/*
+ * Video filter slice jobs
+ */
+void filter_SliceCleanup( libvlc_int_t * );
+
 /*
  * Variables stuff
  */
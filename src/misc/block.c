@@ -36,6 +36,7 @@
 
 #include <vlc_common.h>
 #include <vlc_block.h>
+#include <vlc_atomic.h>
 #include <vlc_fs.h>
 
 /**
@@ -245,6 +246,233 @@ block_t *block_Realloc (block_t *block, ssize_t prebody, size_t body)
     return rea;
 }
 
+/**
+ * @section Block pools
+ *
+ * A block pool recycles fixed-size blocks through a bounded lock-free ring
+ * (Vyukov's MPMC queue), so that blocks can be released from any thread.
+ */
+
+struct block_pool_cell
+{
+    atomic_size_t seq;
+    block_t *block;
+};
+
+struct block_pool_t
+{
+    size_t size; /**< payload size of each block */
+    size_t mask; /**< ring capacity minus one */
+    atomic_size_t enqueue_pos;
+    atomic_size_t dequeue_pos;
+    atomic_uintptr_t refs; /**< owner + outstanding blocks */
+    atomic_uint_least64_t hits;
+    atomic_uint_least64_t misses;
+    struct block_pool_cell cells[];
+};
+
+typedef struct
+{
+    block_t self;
+    block_pool_t *pool;
+} block_pooled_t;
+
+static bool block_pool_Push (block_pool_t *pool, block_t *block)
+{
+    size_t pos = atomic_load_explicit (&pool->enqueue_pos,
+                                       memory_order_relaxed);
+    struct block_pool_cell *cell;
+
+    for (;;)
+    {
+        cell = &pool->cells[pos & pool->mask];
+
+        size_t seq = atomic_load_explicit (&cell->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+
+        if (diff == 0)
+        {
+            if (atomic_compare_exchange_weak (&pool->enqueue_pos, &pos,
+                                              pos + 1))
+                break;
+        }
+        else if (diff < 0)
+            return false; /* full */
+        else
+            pos = atomic_load_explicit (&pool->enqueue_pos,
+                                        memory_order_relaxed);
+    }
+
+    cell->block = block;
+    atomic_store_explicit (&cell->seq, pos + 1, memory_order_release);
+    return true;
+}
+
+static block_t *block_pool_Pop (block_pool_t *pool)
+{
+    size_t pos = atomic_load_explicit (&pool->dequeue_pos,
+                                       memory_order_relaxed);
+    struct block_pool_cell *cell;
+
+    for (;;)
+    {
+        cell = &pool->cells[pos & pool->mask];
+
+        size_t seq = atomic_load_explicit (&cell->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+
+        if (diff == 0)
+        {
+            if (atomic_compare_exchange_weak (&pool->dequeue_pos, &pos,
+                                              pos + 1))
+                break;
+        }
+        else if (diff < 0)
+            return NULL; /* empty */
+        else
+            pos = atomic_load_explicit (&pool->dequeue_pos,
+                                        memory_order_relaxed);
+    }
+
+    block_t *block = cell->block;
+    atomic_store_explicit (&cell->seq, pos + pool->mask + 1,
+                           memory_order_release);
+    return block;
+}
+
+static void block_pool_Unref (block_pool_t *pool)
+{
+    if (atomic_fetch_sub (&pool->refs, 1) != 1)
+        return;
+
+    block_t *block;
+    while ((block = block_pool_Pop (pool)) != NULL)
+        free (block);
+    free (pool);
+}
+
+static void block_pool_Reset (block_pool_t *pool, block_t *block)
+{
+    block_Init (block, (block_pooled_t *)block + 1,
+                BLOCK_ALIGN + (2 * BLOCK_PADDING) + pool->size);
+    block->p_buffer += BLOCK_PADDING + BLOCK_ALIGN - 1;
+    block->p_buffer = (void *)(((uintptr_t)block->p_buffer)
+                               & ~(BLOCK_ALIGN - 1));
+    block->i_buffer = pool->size;
+}
+
+static void block_pool_ReleaseBlock (block_t *block)
+{
+    block_pool_t *pool = ((block_pooled_t *)block)->pool;
+
+    block_Invalidate (block);
+    if (!block_pool_Push (pool, block))
+        free (block);
+    block_pool_Unref (pool);
+}
+
+static block_t *block_pool_NewBlock (block_pool_t *pool)
+{
+    block_pooled_t *pb = malloc (sizeof (*pb) + BLOCK_ALIGN
+                                 + (2 * BLOCK_PADDING) + pool->size);
+    if (unlikely(pb == NULL))
+        return NULL;
+
+    pb->pool = pool;
+    return &pb->self;
+}
+
+/**
+ * Creates a pool of recycled blocks.
+ *
+ * @param size payload size of the blocks (block_t.i_buffer)
+ * @param count number of blocks to preallocate and retain
+ * @return a pool or NULL on error
+ */
+block_pool_t *block_pool_New (size_t size, unsigned count)
+{
+    size_t capacity = 1;
+
+    if (count == 0 || count > 65536)
+        return NULL;
+    while (capacity < count)
+        capacity <<= 1;
+
+    block_pool_t *pool = malloc (sizeof (*pool)
+                                 + capacity * sizeof (pool->cells[0]));
+    if (unlikely(pool == NULL))
+        return NULL;
+
+    pool->size = size;
+    pool->mask = capacity - 1;
+    atomic_init (&pool->enqueue_pos, 0);
+    atomic_init (&pool->dequeue_pos, 0);
+    atomic_init (&pool->refs, 1);
+    atomic_init (&pool->hits, 0);
+    atomic_init (&pool->misses, 0);
+    for (size_t i = 0; i < capacity; i++)
+        atomic_init (&pool->cells[i].seq, i);
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        block_t *block = block_pool_NewBlock (pool);
+        if (unlikely(block == NULL))
+            break;
+        block_pool_Push (pool, block);
+    }
+    return pool;
+}
+
+/**
+ * Releases a pool of blocks.
+ *
+ * Blocks still in use remain valid. The pool memory is reclaimed once the
+ * last of them is released.
+ */
+void block_pool_Release (block_pool_t *pool)
+{
+    block_pool_Unref (pool);
+}
+
+/**
+ * Obtains a block from a pool.
+ *
+ * If no recycled blocks are available, a new block is allocated from the
+ * heap. It will join the pool when released if there is room left.
+ *
+ * @return a block of the pool payload size, or NULL on memory error
+ */
+block_t *block_pool_Alloc (block_pool_t *pool)
+{
+    block_t *block = block_pool_Pop (pool);
+
+    if (likely(block != NULL))
+        atomic_fetch_add_explicit (&pool->hits, 1, memory_order_relaxed);
+    else
+    {
+        atomic_fetch_add_explicit (&pool->misses, 1, memory_order_relaxed);
+        block = block_pool_NewBlock (pool);
+        if (unlikely(block == NULL))
+            return NULL;
+    }
+
+    atomic_fetch_add (&pool->refs, 1);
+    block_pool_Reset (pool, block);
+    block->pf_release = block_pool_ReleaseBlock;
+    return block;
+}
+
+/**
+ * Reports how many block_pool_Alloc() calls were served from recycled
+ * blocks (hits) and from the heap (misses).
+ */
+void block_pool_GetStats (block_pool_t *pool, uint64_t *restrict hits,
+                          uint64_t *restrict misses)
+{
+    *hits = atomic_load_explicit (&pool->hits, memory_order_relaxed);
+    *misses = atomic_load_explicit (&pool->misses, memory_order_relaxed);
+}
+
 static void block_heap_Release (block_t *block)
 {
     block_Invalidate (block);
@@ -30,6 +30,8 @@
 #include <vlc_filter.h>
 #include <vlc_modules.h>
 
+#include <assert.h>
+
 filter_t *filter_NewBlend( vlc_object_t *p_this,
                            const video_format_t *p_dst_chroma )
 {
@@ -111,6 +113,252 @@ void filter_DeleteBlend( filter_t *p_blend )
     vlc_object_release( p_blend );
 }
 
+/*****************************************************************************
+ * Slice jobs
+ *****************************************************************************/
+/* Thinner bands do not pay for the synchronization */
+#define SLICE_MIN_LINES 16
+
+struct filter_slice_job
+{
+    vlc_slice_cb_t    pf_slice;
+    void             *p_data;
+
+    unsigned          i_lines;
+    unsigned          i_band_lines;
+    unsigned          i_bands;
+    unsigned          i_next; /* next band to start */
+    unsigned          i_done; /* number of completed bands */
+    vlc_cond_t        done;
+
+    struct filter_slice_job *p_next;
+};
+
+struct vlc_slicer
+{
+    vlc_mutex_t lock;
+    vlc_cond_t  wait;
+    struct filter_slice_job *p_jobs; /* jobs with bands left to start */
+    bool        b_exit;
+
+    unsigned     i_threads;
+    vlc_thread_t threads[];
+};
+
+/* Starts the next band of a job. The slicer lock must be held. */
+static unsigned SliceTake( struct vlc_slicer *p_slicer,
+                           struct filter_slice_job *p_job )
+{
+    const unsigned i_band = p_job->i_next++;
+
+    if( p_job->i_next == p_job->i_bands )
+    {
+        struct filter_slice_job **pp_job = &p_slicer->p_jobs;
+
+        while( *pp_job != p_job )
+            pp_job = &(*pp_job)->p_next;
+        *pp_job = p_job->p_next;
+    }
+    return i_band;
+}
+
+static void SliceRun( struct filter_slice_job *p_job, unsigned i_band )
+{
+    const unsigned i_first = i_band * p_job->i_band_lines;
+    unsigned i_end = i_first + p_job->i_band_lines;
+
+    if( i_end > p_job->i_lines )
+        i_end = p_job->i_lines;
+    p_job->pf_slice( p_job->p_data, i_first, i_end );
+}
+
+static void *SliceThread( void *p_data )
+{
+    struct vlc_slicer *p_slicer = p_data;
+
+    vlc_mutex_lock( &p_slicer->lock );
+    for( ;; )
+    {
+        while( p_slicer->p_jobs == NULL && !p_slicer->b_exit )
+            vlc_cond_wait( &p_slicer->wait, &p_slicer->lock );
+        if( p_slicer->p_jobs == NULL )
+            break;
+
+        struct filter_slice_job *p_job = p_slicer->p_jobs;
+        const unsigned i_band = SliceTake( p_slicer, p_job );
+
+        vlc_mutex_unlock( &p_slicer->lock );
+        SliceRun( p_job, i_band );
+        vlc_mutex_lock( &p_slicer->lock );
+
+        if( ++p_job->i_done == p_job->i_bands )
+            vlc_cond_signal( &p_job->done );
+    }
+    vlc_mutex_unlock( &p_slicer->lock );
+    return NULL;
+}
+
+static vlc_mutex_t slicer_lock = VLC_STATIC_MUTEX;
+
+/**
+ * Returns the slice worker threads of the LibVLC instance, spawning them
+ * on first use.
+ */
+static struct vlc_slicer *SlicerGet( vlc_object_t *p_obj )
+{
+    libvlc_priv_t *priv = libvlc_priv( p_obj->p_libvlc );
+
+    vlc_mutex_lock( &slicer_lock );
+    struct vlc_slicer *p_slicer = priv->slicer;
+    if( p_slicer != NULL )
+        goto out;
+
+    unsigned i_threads = var_InheritInteger( p_obj, "video-filter-threads" );
+    if( i_threads == 0 )
+    {
+        i_threads = vlc_GetCPUCount();
+        if( i_threads > 16 )
+            i_threads = 16;
+    }
+    /* The calling thread processes bands too */
+    i_threads = i_threads > 1 ? i_threads - 1 : 0;
+
+    p_slicer = malloc( sizeof(*p_slicer) + i_threads * sizeof(vlc_thread_t) );
+    if( unlikely(p_slicer == NULL) )
+        goto out;
+
+    vlc_mutex_init( &p_slicer->lock );
+    vlc_cond_init( &p_slicer->wait );
+    p_slicer->p_jobs = NULL;
+    p_slicer->b_exit = false;
+    p_slicer->i_threads = 0;
+
+    while( p_slicer->i_threads < i_threads )
+    {
+        if( vlc_clone( &p_slicer->threads[p_slicer->i_threads], SliceThread,
+                       p_slicer, VLC_THREAD_PRIORITY_VIDEO ) )
+            break;
+        p_slicer->i_threads++;
+    }
+    msg_Dbg( p_obj->p_libvlc, "using %u video filter slice threads",
+             p_slicer->i_threads );
+    priv->slicer = p_slicer;
+out:
+    vlc_mutex_unlock( &slicer_lock );
+    return p_slicer;
+}
+
+void vlc_Slice( vlc_object_t *p_obj, unsigned i_lines, unsigned i_align,
+                vlc_slice_cb_t pf_slice, void *p_data )
+{
+    struct vlc_slicer *p_slicer = SlicerGet( p_obj );
+    const unsigned i_threads = (p_slicer ? p_slicer->i_threads : 0) + 1;
+
+    if( i_align == 0 )
+        i_align = 1;
+
+    /* Two bands per thread, so that a slower band does not hold back the
+     * whole job */
+    unsigned i_band_lines = (i_lines + 2 * i_threads - 1) / (2 * i_threads);
+    if( i_band_lines < SLICE_MIN_LINES )
+        i_band_lines = SLICE_MIN_LINES;
+    i_band_lines = (i_band_lines + i_align - 1) / i_align * i_align;
+
+    const unsigned i_bands = (i_lines + i_band_lines - 1) / i_band_lines;
+    if( i_threads == 1 || i_bands <= 1 )
+    {
+        pf_slice( p_data, 0, i_lines );
+        return;
+    }
+
+    struct filter_slice_job job = {
+        .pf_slice = pf_slice,
+        .p_data = p_data,
+        .i_lines = i_lines,
+        .i_band_lines = i_band_lines,
+        .i_bands = i_bands,
+        .i_next = 0,
+        .i_done = 0,
+        .p_next = NULL,
+    };
+    vlc_cond_init( &job.done );
+
+    vlc_mutex_lock( &p_slicer->lock );
+    struct filter_slice_job **pp_last = &p_slicer->p_jobs;
+    while( *pp_last != NULL )
+        pp_last = &(*pp_last)->p_next;
+    *pp_last = &job;
+    vlc_cond_broadcast( &p_slicer->wait );
+
+    /* Process bands of our own job until they are all started */
+    while( job.i_next < job.i_bands )
+    {
+        const unsigned i_band = SliceTake( p_slicer, &job );
+
+        vlc_mutex_unlock( &p_slicer->lock );
+        SliceRun( &job, i_band );
+        vlc_mutex_lock( &p_slicer->lock );
+        job.i_done++;
+    }
+    while( job.i_done < job.i_bands )
+        vlc_cond_wait( &job.done, &p_slicer->lock );
+    vlc_mutex_unlock( &p_slicer->lock );
+
+    vlc_cond_destroy( &job.done );
+}
+
+unsigned vlc_SliceThreads( vlc_object_t *p_obj )
+{
+    struct vlc_slicer *p_slicer = SlicerGet( p_obj );
+
+    return (p_slicer ? p_slicer->i_threads : 0) + 1;
+}
+
+struct filter_slice
+{
+    filter_t         *p_filter;
+    filter_slice_cb_t pf_slice;
+    void             *p_data;
+};
+
+static void FilterSliceRun( void *p_data, unsigned i_first, unsigned i_end )
+{
+    struct filter_slice *p_slice = p_data;
+
+    p_slice->pf_slice( p_slice->p_filter, p_slice->p_data, i_first, i_end );
+}
+
+void filter_Slice( filter_t *p_filter, unsigned i_lines, unsigned i_align,
+                   filter_slice_cb_t pf_slice, void *p_data )
+{
+    struct filter_slice slice = { p_filter, pf_slice, p_data };
+
+    vlc_Slice( VLC_OBJECT(p_filter), i_lines, i_align, FilterSliceRun, &slice );
+}
+
+void filter_SliceCleanup( libvlc_int_t *p_libvlc )
+{
+    libvlc_priv_t *priv = libvlc_priv( p_libvlc );
+    struct vlc_slicer *p_slicer = priv->slicer;
+
+    if( p_slicer == NULL )
+        return;
+
+    vlc_mutex_lock( &p_slicer->lock );
+    assert( p_slicer->p_jobs == NULL );
+    p_slicer->b_exit = true;
+    vlc_cond_broadcast( &p_slicer->wait );
+    vlc_mutex_unlock( &p_slicer->lock );
+
+    for( unsigned i = 0; i < p_slicer->i_threads; i++ )
+        vlc_join( p_slicer->threads[i], NULL );
+
+    vlc_cond_destroy( &p_slicer->wait );
+    vlc_mutex_destroy( &p_slicer->lock );
+    free( p_slicer );
+    priv->slicer = NULL;
+}
+
 /* */
 #include <vlc_video_splitter.h>
 
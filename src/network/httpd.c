@@ -40,11 +40,21 @@
 #include <vlc_url.h>
 #include <vlc_mime.h>
 #include <vlc_block.h>
+#include <vlc_atomic.h>
+#include <vlc_fs.h>
+#include <vlc_interrupt.h>
 #include "../libvlc.h"
 
 #include <string.h>
 #include <errno.h>
+#include <ctype.h>
+#include <limits.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifdef HAVE_SENDFILE
+# include <sys/sendfile.h>
+#endif
 
 #ifdef HAVE_POLL
 # include <poll.h>
@@ -63,10 +73,28 @@
 #define HTTPD_CL_BUFSIZE 10000
 #endif
 
+/* maximum number of shared stream chunks written at once to a client */
+#define HTTPD_CL_IOV 16
+
+typedef struct httpd_stream_chunk_t httpd_stream_chunk_t;
+
 static void httpd_ClientClean(httpd_client_t *cl);
-static void httpd_AppendData(httpd_stream_t *stream, uint8_t *p_data, int i_data);
+static void httpd_StreamChunkRelease(httpd_stream_chunk_t *chunk);
 
-/* each host run in his own thread */
+/* each worker runs in its own thread and serves a share of the clients */
+typedef struct
+{
+    httpd_host_t *host;
+    vlc_thread_t thread;
+    vlc_interrupt_t *interrupt; /* wakes the worker up for new clients */
+    vlc_mutex_t  lock; /* protects the client table */
+
+    int            i_client;
+    httpd_client_t **client;
+    atomic_uint    i_load; /* i_client, readable without the lock */
+} httpd_worker_t;
+
+/* each host runs its own pool of worker threads */
 struct httpd_host_t
 {
     VLC_COMMON_MEMBERS
@@ -79,10 +107,12 @@ struct httpd_host_t
     unsigned     nfd;
     unsigned     port;
 
-    vlc_thread_t thread;
     vlc_mutex_t lock;
     vlc_cond_t  wait;
 
+    unsigned        i_worker;
+    httpd_worker_t *worker; /* the first one accepts the connections */
+
     /* all registered url (becarefull that 2 httpd_url_t could point at the same url)
      * This will slow down the url research but make my live easier
      * All url will have their cb trigger, but only the first one can answer
@@ -90,9 +120,6 @@ struct httpd_host_t
     int         i_url;
     httpd_url_t **url;
 
-    int            i_client;
-    httpd_client_t **client;
-
     /* TLS data */
     vlc_tls_creds_t *p_tls;
 };
@@ -169,6 +196,16 @@ struct httpd_client_t
     httpd_message_t query;  /* client -> httpd */
     httpd_message_t answer; /* httpd -> client */
 
+    /* stream data, shared with the other clients of the stream */
+    httpd_stream_chunk_t *chunk[HTTPD_CL_IOV];
+    unsigned i_chunk;
+    size_t   i_chunk_offset; /* bytes of chunk[0] already sent */
+
+    /* body sent straight from a file, see httpd_FilePathNew() */
+    int      i_file_fd;
+    uint64_t i_file_offset;
+    uint64_t i_file_remain;
+
     /* TLS data */
     vlc_tls_t *p_tls;
 };
@@ -302,6 +339,7 @@ struct httpd_file_t
     httpd_url_t *url;
     httpd_file_callback_t pf_fill;
     httpd_file_sys_t      *p_sys;
+    char *path; /* file-backed URL, or NULL */
     char mime[1];
 };
 
@@ -379,6 +417,7 @@ httpd_file_t *httpd_FileNew(httpd_host_t *host,
 
     file->pf_fill = pf_fill;
     file->p_sys   = p_sys;
+    file->path    = NULL;
     memcpy(file->mime, mime, mimelen + 1);
 
     httpd_UrlCatch(file->url, HTTPD_MSG_HEAD, httpd_FileCallBack,
@@ -396,10 +435,166 @@ httpd_file_sys_t *httpd_FileDelete(httpd_file_t *file)
     httpd_file_sys_t *p_sys = file->p_sys;
 
     httpd_UrlDelete(file->url);
+    free(file->path);
     free(file);
     return p_sys;
 }
 
+/* Parses a single "bytes=" range. Returns 1 if the range can be served,
+ * -1 if it cannot be satisfied, or 0 if the header must be ignored: invalid
+ * syntax, other units or multiple ranges (RFC 7233 sections 2.1 and 3.1). */
+static int httpd_ParseRange(const char *range, uint64_t size,
+                            uint64_t *restrict start, uint64_t *restrict end)
+{
+    unsigned long long a, b = ULLONG_MAX;
+    char *p;
+
+    if (strncasecmp(range, "bytes=", 6) || strchr(range, ',') != NULL)
+        return 0;
+    range += 6;
+
+    if (*range == '-') {
+        /* suffix: last a bytes */
+        if (!isdigit((unsigned char)range[1]))
+            return 0;
+        a = strtoull(range + 1, &p, 10);
+        if (*p != '\0')
+            return 0;
+        if (a == 0 || size == 0)
+            return -1;
+        *start = (a < size) ? size - a : 0;
+        *end = size - 1;
+        return 1;
+    }
+
+    if (!isdigit((unsigned char)*range))
+        return 0;
+    a = strtoull(range, &p, 10);
+    if (*(p++) != '-')
+        return 0;
+    if (*p != '\0') {
+        if (!isdigit((unsigned char)*p))
+            return 0;
+        b = strtoull(p, &p, 10);
+        if (*p != '\0' || b < a)
+            return 0;
+    }
+
+    if (a >= size)
+        return -1;
+    *start = a;
+    *end = (b < size - 1) ? b : size - 1;
+    return 1;
+}
+
+static int
+httpd_FilePathCallBack(httpd_callback_sys_t *p_sys, httpd_client_t *cl,
+                       httpd_message_t *answer, const httpd_message_t *query)
+{
+    httpd_file_t *file = (httpd_file_t*)p_sys;
+    struct stat st;
+
+    if (!answer || !query)
+        return VLC_SUCCESS;
+
+    answer->i_proto  = HTTPD_PROTO_HTTP;
+    answer->i_version= 1;
+    answer->i_type   = HTTPD_MSG_ANSWER;
+
+    int fd = vlc_open(file->path, O_RDONLY);
+    if (fd == -1 || fstat(fd, &st) || !S_ISREG(st.st_mode)) {
+        char *p;
+
+        if (fd != -1)
+            close(fd);
+        answer->i_status = 404;
+        answer->i_body = httpd_HtmlError(&p, 404, query->psz_url);
+        answer->p_body = (uint8_t *)p;
+        httpd_MsgAdd(answer, "Content-Type", "%s", "text/html");
+        httpd_MsgAdd(answer, "Content-Length", "%d", answer->i_body);
+        return VLC_SUCCESS;
+    }
+
+    uint64_t size = st.st_size, start = 0, end = size - 1;
+    const char *range = httpd_MsgGet(query, "Range");
+
+    httpd_MsgAdd(answer, "Content-type",  "%s", file->mime);
+    httpd_MsgAdd(answer, "Accept-Ranges", "bytes");
+
+    int val = (range != NULL) ? httpd_ParseRange(range, size, &start, &end)
+                              : 0;
+    if (val < 0) {
+        close(fd);
+        answer->i_status = 416;
+        httpd_MsgAdd(answer, "Content-Range", "bytes */%"PRIu64, size);
+        httpd_MsgAdd(answer, "Content-Length", "0");
+        return VLC_SUCCESS;
+    }
+    if (val > 0) {
+        answer->i_status = 206;
+        httpd_MsgAdd(answer, "Content-Range", "bytes %"PRIu64"-%"PRIu64
+                     "/%"PRIu64, start, end, size);
+    } else
+        answer->i_status = 200;
+
+    uint64_t length = (size > 0) ? end - start + 1 : 0;
+    httpd_MsgAdd(answer, "Content-Length", "%"PRIu64, length);
+
+    if (query->i_type == HTTPD_MSG_HEAD || length == 0) {
+        close(fd);
+        return VLC_SUCCESS;
+    }
+
+    /* The body is sent by httpd_ClientSendFile() once the header is out */
+    cl->i_file_fd = fd;
+    cl->i_file_offset = start;
+    cl->i_file_remain = length;
+    return VLC_SUCCESS;
+}
+
+/**
+ * Serves a regular file from the file system. The body is sent directly
+ * from the file (with sendfile() where available) and byte ranges are
+ * supported.
+ */
+httpd_file_t *httpd_FilePathNew(httpd_host_t *host, const char *psz_url,
+                                const char *psz_mime, const char *psz_user,
+                                const char *psz_password, const char *psz_path)
+{
+    const char *mime = psz_mime;
+    if (mime == NULL || mime[0] == '\0')
+        mime = vlc_mime_Ext2Mime(psz_path);
+
+    size_t mimelen = strlen(mime);
+    httpd_file_t *file = malloc(sizeof(*file) + mimelen);
+    if (unlikely(file == NULL))
+        return NULL;
+
+    file->path = strdup(psz_path);
+    if (unlikely(file->path == NULL)) {
+        free(file);
+        return NULL;
+    }
+
+    file->url = httpd_UrlNew(host, psz_url, psz_user, psz_password);
+    if (!file->url) {
+        free(file->path);
+        free(file);
+        return NULL;
+    }
+
+    file->pf_fill = NULL;
+    file->p_sys   = NULL;
+    memcpy(file->mime, mime, mimelen + 1);
+
+    httpd_UrlCatch(file->url, HTTPD_MSG_HEAD, httpd_FilePathCallBack,
+                    (httpd_callback_sys_t*)file);
+    httpd_UrlCatch(file->url, HTTPD_MSG_GET,  httpd_FilePathCallBack,
+                    (httpd_callback_sys_t*)file);
+
+    return file;
+}
+
 /*****************************************************************************
  * High Level Functions: httpd_handler_t (for CGIs)
  *****************************************************************************/
@@ -611,9 +806,13 @@ struct httpd_stream_t
     bool        b_has_keyframes;
     int64_t     i_last_keyframe_seen_pos;
 
-    /* circular buffer */
-    int         i_buffer_size;      /* buffer size, can't be reallocated smaller */
-    uint8_t     *p_buffer;          /* buffer */
+    /* ring of shared data chunks, oldest first */
+    size_t      i_buffer_size;      /* maximum bytes kept in the ring */
+    size_t      i_buffer_bytes;     /* bytes currently in the ring */
+    httpd_stream_chunk_t **pp_chunk;
+    unsigned    i_chunk_max;        /* allocated ring slots */
+    unsigned    i_chunk_first;      /* slot of the oldest chunk */
+    unsigned    i_chunk;            /* number of chunks */
     int64_t     i_buffer_pos;       /* absolute position from begining */
     int64_t     i_buffer_last_pos;  /* a new connection will start with that */
 
@@ -622,6 +821,83 @@ struct httpd_stream_t
     httpd_header * p_http_headers;
 };
 
+/* Data sent by httpd_StreamSend(), referenced by the stream ring and by
+ * the clients still writing it out. It is never modified once queued. */
+struct httpd_stream_chunk_t
+{
+    atomic_uint refs;
+    int64_t     i_pos;  /* absolute stream position of the first byte */
+    size_t      i_size;
+    uint8_t     p_data[];
+};
+
+static httpd_stream_chunk_t *httpd_StreamChunkNew(int64_t pos,
+                                                  const uint8_t *data,
+                                                  size_t size)
+{
+    httpd_stream_chunk_t *chunk = malloc(sizeof (*chunk) + size);
+    if (unlikely(chunk == NULL))
+        return NULL;
+
+    atomic_init(&chunk->refs, 1);
+    chunk->i_pos = pos;
+    chunk->i_size = size;
+    memcpy(chunk->p_data, data, size);
+    return chunk;
+}
+
+static httpd_stream_chunk_t *httpd_StreamChunkHold(httpd_stream_chunk_t *chunk)
+{
+    atomic_fetch_add(&chunk->refs, 1);
+    return chunk;
+}
+
+static void httpd_StreamChunkRelease(httpd_stream_chunk_t *chunk)
+{
+    if (atomic_fetch_sub(&chunk->refs, 1) == 1)
+        free(chunk);
+}
+
+static httpd_stream_chunk_t *httpd_StreamChunkAt(const httpd_stream_t *stream,
+                                                 unsigned i)
+{
+    return stream->pp_chunk[(stream->i_chunk_first + i) % stream->i_chunk_max];
+}
+
+/* Drops the oldest chunks until the ring fits in the buffer size */
+static void httpd_StreamTrim(httpd_stream_t *stream, size_t i_extra)
+{
+    while (stream->i_chunk > 0
+        && stream->i_buffer_bytes + i_extra > stream->i_buffer_size) {
+        httpd_stream_chunk_t *chunk = httpd_StreamChunkAt(stream, 0);
+
+        stream->i_buffer_bytes -= chunk->i_size;
+        stream->i_chunk_first = (stream->i_chunk_first + 1)
+                                % stream->i_chunk_max;
+        stream->i_chunk--;
+        httpd_StreamChunkRelease(chunk);
+    }
+}
+
+/* Finds the chunk containing the given absolute position (binary search) */
+static int httpd_StreamFind(const httpd_stream_t *stream, int64_t i_pos)
+{
+    unsigned lo = 0, hi = stream->i_chunk;
+
+    if (hi == 0 || i_pos < httpd_StreamChunkAt(stream, 0)->i_pos)
+        return -1;
+
+    while (hi - lo > 1) {
+        unsigned mid = (lo + hi) / 2;
+
+        if (httpd_StreamChunkAt(stream, mid)->i_pos <= i_pos)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
 static int httpd_StreamCallBack(httpd_callback_sys_t *p_sys,
                                  httpd_client_t *cl, httpd_message_t *answer,
                                  const httpd_message_t *query)
@@ -632,46 +908,55 @@ static int httpd_StreamCallBack(httpd_callback_sys_t *p_sys,
         return VLC_SUCCESS;
 
     if (answer->i_body_offset > 0) {
-        int     i_pos;
-
-        if (answer->i_body_offset >= stream->i_buffer_pos)
+        /* Several host workers may be reading concurrently */
+        vlc_mutex_lock(&stream->lock);
+        if (answer->i_body_offset >= stream->i_buffer_pos) {
+            vlc_mutex_unlock(&stream->lock);
             return VLC_EGENERIC;    /* wait, no data available */
+        }
 
         if (cl->i_keyframe_wait_to_pass >= 0) {
-            if (stream->i_last_keyframe_seen_pos <= cl->i_keyframe_wait_to_pass)
+            if (stream->i_last_keyframe_seen_pos <= cl->i_keyframe_wait_to_pass) {
                 /* still waiting for the next keyframe */
+                vlc_mutex_unlock(&stream->lock);
                 return VLC_EGENERIC;
+            }
 
             /* seek to the new keyframe */
             answer->i_body_offset = stream->i_last_keyframe_seen_pos;
             cl->i_keyframe_wait_to_pass = -1;
         }
 
-        if (answer->i_body_offset + stream->i_buffer_size < stream->i_buffer_pos)
-            answer->i_body_offset = stream->i_buffer_last_pos; /* this client isn't fast enough */
-
-        i_pos   = answer->i_body_offset % stream->i_buffer_size;
-        int64_t i_write = stream->i_buffer_pos - answer->i_body_offset;
-
-        if (i_write > HTTPD_CL_BUFSIZE)
-            i_write = HTTPD_CL_BUFSIZE;
-        else if (i_write <= 0)
-            return VLC_EGENERIC;    /* wait, no data available */
+        int i_first = httpd_StreamFind(stream, answer->i_body_offset);
+        if (i_first < 0) {
+            /* this client isn't fast enough */
+            answer->i_body_offset = stream->i_buffer_last_pos;
+            i_first = httpd_StreamFind(stream, answer->i_body_offset);
+            if (i_first < 0) {
+                vlc_mutex_unlock(&stream->lock);
+                return VLC_EGENERIC;
+            }
+        }
 
-        /* Don't go past the end of the circular buffer */
-        i_write = __MIN(i_write, stream->i_buffer_size - i_pos);
+        /* Hand references to the shared chunks over to the client: the
+         * data is written straight from them, without any copy. */
+        assert(cl->i_chunk == 0);
+        cl->i_chunk_offset = answer->i_body_offset
+                           - httpd_StreamChunkAt(stream, i_first)->i_pos;
+        for (unsigned i = i_first;
+             i < stream->i_chunk && cl->i_chunk < HTTPD_CL_IOV; i++)
+            cl->chunk[cl->i_chunk++] =
+                httpd_StreamChunkHold(httpd_StreamChunkAt(stream, i));
+
+        httpd_stream_chunk_t *last = cl->chunk[cl->i_chunk - 1];
+        answer->i_body_offset = last->i_pos + last->i_size;
+        vlc_mutex_unlock(&stream->lock);
 
         /* using HTTPD_MSG_ANSWER -> data available */
         answer->i_proto  = HTTPD_PROTO_HTTP;
         answer->i_version= 0;
         answer->i_type   = HTTPD_MSG_ANSWER;
 
-        answer->i_body = i_write;
-        answer->p_body = xmalloc(i_write);
-        memcpy(answer->p_body, &stream->p_buffer[i_pos], i_write);
-
-        answer->i_body_offset += i_write;
-
         return VLC_SUCCESS;
     } else {
         answer->i_proto  = HTTPD_PROTO_HTTP;
@@ -765,8 +1050,12 @@ httpd_stream_t *httpd_StreamNew(httpd_host_t *host,
 
     stream->i_header = 0;
     stream->p_header = NULL;
-    stream->i_buffer_size = 5000000;    /* 5 Mo per stream */
-    stream->p_buffer = xmalloc(stream->i_buffer_size);
+    stream->i_buffer_size = 5000000;    /* 5 Mo per stream by default */
+    stream->i_buffer_bytes = 0;
+    stream->pp_chunk = NULL;
+    stream->i_chunk_max = 0;
+    stream->i_chunk_first = 0;
+    stream->i_chunk = 0;
     /* We set to 1 to make life simpler
      * (this way i_body_offset can never be 0) */
     stream->i_buffer_pos = 1;
@@ -802,31 +1091,62 @@ int httpd_StreamHeader(httpd_stream_t *stream, uint8_t *p_data, int i_data)
     return VLC_SUCCESS;
 }
 
-static void httpd_AppendData(httpd_stream_t *stream, uint8_t *p_data, int i_data)
+/**
+ * Sets how many bytes of past data the stream keeps for its clients.
+ * Clients lagging further behind skip ahead to the most recent data.
+ */
+int httpd_StreamSetBufferSize(httpd_stream_t *stream, size_t i_size)
 {
-    int i_pos = stream->i_buffer_pos % stream->i_buffer_size;
-    int i_count = i_data;
-    while (i_count > 0) {
-        int i_copy = __MIN(i_count, stream->i_buffer_size - i_pos);
-
-        /* Ok, we can't go past the end of our buffer */
-        memcpy(&stream->p_buffer[i_pos], p_data, i_copy);
-
-        i_pos = (i_pos + i_copy) % stream->i_buffer_size;
-        i_count -= i_copy;
-        p_data  += i_copy;
-    }
+    if (i_size == 0)
+        return VLC_EGENERIC;
 
-    stream->i_buffer_pos += i_data;
+    vlc_mutex_lock(&stream->lock);
+    stream->i_buffer_size = i_size;
+    httpd_StreamTrim(stream, 0);
+    vlc_mutex_unlock(&stream->lock);
+    return VLC_SUCCESS;
 }
 
 int httpd_StreamSend(httpd_stream_t *stream, const block_t *p_block)
 {
-    if (!p_block || !p_block->p_buffer)
+    if (!p_block || !p_block->p_buffer || p_block->i_buffer == 0)
         return VLC_SUCCESS;
 
     vlc_mutex_lock(&stream->lock);
 
+    httpd_stream_chunk_t *chunk = httpd_StreamChunkNew(stream->i_buffer_pos,
+                                                       p_block->p_buffer,
+                                                       p_block->i_buffer);
+    if (unlikely(chunk == NULL)) {
+        vlc_mutex_unlock(&stream->lock);
+        return VLC_ENOMEM;
+    }
+
+    httpd_StreamTrim(stream, chunk->i_size);
+
+    if (stream->i_chunk == stream->i_chunk_max) {
+        /* grow the ring, unwrapping it at the same time */
+        unsigned i_max = stream->i_chunk_max ? 2 * stream->i_chunk_max : 64;
+        httpd_stream_chunk_t **pp = malloc(i_max * sizeof (*pp));
+
+        if (unlikely(pp == NULL)) {
+            vlc_mutex_unlock(&stream->lock);
+            httpd_StreamChunkRelease(chunk);
+            return VLC_ENOMEM;
+        }
+        for (unsigned i = 0; i < stream->i_chunk; i++)
+            pp[i] = httpd_StreamChunkAt(stream, i);
+        free(stream->pp_chunk);
+        stream->pp_chunk = pp;
+        stream->i_chunk_max = i_max;
+        stream->i_chunk_first = 0;
+    }
+
+    stream->pp_chunk[(stream->i_chunk_first + stream->i_chunk)
+                     % stream->i_chunk_max] = chunk;
+    stream->i_chunk++;
+    stream->i_buffer_bytes += chunk->i_size;
+
     /* save this pointer (to be used by new connection) */
     stream->i_buffer_last_pos = stream->i_buffer_pos;
 
@@ -835,7 +1155,7 @@ int httpd_StreamSend(httpd_stream_t *stream, const block_t *p_block)
         stream->i_last_keyframe_seen_pos = stream->i_buffer_pos;
     }
 
-    httpd_AppendData(stream, p_block->p_buffer, p_block->i_buffer);
+    stream->i_buffer_pos += chunk->i_size;
 
     vlc_mutex_unlock(&stream->lock);
     return VLC_SUCCESS;
@@ -852,14 +1172,16 @@ void httpd_StreamDelete(httpd_stream_t *stream)
     vlc_mutex_destroy(&stream->lock);
     free(stream->psz_mime);
     free(stream->p_header);
-    free(stream->p_buffer);
+    for (unsigned i = 0; i < stream->i_chunk; i++)
+        httpd_StreamChunkRelease(httpd_StreamChunkAt(stream, i));
+    free(stream->pp_chunk);
     free(stream);
 }
 
 /*****************************************************************************
  * Low level
  *****************************************************************************/
-static void* httpd_HostThread(void *);
+static void* httpd_WorkerThread(void *);
 static httpd_host_t *httpd_HostCreate(vlc_object_t *, const char *,
                                        const char *, vlc_tls_creds_t *);
 
@@ -970,16 +1292,47 @@ static httpd_host_t *httpd_HostCreate(vlc_object_t *p_this,
     host->port     = port;
     host->i_url    = 0;
     host->url      = NULL;
-    host->i_client = 0;
-    host->client   = NULL;
     host->p_tls    = p_tls;
 
-    /* create the thread */
-    if (vlc_clone(&host->thread, httpd_HostThread, host,
-                   VLC_THREAD_PRIORITY_LOW)) {
+    unsigned i_worker = var_InheritInteger(p_this, "http-threads");
+    if (i_worker == 0)
+        i_worker = 1;
+    host->worker = malloc(i_worker * sizeof (*host->worker));
+    if (unlikely(host->worker == NULL))
+        goto error;
+
+    /* create the threads. They wait for the host lock before they use the
+     * worker table, so the number of workers is final by then. */
+    vlc_mutex_lock(&host->lock);
+    for (host->i_worker = 0; host->i_worker < i_worker; host->i_worker++) {
+        httpd_worker_t *worker = &host->worker[host->i_worker];
+
+        worker->host = host;
+        worker->i_client = 0;
+        worker->client = NULL;
+        atomic_init(&worker->i_load, 0);
+        worker->interrupt = vlc_interrupt_create();
+        if (unlikely(worker->interrupt == NULL))
+            break;
+        vlc_mutex_init(&worker->lock);
+
+        if (vlc_clone(&worker->thread, httpd_WorkerThread, worker,
+                       VLC_THREAD_PRIORITY_LOW)) {
+            vlc_mutex_destroy(&worker->lock);
+            vlc_interrupt_destroy(worker->interrupt);
+            break;
+        }
+    }
+    vlc_mutex_unlock(&host->lock);
+
+    if (host->i_worker == 0) {
         msg_Err(p_this, "cannot spawn http host thread");
+        free(host->worker);
         goto error;
     }
+    if (host->i_worker < i_worker)
+        msg_Warn(p_this, "only %u of %u http host threads started",
+                 host->i_worker, i_worker);
 
     /* now add it to httpd */
     TAB_APPEND(httpd.i_host, httpd.host, host);
@@ -1024,23 +1377,31 @@ void httpd_HostDelete(httpd_host_t *host)
     }
     TAB_REMOVE(httpd.i_host, httpd.host, host);
 
-    vlc_cancel(host->thread);
-    vlc_join(host->thread, NULL);
+    for (unsigned i = 0; i < host->i_worker; i++)
+        vlc_cancel(host->worker[i].thread);
+    for (unsigned i = 0; i < host->i_worker; i++)
+        vlc_join(host->worker[i].thread, NULL);
 
     msg_Dbg(host, "HTTP host removed");
 
     for (int i = 0; i < host->i_url; i++)
         msg_Err(host, "url still registered: %s", host->url[i]->psz_url);
 
-    for (int i = 0; i < host->i_client; i++) {
-        httpd_client_t *cl = host->client[i];
-        msg_Warn(host, "client still connected");
-        httpd_ClientClean(cl);
-        TAB_REMOVE(host->i_client, host->client, cl);
-        free(cl);
-        i--;
-        /* TODO */
+    for (unsigned i = 0; i < host->i_worker; i++) {
+        httpd_worker_t *worker = &host->worker[i];
+
+        for (int j = 0; j < worker->i_client; j++) {
+            httpd_client_t *cl = worker->client[j];
+            msg_Warn(host, "client still connected");
+            httpd_ClientClean(cl);
+            free(cl);
+            /* TODO */
+        }
+        free(worker->client);
+        vlc_mutex_destroy(&worker->lock);
+        vlc_interrupt_destroy(worker->interrupt);
     }
+    free(host->worker);
 
     vlc_tls_Delete(host->p_tls);
     net_ListenClose(host->fds);
@@ -1104,27 +1465,36 @@ void httpd_UrlDelete(httpd_url_t *url)
 
     vlc_mutex_lock(&host->lock);
     TAB_REMOVE(host->i_url, host->url, url);
+    vlc_mutex_unlock(&host->lock);
+
+    /* Workers only use the URL with their own lock held. Once every worker
+     * has been visited, nobody can be using it anymore. */
+    for (unsigned i = 0; i < host->i_worker; i++) {
+        httpd_worker_t *worker = &host->worker[i];
+
+        vlc_mutex_lock(&worker->lock);
+        for (int j = 0; j < worker->i_client; j++) {
+            httpd_client_t *client = worker->client[j];
+
+            if (client->url != url)
+                continue;
+
+            /* TODO complete it */
+            msg_Warn(host, "force closing connections");
+            httpd_ClientClean(client);
+            TAB_REMOVE(worker->i_client, worker->client, client);
+            atomic_fetch_sub(&worker->i_load, 1);
+            free(client);
+            j--;
+        }
+        vlc_mutex_unlock(&worker->lock);
+    }
 
     vlc_mutex_destroy(&url->lock);
     free(url->psz_url);
     free(url->psz_user);
     free(url->psz_password);
-
-    for (int i = 0; i < host->i_client; i++) {
-        httpd_client_t *client = host->client[i];
-
-        if (client->url != url)
-            continue;
-
-        /* TODO complete it */
-        msg_Warn(host, "force closing connections");
-        httpd_ClientClean(client);
-        TAB_REMOVE(host->i_client, host->client, client);
-        free(client);
-        i--;
-    }
     free(url);
-    vlc_mutex_unlock(&host->lock);
 }
 
 static void httpd_MsgInit(httpd_message_t *msg)
@@ -1206,6 +1576,9 @@ static void httpd_ClientInit(httpd_client_t *cl, mtime_t now)
     cl->p_buffer = xmalloc(cl->i_buffer_size);
     cl->i_keyframe_wait_to_pass = -1;
     cl->b_stream_mode = false;
+    cl->i_chunk = 0;
+    cl->i_chunk_offset = 0;
+    cl->i_file_fd = -1;
 
     httpd_MsgInit(&cl->query);
     httpd_MsgInit(&cl->answer);
@@ -1233,6 +1606,15 @@ static void httpd_ClientClean(httpd_client_t *cl)
     httpd_MsgClean(&cl->answer);
     httpd_MsgClean(&cl->query);
 
+    for (unsigned i = 0; i < cl->i_chunk; i++)
+        httpd_StreamChunkRelease(cl->chunk[i]);
+    cl->i_chunk = 0;
+
+    if (cl->i_file_fd != -1) {
+        close(cl->i_file_fd);
+        cl->i_file_fd = -1;
+    }
+
     free(cl->p_buffer);
     cl->p_buffer = NULL;
 }
@@ -1587,10 +1969,163 @@ static void httpd_ClientRecv(httpd_client_t *cl)
         cl->i_activity_timeout = 0;
 }
 
+/* Writes out as much of the held stream chunks as possible */
+static ssize_t httpd_NetSendChunks(httpd_client_t *cl)
+{
+    struct iovec iov[HTTPD_CL_IOV];
+
+    for (unsigned i = 0; i < cl->i_chunk; i++) {
+        iov[i].iov_base = cl->chunk[i]->p_data;
+        iov[i].iov_len = cl->chunk[i]->i_size;
+    }
+    iov[0].iov_base = (uint8_t *)iov[0].iov_base + cl->i_chunk_offset;
+    iov[0].iov_len -= cl->i_chunk_offset;
+
+#ifndef _WIN32
+    if (cl->p_tls == NULL) {
+        struct msghdr hdr = {
+            .msg_iov = iov,
+            .msg_iovlen = cl->i_chunk,
+        };
+        ssize_t val;
+
+        do
+            val = sendmsg(cl->fd, &hdr, MSG_NOSIGNAL);
+        while (val == -1 && errno == EINTR);
+        return val;
+    }
+#endif
+    return httpd_NetSend(cl, iov[0].iov_base, iov[0].iov_len);
+}
+
+/* Asks the URL of the client for more body data. Only the stream callback
+ * may run on several workers at once. The other callbacks (files, handlers,
+ * redirects and those of the modules) were written for a single host thread
+ * and are still serialized by the host lock. */
+static void httpd_ClientCatch(httpd_client_t *cl)
+{
+    httpd_url_t *url = cl->url;
+    int i_msg = cl->query.i_type;
+
+    if (url->catch[i_msg].cb == httpd_StreamCallBack) {
+        httpd_StreamCallBack(url->catch[i_msg].p_sys, cl, &cl->answer,
+                             &cl->query);
+        return;
+    }
+
+    vlc_mutex_lock(&url->host->lock);
+    url->catch[i_msg].cb(url->catch[i_msg].p_sys, cl, &cl->answer,
+                         &cl->query);
+    vlc_mutex_unlock(&url->host->lock);
+}
+
+static void httpd_ClientSendChunks(httpd_client_t *cl)
+{
+    ssize_t i_len = httpd_NetSendChunks(cl);
+
+    if (i_len <= 0) {
+#if defined(_WIN32)
+        if ((i_len < 0 && WSAGetLastError() != WSAEWOULDBLOCK) || (i_len == 0))
+#else
+        if ((i_len < 0 && errno != EAGAIN) || (i_len == 0))
+#endif
+            cl->i_state = HTTPD_CLIENT_DEAD;
+        return;
+    }
+
+    /* release the chunks that were sent completely */
+    size_t i_done = cl->i_chunk_offset + i_len;
+    unsigned i_sent = 0;
+
+    while (i_sent < cl->i_chunk && i_done >= cl->chunk[i_sent]->i_size) {
+        i_done -= cl->chunk[i_sent]->i_size;
+        httpd_StreamChunkRelease(cl->chunk[i_sent]);
+        i_sent++;
+    }
+    memmove(cl->chunk, cl->chunk + i_sent,
+            (cl->i_chunk - i_sent) * sizeof (cl->chunk[0]));
+    cl->i_chunk -= i_sent;
+    cl->i_chunk_offset = i_done;
+
+    if (cl->i_chunk == 0) {
+        /* catch more body data */
+        int64_t i_offset = cl->answer.i_body_offset;
+
+        httpd_MsgClean(&cl->answer);
+        cl->answer.i_body_offset = i_offset;
+
+        httpd_ClientCatch(cl);
+        if (cl->i_chunk == 0)
+            cl->i_state = HTTPD_CLIENT_SEND_DONE;
+    }
+}
+
+/* Sends the next part of a file body. Returns true if the data went straight
+ * to the socket, false if it was read into the client buffer instead. */
+static bool httpd_ClientSendFile(httpd_client_t *cl)
+{
+#ifdef HAVE_SENDFILE
+    if (cl->p_tls == NULL) {
+        off_t offset = cl->i_file_offset;
+        size_t len = __MIN(cl->i_file_remain, 1 << 20);
+        ssize_t val = sendfile(cl->fd, cl->i_file_fd, &offset, len);
+
+        if (val > 0) {
+            cl->i_file_offset += val;
+            cl->i_file_remain -= val;
+        } else if (val == 0 || (errno != EAGAIN && errno != EINTR)) {
+            cl->i_state = HTTPD_CLIENT_DEAD; /* truncated file or error */
+            return true;
+        }
+
+        if (cl->i_file_remain == 0) {
+            close(cl->i_file_fd);
+            cl->i_file_fd = -1;
+            cl->i_state = HTTPD_CLIENT_SEND_DONE;
+        }
+        return true;
+    }
+#endif
+    /* Copy through the client buffer (TLS or no sendfile()) */
+    size_t len = __MIN(cl->i_file_remain, HTTPD_CL_BUFSIZE);
+
+    if (cl->p_buffer == NULL || (size_t)cl->i_buffer_size < len) {
+        free(cl->p_buffer);
+        cl->p_buffer = xmalloc(HTTPD_CL_BUFSIZE);
+    }
+
+    ssize_t val = -1;
+    if (lseek(cl->i_file_fd, cl->i_file_offset, SEEK_SET) != (off_t)-1)
+        val = read(cl->i_file_fd, cl->p_buffer, len);
+    if (val <= 0) {
+        cl->i_state = HTTPD_CLIENT_DEAD;
+        return true;
+    }
+
+    cl->i_buffer = 0;
+    cl->i_buffer_size = val;
+    cl->i_file_offset += val;
+    cl->i_file_remain -= val;
+    if (cl->i_file_remain == 0) {
+        close(cl->i_file_fd);
+        cl->i_file_fd = -1;
+    }
+    return false;
+}
+
 static void httpd_ClientSend(httpd_client_t *cl)
 {
     int i_len;
 
+    if (cl->i_chunk > 0) {
+        httpd_ClientSendChunks(cl);
+        return;
+    }
+
+    if (cl->i_file_fd != -1 && cl->i_buffer >= cl->i_buffer_size
+     && httpd_ClientSendFile(cl))
+        return;
+
     if (cl->i_buffer < 0) {
         /* We need to create the header */
         int i_size = 0;
@@ -1630,14 +2165,12 @@ static void httpd_ClientSend(httpd_client_t *cl)
         if (cl->i_buffer >= cl->i_buffer_size) {
             if (cl->answer.i_body == 0  && cl->answer.i_body_offset > 0) {
                 /* catch more body data */
-                int     i_msg = cl->query.i_type;
                 int64_t i_offset = cl->answer.i_body_offset;
 
                 httpd_MsgClean(&cl->answer);
                 cl->answer.i_body_offset = i_offset;
 
-                cl->url->catch[i_msg].cb(cl->url->catch[i_msg].p_sys, cl,
-                                          &cl->answer, &cl->query);
+                httpd_ClientCatch(cl);
             }
 
             if (cl->answer.i_body > 0) {
@@ -1649,6 +2182,14 @@ static void httpd_ClientSend(httpd_client_t *cl)
 
                 cl->answer.i_body = 0;
                 cl->answer.p_body = NULL;
+            } else if (cl->i_chunk > 0) {
+                /* send the shared stream data on the next round */
+                free(cl->p_buffer);
+                cl->p_buffer = NULL;
+                cl->i_buffer_size = 0;
+                cl->i_buffer = 0;
+            } else if (cl->i_file_fd != -1) {
+                /* send the file body on the next round */
             } else /* send finished */
                 cl->i_state = HTTPD_CLIENT_SEND_DONE;
         }
@@ -1716,36 +2257,72 @@ auth_failed:
     return false;
 }
 
-static void httpdLoop(httpd_host_t *host)
+/* Gives a new client to the worker with the fewest clients */
+static void httpd_WorkerAdd(httpd_host_t *host, httpd_client_t *cl)
 {
-    struct pollfd ufd[host->nfd + host->i_client];
-    unsigned nfd;
-    for (nfd = 0; nfd < host->nfd; nfd++) {
-        ufd[nfd].fd = host->fds[nfd];
-        ufd[nfd].events = POLLIN;
-        ufd[nfd].revents = 0;
+    httpd_worker_t *worker = &host->worker[0];
+    unsigned i_load = atomic_load(&worker->i_load);
+
+    for (unsigned i = 1; i < host->i_worker && i_load > 0; i++) {
+        unsigned i_other = atomic_load(&host->worker[i].i_load);
+
+        if (i_other < i_load) {
+            worker = &host->worker[i];
+            i_load = i_other;
+        }
     }
 
-    /* add all socket that should be read/write and close dead connection */
+    vlc_mutex_lock(&worker->lock);
+    TAB_APPEND(worker->i_client, worker->client, cl);
+    atomic_fetch_add(&worker->i_load, 1);
+    vlc_mutex_unlock(&worker->lock);
+
+    if (worker != &host->worker[0])
+        vlc_interrupt_raise(worker->interrupt);
+}
+
+static void httpdLoop(httpd_worker_t *worker)
+{
+    httpd_host_t *host = worker->host;
+
+    vlc_mutex_lock(&host->lock);
     while (host->i_url <= 0) {
         mutex_cleanup_push(&host->lock);
         vlc_cond_wait(&host->wait, &host->lock);
         vlc_cleanup_pop();
     }
+    vlc_mutex_unlock(&host->lock);
+
+    int canc = vlc_savecancel();
+    vlc_mutex_lock(&worker->lock);
+
+    /* Only the first worker listens, so that a new connection does not
+     * wake every worker up. It hands the client over to the least busy
+     * worker. */
+    const unsigned i_listen = (worker == &host->worker[0]) ? host->nfd : 0;
+
+    struct pollfd ufd[i_listen + worker->i_client];
+    unsigned nfd;
+    for (nfd = 0; nfd < i_listen; nfd++) {
+        ufd[nfd].fd = host->fds[nfd];
+        ufd[nfd].events = POLLIN;
+        ufd[nfd].revents = 0;
+    }
 
     mtime_t now = mdate();
     bool b_low_delay = false;
 
-    int canc = vlc_savecancel();
-    for (int i_client = 0; i_client < host->i_client; i_client++) {
+    /* add all socket that should be read/write and close dead connection */
+    for (int i_client = 0; i_client < worker->i_client; i_client++) {
         int64_t i_offset;
-        httpd_client_t *cl = host->client[i_client];
+        httpd_client_t *cl = worker->client[i_client];
         if (cl->i_ref < 0 || (cl->i_ref == 0 &&
                     (cl->i_state == HTTPD_CLIENT_DEAD ||
                       (cl->i_activity_timeout > 0 &&
                         cl->i_activity_date+cl->i_activity_timeout < now)))) {
             httpd_ClientClean(cl);
-            TAB_REMOVE(host->i_client, host->client, cl);
+            TAB_REMOVE(worker->i_client, worker->client, cl);
+            atomic_fetch_sub(&worker->i_load, 1);
             free(cl);
             i_client--;
             continue;
@@ -1848,7 +2425,10 @@ static void httpdLoop(httpd_host_t *host)
                         int i_msg = query->i_type;
                         bool b_auth_failed = false;
 
-                        /* Search the url and trigger callbacks */
+                        /* Search the url and trigger callbacks.
+                         * Request callbacks are serialized by the host lock,
+                         * see also httpd_ClientCatch(). */
+                        vlc_mutex_lock(&host->lock);
                         for (int i = 0; i < host->i_url; i++) {
                             httpd_url_t *url = host->url[i];
 
@@ -1878,6 +2458,7 @@ static void httpdLoop(httpd_host_t *host)
                             if (!cl->url)
                                 cl->url = url;
                         }
+                        vlc_mutex_unlock(&host->lock);
 
                         if (answer) {
                             answer->i_proto  = query->i_proto;
@@ -1956,13 +2537,11 @@ static void httpdLoop(httpd_host_t *host)
 
             case HTTPD_CLIENT_WAITING:
                 i_offset = cl->answer.i_body_offset;
-                int i_msg = cl->query.i_type;
 
                 httpd_MsgInit(&cl->answer);
                 cl->answer.i_body_offset = i_offset;
 
-                cl->url->catch[i_msg].cb(cl->url->catch[i_msg].p_sys, cl,
-                        &cl->answer, &cl->query);
+                httpd_ClientCatch(cl);
                 if (cl->answer.i_type != HTTPD_MSG_NONE) {
                     /* we have new data, so re-enter send mode */
                     cl->i_buffer      = 0;
@@ -1979,14 +2558,13 @@ static void httpdLoop(httpd_host_t *host)
         else
             b_low_delay = true;
     }
-    vlc_mutex_unlock(&host->lock);
+    vlc_mutex_unlock(&worker->lock);
     vlc_restorecancel(canc);
 
-    /* we will wait 20ms (not too big) if HTTPD_CLIENT_WAITING */
-    int ret = poll(ufd, nfd, b_low_delay ? 20 : -1);
+    /* we will wait 20ms (not too big) if HTTPD_CLIENT_WAITING.
+     * The first worker interrupts the wait when it adds a client. */
+    int ret = vlc_poll_i11e(ufd, nfd, b_low_delay ? 20 : -1);
 
-    canc = vlc_savecancel();
-    vlc_mutex_lock(&host->lock);
     switch(ret) {
         case -1:
             if (errno != EINTR) {
@@ -1995,20 +2573,23 @@ static void httpdLoop(httpd_host_t *host)
                 msleep(100000);
             }
         case 0:
-            vlc_restorecancel(canc);
             return;
     }
 
-    /* Handle client sockets */
+    canc = vlc_savecancel();
+    vlc_mutex_lock(&worker->lock);
+
+    /* Handle client sockets. Clients added by the first worker in the
+     * mean time were not polled. */
+    const unsigned i_polled = nfd;
     now = mdate();
-    nfd = host->nfd;
+    nfd = i_listen;
 
-    for (int i_client = 0; i_client < host->i_client; i_client++) {
-        httpd_client_t *cl = host->client[i_client];
+    for (int i_client = 0; i_client < worker->i_client && nfd < i_polled;
+         i_client++) {
+        httpd_client_t *cl = worker->client[i_client];
         const struct pollfd *pufd = &ufd[nfd];
 
-        assert(pufd < &ufd[sizeof(ufd) / sizeof(ufd[0])]);
-
         if (cl->fd != pufd->fd)
             continue; // we were not waiting for this client
         ++nfd;
@@ -2024,9 +2605,10 @@ static void httpdLoop(httpd_host_t *host)
             case HTTPD_CLIENT_TLS_HS_OUT: httpd_ClientTlsHandshake(cl); break;
         }
     }
+    vlc_mutex_unlock(&worker->lock);
 
     /* Handle server sockets (accept new connections) */
-    for (nfd = 0; nfd < host->nfd; nfd++) {
+    for (nfd = 0; nfd < i_listen; nfd++) {
         httpd_client_t *cl;
         int fd = ufd[nfd].fd;
 
@@ -2054,22 +2636,26 @@ static void httpdLoop(httpd_host_t *host)
             p_tls = NULL;
 
         cl = httpd_ClientNew(fd, p_tls, now);
+        if (unlikely(cl == NULL)) {
+            if (p_tls != NULL)
+                vlc_tls_SessionDelete(p_tls);
+            net_Close(fd);
+            continue;
+        }
 
-        TAB_APPEND(host->i_client, host->client, cl);
+        httpd_WorkerAdd(host, cl);
     }
-
     vlc_restorecancel(canc);
 }
 
-static void* httpd_HostThread(void *data)
+static void* httpd_WorkerThread(void *data)
 {
-    httpd_host_t *host = data;
+    httpd_worker_t *worker = data;
 
-    vlc_mutex_lock(&host->lock);
-    while (host->i_ref > 0)
-        httpdLoop(host);
-    vlc_mutex_unlock(&host->lock);
-    return NULL;
+    vlc_interrupt_set(worker->interrupt);
+    for (;;)
+        httpdLoop(worker);
+    vlc_assert_unreachable();
 }
 
 int httpd_StreamSetHTTPHeaders(httpd_stream_t * p_stream, httpd_header * p_headers, size_t i_headers)
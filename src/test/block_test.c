@@ -84,10 +84,48 @@ static void test_block (void)
     //assert (block == NULL);
 }
 
+static void test_block_pool (void)
+{
+    block_pool_t *pool = block_pool_New (188, 3);
+    uint64_t hits, misses;
+    block_t *blocks[5];
+
+    assert (pool != NULL);
+
+    for (unsigned i = 0; i < 5; i++)
+    {
+        blocks[i] = block_pool_Alloc (pool);
+        assert (blocks[i] != NULL);
+        assert (blocks[i]->i_buffer == 188);
+        memset (blocks[i]->p_buffer, i, 188);
+    }
+    block_pool_GetStats (pool, &hits, &misses);
+    assert (hits == 3 && misses == 2);
+
+    blocks[0]->p_buffer += 4;
+    blocks[0]->i_buffer -= 4;
+    for (unsigned i = 0; i < 5; i++)
+        block_Release (blocks[i]);
+
+    /* Recycled blocks come back with their full payload */
+    block_t *block = block_pool_Alloc (pool);
+    assert (block != NULL);
+    assert (block->i_buffer == 188);
+    block_pool_GetStats (pool, &hits, &misses);
+    assert (hits == 4 && misses == 2);
+
+    /* Outstanding blocks survive the pool */
+    block_pool_Release (pool);
+    block = block_Realloc (block, 16, 188 + 16);
+    assert (block != NULL);
+    block_Release (block);
+}
+
 int main (void)
 {
     test_block_File ();
     test_block ();
+    test_block_pool ();
     return 0;
 }
 
@@ -0,0 +1,460 @@
+/*****************************************************************************
+ * adaptative_http.cpp: adaptative streaming HTTP connection pool test
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Runs the connection pool against a local stand-in HTTP server: keep-alive
+ * reuse, recovery from connections dropped while idle, idle expiry,
+ * requests pipelined at the per host limit, and downloads cancelled while
+ * they wait for a connection. */
+
+#include "http/HTTPConnectionManager.h"
+#include "http/Downloader.hpp"
+#include "http/Chunk.h"
+
+#include <vlc_block.h>
+
+#include <vector>
+#include <cstring>
+#include <cctype>
+#include <csignal>
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+using namespace adaptative::http;
+
+/*****************************************************************************
+ * Stand-in server: GET /<size> replies with size bytes of i % 251
+ *****************************************************************************/
+struct server
+{
+    int fd;
+    uint16_t port;
+    vlc_thread_t thread;
+    vlc_mutex_t lock;
+    vlc_cond_t wait;
+    std::vector<vlc_thread_t> clients;
+    unsigned accepts;
+    unsigned requests;
+    unsigned close_after; /* drops connections after that many replies */
+    unsigned keepalive; /* advertised timeout in seconds */
+};
+
+struct client
+{
+    server *srv;
+    int fd;
+};
+
+static bool send_all( int fd, const char *p, size_t i_size )
+{
+    while( i_size > 0 )
+    {
+        ssize_t i_ret = send( fd, p, i_size, MSG_NOSIGNAL );
+        if( i_ret <= 0 )
+            return false;
+        p += i_ret;
+        i_size -= i_ret;
+    }
+    return true;
+}
+
+static bool reply( int fd, const std::string &request, unsigned keepalive )
+{
+    size_t i_size = strtoul( request.c_str() + 5, NULL, 10 );
+    size_t i_start = 0, i_end = i_size - 1;
+    bool b_range = false;
+
+    size_t pos = request.find( "Range: bytes=" );
+    if( pos != std::string::npos )
+    {
+        b_range = true;
+        i_start = strtoul( request.c_str() + pos + 13, NULL, 10 );
+        size_t dash = request.find( '-', pos + 13 );
+        if( isdigit( request[dash + 1] ) )
+            i_end = strtoul( request.c_str() + dash + 1, NULL, 10 );
+    }
+
+    std::string body;
+    for( size_t i = i_start; i <= i_end; i++ )
+        body += (char)(i % 251);
+
+    char header[256];
+    int i_header = snprintf( header, sizeof(header),
+                             "HTTP/1.1 %s\r\nContent-Length: %zu\r\n",
+                             b_range ? "206 Partial Content" : "200 OK",
+                             body.length() );
+    if( keepalive )
+        i_header += snprintf( header + i_header, sizeof(header) - i_header,
+                              "Keep-Alive: timeout=%u\r\n", keepalive );
+    i_header += snprintf( header + i_header, sizeof(header) - i_header, "\r\n" );
+
+    return send_all( fd, header, i_header ) &&
+           send_all( fd, body.c_str(), body.length() );
+}
+
+static void *serve_client( void *data )
+{
+    client *c = static_cast<client *>(data);
+    server *srv = c->srv;
+    std::string buf;
+
+    for( unsigned i_served = 0; ; )
+    {
+        size_t end = buf.find( "\r\n\r\n" );
+        if( end == std::string::npos )
+        {
+            char chunk[1024];
+            ssize_t i_ret = recv( c->fd, chunk, sizeof(chunk), 0 );
+            if( i_ret <= 0 )
+                break;
+            buf.append( chunk, i_ret );
+            continue;
+        }
+
+        std::string request = buf.substr( 0, end + 4 );
+        buf.erase( 0, end + 4 );
+        assert( request.compare( 0, 5, "GET /" ) == 0 );
+
+        vlc_mutex_lock( &srv->lock );
+        srv->requests++;
+        const unsigned close_after = srv->close_after;
+        const unsigned keepalive = srv->keepalive;
+        vlc_cond_broadcast( &srv->wait );
+        vlc_mutex_unlock( &srv->lock );
+
+        if( !reply( c->fd, request, keepalive ) )
+            break;
+
+        /* like a server timing out an idle connection */
+        if( close_after && ++i_served == close_after )
+            break;
+    }
+
+    close( c->fd );
+    delete c;
+    return NULL;
+}
+
+static void *serve( void *data )
+{
+    server *srv = static_cast<server *>(data);
+
+    for( ;; )
+    {
+        int fd = accept( srv->fd, NULL, NULL );
+        if( fd == -1 )
+            continue;
+
+        int canc = vlc_savecancel();
+        client *c = new client;
+        c->srv = srv;
+        c->fd = fd;
+
+        /* counted before the client can get any reply */
+        vlc_mutex_lock( &srv->lock );
+        srv->accepts++;
+        vlc_thread_t thread;
+        int i_ret = vlc_clone( &thread, serve_client, c, VLC_THREAD_PRIORITY_LOW );
+        assert( i_ret == 0 );
+        srv->clients.push_back( thread );
+        vlc_mutex_unlock( &srv->lock );
+        vlc_restorecancel( canc );
+    }
+    return NULL;
+}
+
+static void server_Start( server *srv )
+{
+    struct sockaddr_in addr;
+    socklen_t i_len = sizeof(addr);
+
+    memset( &addr, 0, sizeof(addr) );
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+
+    srv->fd = socket( AF_INET, SOCK_STREAM, 0 );
+    assert( srv->fd != -1 );
+    int i_ret = bind( srv->fd, (struct sockaddr *)&addr, sizeof(addr) );
+    assert( i_ret == 0 );
+    i_ret = listen( srv->fd, 16 );
+    assert( i_ret == 0 );
+    i_ret = getsockname( srv->fd, (struct sockaddr *)&addr, &i_len );
+    assert( i_ret == 0 );
+    srv->port = ntohs( addr.sin_port );
+
+    vlc_mutex_init( &srv->lock );
+    vlc_cond_init( &srv->wait );
+    srv->accepts = srv->requests = 0;
+    srv->close_after = srv->keepalive = 0;
+
+    i_ret = vlc_clone( &srv->thread, serve, srv, VLC_THREAD_PRIORITY_LOW );
+    assert( i_ret == 0 );
+}
+
+/* Once the clients have closed all their connections */
+static void server_Stop( server *srv )
+{
+    vlc_cancel( srv->thread );
+    vlc_join( srv->thread, NULL );
+    for( size_t i = 0; i < srv->clients.size(); i++ )
+        vlc_join( srv->clients[i], NULL );
+    close( srv->fd );
+    vlc_cond_destroy( &srv->wait );
+    vlc_mutex_destroy( &srv->lock );
+}
+
+static void server_Reset( server *srv, unsigned close_after, unsigned keepalive )
+{
+    vlc_mutex_lock( &srv->lock );
+    srv->accepts = srv->requests = 0;
+    srv->close_after = close_after;
+    srv->keepalive = keepalive;
+    vlc_mutex_unlock( &srv->lock );
+}
+
+static unsigned server_Accepts( server *srv )
+{
+    vlc_mutex_lock( &srv->lock );
+    unsigned i_accepts = srv->accepts;
+    vlc_mutex_unlock( &srv->lock );
+    return i_accepts;
+}
+
+static bool server_WaitRequests( server *srv, unsigned i_count, mtime_t i_timeout )
+{
+    const mtime_t deadline = mdate() + i_timeout;
+    vlc_mutex_lock( &srv->lock );
+    while( srv->requests < i_count )
+        if( vlc_cond_timedwait( &srv->wait, &srv->lock, deadline ) )
+            break;
+    bool b_ret = srv->requests >= i_count;
+    vlc_mutex_unlock( &srv->lock );
+    return b_ret;
+}
+
+/*****************************************************************************
+ * Client side
+ *****************************************************************************/
+static server srv;
+
+static HTTPChunkSource *chunk_New( HTTPConnectionManager *manager, size_t i_size )
+{
+    char url[64];
+    snprintf( url, sizeof(url), "http://127.0.0.1:%u/%zu", srv.port, i_size );
+    return new HTTPChunkSource( url, manager );
+}
+
+/* Reads the rest of the chunk, checking the data from offset i_pos */
+static void chunk_ReadAll( HTTPChunkSource *chunk, size_t i_pos, size_t i_size )
+{
+    block_t *p_block;
+    while( (p_block = chunk->readBlock()) != NULL )
+    {
+        for( size_t i = 0; i < p_block->i_buffer; i++ )
+            assert( p_block->p_buffer[i] == (i_pos + i) % 251 );
+        i_pos += p_block->i_buffer;
+        block_Release( p_block );
+    }
+    assert( i_pos == i_size );
+}
+
+static void fetch( HTTPConnectionManager *manager, size_t i_size )
+{
+    HTTPChunkSource *chunk = chunk_New( manager, i_size );
+    chunk_ReadAll( chunk, 0, i_size );
+    delete chunk;
+}
+
+static void *fetch_thread( void *data )
+{
+    fetch( static_cast<HTTPConnectionManager *>(data), 5000 );
+    return NULL;
+}
+
+static void test_keepalive( vlc_object_t *obj )
+{
+    log( "testing keep-alive\n" );
+    server_Reset( &srv, 0, 0 );
+
+    HTTPConnectionManager *manager = new HTTPConnectionManager( obj );
+    for( int i = 0; i < 5; i++ )
+        fetch( manager, 1000 + i * 10000 );
+    assert( server_Accepts( &srv ) == 1 );
+
+    /* byte ranges */
+    HTTPChunkSource *chunk = chunk_New( manager, 100000 );
+    chunk->setBytesRange( BytesRange( 5000, 9999 ) );
+    chunk_ReadAll( chunk, 5000, 10000 );
+    delete chunk;
+    assert( server_Accepts( &srv ) == 1 );
+
+    delete manager;
+}
+
+static void test_dropped( vlc_object_t *obj )
+{
+    log( "testing connections dropped by the server\n" );
+    server_Reset( &srv, 2, 0 );
+
+    HTTPConnectionManager *manager = new HTTPConnectionManager( obj );
+    for( int i = 0; i < 6; i++ )
+        fetch( manager, 1000 );
+    /* reconnected, but still keeping connections alive */
+    assert( server_Accepts( &srv ) == 3 );
+    delete manager;
+}
+
+static void test_idle( vlc_object_t *obj )
+{
+    log( "testing idle timeouts\n" );
+    server_Reset( &srv, 0, 0 );
+
+    HTTPConnectionManager *manager = new HTTPConnectionManager( obj );
+    manager->setIdleTimeout( CLOCK_FREQ / 10 );
+    fetch( manager, 1000 );
+    fetch( manager, 1000 );
+    assert( server_Accepts( &srv ) == 1 );
+    mwait( mdate() + CLOCK_FREQ / 5 );
+    fetch( manager, 1000 );
+    assert( server_Accepts( &srv ) == 2 );
+    delete manager;
+
+    /* advertised by the server */
+    server_Reset( &srv, 0, 1 );
+    manager = new HTTPConnectionManager( obj );
+    fetch( manager, 1000 );
+    mwait( mdate() + CLOCK_FREQ * 7 / 10 );
+    fetch( manager, 1000 );
+    assert( server_Accepts( &srv ) == 2 );
+    delete manager;
+}
+
+static void test_pipelining( vlc_object_t *obj )
+{
+    log( "testing pipelining\n" );
+    server_Reset( &srv, 0, 0 );
+
+    HTTPConnectionManager *manager = new HTTPConnectionManager( obj );
+    manager->setMaxConnectionsPerHost( 1 );
+
+    /* keep the only connection busy */
+    HTTPChunkSource *chunk = chunk_New( manager, 30000 );
+    block_t *p_block = chunk->read( 1000 );
+    assert( p_block != NULL && p_block->i_buffer == 1000 );
+    block_Release( p_block );
+
+    vlc_thread_t thread;
+    int i_ret = vlc_clone( &thread, fetch_thread, manager, VLC_THREAD_PRIORITY_LOW );
+    assert( i_ret == 0 );
+
+    /* the second request reaches the server before the first reply is read */
+    assert( server_WaitRequests( &srv, 2, CLOCK_FREQ / 2 ) );
+
+    chunk_ReadAll( chunk, 1000, 30000 );
+    vlc_join( thread, NULL );
+    delete chunk;
+    assert( server_Accepts( &srv ) == 1 );
+
+    /* The reader doesn't release the connection in time: the pipelined
+     * reply gets dropped with it */
+    server_Reset( &srv, 0, 0 );
+    chunk = chunk_New( manager, 30000 );
+    p_block = chunk->read( 1000 );
+    assert( p_block != NULL );
+    block_Release( p_block );
+
+    i_ret = vlc_clone( &thread, fetch_thread, manager, VLC_THREAD_PRIORITY_LOW );
+    assert( i_ret == 0 );
+    vlc_join( thread, NULL );
+    chunk_ReadAll( chunk, 1000, 30000 );
+    delete chunk;
+    assert( server_Accepts( &srv ) == 1 );
+
+    /* the connection opened meanwhile is the one kept */
+    fetch( manager, 1000 );
+    assert( server_Accepts( &srv ) == 1 );
+    delete manager;
+}
+
+static void test_cancel( vlc_object_t *obj )
+{
+    log( "testing cancelling a download waiting for a connection\n" );
+    server_Reset( &srv, 0, 0 );
+
+    HTTPConnectionManager *manager = new HTTPConnectionManager( obj );
+    manager->setMaxConnectionsPerHost( 1 );
+
+    /* keep the only connection busy */
+    HTTPChunkSource *chunk = chunk_New( manager, 30000 );
+    block_t *p_block = chunk->read( 1000 );
+    assert( p_block != NULL );
+    block_Release( p_block );
+
+    char url[64];
+    snprintf( url, sizeof(url), "http://127.0.0.1:%u/%u", srv.port, 5000 );
+    HTTPChunkBufferedSource *source = new HTTPChunkBufferedSource( url, manager );
+    manager->downloader->schedule( source );
+
+    /* a download thread now waits for the connection to be handed over */
+    assert( server_WaitRequests( &srv, 2, CLOCK_FREQ / 2 ) );
+
+    mtime_t i_start = mdate();
+    delete source;
+    assert( mdate() - i_start < HTTPConnectionManager::connectionWait / 2 );
+
+    chunk_ReadAll( chunk, 1000, 30000 );
+    delete chunk;
+    delete manager;
+}
+
+int main( void )
+{
+    const char *argv[] = {
+        "-v",
+        "--ignore-config",
+        "-I",
+        "dummy",
+        "--no-media-library",
+    };
+
+    test_init();
+    signal( SIGPIPE, SIG_IGN );
+
+    libvlc_instance_t *p_vlc = libvlc_new( sizeof(argv) / sizeof(argv[0]),
+                                           argv );
+    assert( p_vlc != NULL );
+    vlc_object_t *obj = VLC_OBJECT(p_vlc->p_libvlc_int);
+
+    server_Start( &srv );
+
+    test_keepalive( obj );
+    test_dropped( obj );
+    test_idle( obj );
+    test_pipelining( obj );
+    test_cancel( obj );
+
+    server_Stop( &srv );
+    libvlc_release( p_vlc );
+    return 0;
+}
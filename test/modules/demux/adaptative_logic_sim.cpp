@@ -0,0 +1,446 @@
+/*****************************************************************************
+ * adaptative_logic_sim.cpp: adaptative streaming logic trace replay
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Usage: test_modules_demux_adaptative_logic_sim [trace...]
+ *
+ * Replays bandwidth traces against the adaptative logics, with each of the
+ * throughput estimators, and reports the average bitrate, the count and
+ * length of rebuffering, and the count of switches. Traces are text files
+ * of "<duration in ms> <kbit/s>" lines, looped over the session; without
+ * any, synthetic ones are replayed. There is no randomness nor wall clock
+ * involved: runs are reproducible.
+ *
+ * The player is modelled on this module: a stream downloads one segment at
+ * a time, starting when the previous one has been read, and up to the
+ * read-ahead in advance of the reader. The reader only stays the input
+ * caching ahead of the playback. The logics are the ones PlaylistManager
+ * creates, fed with the same download rates, switches and buffering
+ * reports as from a real stream. */
+
+#include "playlist/AbstractPlaylist.hpp"
+#include "playlist/BasePeriod.h"
+#include "playlist/BaseAdaptationSet.h"
+#include "playlist/BaseRepresentation.h"
+#include "playlist/SegmentList.h"
+#include "playlist/Segment.h"
+#include "SegmentTracker.hpp"
+#include "logic/AbstractAdaptationLogic.h"
+#include "logic/BandwidthEstimators.hpp"
+#include "logic/HybridAdaptationLogic.hpp"
+#include "logic/HybridSelector.hpp"
+#include "logic/RateBasedAdaptationLogic.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace adaptative;
+using namespace adaptative::logic;
+using namespace adaptative::playlist;
+
+#define SESSION   (600 * CLOCK_FREQ)
+#define READAHEAD (10 * CLOCK_FREQ) /* adaptative-readahead default */
+#define CACHING   (CLOCK_FREQ)      /* network-caching default */
+#define LATENCY   (CLOCK_FREQ / 25) /* per request */
+#define STEP      (CLOCK_FREQ / 100)
+
+static const mtime_t segments[] = { 2 * CLOCK_FREQ,  /* DASH */
+                                    6 * CLOCK_FREQ };/* HLS */
+
+static const uint64_t ladder[] = { 235000, 375000, 560000, 750000, 1050000,
+                                   1750000, 2350000, 3000000, 4300000, 5800000 };
+
+/*****************************************************************************
+ * Traces
+ *****************************************************************************/
+struct trace
+{
+    std::string name;
+    std::vector<mtime_t> durations;
+    std::vector<uint64_t> rates; /* bits/s */
+
+    void add(mtime_t duration, uint64_t kbps)
+    {
+        durations.push_back(duration);
+        rates.push_back(kbps * 1000);
+    }
+};
+
+static bool trace_Load(trace *t, const char *psz_path)
+{
+    FILE *fp = fopen(psz_path, "r");
+    if(!fp)
+        return false;
+    t->name = psz_path;
+    unsigned ms, kbps;
+    while(fscanf(fp, "%u %u", &ms, &kbps) == 2)
+    {
+        if(ms)
+            t->add(ms * INT64_C(1000), kbps);
+    }
+    fclose(fp);
+    return !t->durations.empty();
+}
+
+static void trace_Synthesize(std::vector<trace> &traces)
+{
+    trace t;
+
+    t.name = "steady 4.5M";
+    t.add(SESSION, 4500);
+    traces.push_back(t);
+
+    /* minute long steps */
+    t = trace();
+    t.name = "steps 6M/1.5M";
+    t.add(60 * CLOCK_FREQ, 6000);
+    t.add(60 * CLOCK_FREQ, 1500);
+    traces.push_back(t);
+
+    /* short swings, which rate based logics chase */
+    t = trace();
+    t.name = "oscillating 1-6M";
+    t.add(3 * CLOCK_FREQ, 6000);
+    t.add(2 * CLOCK_FREQ, 1000);
+    t.add(4 * CLOCK_FREQ, 4500);
+    t.add(3 * CLOCK_FREQ, 1500);
+    traces.push_back(t);
+
+    /* congested last mile: random walk with sudden drops, fixed seed */
+    t = trace();
+    t.name = "congested ~3M";
+    uint32_t seed = 0x5eed;
+    unsigned kbps = 3000;
+    for(mtime_t time = 0; time < SESSION; time += CLOCK_FREQ / 2)
+    {
+        seed = seed * 1103515245 + 12345;
+        unsigned r = (seed >> 16) % 100;
+        if(r < 4)
+            kbps = 300 + r * 100; /* drop */
+        else if(r < 52)
+            kbps = __MIN(kbps + (r - 4) * 10, 6000);
+        else
+            kbps = __MAX(kbps, 600 + (r - 52) * 10) - (r - 52) * 10;
+        t.add(CLOCK_FREQ / 2, kbps);
+    }
+    traces.push_back(t);
+}
+
+/*****************************************************************************
+ * Logics
+ *****************************************************************************/
+enum policy
+{
+    POLICY_RATE,      /* RateBasedAdaptationLogic */
+    POLICY_RATE_HYST, /* HybridSelector throughput part */
+    POLICY_BUFFER,    /* HybridSelector BOLA part */
+    POLICY_HYBRID,    /* HybridAdaptationLogic */
+};
+static const char *const policies[] = { "rate", "rate+hyst", "bola", "hybrid" };
+
+enum estimator
+{
+    ESTIMATOR_VHF,
+    ESTIMATOR_EWMA,
+    ESTIMATOR_HARMONIC,
+};
+static const char *const estimators[] = { "vhf", "ewma", "harmonic" };
+
+static AbstractBandwidthEstimator *estimator_New(int i)
+{
+    switch(i)
+    {
+        case ESTIMATOR_VHF:
+            return new VHFBandwidthEstimator();
+        case ESTIMATOR_EWMA:
+            return new EWMABandwidthEstimator();
+        default:
+            return new HarmonicMeanBandwidthEstimator();
+    }
+}
+
+/* The selector parts alone, as a logic fed like HybridAdaptationLogic */
+class SelectorLogic : public AbstractAdaptationLogic
+{
+    public:
+        SelectorLogic(int policy_, AbstractBandwidthEstimator *estimator_,
+                      mtime_t segment) :
+            selector(__MIN(READAHEAD, segment))
+        {
+            policy = policy_;
+            estimator = estimator_;
+            level = 0;
+        }
+        virtual ~SelectorLogic()
+        {
+            delete estimator;
+        }
+
+        BaseRepresentation *getNextRepresentation(BaseAdaptationSet *adaptSet,
+                                                  BaseRepresentation *currep) const
+        {
+            const std::vector<BaseRepresentation *> &reps = adaptSet->getRepresentations();
+            std::vector<uint64_t> bitrates;
+            unsigned current = reps.size();
+            for(unsigned i=0; i<reps.size(); i++)
+            {
+                bitrates.push_back(reps[i]->getBandwidth());
+                if(reps[i] == currep)
+                    current = i;
+            }
+
+            unsigned index;
+            if(policy == POLICY_BUFFER)
+                index = selector.selectByBuffer(bitrates, level);
+            else
+                index = HybridSelector::selectByRate(bitrates, current,
+                                                     estimator->getEstimate());
+            level = 0;
+            return reps[index];
+        }
+
+        virtual void updateDownloadRate(size_t size, mtime_t time)
+        {
+            estimator->push(size, time);
+        }
+
+        virtual void trackerEvent(const SegmentTrackerEvent &event)
+        {
+            if(event.type == SegmentTrackerEvent::BUFFERING_STATE &&
+               event.u.buffering.current > level)
+                level = event.u.buffering.current;
+        }
+
+    private:
+        int policy;
+        HybridSelector selector;
+        AbstractBandwidthEstimator *estimator;
+        mutable mtime_t level;
+};
+
+static AbstractAdaptationLogic *logic_New(int pol, int est, mtime_t segment)
+{
+    switch(pol)
+    {
+        case POLICY_RATE:
+            return new RateBasedAdaptationLogic(NULL, 0, 0);
+        case POLICY_HYBRID:
+            /* as PlaylistManager::createLogic */
+            return new HybridAdaptationLogic(NULL, 0, 0, estimator_New(est), READAHEAD);
+        default:
+            return new SelectorLogic(pol, estimator_New(est), segment);
+    }
+}
+
+/*****************************************************************************
+ * Player
+ *****************************************************************************/
+struct result
+{
+    uint64_t bits;
+    mtime_t  played;
+    unsigned rebuffers;
+    mtime_t  stalled;
+    unsigned switches;
+};
+
+struct player
+{
+    const trace *t;
+    size_t piece;
+    mtime_t pieceleft;
+
+    mtime_t segment;    /* duration */
+    uint64_t bitrate;   /* of the segment being fetched */
+    uint64_t size;      /* bits */
+    uint64_t received;
+    mtime_t latency;    /* left before the first byte */
+    mtime_t read;       /* position of the reader in the segment */
+    mtime_t cached;     /* read, not played yet */
+    bool playing;
+    result res;
+
+    mtime_t ahead() const
+    {
+        return (mtime_t)(received * CLOCK_FREQ / bitrate) - read;
+    }
+
+    void next()
+    {
+        piece = (piece + 1) % t->durations.size();
+        pieceleft = t->durations[piece];
+    }
+
+    /* one step of the link, the reader and the playback */
+    void step(AbstractAdaptationLogic *logic, BaseAdaptationSet *set)
+    {
+        mtime_t left = STEP;
+        if(latency > 0)
+        {
+            mtime_t wait = __MIN(latency, left);
+            latency -= wait;
+            left -= wait;
+        }
+        /* downloads until the read-ahead is reached, like the Downloader */
+        if(left > 0 && received < size && ahead() < READAHEAD)
+        {
+            uint64_t bits = t->rates[piece] * left / CLOCK_FREQ;
+            mtime_t time = left;
+            if(bits > size - received)
+            {
+                bits = size - received;
+                time = __MAX(1, bits * CLOCK_FREQ / __MAX(t->rates[piece], 1));
+            }
+            received += bits;
+            if(bits)
+                logic->updateDownloadRate(bits / 8, time);
+        }
+
+        /* the demuxer only reads up to the caching ahead of the playback */
+        mtime_t avail = __MIN(ahead(), CACHING - cached);
+        if(avail > 0)
+        {
+            read += avail;
+            cached += avail;
+            logic->trackerEvent(SegmentTrackerEvent(set, ahead(), segment));
+        }
+
+        if(playing)
+        {
+            mtime_t played = __MIN(cached, STEP);
+            cached -= played;
+            res.played += played;
+            res.bits += bitrate * played / CLOCK_FREQ;
+            if(played < STEP)
+            {
+                res.stalled += STEP - played;
+                res.rebuffers++;
+                playing = false;
+            }
+        }
+        else
+        {
+            if(res.played > 0)
+                res.stalled += STEP;
+            if(cached >= CACHING)
+                playing = true;
+        }
+
+        pieceleft -= STEP;
+        if(pieceleft <= 0)
+            next();
+    }
+};
+
+static result Replay(const trace *t, mtime_t segment, int pol, int est)
+{
+    BaseAdaptationSet set(NULL);
+    for(size_t i=0; i<ARRAY_SIZE(ladder); i++)
+    {
+        BaseRepresentation *rep = new BaseRepresentation(&set);
+        rep->setBandwidth(ladder[i]);
+        set.addRepresentation(rep);
+    }
+    AbstractAdaptationLogic *logic = logic_New(pol, est, segment);
+
+    player p;
+    p.t = t;
+    p.piece = 0;
+    p.pieceleft = t->durations[0];
+    p.segment = segment;
+    p.received = p.size = 0;
+    p.bitrate = 1;
+    p.read = segment; /* requests the first one */
+    p.latency = 0;
+    p.cached = 0;
+    p.playing = false;
+    p.res = result();
+
+    BaseRepresentation *current = NULL;
+    for(mtime_t time = 0; time < SESSION; time += STEP)
+    {
+        if(p.read >= segment)
+        {
+            BaseRepresentation *next = logic->getNextRepresentation(&set, current);
+            if(next != current)
+            {
+                if(current)
+                    p.res.switches++;
+                logic->trackerEvent(SegmentTrackerEvent(current, next));
+                current = next;
+            }
+            p.bitrate = current->getBandwidth();
+            p.size = p.bitrate * segment / CLOCK_FREQ;
+            p.received = 0;
+            p.read = 0;
+            p.latency = LATENCY;
+        }
+        p.step(logic, &set);
+    }
+
+    delete logic;
+    return p.res;
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<trace> traces;
+    for(int i=1; i<argc; i++)
+    {
+        trace t;
+        if(!trace_Load(&t, argv[i]))
+        {
+            fprintf(stderr, "can't read trace %s\n", argv[i]);
+            return 1;
+        }
+        traces.push_back(t);
+    }
+    if(traces.empty())
+        trace_Synthesize(traces);
+
+    for(size_t i=0; i<traces.size(); i++)
+    {
+        for(size_t j=0; j<ARRAY_SIZE(segments); j++)
+        {
+            printf("%s, %" PRId64 " s segments\n", traces[i].name.c_str(),
+                   segments[j] / CLOCK_FREQ);
+            printf("  %-10s %-9s %8s %9s %9s %8s\n", "logic", "estimator",
+                   "kbit/s", "rebuffers", "stalled s", "switches");
+            for(int pol=0; pol<(int)ARRAY_SIZE(policies); pol++)
+            {
+                for(int est=0; est<(int)ARRAY_SIZE(estimators); est++)
+                {
+                    if(pol == POLICY_RATE && est != ESTIMATOR_VHF)
+                        continue; /* has its own */
+                    if(pol == POLICY_BUFFER && est != ESTIMATOR_VHF)
+                        continue; /* does not use the estimate */
+                    result res = Replay(&traces[i], segments[j], pol, est);
+                    printf("  %-10s %-9s %8" PRIu64 " %9u %9.1f %8u\n",
+                           policies[pol], pol == POLICY_BUFFER ? "-" : estimators[est],
+                           res.played ? res.bits * CLOCK_FREQ / res.played / 1000 : 0,
+                           res.rebuffers, (double) res.stalled / CLOCK_FREQ,
+                           res.switches);
+                }
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,262 @@
+/*****************************************************************************
+ * adaptative_refresh_bench.cpp: adaptative streaming live playlist refresh
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Usage: test_modules_demux_adaptative_refresh_bench [hours [refreshes]]
+ *
+ * Refreshes a live playlist with a DVR window of the given length, sliding
+ * by one segment each time, and reports the average and worst time taken:
+ * - for a media playlist of 6s segments, incrementally merged into the
+ *   representation, against a full parse of the same playlist,
+ * - for a segment timeline of 4s alternating durations, as a MPD would
+ *   carry, merged into the current one (without the XML parsing).
+ * Checks the segments known before a refresh are the same objects after
+ * it, and that expired ones are pruned so the window does not grow. */
+
+#include "playlist/BasePeriod.h"
+#include "playlist/BaseAdaptationSet.h"
+#include "playlist/SegmentInformation.hpp"
+#include "playlist/SegmentList.h"
+#include "playlist/SegmentTemplate.h"
+#include "playlist/SegmentTimeline.h"
+#include "../hls/playlist/M3U8.hpp"
+#include "../hls/playlist/Parser.hpp"
+#include "../hls/playlist/Representation.hpp"
+
+#include <vlc_stream.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+using namespace adaptative::playlist;
+
+#define HLS_SEGMENT      6 /* s */
+#define TIMESCALE        90000
+#define TIMELINE_LONG    360360 /* alternating 4.004s and 3.996s */
+#define TIMELINE_SHORT   359640
+
+struct timing
+{
+    mtime_t total;
+    mtime_t worst;
+
+    void add(mtime_t duration)
+    {
+        total += duration;
+        if(duration > worst)
+            worst = duration;
+    }
+};
+
+static void timing_Print(const char *psz_name, const timing &t, unsigned count)
+{
+    printf("  %-20s %8.3f ms avg %8.3f ms worst\n", psz_name,
+           (double) t.total / count / 1000, (double) t.worst / 1000);
+}
+
+/*****************************************************************************
+ * Media playlist
+ *****************************************************************************/
+static std::string playlist_Generate(uint64_t first, unsigned count)
+{
+    std::string playlist;
+    char psz_line[64];
+
+    playlist.reserve(32 * count + 128);
+    playlist += "#EXTM3U\n#EXT-X-VERSION:3\n";
+    snprintf(psz_line, sizeof(psz_line), "#EXT-X-TARGETDURATION:%u\n", HLS_SEGMENT);
+    playlist += psz_line;
+    snprintf(psz_line, sizeof(psz_line), "#EXT-X-MEDIA-SEQUENCE:%" PRIu64 "\n", first);
+    playlist += psz_line;
+    for(uint64_t i=first; i<first + count; i++)
+    {
+        snprintf(psz_line, sizeof(psz_line), "#EXTINF:%u.000,\nsegment%" PRIu64 ".ts\n",
+                 HLS_SEGMENT, i);
+        playlist += psz_line;
+    }
+
+    return playlist;
+}
+
+static stream_t *playlist_Stream(vlc_object_t *obj, const std::string &playlist)
+{
+    return stream_MemoryNew(obj, (uint8_t *) playlist.c_str(), playlist.size(), true);
+}
+
+static int test_hls(vlc_object_t *obj, unsigned count, unsigned refreshes)
+{
+    const std::string url = "http://localhost/live/index.m3u8";
+    hls::playlist::M3U8Parser parser;
+
+    std::string playlist = playlist_Generate(0, count);
+    stream_t *s = playlist_Stream(obj, playlist);
+    assert(s != NULL);
+    hls::playlist::M3U8 *m3u8 = parser.parse(s, url);
+    stream_Delete(s);
+    assert(m3u8 != NULL);
+
+    hls::playlist::Representation *rep = dynamic_cast<hls::playlist::Representation *>
+            (m3u8->getFirstPeriod()->getAdaptationSets().front()->getRepresentations().front());
+    assert(rep != NULL && rep->isLive());
+    assert(rep->getSegmentList()->getSegments().size() == count);
+    /* segments numbering does not start at the media sequence */
+    const uint64_t base = rep->getSegmentList()->getSegments().front()->getSequenceNumber();
+
+    timing incremental = timing();
+    timing full = timing();
+
+    for(unsigned i=1; i<=refreshes; i++)
+    {
+        playlist = playlist_Generate(i, count);
+
+        const std::vector<ISegment *> &segments = rep->getSegmentList()->getSegments();
+        const ISegment *kept = segments.back();
+        const uint64_t keptnumber = kept->getSequenceNumber();
+
+        s = playlist_Stream(obj, playlist);
+        assert(s != NULL);
+        mtime_t start = mdate();
+        parser.appendSegmentsFromStream(obj, rep, s);
+        /* as runLocalUpdates() does, playing from the start of the window */
+        rep->pruneBySegmentNumber(base + i);
+        incremental.add(mdate() - start);
+        stream_Delete(s);
+
+        if(segments.size() != count || segments.front()->getSequenceNumber() != base + i ||
+           segments.back()->getSequenceNumber() != base + i + count - 1)
+        {
+            fprintf(stderr, "refresh %u: window of %zu segments, %" PRIu64 " to %" PRIu64 "\n",
+                    i, segments.size(), segments.front()->getSequenceNumber() - base,
+                    segments.back()->getSequenceNumber() - base);
+            return 1;
+        }
+        if(segments[keptnumber - base - i] != kept)
+        {
+            fprintf(stderr, "refresh %u: segment %" PRIu64 " was recreated\n", i, keptnumber - base);
+            return 1;
+        }
+
+        s = playlist_Stream(obj, playlist);
+        assert(s != NULL);
+        start = mdate();
+        hls::playlist::M3U8 *reparsed = parser.parse(s, url);
+        delete reparsed;
+        full.add(mdate() - start);
+        stream_Delete(s);
+    }
+
+    printf("media playlist, %u segments, %u refreshes\n", count, refreshes);
+    timing_Print("incremental merge", incremental, refreshes);
+    timing_Print("full parse", full, refreshes);
+
+    delete m3u8;
+    return 0;
+}
+
+/*****************************************************************************
+ * Segment timeline
+ *****************************************************************************/
+static stime_t timeline_Time(uint64_t number)
+{
+    return (number / 2) * (TIMELINE_LONG + TIMELINE_SHORT) + (number % 2) * TIMELINE_LONG;
+}
+
+/* as the MPD parser would build it from a window starting at first */
+static SegmentTimeline *timeline_Generate(uint64_t first, unsigned count)
+{
+    SegmentTimeline *timeline = new SegmentTimeline(TIMESCALE);
+    for(uint64_t i=first; i<first + count; i++)
+        timeline->addElement(i, (i % 2) ? TIMELINE_SHORT : TIMELINE_LONG, 0,
+                             (i == first) ? timeline_Time(first) : 0);
+    return timeline;
+}
+
+static int test_timeline(unsigned count, unsigned refreshes)
+{
+    SegmentInformation info;
+    MediaSegmentTemplate *templ = new MediaSegmentTemplate(&info);
+    templ->segmentTimeline.Set(timeline_Generate(0, count));
+    info.setSegmentTemplate(templ);
+
+    timing build = timing();
+    timing merge = timing();
+
+    for(unsigned i=1; i<=refreshes; i++)
+    {
+        mtime_t start = mdate();
+        MediaSegmentTemplate *updated = new MediaSegmentTemplate(&info);
+        updated->segmentTimeline.Set(timeline_Generate(i, count));
+        build.add(mdate() - start);
+
+        start = mdate();
+        /* playing from the start of the window */
+        templ->mergeWith(updated, timeline_Time(i) * CLOCK_FREQ / TIMESCALE);
+        merge.add(mdate() - start);
+        delete updated;
+
+        const SegmentTimeline *timeline = templ->segmentTimeline.Get();
+        if(timeline->minElementNumber() != i ||
+           timeline->maxElementNumber() != i + count - 1 ||
+           timeline->scaledStart() != timeline_Time(i))
+        {
+            fprintf(stderr, "refresh %u: timeline of %" PRIu64 " to %" PRIu64 "\n",
+                    i, timeline->minElementNumber(), timeline->maxElementNumber());
+            return 1;
+        }
+    }
+
+    printf("segment timeline, %u elements, %u refreshes\n", count, refreshes);
+    timing_Print("timeline build", build, refreshes);
+    timing_Print("incremental merge", merge, refreshes);
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    const unsigned hours = (argc > 1) ? strtoul(argv[1], NULL, 10) : 6;
+    const unsigned refreshes = (argc > 2) ? strtoul(argv[2], NULL, 10) : 60;
+
+    if(hours == 0 || refreshes == 0)
+    {
+        fprintf(stderr, "Usage: %s [hours [refreshes]]\n", argv[0]);
+        return 77;
+    }
+
+    test_init();
+    alarm(0);
+
+    const char *vlc_argv[] = { "--ignore-config", "-q" };
+    libvlc_instance_t *vlc = libvlc_new(sizeof (vlc_argv) / sizeof (vlc_argv[0]),
+                                        vlc_argv);
+    assert(vlc != NULL);
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+
+    int i_ret = test_hls(obj, hours * 3600 / HLS_SEGMENT, refreshes);
+    if(i_ret == 0)
+        i_ret = test_timeline(UINT64_C(7200) * hours * TIMESCALE / (TIMELINE_LONG + TIMELINE_SHORT),
+                              refreshes);
+
+    libvlc_release(vlc);
+    return i_ret;
+}
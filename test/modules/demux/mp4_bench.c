@@ -0,0 +1,440 @@
+/*****************************************************************************
+ * mp4_bench.c: MP4 demuxer sample tables benchmark
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Usage: test_modules_demux_mp4_bench [samples [stz2]]
+ *
+ * Writes a synthetic file with one video track of the given count of
+ * samples (one per chunk, with stts, ctts and stss tables, and sample sizes
+ * in a stsz or a compact stz2 box), then reports the time and the memory
+ * the MP4 demuxer takes to open it, and the average time of random seeks. */
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_demux.h>
+#include <vlc_es_out.h>
+#include <vlc_stream.h>
+#include <vlc_url.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#define TIMESCALE 25000
+#define DURATION  1000 /* per sample, 25 fps */
+#define GOP       25
+#define SEEKS     1000
+
+/* Box writer */
+typedef struct
+{
+    uint8_t *p;
+    size_t   i_size;
+    size_t   i_alloc;
+    size_t   stack[8];
+    unsigned i_depth;
+} bo_t;
+
+static void bo_add( bo_t *b, const void *p_data, size_t i_data )
+{
+    if( b->i_size + i_data > b->i_alloc )
+    {
+        b->i_alloc = ( b->i_size + i_data ) * 2;
+        b->p = realloc( b->p, b->i_alloc );
+        assert( b->p != NULL );
+    }
+    memcpy( &b->p[b->i_size], p_data, i_data );
+    b->i_size += i_data;
+}
+
+static void bo_add_8( bo_t *b, uint8_t i )
+{
+    bo_add( b, &i, 1 );
+}
+
+static void bo_add_16( bo_t *b, uint16_t i )
+{
+    uint8_t p[2];
+    SetWBE( p, i );
+    bo_add( b, p, 2 );
+}
+
+static void bo_add_32( bo_t *b, uint32_t i )
+{
+    uint8_t p[4];
+    SetDWBE( p, i );
+    bo_add( b, p, 4 );
+}
+
+static void bo_add_zero( bo_t *b, size_t i_count )
+{
+    while( i_count-- > 0 )
+        bo_add_8( b, 0 );
+}
+
+static void box_open( bo_t *b, const char *psz_type )
+{
+    assert( b->i_depth < ARRAY_SIZE(b->stack) );
+    b->stack[b->i_depth++] = b->i_size;
+    bo_add_32( b, 0 );
+    bo_add( b, psz_type, 4 );
+}
+
+static void fullbox_open( bo_t *b, const char *psz_type )
+{
+    box_open( b, psz_type );
+    bo_add_32( b, 0 ); /* version and flags */
+}
+
+static void box_close( bo_t *b )
+{
+    size_t i_start = b->stack[--b->i_depth];
+    SetDWBE( &b->p[i_start], b->i_size - i_start );
+}
+
+static uint32_t SampleSize( uint32_t i_sample )
+{
+    return ( i_sample % GOP ) ? 16 + ( i_sample & 15 ) : 200;
+}
+
+static bool WriteFile( const char *psz_path, uint32_t i_samples, bool b_stz2 )
+{
+    bo_t b = { .p = NULL };
+    uint64_t i_duration = (uint64_t)i_samples * DURATION;
+
+    box_open( &b, "ftyp" );
+    bo_add( &b, "isom", 4 );
+    bo_add_32( &b, 0 );
+    bo_add( &b, "isom", 4 );
+    box_close( &b );
+
+    box_open( &b, "moov" );
+
+    fullbox_open( &b, "mvhd" );
+    bo_add_32( &b, 0 ); /* creation time */
+    bo_add_32( &b, 0 ); /* modification time */
+    bo_add_32( &b, TIMESCALE );
+    bo_add_32( &b, i_duration );
+    bo_add_32( &b, 0x10000 ); /* rate */
+    bo_add_16( &b, 0x100 ); /* volume */
+    bo_add_zero( &b, 10 );
+    static const uint32_t matrix[9] = { 0x10000, 0, 0, 0, 0x10000, 0, 0, 0,
+                                        0x40000000 };
+    for( unsigned i = 0; i < 9; i++ )
+        bo_add_32( &b, matrix[i] );
+    bo_add_zero( &b, 24 );
+    bo_add_32( &b, 2 ); /* next track ID */
+    box_close( &b );
+
+    box_open( &b, "trak" );
+
+    box_open( &b, "tkhd" );
+    bo_add_32( &b, 3 ); /* enabled, in movie */
+    bo_add_32( &b, 0 );
+    bo_add_32( &b, 0 );
+    bo_add_32( &b, 1 ); /* track ID */
+    bo_add_32( &b, 0 );
+    bo_add_32( &b, i_duration );
+    bo_add_zero( &b, 16 );
+    for( unsigned i = 0; i < 9; i++ )
+        bo_add_32( &b, matrix[i] );
+    bo_add_32( &b, 320 << 16 );
+    bo_add_32( &b, 240 << 16 );
+    box_close( &b );
+
+    box_open( &b, "mdia" );
+
+    fullbox_open( &b, "mdhd" );
+    bo_add_32( &b, 0 );
+    bo_add_32( &b, 0 );
+    bo_add_32( &b, TIMESCALE );
+    bo_add_32( &b, i_duration );
+    bo_add_16( &b, 0x55c4 ); /* und */
+    bo_add_16( &b, 0 );
+    box_close( &b );
+
+    fullbox_open( &b, "hdlr" );
+    bo_add_32( &b, 0 );
+    bo_add( &b, "vide", 4 );
+    bo_add_zero( &b, 12 );
+    bo_add_8( &b, 0 ); /* empty name */
+    box_close( &b );
+
+    box_open( &b, "minf" );
+
+    fullbox_open( &b, "vmhd" );
+    bo_add_zero( &b, 8 );
+    box_close( &b );
+
+    box_open( &b, "stbl" );
+
+    fullbox_open( &b, "stsd" );
+    bo_add_32( &b, 1 );
+    box_open( &b, "jpeg" );
+    bo_add_zero( &b, 6 );
+    bo_add_16( &b, 1 ); /* data reference index */
+    bo_add_zero( &b, 16 );
+    bo_add_16( &b, 320 );
+    bo_add_16( &b, 240 );
+    bo_add_32( &b, 0x480000 );
+    bo_add_32( &b, 0x480000 );
+    bo_add_32( &b, 0 );
+    bo_add_16( &b, 1 ); /* frame count */
+    bo_add_zero( &b, 32 ); /* compressor name */
+    bo_add_16( &b, 24 );
+    bo_add_16( &b, 0xffff );
+    box_close( &b );
+    box_close( &b );
+
+    fullbox_open( &b, "stts" );
+    bo_add_32( &b, 1 );
+    bo_add_32( &b, i_samples );
+    bo_add_32( &b, DURATION );
+    box_close( &b );
+
+    /* reordered frames: one offset per sample, as encoders write them */
+    fullbox_open( &b, "ctts" );
+    bo_add_32( &b, i_samples );
+    for( uint32_t i = 0; i < i_samples; i++ )
+    {
+        bo_add_32( &b, 1 );
+        bo_add_32( &b, ( i % GOP ) ? ( i & 1 ) * 2 * DURATION : DURATION );
+    }
+    box_close( &b );
+
+    fullbox_open( &b, "stss" );
+    bo_add_32( &b, ( i_samples + GOP - 1 ) / GOP );
+    for( uint32_t i = 0; i < i_samples; i += GOP )
+        bo_add_32( &b, i + 1 );
+    box_close( &b );
+
+    fullbox_open( &b, "stsc" );
+    bo_add_32( &b, 1 );
+    bo_add_32( &b, 1 ); /* first chunk */
+    bo_add_32( &b, 1 ); /* samples per chunk */
+    bo_add_32( &b, 1 ); /* sample description index */
+    box_close( &b );
+
+    if( b_stz2 )
+    {
+        fullbox_open( &b, "stz2" );
+        bo_add_zero( &b, 3 );
+        bo_add_8( &b, 8 ); /* field size */
+        bo_add_32( &b, i_samples );
+        for( uint32_t i = 0; i < i_samples; i++ )
+            bo_add_8( &b, SampleSize( i ) );
+    }
+    else
+    {
+        fullbox_open( &b, "stsz" );
+        bo_add_32( &b, 0 );
+        bo_add_32( &b, i_samples );
+        for( uint32_t i = 0; i < i_samples; i++ )
+            bo_add_32( &b, SampleSize( i ) );
+    }
+    box_close( &b );
+
+    /* chunk offsets are relative to the mdat payload until the moov
+     * size is known */
+    fullbox_open( &b, "co64" );
+    bo_add_32( &b, i_samples );
+    size_t i_co64 = b.i_size;
+    uint64_t i_offset = 0;
+    for( uint32_t i = 0; i < i_samples; i++ )
+    {
+        uint8_t p[8];
+        SetQWBE( p, i_offset );
+        bo_add( &b, p, 8 );
+        i_offset += SampleSize( i );
+    }
+
+    while( b.i_depth > 0 )
+        box_close( &b ); /* co64 stbl minf mdia trak moov */
+
+    uint64_t i_mdat = b.i_size;
+    for( uint32_t i = 0; i < i_samples; i++ )
+    {
+        uint8_t *p = &b.p[i_co64 + 8 * i];
+        SetQWBE( p, GetQWBE( p ) + i_mdat + 8 );
+    }
+
+    FILE *f = fopen( psz_path, "wb" );
+    if( f == NULL )
+    {
+        free( b.p );
+        return false;
+    }
+
+    bool b_ok = fwrite( b.p, 1, b.i_size, f ) == b.i_size;
+    free( b.p );
+
+    uint8_t hdr[8];
+    SetDWBE( hdr, i_offset + 8 );
+    memcpy( &hdr[4], "mdat", 4 );
+    b_ok = b_ok && fwrite( hdr, 1, 8, f ) == 8;
+
+    static const uint8_t zero[256];
+    for( uint32_t i = 0; b_ok && i < i_samples; i++ )
+        b_ok = fwrite( zero, 1, SampleSize( i ), f ) == SampleSize( i );
+
+    return fclose( f ) == 0 && b_ok;
+}
+
+static long PeakRSS( void )
+{
+    struct rusage usage;
+    getrusage( RUSAGE_SELF, &usage );
+    return usage.ru_maxrss; /* KiB */
+}
+
+static es_out_id_t *EsOutAdd( es_out_t *out, const es_format_t *fmt )
+{
+    (void) fmt;
+    /* any non NULL value: the demuxer does not look into it */
+    return (es_out_id_t *)out;
+}
+
+static int EsOutSend( es_out_t *out, es_out_id_t *id, block_t *block )
+{
+    (void) out; (void) id;
+    block_ChainRelease( block );
+    return VLC_SUCCESS;
+}
+
+static void EsOutDel( es_out_t *out, es_out_id_t *id )
+{
+    (void) out; (void) id;
+}
+
+static int EsOutControl( es_out_t *out, int query, va_list args )
+{
+    (void) out;
+
+    switch( query )
+    {
+        case ES_OUT_GET_ES_STATE:
+        {
+            (void) va_arg( args, es_out_id_t * );
+            *va_arg( args, bool * ) = true;
+            return VLC_SUCCESS;
+        }
+        default:
+            return VLC_EGENERIC;
+    }
+}
+
+int main( int argc, char *argv[] )
+{
+    uint32_t i_samples = (argc > 1) ? strtoul( argv[1], NULL, 10 ) : 1000000;
+    bool b_stz2 = argc > 2 && !strcmp( argv[2], "stz2" );
+
+    if( i_samples == 0 )
+    {
+        fprintf( stderr, "Usage: %s [samples [stz2]]\n", argv[0] );
+        return 77;
+    }
+
+    char psz_path[] = "/tmp/vlc-mp4-bench-XXXXXX";
+    int fd = mkstemp( psz_path );
+    if( fd == -1 )
+        return 77;
+    close( fd );
+
+    if( !WriteFile( psz_path, i_samples, b_stz2 ) )
+    {
+        log( "cannot write %s\n", psz_path );
+        unlink( psz_path );
+        return 77;
+    }
+
+    test_init();
+    alarm( 0 );
+
+    const char *vlc_argv[] = { "--ignore-config", "-q" };
+    libvlc_instance_t *vlc = libvlc_new( sizeof (vlc_argv)
+                                         / sizeof (vlc_argv[0]), vlc_argv );
+    assert( vlc != NULL );
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+
+    char *url = vlc_path2uri( psz_path, NULL );
+    assert( url != NULL );
+
+    es_out_t out = {
+        .pf_add = EsOutAdd,
+        .pf_send = EsOutSend,
+        .pf_del = EsOutDel,
+        .pf_control = EsOutControl,
+        .p_sys = NULL,
+    };
+
+    int i_ret = 77;
+    stream_t *s = stream_UrlNew( obj, url );
+    if( s == NULL )
+    {
+        log( "cannot open %s\n", psz_path );
+        goto end;
+    }
+
+    long i_rss = PeakRSS();
+    mtime_t start = mdate();
+
+    demux_t *demux = demux_New( obj, "mp4", psz_path, s, &out );
+    if( demux == NULL )
+    {
+        log( "MP4 demuxer not available\n" );
+        stream_Delete( s );
+        goto end;
+    }
+
+    mtime_t opened = mdate() - start;
+    printf( "%"PRIu32" samples (%s): opened in %"PRId64" ms, "
+            "peak RSS +%ld KiB\n", i_samples, b_stz2 ? "stz2" : "stsz",
+            opened / 1000, PeakRSS() - i_rss );
+
+    /* random seeks, each followed by a demux call */
+    mtime_t i_length = CLOCK_FREQ * i_samples * DURATION / TIMESCALE;
+    start = mdate();
+    for( unsigned i = 0; i < SEEKS; i++ )
+    {
+        mtime_t i_time = (mtime_t)( (uint64_t)rand() * i_length / RAND_MAX );
+        demux_Control( demux, DEMUX_SET_TIME, i_time, false );
+        if( demux_Demux( demux ) != VLC_DEMUXER_SUCCESS )
+        {
+            log( "demux stopped after seek %u to %"PRId64" us\n", i, i_time );
+            demux_Delete( demux );
+            i_ret = 1;
+            goto end;
+        }
+    }
+    mtime_t seeks = mdate() - start;
+    printf( "%u seeks in %"PRId64" ms: %"PRId64" us per seek, "
+            "peak RSS +%ld KiB\n", SEEKS, seeks / 1000, seeks / SEEKS,
+            PeakRSS() - i_rss );
+
+    demux_Delete( demux ); /* also deletes the stream */
+    i_ret = 0;
+end:
+    free( url );
+    libvlc_release( vlc );
+    unlink( psz_path );
+    return i_ret;
+}
@@ -0,0 +1,161 @@
+/*****************************************************************************
+ * ts_bench.c: TS demuxer throughput benchmark
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Usage: test_modules_demux_ts_bench file.ts [runs [all]]
+ *
+ * Demuxes a capture (ideally a multi-program one) as fast as possible into
+ * an ES output that drops everything, and reports the packets per second.
+ * With "all", every program is selected, instead of the first one only. */
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_demux.h>
+#include <vlc_es_out.h>
+#include <vlc_stream.h>
+#include <vlc_url.h>
+
+#include <string.h>
+
+struct es_out_sys_t
+{
+    unsigned i_es;
+    uint64_t i_blocks;
+    uint64_t i_bytes;
+};
+
+static es_out_id_t *EsOutAdd( es_out_t *out, const es_format_t *fmt )
+{
+    (void) fmt;
+    out->p_sys->i_es++;
+    /* any non NULL value: the demuxer does not look into it */
+    return (es_out_id_t *)out;
+}
+
+static int EsOutSend( es_out_t *out, es_out_id_t *id, block_t *block )
+{
+    (void) id;
+    for( block_t *b = block; b != NULL; b = b->p_next )
+        out->p_sys->i_bytes += b->i_buffer;
+    out->p_sys->i_blocks++;
+    block_ChainRelease( block );
+    return VLC_SUCCESS;
+}
+
+static void EsOutDel( es_out_t *out, es_out_id_t *id )
+{
+    (void) out; (void) id;
+}
+
+static int EsOutControl( es_out_t *out, int query, va_list args )
+{
+    (void) out; (void) args;
+
+    switch( query )
+    {
+        case ES_OUT_GET_ES_STATE:
+        {
+            (void) va_arg( args, es_out_id_t * );
+            *va_arg( args, bool * ) = true;
+            return VLC_SUCCESS;
+        }
+        default:
+            return VLC_EGENERIC;
+    }
+}
+
+int main( int argc, char *argv[] )
+{
+    if( argc < 2 )
+    {
+        fprintf( stderr, "Usage: %s file.ts [runs [all]]\n", argv[0] );
+        return 77;
+    }
+
+    unsigned runs = (argc > 2) ? atoi( argv[2] ) : 5;
+    bool all = argc > 3 && !strcmp( argv[3], "all" );
+
+    test_init();
+    alarm( 0 );
+
+    const char *vlc_argv[] = { "--ignore-config", "-q" };
+    libvlc_instance_t *vlc = libvlc_new( sizeof (vlc_argv)
+                                         / sizeof (vlc_argv[0]), vlc_argv );
+    assert( vlc != NULL );
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+
+    char *url = vlc_path2uri( argv[1], NULL );
+    assert( url != NULL );
+
+    for( unsigned run = 0; run < runs; run++ )
+    {
+        struct es_out_sys_t sys = { 0, 0, 0 };
+        es_out_t out = {
+            .pf_add = EsOutAdd,
+            .pf_send = EsOutSend,
+            .pf_del = EsOutDel,
+            .pf_control = EsOutControl,
+            .p_sys = &sys,
+        };
+
+        stream_t *s = stream_UrlNew( obj, url );
+        if( s == NULL )
+        {
+            log( "cannot open %s\n", argv[1] );
+            free( url );
+            libvlc_release( vlc );
+            return 77;
+        }
+
+        demux_t *demux = demux_New( obj, "ts", argv[1], s, &out );
+        if( demux == NULL )
+        {
+            log( "TS demuxer not available or not a TS file\n" );
+            stream_Delete( s );
+            free( url );
+            libvlc_release( vlc );
+            return 77;
+        }
+        if( all )
+            demux_Control( demux, DEMUX_SET_GROUP, -1, NULL );
+
+        uint64_t size = stream_Size( s );
+        mtime_t start = mdate();
+
+        while( demux_Demux( demux ) == VLC_DEMUXER_SUCCESS );
+
+        mtime_t elapsed = mdate() - start;
+        demux_Delete( demux ); /* also deletes the stream */
+
+        if( elapsed <= 0 )
+            elapsed = 1;
+        printf( "run %u: %"PRIu64" packets in %"PRId64" ms: %"PRIu64
+                " packets/s, %"PRIu64" MiB/s, %u ES, %"PRIu64" blocks, "
+                "%"PRIu64" bytes\n", run, size / 188, elapsed / 1000,
+                size / 188 * CLOCK_FREQ / elapsed,
+                size * CLOCK_FREQ / elapsed / (1024 * 1024),
+                sys.i_es, sys.i_blocks, sys.i_bytes );
+    }
+
+    free( url );
+    libvlc_release( vlc );
+    return 0;
+}
@@ -0,0 +1,99 @@
+/*****************************************************************************
+ * csa.c: CSA scrambler test
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Checks the bitsliced scrambler against the packet by packet one, with
+ * random packets, keys and batch sizes. */
+
+#undef NDEBUG
+#include "../../../modules/mux/mpeg/csa.c"
+
+#include <stdio.h>
+
+static uint8_t pkts[2][600][188];
+
+static void test_keystream( csa_t *c, const char *name, unsigned i_lanes,
+                            csa_keystream_t keystream )
+{
+    printf( "testing %s (%u lanes)\n", name, i_lanes );
+    c->keystream = keystream;
+    c->i_lanes = i_lanes;
+
+    for( int run = 0; run < 50; run++ )
+    {
+        uint8_t ck[8];
+
+        for( int i = 0; i < 8; i++ )
+            ck[i] = rand();
+        c->use_odd = rand() & 1;
+        if( c->use_odd )
+        {
+            memcpy( c->o_ck, ck, 8 );
+            csa_ComputeKey( c->o_kk, ck );
+        }
+        else
+        {
+            memcpy( c->e_ck, ck, 8 );
+            csa_ComputeKey( c->e_kk, ck );
+        }
+
+        const int i_pkts = 1 + rand() % 600;
+        const int i_pkt_size = (run & 1) ? 188 : 12 + rand() % (188 - 12 + 1);
+        uint8_t *batch[600];
+
+        for( int k = 0; k < i_pkts; k++ )
+        {
+            for( int i = 0; i < 188; i++ )
+                pkts[0][k][i] = rand();
+            pkts[0][k][0] = 0x47;
+            pkts[0][k][3] &= 0x3f;
+            if( pkts[0][k][3] & 0x20 ) /* adaptation field */
+                pkts[0][k][4] = rand() % 184;
+            memcpy( pkts[1][k], pkts[0][k], 188 );
+            batch[k] = pkts[1][k];
+        }
+
+        for( int k = 0; k < i_pkts; k++ )
+            csa_Encrypt( c, pkts[0][k], i_pkt_size );
+        csa_EncryptBatch( c, batch, i_pkts, i_pkt_size );
+
+        for( int k = 0; k < i_pkts; k++ )
+            assert( memcmp( pkts[0][k], pkts[1][k], 188 ) == 0 );
+    }
+}
+
+int main( void )
+{
+    csa_t *c = csa_New();
+    assert( c != NULL );
+    srand( 42 );
+
+    test_keystream( c, "C", 64, csa_bs64_keystream );
+#ifdef HAVE_SSE2_INTRINSICS
+    if( vlc_CPU_SSE2() )
+        test_keystream( c, "SSE2", 128, csa_bs128_keystream );
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+    if( vlc_CPU_AVX2() )
+        test_keystream( c, "AVX2", 256, csa_bs256_keystream );
+#endif
+
+    csa_Delete( c );
+    return 0;
+}
@@ -0,0 +1,254 @@
+/*****************************************************************************
+ * ts.c: TS muxer regression test
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Muxes the same synthetic streams with and without packetization threads
+ * and checks that the outputs are identical. */
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_es.h>
+#include <vlc_sout.h>
+
+#include <string.h>
+
+#define DURATION (10 * CLOCK_FREQ)
+
+struct test_es
+{
+    int          i_cat;
+    vlc_fourcc_t i_codec;
+    mtime_t      i_interval;
+    size_t       i_size;
+    sout_input_t *p_input;
+    mtime_t      i_next;
+    unsigned     i_count;
+};
+
+static uint32_t rnd_state;
+
+static uint32_t rnd( void )
+{
+    /* xorshift32: the same data for every run */
+    rnd_state ^= rnd_state << 13;
+    rnd_state ^= rnd_state >> 17;
+    rnd_state ^= rnd_state << 5;
+    return rnd_state;
+}
+
+static block_t *es_NewBlock( struct test_es *es )
+{
+    size_t i_size = es->i_size;
+
+    if( es->i_cat == VIDEO_ES && es->i_count % 12 != 0 )
+        i_size = i_size / 4 + rnd() % (i_size / 4);
+
+    block_t *p_block = block_Alloc( i_size );
+    assert( p_block != NULL );
+
+    if( es->i_codec == VLC_CODEC_SUBT )
+    {
+        memset( p_block->p_buffer, 0, i_size );
+        snprintf( (char *)p_block->p_buffer, i_size, "subtitle %u",
+                  es->i_count );
+    }
+    else
+        for( size_t i = 0; i < i_size; i++ )
+            p_block->p_buffer[i] = rnd();
+
+    p_block->i_dts = p_block->i_pts = es->i_next;
+    p_block->i_length = es->i_interval;
+    if( es->i_cat == VIDEO_ES && es->i_count % 12 == 0 )
+        p_block->i_flags |= BLOCK_FLAG_TYPE_I;
+
+    es->i_next += es->i_interval;
+    es->i_count++;
+    return p_block;
+}
+
+static block_t *mux( libvlc_instance_t *p_vlc, const char *psz_options,
+                     unsigned i_threads )
+{
+    sout_instance_t *p_sout = vlc_object_create( p_vlc->p_libvlc_int,
+                                                 sizeof(*p_sout) );
+    assert( p_sout != NULL );
+    p_sout->psz_sout = NULL;
+    p_sout->i_out_pace_nocontrol = 0;
+    p_sout->p_stream = NULL;
+    vlc_mutex_init( &p_sout->lock );
+
+    FILE *stream = tmpfile();
+    assert( stream != NULL );
+
+    char psz_fd[16], *psz_mux;
+    snprintf( psz_fd, sizeof(psz_fd), "%d", fileno( stream ) );
+    int i_ret = asprintf( &psz_mux, "ts{threads=%u%s%s}", i_threads,
+                          *psz_options ? "," : "", psz_options );
+    assert( i_ret != -1 );
+    (void) i_ret;
+
+    sout_access_out_t *p_access = sout_AccessOutNew( p_sout, "fd", psz_fd );
+    assert( p_access != NULL );
+
+    sout_mux_t *p_mux = sout_MuxNew( p_sout, psz_mux, p_access );
+    free( psz_mux );
+    if( p_mux == NULL )
+    {
+        sout_AccessOutDelete( p_access );
+        fclose( stream );
+        vlc_mutex_destroy( &p_sout->lock );
+        vlc_object_release( p_sout );
+        return NULL;
+    }
+
+    struct test_es es[] = {
+        { VIDEO_ES, VLC_CODEC_MPGV, 40000, 60000, NULL, 0, 0 },
+        { AUDIO_ES, VLC_CODEC_A52,  32000, 1536,  NULL, 0, 0 },
+        { AUDIO_ES, VLC_CODEC_A52,  32000, 768,   NULL, 0, 0 },
+        { AUDIO_ES, VLC_CODEC_MPGA, 24000, 576,   NULL, 0, 0 },
+        { SPU_ES,   VLC_CODEC_SUBT, 2000000, 32,  NULL, 0, 0 },
+    };
+    const size_t i_es = sizeof(es) / sizeof(es[0]);
+
+    for( size_t i = 0; i < i_es; i++ )
+    {
+        es_format_t fmt;
+
+        es_format_Init( &fmt, es[i].i_cat, es[i].i_codec );
+        fmt.i_id = i + 1;
+        if( es[i].i_cat == AUDIO_ES )
+        {
+            fmt.audio.i_channels = 2;
+            fmt.audio.i_rate = 48000;
+        }
+        es[i].p_input = sout_MuxAddStream( p_mux, &fmt );
+        assert( es[i].p_input != NULL );
+        es[i].i_next = VLC_TS_0 + CLOCK_FREQ;
+    }
+
+    rnd_state = 0x12345678;
+    for( ;; )
+    {
+        /* send the blocks in dts order, as a demux would */
+        struct test_es *p_es = &es[0];
+        for( size_t i = 1; i < i_es; i++ )
+            if( es[i].i_next < p_es->i_next )
+                p_es = &es[i];
+        if( p_es->i_next > VLC_TS_0 + CLOCK_FREQ + DURATION )
+            break;
+
+        sout_MuxSendBuffer( p_mux, p_es->p_input, es_NewBlock( p_es ) );
+    }
+
+    for( size_t i = 0; i < i_es; i++ )
+        sout_MuxDeleteStream( p_mux, es[i].p_input );
+    sout_MuxDelete( p_mux );
+    sout_AccessOutDelete( p_access );
+    vlc_mutex_destroy( &p_sout->lock );
+    vlc_object_release( p_sout );
+
+    /* read the output back */
+    i_ret = fseek( stream, 0, SEEK_END );
+    assert( i_ret == 0 );
+    long i_size = ftell( stream );
+    assert( i_size > 0 && i_size % 188 == 0 );
+    rewind( stream );
+
+    block_t *p_out = block_Alloc( i_size );
+    assert( p_out != NULL );
+    size_t i_read = fread( p_out->p_buffer, 1, i_size, stream );
+    assert( i_read == (size_t)i_size );
+    (void) i_read;
+    fclose( stream );
+    return p_out;
+}
+
+#define PMT_PID 32 /* pid-pmt default */
+
+/* The PAT, PMT and SDT carry randomly chosen version numbers and ids, so
+ * only the headers of their packets are compared. */
+static void compare( const block_t *p_ref, const block_t *p_out )
+{
+    assert( p_out->i_buffer == p_ref->i_buffer );
+
+    for( size_t i = 0; i < p_ref->i_buffer; i += 188 )
+    {
+        const uint8_t *p_a = &p_ref->p_buffer[i], *p_b = &p_out->p_buffer[i];
+        unsigned i_pid = ((p_a[1] & 0x1f) << 8) | p_a[2];
+
+        assert( memcmp( p_a, p_b, 4 ) == 0 );
+        if( i_pid != 0x00 && i_pid != 0x11 && i_pid != PMT_PID )
+            assert( memcmp( p_a, p_b, 188 ) == 0 );
+    }
+}
+
+static const char *const options[] = {
+    "",
+    "use-key-frames",
+    "shaping=500,pcr=30",
+    "alignment=0",
+};
+
+int main( void )
+{
+    const char *argv[] = {
+        "-v",
+        "--ignore-config",
+        "-I",
+        "dummy",
+        "--no-media-library",
+    };
+
+    test_init();
+
+    libvlc_instance_t *p_vlc = libvlc_new( sizeof(argv) / sizeof(argv[0]),
+                                           argv );
+    assert( p_vlc != NULL );
+
+    for( size_t i = 0; i < sizeof(options) / sizeof(options[0]); i++ )
+    {
+        log( "Testing TS mux with \"%s\"\n", options[i] );
+
+        block_t *p_ref = mux( p_vlc, options[i], 1 );
+        if( p_ref == NULL )
+        {
+            /* only built along with the muxer: this is a failure */
+            log( "ERROR: TS muxer not available\n" );
+            libvlc_release( p_vlc );
+            return 1;
+        }
+
+        for( unsigned i_threads = 2; i_threads <= 4; i_threads += 2 )
+        {
+            block_t *p_out = mux( p_vlc, options[i], i_threads );
+
+            assert( p_out != NULL );
+            log( "  %u threads: %zu bytes\n", i_threads, p_out->i_buffer );
+            compare( p_ref, p_out );
+            block_Release( p_out );
+        }
+        block_Release( p_ref );
+    }
+
+    libvlc_release( p_vlc );
+    return 0;
+}
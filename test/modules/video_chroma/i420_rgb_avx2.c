@@ -0,0 +1,169 @@
+/*****************************************************************************
+ * i420_rgb_avx2.c: AVX2 I420 to RV32 converter test
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Checks the AVX2 lines against the C ones, with random lines, widths and
+ * alignments, then whole pictures with margins, for the four byte orders. */
+
+#undef NDEBUG
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+
+#ifdef HAVE_AVX2_INTRINSICS
+# include "../../../modules/video_chroma/i420_rgb_avx2.c"
+#endif
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#define WIDTH 300
+
+#ifdef HAVE_AVX2_INTRINSICS
+static const struct
+{
+    const char *psz_name;
+    const rgb32_layout_t *p_layout;
+    void (*pf_convert)( filter_t *, picture_t *, picture_t *, unsigned );
+} layouts[] = {
+    { "ARGB", &layout_argb, I420_A8R8G8B8 },
+    { "RGBA", &layout_rgba, I420_R8G8B8A8 },
+    { "BGRA", &layout_bgra, I420_B8G8R8A8 },
+    { "ABGR", &layout_abgr, I420_A8B8G8R8 },
+};
+
+static void fill( uint8_t *p, size_t i_size )
+{
+    for( size_t i = 0; i < i_size; i++ )
+        p[i] = rand();
+}
+
+static void test_line( rgb32_layout_t layout )
+{
+    static uint8_t y[WIDTH + 32], u[WIDTH / 2 + 32], v[WIDTH / 2 + 32];
+    static uint8_t out[2][4 * WIDTH + 32];
+
+    for( int run = 0; run < 1000; run++ )
+    {
+        /* odd widths too: the last chroma sample covers a single pixel */
+        unsigned i_width = rand() % WIDTH;
+        const uint8_t *p_y = &y[rand() % 32];
+        const uint8_t *p_u = &u[rand() % 32];
+        const uint8_t *p_v = &v[rand() % 32];
+        unsigned i_offset = rand() % 32;
+
+        fill( y, sizeof (y) );
+        fill( u, sizeof (u) );
+        fill( v, sizeof (v) );
+        fill( out[0], sizeof (out[0]) );
+        memcpy( out[1], out[0], sizeof (out[0]) );
+
+        I420_RGB32_Line_C( &out[0][i_offset], p_y, p_u, p_v, i_width, layout );
+        I420_RGB32_Line_AVX2( &out[1][i_offset], p_y, p_u, p_v, i_width,
+                              layout );
+        assert( memcmp( out[0], out[1], sizeof (out[0]) ) == 0 );
+    }
+}
+
+static picture_t *NewPicture( vlc_fourcc_t i_chroma, unsigned i_width,
+                              unsigned i_height, unsigned i_margin )
+{
+    video_format_t fmt;
+
+    /* the margin ends up in the pitch, but not in the visible pitch */
+    video_format_Setup( &fmt, i_chroma, i_width + i_margin, i_height,
+                        i_width, i_height, 1, 1 );
+    picture_t *p_pic = picture_NewFromFormat( &fmt );
+    assert( p_pic != NULL );
+    for( int i = 0; i < p_pic->i_planes; i++ )
+        fill( p_pic->p[i].p_pixels, p_pic->p[i].i_pitch * p_pic->p[i].i_lines );
+    return p_pic;
+}
+
+static void test_picture( rgb32_layout_t layout,
+                          void (*pf_convert)( filter_t *, picture_t *,
+                                              picture_t *, unsigned ) )
+{
+    filter_t filter;
+
+    for( int run = 0; run < 100; run++ )
+    {
+        unsigned i_width = 2 + 2 * (rand() % (WIDTH / 2));
+        unsigned i_height = 2 + 2 * (rand() % 10);
+        vlc_fourcc_t i_chroma = (run & 1) ? VLC_CODEC_YV12 : VLC_CODEC_I420;
+
+        memset( &filter, 0, sizeof (filter) );
+        video_format_Setup( &filter.fmt_in.video, i_chroma,
+                            i_width, i_height, i_width, i_height, 1, 1 );
+        video_format_Setup( &filter.fmt_out.video, VLC_CODEC_RGB32,
+                            i_width, i_height, i_width, i_height, 1, 1 );
+
+        picture_t *p_src = NewPicture( i_chroma, i_width, i_height,
+                                       2 * (rand() % 32) );
+        picture_t *p_ref = NewPicture( VLC_CODEC_RGB32, i_width, i_height,
+                                       rand() % 32 );
+        picture_t *p_dst = picture_NewFromFormat( &p_ref->format );
+        assert( p_dst != NULL );
+        memcpy( p_dst->p->p_pixels, p_ref->p->p_pixels,
+                p_ref->p->i_pitch * p_ref->p->i_lines );
+
+        /* YV12 has the chroma planes swapped */
+        int i_u = (i_chroma == VLC_CODEC_YV12) ? V_PLANE : U_PLANE;
+        int i_v = (i_chroma == VLC_CODEC_YV12) ? U_PLANE : V_PLANE;
+        for( unsigned i_y = 0; i_y < i_height; i_y++ )
+            I420_RGB32_Line_C( &p_ref->p->p_pixels[i_y * p_ref->p->i_pitch],
+                &p_src->p[Y_PLANE].p_pixels[i_y * p_src->p[Y_PLANE].i_pitch],
+                &p_src->p[i_u].p_pixels[i_y / 2 * p_src->p[i_u].i_pitch],
+                &p_src->p[i_v].p_pixels[i_y / 2 * p_src->p[i_v].i_pitch],
+                i_width, layout );
+        pf_convert( &filter, p_src, p_dst, i_height );
+
+        /* the margins must be left alone too */
+        assert( memcmp( p_ref->p->p_pixels, p_dst->p->p_pixels,
+                        p_ref->p->i_pitch * p_ref->p->i_lines ) == 0 );
+
+        picture_Release( p_dst );
+        picture_Release( p_ref );
+        picture_Release( p_src );
+    }
+}
+#endif
+
+int main( void )
+{
+    srand( 42 );
+
+#ifdef HAVE_AVX2_INTRINSICS
+    if( vlc_CPU_AVX2() )
+    {
+        for( size_t i = 0; i < ARRAY_SIZE(layouts); i++ )
+        {
+            printf( "testing %s\n", layouts[i].psz_name );
+            test_line( *layouts[i].p_layout );
+            test_picture( *layouts[i].p_layout, layouts[i].pf_convert );
+        }
+        return 0;
+    }
+#endif
+    return 77;
+}
@@ -0,0 +1,128 @@
+/*****************************************************************************
+ * yuy2_i420.c: packed to planar YUV converter test
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Checks the AVX2 unpacking against the C one, with random pictures, sizes
+ * and margins, for the three packed layouts. */
+
+#undef NDEBUG
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+
+#ifdef HAVE_AVX2_INTRINSICS
+/* lets the test run the C path on an AVX2 machine */
+static bool b_avx2 = true;
+# undef vlc_CPU_AVX2
+# define vlc_CPU_AVX2() (b_avx2 && (vlc_CPU() & VLC_CPU_AVX2))
+
+# include "../../../modules/video_chroma/yuy2_i420.c"
+#endif
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef HAVE_AVX2_INTRINSICS
+static void fill( picture_t *p_pic )
+{
+    for( int i = 0; i < p_pic->i_planes; i++ )
+        for( int j = 0; j < p_pic->p[i].i_pitch * p_pic->p[i].i_lines; j++ )
+            p_pic->p[i].p_pixels[j] = rand();
+}
+
+static picture_t *NewPicture( vlc_fourcc_t i_chroma, unsigned i_width,
+                              unsigned i_height, unsigned i_margin )
+{
+    video_format_t fmt;
+
+    /* the margin ends up in the pitch, but not in the visible pitch */
+    video_format_Setup( &fmt, i_chroma, i_width + i_margin, i_height,
+                        i_width, i_height, 1, 1 );
+    picture_t *p_pic = picture_NewFromFormat( &fmt );
+    assert( p_pic != NULL );
+    fill( p_pic );
+    return p_pic;
+}
+
+static void test( vlc_fourcc_t i_chroma,
+                  void (*pf_convert)( filter_t *, picture_t *, picture_t *,
+                                      unsigned ) )
+{
+    filter_t filter;
+
+    printf( "testing %4.4s\n", (const char *)&i_chroma );
+
+    for( int run = 0; run < 200; run++ )
+    {
+        /* any even size, down to a single macropixel */
+        unsigned i_width = 2 + 2 * (rand() % 200);
+        unsigned i_height = 2 + 2 * (rand() % 10);
+
+        memset( &filter, 0, sizeof (filter) );
+        video_format_Setup( &filter.fmt_in.video, i_chroma, i_width, i_height,
+                            i_width, i_height, 1, 1 );
+        video_format_Setup( &filter.fmt_out.video, VLC_CODEC_I420,
+                            i_width, i_height, i_width, i_height, 1, 1 );
+
+        picture_t *p_src = NewPicture( i_chroma, i_width, i_height,
+                                       2 * (rand() % 32) );
+        picture_t *p_ref = NewPicture( VLC_CODEC_I420, i_width, i_height,
+                                       2 * (rand() % 32) );
+        picture_t *p_dst = picture_NewFromFormat( &p_ref->format );
+        assert( p_dst != NULL );
+        for( int i = 0; i < p_ref->i_planes; i++ )
+            memcpy( p_dst->p[i].p_pixels, p_ref->p[i].p_pixels,
+                    p_ref->p[i].i_pitch * p_ref->p[i].i_lines );
+
+        b_avx2 = false;
+        pf_convert( &filter, p_src, p_ref, i_height );
+        b_avx2 = true;
+        pf_convert( &filter, p_src, p_dst, i_height );
+
+        /* the margins must be left alone too */
+        for( int i = 0; i < p_ref->i_planes; i++ )
+            assert( memcmp( p_ref->p[i].p_pixels, p_dst->p[i].p_pixels,
+                            p_ref->p[i].i_pitch * p_ref->p[i].i_lines ) == 0 );
+
+        picture_Release( p_dst );
+        picture_Release( p_ref );
+        picture_Release( p_src );
+    }
+}
+#endif
+
+int main( void )
+{
+    srand( 42 );
+
+#ifdef HAVE_AVX2_INTRINSICS
+    if( vlc_CPU_AVX2() )
+    {
+        test( VLC_CODEC_YUYV, YUY2_I420 );
+        test( VLC_CODEC_YVYU, YVYU_I420 );
+        test( VLC_CODEC_UYVY, UYVY_I420 );
+        return 0;
+    }
+#endif
+    return 77;
+}
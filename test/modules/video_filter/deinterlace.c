@@ -0,0 +1,177 @@
+/*****************************************************************************
+ * deinterlace.c: deinterlacer SIMD kernels test
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Checks the AVX2 merge, yadif and phosphor kernels against the C ones,
+ * with random lines, sizes and alignments. */
+
+#undef NDEBUG
+#include "../../../modules/video_filter/deinterlace/merge.c"
+#include "../../../modules/video_filter/deinterlace/helpers.c"
+#include "../../../modules/video_filter/deinterlace/algo_phosphor.c"
+#ifdef HAVE_AVX2_INTRINSICS
+# include "../../../modules/video_filter/deinterlace/yadif.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#define WIDTH 300
+#define MARGIN 64 /* yadif reads a few pixels and two lines around */
+
+static uint8_t src[2][MARGIN + 2 * WIDTH + MARGIN];
+static uint8_t out[2][2 * WIDTH + 32];
+
+static void fill( uint8_t *p, size_t i_size )
+{
+    for( size_t i = 0; i < i_size; i++ )
+        p[i] = rand();
+}
+
+#ifdef HAVE_AVX2_INTRINSICS
+static void test_merge( void )
+{
+    printf( "testing merge\n" );
+
+    for( int run = 0; run < 1000; run++ )
+    {
+        size_t i_bytes = rand() % (2 * WIDTH);
+        const uint8_t *s1 = &src[0][MARGIN + rand() % 32];
+        const uint8_t *s2 = &src[1][MARGIN + rand() % 32];
+
+        fill( src[0], sizeof (src[0]) );
+        fill( src[1], sizeof (src[1]) );
+        memset( out, 0, sizeof (out) );
+
+        Merge8BitGeneric( out[0], s1, s2, i_bytes );
+        Merge8BitAVX2( out[1], s1, s2, i_bytes );
+        assert( memcmp( out[0], out[1], sizeof (out[0]) ) == 0 );
+
+        /* keep 2-byte alignment for 16-bit pixels */
+        s1 = &src[0][MARGIN + 2 * (rand() % 16)];
+        s2 = &src[1][MARGIN + 2 * (rand() % 16)];
+        Merge16BitGeneric( out[0], s1, s2, i_bytes );
+        Merge16BitAVX2( out[1], s1, s2, i_bytes );
+        assert( memcmp( out[0], out[1], sizeof (out[0]) ) == 0 );
+    }
+}
+
+static void test_yadif( void )
+{
+    /* five lines per picture: 2 above and 2 below the interpolated one */
+    static uint8_t pics[3][5 * WIDTH + 2 * MARGIN];
+    const int i_pitch = WIDTH;
+
+    printf( "testing yadif\n" );
+
+    for( int run = 0; run < 1000; run++ )
+    {
+        int w = 1 + rand() % (WIDTH - 2 * 4);
+        int parity = rand() & 1;
+        int mode = (rand() & 1) ? 0 : 2;
+
+        for( int i = 0; i < 3; i++ )
+            fill( pics[i], sizeof (pics[i]) );
+        /* make some areas static, so that both branches are taken */
+        if( run & 2 )
+            memcpy( pics[2], pics[0], sizeof (pics[0]) );
+        memset( out, 0, sizeof (out) );
+
+        uint8_t *prev = &pics[0][MARGIN + 2 * i_pitch + 4];
+        uint8_t *cur  = &pics[1][MARGIN + 2 * i_pitch + 4];
+        uint8_t *next = &pics[2][MARGIN + 2 * i_pitch + 4];
+
+        yadif_filter_line_c( out[0], prev, cur, next, w,
+                             i_pitch, -i_pitch, parity, mode );
+        yadif_filter_line_avx2( out[1], prev, cur, next, w,
+                                i_pitch, -i_pitch, parity, mode );
+        assert( memcmp( out[0], out[1], sizeof (out[0]) ) == 0 );
+    }
+
+    /* the other kernels come with the header but are not compared here */
+    (void) yadif_filter_line_c_16bit;
+#ifdef HAVE_YADIF_MMX
+    (void) yadif_filter_line_mmx;
+#endif
+#ifdef HAVE_YADIF_SSE2
+    (void) yadif_filter_line_sse2;
+#endif
+#ifdef HAVE_YADIF_SSSE3
+    (void) yadif_filter_line_ssse3;
+#endif
+}
+
+static void test_phosphor( void )
+{
+    video_format_t fmt;
+
+    printf( "testing phosphor\n" );
+
+    for( int run = 0; run < 100; run++ )
+    {
+        int i_width = 2 + 2 * (rand() % 200);
+        int i_height = 2 + 2 * (rand() % 20);
+        vlc_fourcc_t i_chroma = (run & 1) ? VLC_CODEC_I444 : VLC_CODEC_I420;
+
+        video_format_Init( &fmt, i_chroma );
+        video_format_Setup( &fmt, i_chroma, i_width, i_height,
+                            i_width, i_height, 1, 1 );
+
+        picture_t *ref = picture_NewFromFormat( &fmt );
+        picture_t *pic = picture_NewFromFormat( &fmt );
+        assert( ref != NULL && pic != NULL );
+
+        for( int i = 0; i < ref->i_planes; i++ )
+            fill( ref->p[i].p_pixels, ref->p[i].i_pitch * ref->p[i].i_lines );
+        picture_CopyPixels( pic, ref );
+
+        int i_field = rand() & 1;
+        int i_strength = 1 + rand() % 3;
+        bool process_chroma = run & 1;
+
+        DarkenField( ref, i_field, i_strength, process_chroma );
+        DarkenFieldAVX2( pic, i_field, i_strength, process_chroma );
+
+        for( int i = 0; i < ref->i_planes; i++ )
+            for( int y = 0; y < ref->p[i].i_visible_lines; y++ )
+                assert( memcmp( &ref->p[i].p_pixels[y * ref->p[i].i_pitch],
+                                &pic->p[i].p_pixels[y * pic->p[i].i_pitch],
+                                ref->p[i].i_visible_pitch ) == 0 );
+
+        picture_Release( pic );
+        picture_Release( ref );
+    }
+}
+#endif
+
+int main( void )
+{
+    srand( 42 );
+
+#ifdef HAVE_AVX2_INTRINSICS
+    if( vlc_CPU_AVX2() )
+    {
+        test_merge();
+        test_yadif();
+        test_phosphor();
+        return 0;
+    }
+#endif
+    return 77;
+}
@@ -0,0 +1,463 @@
+/*****************************************************************************
+ * filter_bench.c: video filter and chroma converter benchmark
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Usage: test_modules_video_filter_bench [options] chain
+ *
+ * Runs pictures through a video filter chain (as given to --video-filter,
+ * e.g. "deinterlace{mode=yadif}:adjust") or, with -o, through a chroma
+ * converter (named by the chain argument, or "any"), as fast as possible.
+ * It reports the time per frame, the throughput and the bytes read and
+ * written per plane. The pictures are synthetic unless -i is given.
+ * With -j, the results are printed as a single JSON object, so that they
+ * can be compared across machines and releases. */
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_modules.h>
+#include <vlc_filter.h>
+#include <vlc_image.h>
+#include <vlc_picture_pool.h>
+#include <vlc_url.h>
+
+#include <string.h>
+#include <limits.h>
+
+#define POOL_SIZE 16 /* input pictures; deinterlacers keep a few of them */
+
+struct bench
+{
+    filter_chain_t *chain;
+    filter_t *converter;
+};
+
+struct plane_stats
+{
+    uint64_t i_bytes; /* per picture */
+};
+
+static picture_t *BufferNew( filter_t *filter )
+{
+    return picture_NewFromFormat( &filter->fmt_out.video );
+}
+
+static filter_t *ConverterNew( vlc_object_t *obj, const char *name,
+                               const video_format_t *fmt_in,
+                               const video_format_t *fmt_out )
+{
+    filter_t *filter = vlc_object_create( obj, sizeof (*filter) );
+    if( filter == NULL )
+        return NULL;
+
+    es_format_InitFromVideo( &filter->fmt_in, fmt_in );
+    es_format_InitFromVideo( &filter->fmt_out, fmt_out );
+    filter->owner.video.buffer_new = BufferNew;
+
+    bool strict = strcmp( name, "any" ) != 0;
+    /* converters are video filters with different input and output
+     * chromas */
+    filter->p_module = module_need( filter, "video filter2",
+                                    strict ? name : NULL, strict );
+    if( filter->p_module == NULL )
+    {
+        es_format_Clean( &filter->fmt_out );
+        es_format_Clean( &filter->fmt_in );
+        vlc_object_release( filter );
+        return NULL;
+    }
+    return filter;
+}
+
+static void ConverterDelete( filter_t *filter )
+{
+    module_unneed( filter, filter->p_module );
+    es_format_Clean( &filter->fmt_out );
+    es_format_Clean( &filter->fmt_in );
+    vlc_object_release( filter );
+}
+
+static picture_t *BenchFilter( struct bench *bench, picture_t *pic )
+{
+    if( bench->converter != NULL )
+        return bench->converter->pf_video_filter( bench->converter, pic );
+    return filter_chain_VideoFilter( bench->chain, pic );
+}
+
+static uint32_t rnd_state;
+
+static uint32_t rnd( void )
+{
+    /* xorshift32: the same pictures for every run */
+    rnd_state ^= rnd_state << 13;
+    rnd_state ^= rnd_state >> 17;
+    rnd_state ^= rnd_state << 5;
+    return rnd_state;
+}
+
+static void FillSynthetic( picture_t *pic, unsigned i_index )
+{
+    /* moving gradients with some noise, so that motion adaptive and
+     * content dependent filters do not take trivial paths */
+    for( int i = 0; i < pic->i_planes; i++ )
+    {
+        plane_t *p = &pic->p[i];
+
+        for( int y = 0; y < p->i_lines; y++ )
+        {
+            uint8_t *row = &p->p_pixels[y * p->i_pitch];
+
+            for( int x = 0; x < p->i_pitch; x++ )
+                row[x] = (x + 2 * y + 5 * i_index + 64 * i)
+                       + (rnd() & 0x0f);
+        }
+    }
+}
+
+static void PlaneBytes( const picture_t *pic, struct plane_stats *stats )
+{
+    for( int i = 0; i < pic->i_planes; i++ )
+        stats[i].i_bytes = (uint64_t)pic->p[i].i_visible_pitch
+                         * pic->p[i].i_visible_lines;
+}
+
+/* Prints a JSON string literal, as the chain and the thread count come
+ * from the command line */
+static void PrintJSONString( const char *str )
+{
+    putchar( '"' );
+    for( const unsigned char *p = (const unsigned char *)str; *p; p++ )
+    {
+        if( *p == '"' || *p == '\\' )
+            printf( "\\%c", *p );
+        else if( *p < 0x20 )
+            printf( "\\u%04x", *p );
+        else
+            putchar( *p );
+    }
+    putchar( '"' );
+}
+
+static void PrintPlanes( bool json, const char *name,
+                         const struct plane_stats *stats, int i_planes,
+                         unsigned i_frames, mtime_t elapsed )
+{
+    if( json )
+        printf( ", \"%s\": [", name );
+    for( int i = 0; i < i_planes; i++ )
+    {
+        uint64_t i_rate = stats[i].i_bytes * i_frames * CLOCK_FREQ / elapsed;
+
+        if( json )
+            printf( "%s{\"bytes\": %"PRIu64", \"bytes_per_s\": %"PRIu64"}",
+                    i ? ", " : "", stats[i].i_bytes, i_rate );
+        else
+            printf( "  %s plane %d: %"PRIu64" bytes/frame, %"PRIu64
+                    " MiB/s\n", name, i, stats[i].i_bytes,
+                    i_rate / (1024 * 1024) );
+    }
+    if( json )
+        printf( "]" );
+}
+
+static void Usage( const char *psz_name )
+{
+    fprintf( stderr,
+        "Usage: %s [options] chain\n"
+        "  -c chroma   input chroma (default I420)\n"
+        "  -o chroma   benchmark a chroma converter to this chroma; the chain\n"
+        "              is then the converter module name, or \"any\"\n"
+        "  -s WxH      picture size (default 1920x1080)\n"
+        "  -n frames   number of timed frames (default 200)\n"
+        "  -w frames   number of warm-up frames (default 10)\n"
+        "  -i image    read the input picture from an image file\n"
+        "  -t threads  video filter threads (default 0: automatic)\n"
+        "  -j          print the results as JSON\n", psz_name );
+}
+
+int main( int argc, char *argv[] )
+{
+    const char *psz_chroma = "I420", *psz_out_chroma = NULL;
+    const char *psz_image = NULL, *psz_threads = "0";
+    unsigned i_width = 1920, i_height = 1080;
+    unsigned i_frames = 200, i_warmup = 10;
+    bool json = false;
+    int c;
+
+    while( (c = getopt( argc, argv, "c:o:s:n:w:i:t:j" )) != -1 )
+    {
+        switch( c )
+        {
+            case 'c': psz_chroma = optarg; break;
+            case 'o': psz_out_chroma = optarg; break;
+            case 's':
+                if( sscanf( optarg, "%ux%u", &i_width, &i_height ) != 2
+                 || i_width == 0 || i_height == 0 )
+                {
+                    Usage( argv[0] );
+                    return 77;
+                }
+                break;
+            case 'n': i_frames = strtoul( optarg, NULL, 10 ); break;
+            case 'w': i_warmup = strtoul( optarg, NULL, 10 ); break;
+            case 'i': psz_image = optarg; break;
+            case 't': psz_threads = optarg; break;
+            case 'j': json = true; break;
+            default:
+                Usage( argv[0] );
+                return 77;
+        }
+    }
+    if( optind + 1 != argc || i_frames == 0 )
+    {
+        Usage( argv[0] );
+        return 77;
+    }
+    const char *psz_chain = argv[optind];
+
+    vlc_fourcc_t i_chroma = vlc_fourcc_GetCodecFromString( VIDEO_ES,
+                                                           psz_chroma );
+    vlc_fourcc_t i_out_chroma = i_chroma;
+    if( psz_out_chroma != NULL )
+        i_out_chroma = vlc_fourcc_GetCodecFromString( VIDEO_ES,
+                                                      psz_out_chroma );
+    if( i_chroma == 0 || i_out_chroma == 0 )
+    {
+        fprintf( stderr, "unknown chroma\n" );
+        return 77;
+    }
+
+    test_init();
+    alarm( 0 );
+
+    const char *vlc_argv[] = {
+        "--ignore-config", "-q", "--video-filter-threads", psz_threads,
+    };
+    libvlc_instance_t *vlc = libvlc_new( sizeof (vlc_argv)
+                                         / sizeof (vlc_argv[0]), vlc_argv );
+    assert( vlc != NULL );
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+
+    video_format_t fmt, fmt_out;
+    video_format_Init( &fmt, i_chroma );
+    video_format_Setup( &fmt, i_chroma, i_width, i_height,
+                        i_width, i_height, 1, 1 );
+    fmt.i_frame_rate = 25;
+    fmt.i_frame_rate_base = 1;
+    fmt_out = fmt;
+    fmt_out.i_chroma = i_out_chroma;
+
+    /* Input pictures */
+    picture_t *p_image = NULL;
+    if( psz_image != NULL )
+    {
+        video_format_t fmt_image;
+        char *url = vlc_path2uri( psz_image, NULL );
+        image_handler_t *handler = image_HandlerCreate( obj );
+
+        video_format_Init( &fmt_image, 0 );
+        if( url != NULL && handler != NULL )
+            p_image = image_ReadUrl( handler, url, &fmt_image, &fmt );
+        if( handler != NULL )
+            image_HandlerDelete( handler );
+        free( url );
+        if( p_image == NULL )
+        {
+            log( "cannot read %s\n", psz_image );
+            libvlc_release( vlc );
+            return 77;
+        }
+    }
+
+    picture_pool_t *pool = picture_pool_NewFromFormat( &fmt, POOL_SIZE );
+    assert( pool != NULL );
+    {
+        picture_t *pics[POOL_SIZE];
+
+        rnd_state = 0x12345678;
+        for( unsigned i = 0; i < POOL_SIZE; i++ )
+        {
+            pics[i] = picture_pool_Get( pool );
+            assert( pics[i] != NULL );
+            if( p_image != NULL )
+                picture_CopyPixels( pics[i], p_image );
+            else
+                FillSynthetic( pics[i], i );
+        }
+        for( unsigned i = 0; i < POOL_SIZE; i++ )
+            picture_Release( pics[i] );
+    }
+    if( p_image != NULL )
+        picture_Release( p_image );
+
+    /* Filters */
+    struct bench bench = { NULL, NULL };
+    if( psz_out_chroma != NULL )
+    {
+        bench.converter = ConverterNew( obj, psz_chain, &fmt, &fmt_out );
+        if( bench.converter == NULL )
+        {
+            log( "no %s converter from %4.4s to %4.4s\n", psz_chain,
+                 (const char *)&i_chroma, (const char *)&i_out_chroma );
+            picture_pool_Release( pool );
+            libvlc_release( vlc );
+            return 77;
+        }
+    }
+    else
+    {
+        filter_owner_t owner = {
+            .video = {
+                .buffer_new = BufferNew,
+            },
+        };
+        es_format_t es_fmt;
+
+        bench.chain = filter_chain_NewVideo( obj, true, &owner );
+        assert( bench.chain != NULL );
+        es_format_InitFromVideo( &es_fmt, &fmt );
+        filter_chain_Reset( bench.chain, &es_fmt, &es_fmt );
+        es_format_Clean( &es_fmt );
+
+        if( filter_chain_AppendFromString( bench.chain, psz_chain ) <= 0 )
+        {
+            log( "cannot create the filter chain \"%s\"\n", psz_chain );
+            filter_chain_Delete( bench.chain );
+            picture_pool_Release( pool );
+            libvlc_release( vlc );
+            return 77;
+        }
+    }
+
+    /* Run */
+    struct plane_stats stats_in[PICTURE_PLANE_MAX];
+    struct plane_stats stats_out[PICTURE_PLANE_MAX];
+    int i_planes_in = 0, i_planes_out = 0;
+    unsigned i_frames_out = 0;
+    mtime_t elapsed = 0, min = INT64_MAX, max = 0;
+    mtime_t date = VLC_TS_0;
+
+    for( unsigned i = 0; i < i_warmup + i_frames; i++ )
+    {
+        picture_t *pic = picture_pool_Get( pool );
+        if( pic == NULL )
+        {
+            log( "the filters hold too many pictures\n" );
+            break;
+        }
+        pic->date = date;
+        pic->b_progressive = false;
+        pic->b_top_field_first = true;
+        pic->i_nb_fields = 2;
+        date += CLOCK_FREQ / 25;
+
+        if( i_planes_in == 0 )
+        {
+            PlaneBytes( pic, stats_in );
+            i_planes_in = pic->i_planes;
+        }
+
+        mtime_t start = mdate();
+        picture_t *out = BenchFilter( &bench, pic );
+        mtime_t duration = mdate() - start;
+
+        if( i >= i_warmup )
+        {
+            elapsed += duration;
+            if( duration < min )
+                min = duration;
+            if( duration > max )
+                max = duration;
+        }
+
+        while( out != NULL )
+        {
+            picture_t *next = out->p_next;
+
+            out->p_next = NULL;
+            if( i_planes_out == 0 )
+            {
+                PlaneBytes( out, stats_out );
+                i_planes_out = out->i_planes;
+                fmt_out = out->format;
+            }
+            if( i >= i_warmup )
+                i_frames_out++;
+            picture_Release( out );
+            out = next;
+        }
+    }
+
+    if( bench.converter != NULL )
+        ConverterDelete( bench.converter );
+    else
+        filter_chain_Delete( bench.chain );
+    picture_pool_Release( pool );
+
+    if( elapsed <= 0 )
+        elapsed = 1;
+    if( min == INT64_MAX )
+        min = 0;
+
+    const uint64_t i_ns = elapsed * 1000 / i_frames;
+    const uint64_t i_fps = (uint64_t)i_frames * CLOCK_FREQ / elapsed;
+    const uint64_t i_pixels = (uint64_t)i_width * i_height * i_frames
+                            * CLOCK_FREQ / elapsed;
+
+    if( json )
+    {
+        printf( "{\"chain\": " );
+        PrintJSONString( psz_chain );
+        printf( ", \"threads\": " );
+        PrintJSONString( psz_threads );
+        printf( ", \"converter\": %s, "
+                "\"chroma\": \"%4.4s\", \"out_chroma\": \"%4.4s\", "
+                "\"width\": %u, \"height\": %u, "
+                "\"frames\": %u, \"frames_out\": %u, "
+                "\"ns_per_frame\": %"PRIu64", \"ns_min\": %"PRId64", "
+                "\"ns_max\": %"PRId64", \"frames_per_s\": %"PRIu64", "
+                "\"pixels_per_s\": %"PRIu64,
+                bench.converter != NULL ? "true" : "false",
+                (const char *)&i_chroma, (const char *)&fmt_out.i_chroma,
+                i_width, i_height, i_frames, i_frames_out,
+                i_ns, min * 1000, max * 1000, i_fps, i_pixels );
+        PrintPlanes( true, "planes_in", stats_in, i_planes_in,
+                     i_frames, elapsed );
+        PrintPlanes( true, "planes_out", stats_out, i_planes_out,
+                     i_frames_out, elapsed );
+        printf( "}\n" );
+    }
+    else
+    {
+        printf( "%s: %4.4s %ux%u -> %4.4s, %u frames in, %u frames out\n",
+                psz_chain, (const char *)&i_chroma, i_width, i_height,
+                (const char *)&fmt_out.i_chroma, i_frames, i_frames_out );
+        printf( "  %"PRIu64" ns/frame (min %"PRId64", max %"PRId64"), "
+                "%"PRIu64" frames/s, %"PRIu64" Mpixels/s\n", i_ns,
+                min * 1000, max * 1000, i_fps, i_pixels / 1000000 );
+        PrintPlanes( false, "input", stats_in, i_planes_in,
+                     i_frames, elapsed );
+        PrintPlanes( false, "output", stats_out, i_planes_out,
+                     i_frames_out, elapsed );
+    }
+
+    libvlc_release( vlc );
+    return 0;
+}
@@ -0,0 +1,223 @@
+/*****************************************************************************
+ * httpd_bench.c: HTTP server stream fan-out benchmark
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Usage: test_src_network_httpd_bench [clients [threads [seconds [Mbit/s]]]]
+ *
+ * Serves a looped synthetic stream through httpd_stream_t and connects N
+ * local clients to it. Reports the aggregate throughput, the time to first
+ * byte and the distribution of the gaps between successive reads. */
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_httpd.h>
+#include <vlc_block.h>
+#include <vlc_atomic.h>
+
+#include <string.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define BENCH_PORT   18080
+#define BENCH_URL    "/bench"
+#define CHUNK_SIZE   (7 * 188)
+/* Gap histogram: 100 us resolution up to 10 s */
+#define HIST_STEP    100
+#define HIST_SIZE    100000
+
+struct bench_client
+{
+    vlc_thread_t thread;
+    uint64_t     bytes;
+    mtime_t      first_byte;
+    unsigned     *hist;
+};
+
+static atomic_bool stop;
+
+static void *ClientThread( void *data )
+{
+    struct bench_client *c = data;
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons( BENCH_PORT ),
+        .sin_addr.s_addr = htonl( INADDR_LOOPBACK ),
+    };
+    static const char req[] = "GET " BENCH_URL " HTTP/1.0\r\n\r\n";
+    char buf[65536];
+
+    int fd = socket( AF_INET, SOCK_STREAM, 0 );
+    assert( fd != -1 );
+    setsockopt( fd, SOL_SOCKET, SO_RCVTIMEO,
+                &(struct timeval){ .tv_sec = 1 }, sizeof (struct timeval) );
+
+    mtime_t start = mdate();
+    if( connect( fd, (struct sockaddr *)&addr, sizeof (addr) )
+     || send( fd, req, strlen( req ), 0 ) != (ssize_t)strlen( req ) )
+    {
+        log( "client connection failed: %s\n", strerror( errno ) );
+        close( fd );
+        return NULL;
+    }
+
+    mtime_t last = 0;
+    while( !atomic_load( &stop ) )
+    {
+        ssize_t val = recv( fd, buf, sizeof (buf), 0 );
+        mtime_t now = mdate();
+
+        if( val < 0 && errno == EAGAIN )
+            continue;
+        if( val <= 0 )
+            break;
+
+        if( last == 0 )
+            c->first_byte = now - start;
+        else
+        {
+            mtime_t gap = (now - last) / HIST_STEP;
+            c->hist[gap < HIST_SIZE ? gap : HIST_SIZE - 1]++;
+        }
+        last = now;
+        c->bytes += val;
+    }
+    close( fd );
+    return NULL;
+}
+
+static mtime_t Percentile( const unsigned *hist, uint64_t total, double p )
+{
+    uint64_t rank = total * p, sum = 0;
+
+    for( unsigned i = 0; i < HIST_SIZE; i++ )
+    {
+        sum += hist[i];
+        if( sum > rank )
+            return (mtime_t)i * HIST_STEP;
+    }
+    return (mtime_t)HIST_SIZE * HIST_STEP;
+}
+
+int main( int argc, char *argv[] )
+{
+    unsigned clients = (argc > 1) ? atoi( argv[1] ) : 100;
+    const char *threads = (argc > 2) ? argv[2] : "1";
+    unsigned seconds = (argc > 3) ? atoi( argv[3] ) : 10;
+    unsigned mbps = (argc > 4) ? atoi( argv[4] ) : 8;
+    char threads_arg[32];
+
+    test_init();
+    alarm( 0 );
+
+    snprintf( threads_arg, sizeof (threads_arg), "--http-threads=%s",
+              threads );
+    const char *vlc_argv[] = {
+        "--ignore-config", "--http-host=127.0.0.1",
+        "--http-port=18080", threads_arg,
+    };
+    libvlc_instance_t *vlc = libvlc_new( sizeof (vlc_argv)
+                                         / sizeof (vlc_argv[0]), vlc_argv );
+    assert( vlc != NULL );
+
+    httpd_host_t *host = vlc_http_HostNew( VLC_OBJECT(vlc->p_libvlc_int) );
+    assert( host != NULL );
+    httpd_stream_t *stream = httpd_StreamNew( host, BENCH_URL,
+                                              "video/mp2t", NULL, NULL );
+    assert( stream != NULL );
+
+    struct bench_client *tab = calloc( clients, sizeof (*tab) );
+    assert( tab != NULL );
+    atomic_init( &stop, false );
+    for( unsigned i = 0; i < clients; i++ )
+    {
+        tab[i].hist = calloc( HIST_SIZE, sizeof (unsigned) );
+        assert( tab[i].hist != NULL );
+        assert( !vlc_clone( &tab[i].thread, ClientThread, &tab[i],
+                            VLC_THREAD_PRIORITY_LOW ) );
+    }
+
+    /* Feed the looped stream at the requested bit rate */
+    uint8_t payload[CHUNK_SIZE];
+    for( unsigned i = 0; i < CHUNK_SIZE; i++ )
+        payload[i] = (i % 188) ? i : 0x47;
+
+    const mtime_t period = CLOCK_FREQ * CHUNK_SIZE * 8 / (mbps * 1000000);
+    mtime_t start = mdate(), deadline = start;
+    uint64_t sent = 0;
+
+    while( deadline < start + seconds * CLOCK_FREQ )
+    {
+        block_t *block = block_Alloc( CHUNK_SIZE );
+        assert( block != NULL );
+        memcpy( block->p_buffer, payload, CHUNK_SIZE );
+
+        httpd_StreamSend( stream, block );
+        block_Release( block );
+        sent += CHUNK_SIZE;
+        deadline += period;
+        mwait( deadline );
+    }
+    mtime_t elapsed = mdate() - start;
+
+    atomic_store( &stop, true );
+
+    uint64_t bytes = 0, count = 0;
+    mtime_t ttfb_max = 0;
+    unsigned *hist = calloc( HIST_SIZE, sizeof (unsigned) );
+    assert( hist != NULL );
+
+    for( unsigned i = 0; i < clients; i++ )
+    {
+        vlc_join( tab[i].thread, NULL );
+        bytes += tab[i].bytes;
+        if( tab[i].first_byte > ttfb_max )
+            ttfb_max = tab[i].first_byte;
+        for( unsigned j = 0; j < HIST_SIZE; j++ )
+        {
+            hist[j] += tab[i].hist[j];
+            count += tab[i].hist[j];
+        }
+        free( tab[i].hist );
+    }
+    free( tab );
+
+    printf( "clients=%u threads=%s seconds=%.2f\n", clients, threads,
+            (double)elapsed / CLOCK_FREQ );
+    printf( "source_mbps=%.2f delivered_mbps=%.2f delivery_ratio=%.3f\n",
+            (double)sent * 8 / elapsed,
+            (double)bytes * 8 / elapsed,
+            (double)bytes / ((double)sent * clients) );
+    const mtime_t p50 = Percentile( hist, count, 0.5 );
+    const mtime_t p99 = Percentile( hist, count, 0.99 );
+    const mtime_t p999 = Percentile( hist, count, 0.999 );
+
+    printf( "ttfb_max_ms=%.1f\n", (double)ttfb_max / 1000 );
+    printf( "read_gap_ms p50=%.1f p99=%.1f p999=%.1f\n",
+            (double)p50 / 1000, (double)p99 / 1000, (double)p999 / 1000 );
+    free( hist );
+
+    httpd_StreamDelete( stream );
+    httpd_HostDelete( host );
+    libvlc_release( vlc );
+    return 0;
+}